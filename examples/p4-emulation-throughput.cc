@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+/**
+ * Real-time emulation throughput benchmark.
+ *
+ * Runs one V1Model switch in emulation mode (worker threads, real-time
+ * simulator) between two hosts and offers UDP traffic in steps of increasing
+ * packet rate. For every step the packets received by the sink are counted
+ * against the wall clock, together with the largest lag of the simulator
+ * behind the wall clock. The sustainable rate is the highest step that is
+ * delivered without loss while the simulator keeps up, e.g.
+ *
+ *   ./ns3 run "p4-emulation-throughput --startPps=10000 --stepPps=10000 --steps=10"
+ *
+ * Columns: offered_pps, received_pps, loss_ratio, max_lag_us
+ */
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/csma-helper.h"
+#include "ns3/format-utils.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/p4-helper.h"
+#include "ns3/p4-switch-net-device.h"
+#include "ns3/realtime-simulator-impl.h"
+
+#include <chrono>
+#include <fstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P4EmulationThroughput");
+
+namespace
+{
+
+uint64_t g_rxPackets = 0; //!< Packets received by the sink so far
+int64_t g_maxLagNs = 0;   //!< Largest lag of the simulator in the current step
+
+/**
+ * Result of one offered rate
+ */
+struct Step
+{
+    uint64_t offeredPps{0}; //!< Offered packet rate
+    uint64_t rxStart{0};    //!< Packets received when the step started
+    uint64_t rxEnd{0};      //!< Packets received when the step ended
+    std::chrono::steady_clock::time_point wallStart; //!< Wall clock at start
+    std::chrono::steady_clock::time_point wallEnd;   //!< Wall clock at end
+    int64_t maxLagNs{0};                             //!< Largest lag in the step
+};
+
+void
+RxCallback(Ptr<const Packet> packet, const Address& addr)
+{
+    g_rxPackets++;
+}
+
+// Sample how far the simulator runs behind the wall clock
+void
+SampleLag(Ptr<RealtimeSimulatorImpl> realtime, Time interval)
+{
+    int64_t lag = (realtime->RealtimeNow() - Simulator::Now()).GetNanoSeconds();
+    g_maxLagNs = std::max(g_maxLagNs, lag);
+    Simulator::Schedule(interval, &SampleLag, realtime, interval);
+}
+
+void
+StartStep(Step* step)
+{
+    step->rxStart = g_rxPackets;
+    step->wallStart = std::chrono::steady_clock::now();
+    g_maxLagNs = 0;
+}
+
+void
+EndStep(Step* step)
+{
+    step->rxEnd = g_rxPackets;
+    step->wallEnd = std::chrono::steady_clock::now();
+    step->maxLagNs = g_maxLagNs;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    LogComponentEnable("P4EmulationThroughput", LOG_LEVEL_INFO);
+
+    uint32_t pktSize = 64;       ///< UDP payload size (bytes).
+    uint64_t startPps = 10000;   ///< Offered rate of the first step.
+    uint64_t stepPps = 10000;    ///< Offered rate added per step.
+    uint32_t steps = 10;         ///< Number of steps.
+    double stepDuration = 2.0;   ///< Duration of one step (s).
+    uint32_t egressThreads = 4;  ///< Egress threads of the switch.
+    std::string cpus = "";       ///< CPU affinity of the switch threads.
+    uint64_t switchRate = 10000000; ///< Egress rate limit of the switch (pps).
+    std::string outFile = "p4-emulation-throughput.csv"; ///< CSV output file.
+
+    std::string p4SrcDir = GetP4ExamplePath() + "/simple_v1model";
+    std::string p4JsonPath = p4SrcDir + "/simple_v1model.json";
+    std::string flowTablePath = p4SrcDir + "/flowtable_0.txt";
+
+    CommandLine cmd;
+    cmd.AddValue("pktSize", "UDP payload size in bytes (default 64)", pktSize);
+    cmd.AddValue("startPps", "Offered rate of the first step (default 10000)", startPps);
+    cmd.AddValue("stepPps", "Offered rate added per step (default 10000)", stepPps);
+    cmd.AddValue("steps", "Number of steps (default 10)", steps);
+    cmd.AddValue("stepDuration", "Duration of one step in seconds (default 2)", stepDuration);
+    cmd.AddValue("egressThreads", "Egress threads of the switch (default 4)", egressThreads);
+    cmd.AddValue("cpus", "CPUs the switch threads are pinned to, e.g. 2,3,4,5,6", cpus);
+    cmd.AddValue("switchRate", "Egress rate limit of the switch in pps", switchRate);
+    cmd.AddValue("out", "CSV output file (default p4-emulation-throughput.csv)", outFile);
+    cmd.Parse(argc, argv);
+
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    GlobalValue::Bind("ChecksumEnabled", BooleanValue(false));
+    Ptr<RealtimeSimulatorImpl> realtime =
+        DynamicCast<RealtimeSimulatorImpl>(Simulator::GetImplementation());
+
+    // h0 -- s0 -- h1, the devices are created in the order the flow table expects
+    NodeContainer hosts;
+    hosts.Create(2);
+    Ptr<Node> switchNode = CreateObject<Node>();
+
+    CsmaHelper csma;
+    csma.SetChannelAttribute("DataRate", StringValue("100Gbps"));
+    csma.SetChannelAttribute("Delay", TimeValue(MicroSeconds(1)));
+
+    NetDeviceContainer hostDevices;
+    NetDeviceContainer switchDevices;
+    for (uint32_t i = 0; i < hosts.GetN(); i++)
+    {
+        NetDeviceContainer link = csma.Install(NodeContainer(hosts.Get(i), switchNode));
+        hostDevices.Add(link.Get(0));
+        switchDevices.Add(link.Get(1));
+    }
+
+    InternetStackHelper internet;
+    internet.Install(hosts);
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = ipv4.Assign(hostDevices);
+
+    P4Helper p4Helper;
+    p4Helper.SetDeviceAttribute("JsonPath", StringValue(p4JsonPath));
+    p4Helper.SetDeviceAttribute("FlowTablePath", StringValue(flowTablePath));
+    p4Helper.SetDeviceAttribute("ChannelType", UintegerValue(P4CHANNELCSMA));
+    p4Helper.SetDeviceAttribute("P4SwitchArch", UintegerValue(P4SWITCH_ARCH_V1MODEL));
+    p4Helper.SetDeviceAttribute("SwitchRate", UintegerValue(switchRate));
+    p4Helper.SetDeviceAttribute("EmulationMode", BooleanValue(true));
+    p4Helper.SetDeviceAttribute("EmulationEgressThreads", UintegerValue(egressThreads));
+    p4Helper.SetDeviceAttribute("EmulationCpuAffinity", StringValue(cpus));
+    p4Helper.Install(switchNode, switchDevices);
+
+    uint16_t port = 9093;
+    InetSocketAddress dst(interfaces.GetAddress(1), port);
+    PacketSinkHelper sink("ns3::UdpSocketFactory", dst);
+    ApplicationContainer sinkApp = sink.Install(hosts.Get(1));
+    sinkApp.Start(Seconds(0.5));
+    sinkApp.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&RxCallback));
+
+    // one constant-rate flow per step, separated by a short drain gap
+    std::vector<Step> results(steps);
+    double gap = 0.2;
+    double t = 1.0;
+    for (uint32_t i = 0; i < steps; i++)
+    {
+        uint64_t pps = startPps + i * stepPps;
+        results[i].offeredPps = pps;
+
+        OnOffHelper onOff("ns3::UdpSocketFactory", dst);
+        onOff.SetAttribute("PacketSize", UintegerValue(pktSize));
+        onOff.SetAttribute("DataRate", DataRateValue(DataRate(pps * pktSize * 8)));
+        onOff.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+        onOff.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
+        ApplicationContainer app = onOff.Install(hosts.Get(0));
+        app.Start(Seconds(t));
+        app.Stop(Seconds(t + stepDuration));
+
+        Simulator::Schedule(Seconds(t), &StartStep, &results[i]);
+        Simulator::Schedule(Seconds(t + stepDuration + gap), &EndStep, &results[i]);
+        t += stepDuration + 2 * gap;
+    }
+    Simulator::Schedule(Seconds(1.0), &SampleLag, realtime, MilliSeconds(1));
+
+    NS_LOG_INFO("Running " << steps << " steps in real time, about " << t << " s");
+    Simulator::Stop(Seconds(t));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    std::ofstream csv(outFile);
+    if (!csv.is_open())
+    {
+        NS_LOG_ERROR("Cannot open output file " << outFile);
+        return -1;
+    }
+    csv << "offered_pps,received_pps,loss_ratio,max_lag_us" << std::endl;
+
+    uint64_t sustainable = 0;
+    for (const Step& step : results)
+    {
+        double wall = std::chrono::duration<double>(step.wallEnd - step.wallStart).count();
+        uint64_t received = step.rxEnd - step.rxStart;
+        uint64_t offered = static_cast<uint64_t>(step.offeredPps * stepDuration);
+        // packets counted against the wall clock, the drain gap included
+        double receivedPps = (wall > 0) ? received / wall : 0;
+        double loss = (offered > 0 && received < offered) ? 1.0 - double(received) / offered : 0;
+        csv << step.offeredPps << "," << receivedPps << "," << loss << ","
+            << step.maxLagNs / 1000 << std::endl;
+        NS_LOG_INFO("offered=" << step.offeredPps << "pps received=" << receivedPps
+                               << "pps loss=" << loss << " lag=" << step.maxLagNs / 1000
+                               << "us");
+        // sustainable: no loss and the simulator stayed within 1 ms of the wall clock
+        if (loss < 0.001 && step.maxLagNs < 1000000)
+        {
+            sustainable = step.offeredPps;
+        }
+    }
+
+    NS_LOG_INFO("Sustainable rate: " << sustainable << " pps, results written to " << outFile);
+    return 0;
+}
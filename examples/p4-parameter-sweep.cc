@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+/**
+ * Parallel parameter sweep over a fat-tree of V1Model switches.
+ *
+ * The fat-tree topology file and the flow tables of all switches are generated
+ * once, before the sweep, and shared by every run. P4SweepRunner then runs the
+ * points in worker processes, one per core by default, sweeping the switch
+ * rate, the switch queue buffer and the offered load, and collects one summary
+ * row per run, e.g.
+ *
+ *   ./ns3 run "p4-parameter-sweep --workers=8 --repetitions=3"
+ *
+ * Summary columns: index, seed, run, SwitchRate, QueueBufferSize, appDataRate,
+ * status, rxPackets, rxBytes, wallMs
+ */
+
+#include "ns3/applications-module.h"
+#include "ns3/build-flowtable-helper.h"
+#include "ns3/core-module.h"
+#include "ns3/csma-helper.h"
+#include "ns3/fattree-topo-helper.h"
+#include "ns3/format-utils.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/p4-helper.h"
+#include "ns3/p4-sweep-runner.h"
+#include "ns3/p4-switch-net-device.h"
+#include "ns3/p4-topology-reader-helper.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P4ParameterSweep");
+
+namespace
+{
+
+/**
+ * Split a comma separated list
+ */
+std::vector<std::string>
+SplitList(const std::string& list)
+{
+    std::vector<std::string> values;
+    std::stringstream ss(list);
+    std::string value;
+    while (std::getline(ss, value, ','))
+    {
+        if (!value.empty())
+        {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+/**
+ * Generate the flow tables of the fat-tree from the topology file alone.
+ *
+ * The ports are numbered in link order and hosts get consecutive addresses
+ * from 10.1.0.1, exactly as RunPoint builds the network, so the tables match
+ * without building ns-3 nodes in the parent process.
+ */
+bool
+WriteFlowTables(const std::string& topoFile, unsigned int podNum, const std::string& outDir)
+{
+    std::ifstream in(topoFile);
+    unsigned int switchNum = 0;
+    unsigned int hostNum = 0;
+    unsigned int linkNum = 0;
+    if (!(in >> switchNum >> hostNum >> linkNum))
+    {
+        NS_LOG_ERROR("Cannot read topology " << topoFile);
+        return false;
+    }
+
+    std::vector<std::vector<std::string>> switchPortInfo(switchNum);
+    std::vector<unsigned int> linkSwitchIndex(hostNum);
+    std::vector<unsigned int> linkSwitchPort(hostNum);
+    for (unsigned int i = 0; i < linkNum; i++)
+    {
+        unsigned int from;
+        unsigned int to;
+        char fromType;
+        char toType;
+        std::string dataRate;
+        std::string delay;
+        in >> from >> fromType >> to >> toType >> dataRate >> delay;
+        if (fromType == 's' && toType == 's')
+        {
+            unsigned int fromPort = switchPortInfo[from].size();
+            unsigned int toPort = switchPortInfo[to].size();
+            switchPortInfo[from].push_back("s" + std::to_string(to) + "_" +
+                                           std::to_string(toPort));
+            switchPortInfo[to].push_back("s" + std::to_string(from) + "_" +
+                                         std::to_string(fromPort));
+        }
+        else
+        {
+            unsigned int sw = (fromType == 's') ? from : to;
+            unsigned int host = ((fromType == 's') ? to : from) - switchNum;
+            linkSwitchIndex[host] = sw;
+            linkSwitchPort[host] = switchPortInfo[sw].size();
+            switchPortInfo[sw].push_back("h" + std::to_string(host));
+        }
+    }
+
+    std::vector<std::string> hostIpv4(hostNum);
+    for (unsigned int i = 0; i < hostNum; i++)
+    {
+        hostIpv4[i] = Uint32IpToHex(Ipv4Address("10.1.0.1").Get() + i);
+    }
+
+    BuildFlowtableHelper flowtableHelper("fattree", podNum);
+    flowtableHelper.Build(linkSwitchIndex, linkSwitchPort, hostIpv4, switchPortInfo);
+    flowtableHelper.Write(outDir);
+    return true;
+}
+
+/**
+ * Simulate one point of the sweep
+ */
+int
+RunPoint(const P4SweepRunner::Point& point,
+         P4SweepRunner::Results* results,
+         const std::string& topoFile,
+         const std::string& jsonPath,
+         const std::string& flowTableDir,
+         double duration)
+{
+    unsigned long start = getTickCount();
+
+    P4TopologyReaderHelper p4TopoHelper;
+    p4TopoHelper.SetFileName(topoFile);
+    p4TopoHelper.SetFileType("CsmaTopo");
+    Ptr<P4TopologyReader> topoReader = p4TopoHelper.GetTopologyReader();
+    if (topoReader->LinksSize() == 0)
+    {
+        return 1;
+    }
+    NodeContainer hosts = topoReader->GetHostNodeContainer();
+    NodeContainer switches = topoReader->GetSwitchNodeContainer();
+    unsigned int switchNum = switches.GetN();
+
+    // devices are added in link order, the order WriteFlowTables numbered the ports
+    CsmaHelper csma;
+    std::vector<NetDeviceContainer> switchDevices(switchNum);
+    std::vector<NetDeviceContainer> hostDevices(hosts.GetN());
+    std::string dataRate;
+    std::string delay;
+    for (auto iter = topoReader->LinksBegin(); iter != topoReader->LinksEnd(); iter++)
+    {
+        if (iter->GetAttributeFailSafe("DataRate", dataRate))
+        {
+            csma.SetChannelAttribute("DataRate", DataRateValue(DataRate(dataRate)));
+        }
+        if (iter->GetAttributeFailSafe("Delay", delay))
+        {
+            csma.SetChannelAttribute("Delay", StringValue(delay));
+        }
+        NetDeviceContainer link =
+            csma.Install(NodeContainer(iter->GetFromNode(), iter->GetToNode()));
+        unsigned int ends[2] = {iter->GetFromIndex(), iter->GetToIndex()};
+        char types[2] = {iter->GetFromType(), iter->GetToType()};
+        for (int k = 0; k < 2; k++)
+        {
+            if (types[k] == 's')
+            {
+                switchDevices[ends[k]].Add(link.Get(k));
+            }
+            else
+            {
+                hostDevices[ends[k] - switchNum].Add(link.Get(k));
+            }
+        }
+    }
+
+    InternetStackHelper internet;
+    internet.Install(hosts);
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("10.1.0.0", "255.255.255.0");
+    std::vector<Ipv4InterfaceContainer> hostIpv4(hosts.GetN());
+    for (unsigned int i = 0; i < hosts.GetN(); i++)
+    {
+        hostIpv4[i] = ipv4.Assign(hostDevices[i]);
+    }
+
+    P4Helper p4SwitchHelper;
+    p4SwitchHelper.SetDeviceAttribute("JsonPath", StringValue(jsonPath));
+    p4SwitchHelper.SetDeviceAttribute("ChannelType", UintegerValue(P4CHANNELCSMA));
+    p4SwitchHelper.SetDeviceAttribute("P4SwitchArch", UintegerValue(P4SWITCH_ARCH_V1MODEL));
+    p4SwitchHelper.SetDeviceAttribute("SwitchRate",
+                                      UintegerValue(std::stoull(point.Get("SwitchRate"))));
+    p4SwitchHelper.SetDeviceAttribute("QueueBufferSize",
+                                      UintegerValue(std::stoul(point.Get("QueueBufferSize"))));
+    for (unsigned int i = 0; i < switchNum; i++)
+    {
+        p4SwitchHelper.SetDeviceAttribute(
+            "FlowTablePath",
+            StringValue(flowTableDir + "/flowtable_" + std::to_string(i)));
+        p4SwitchHelper.Install(switches.Get(i), switchDevices[i]);
+    }
+
+    // the first half of the hosts sends to the second half, mirrored
+    ApplicationContainer sinks;
+    unsigned int hostNum = hosts.GetN();
+    for (unsigned int i = 0; i < hostNum / 2; i++)
+    {
+        unsigned int server = hostNum - i - 1;
+        InetSocketAddress dst(hostIpv4[server].GetAddress(0), 9000);
+
+        OnOffHelper onOff("ns3::UdpSocketFactory", dst);
+        onOff.SetAttribute("PacketSize", UintegerValue(1000));
+        onOff.SetAttribute("DataRate", StringValue(point.Get("appDataRate")));
+        onOff.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+        onOff.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
+        ApplicationContainer client = onOff.Install(hosts.Get(i));
+        client.Start(Seconds(2.0));
+        client.Stop(Seconds(2.0 + duration));
+
+        PacketSinkHelper sink("ns3::UdpSocketFactory", dst);
+        sinks.Add(sink.Install(hosts.Get(server)));
+    }
+    sinks.Start(Seconds(1.0));
+
+    Simulator::Stop(Seconds(3.0 + duration));
+    Simulator::Run();
+
+    uint64_t rxBytes = 0;
+    for (uint32_t i = 0; i < sinks.GetN(); i++)
+    {
+        rxBytes += DynamicCast<PacketSink>(sinks.Get(i))->GetTotalRx();
+    }
+    Simulator::Destroy();
+
+    (*results)["rxBytes"] = std::to_string(rxBytes);
+    (*results)["rxPackets"] = std::to_string(rxBytes / 1000);
+    (*results)["wallMs"] = std::to_string(getTickCount() - start);
+    return 0;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    LogComponentEnable("P4ParameterSweep", LOG_LEVEL_INFO);
+    LogComponentEnable("P4SweepRunner", LOG_LEVEL_INFO);
+
+    unsigned int podNum = 4;                         ///< Fat-tree pods.
+    uint32_t workers = 0;                            ///< Worker processes, 0 for one per core.
+    uint32_t repetitions = 1;                        ///< Runs per parameter point.
+    double duration = 1.0;                           ///< Traffic duration per run (s).
+    std::string switchRates = "1000,2000,4000";      ///< Swept SwitchRate values (pps).
+    std::string bufferSizes = "100,1000";            ///< Swept QueueBufferSize values.
+    std::string dataRates = "1Mbps,5Mbps";           ///< Swept offered load per flow.
+    std::string outDir = "p4-parameter-sweep";       ///< Output directory.
+
+    std::string p4JsonPath = GetP4ExamplePath() + "/fat-tree/switch.json";
+
+    CommandLine cmd;
+    cmd.AddValue("podnum", "Number of fat-tree pods (default 4)", podNum);
+    cmd.AddValue("workers", "Worker processes, 0 for one per core (default 0)", workers);
+    cmd.AddValue("repetitions", "Runs per parameter point (default 1)", repetitions);
+    cmd.AddValue("duration", "Traffic duration per run in seconds (default 1)", duration);
+    cmd.AddValue("switchRates", "Comma separated SwitchRate values", switchRates);
+    cmd.AddValue("bufferSizes", "Comma separated QueueBufferSize values", bufferSizes);
+    cmd.AddValue("dataRates", "Comma separated offered loads per flow", dataRates);
+    cmd.AddValue("out", "Output directory (default p4-parameter-sweep)", outDir);
+    cmd.Parse(argc, argv);
+
+    // ===================== shared artifacts, built once =====================
+    std::string artifactDir = outDir + "/artifacts";
+    std::filesystem::create_directories(artifactDir);
+    std::string topoFile = artifactDir + "/topo.txt";
+
+    FattreeTopoHelper treeTopo(podNum, topoFile);
+    treeTopo.SetLinkDataRate("1000Mbps");
+    treeTopo.SetLinkDelay("0.01ms");
+    treeTopo.Write();
+    if (!WriteFlowTables(topoFile, podNum, artifactDir + "/"))
+    {
+        return -1;
+    }
+    NS_LOG_INFO("Topology and flow tables for " << treeTopo.GetSwitchNum() << " switches in "
+                                                << artifactDir);
+
+    // ================================ sweep ================================
+    P4SweepRunner sweep;
+    sweep.AddParameter("SwitchRate", SplitList(switchRates));
+    sweep.AddParameter("QueueBufferSize", SplitList(bufferSizes));
+    sweep.AddParameter("appDataRate", SplitList(dataRates));
+    sweep.SetRepetitions(repetitions);
+    sweep.SetWorkers(workers);
+    sweep.SetPortsPerWorker(treeTopo.GetSwitchNum());
+    sweep.SetOutputDirectory(outDir);
+
+    unsigned long start = getTickCount();
+    int failed = sweep.Run([&](const P4SweepRunner::Point& point, P4SweepRunner::Results* r) {
+        return RunPoint(point, r, topoFile, p4JsonPath, artifactDir, duration);
+    });
+    unsigned long end = getTickCount();
+
+    NS_LOG_INFO(sweep.GetNPoints() << " runs in " << end - start << "ms, " << failed
+                                   << " failed, summary in " << outDir << "/summary.csv");
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+/**
+ * Switch-count scaling benchmark.
+ *
+ * Instantiates idle V1Model switches in steps of `step` up to `maxSwitches`
+ * and records, after every step, the resident memory of the process and the
+ * per-switch memory report of the switches. No traffic is generated. The
+ * result is written as CSV so it can be plotted directly, e.g.
+ *
+ *   ./ns3 run "p4-switch-scaling --maxSwitches=512 --step=32"
+ *
+ * Columns: switches, rss_bytes, rss_per_switch, report_per_switch,
+ *          program_per_switch, init_ms
+ *
+ * The rss columns are only estimates: the allocator keeps freed memory for
+ * reuse, so the growth between two steps is not exactly what they allocated.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/csma-helper.h"
+#include "ns3/format-utils.h"
+#include "ns3/network-module.h"
+#include "ns3/p4-helper.h"
+#include "ns3/p4-switch-net-device.h"
+
+#include <fstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P4SwitchScaling");
+
+int
+main(int argc, char* argv[])
+{
+    LogComponentEnable("P4SwitchScaling", LOG_LEVEL_INFO);
+
+    uint32_t maxSwitches = 256;         ///< Largest number of switches instantiated.
+    uint32_t step = 16;                 ///< Switches added between two samples.
+    uint32_t portsPerSwitch = 2;        ///< CSMA ports attached to each switch.
+    std::string flowTablePath = "";     ///< Optional flow table loaded into every switch.
+    std::string outFile = "p4-switch-scaling.csv"; ///< CSV output file.
+    std::string p4JsonPath = GetP4ExamplePath() + "/simple_v1model/simple_v1model.json";
+
+    CommandLine cmd;
+    cmd.AddValue("maxSwitches", "Largest number of switches (default 256)", maxSwitches);
+    cmd.AddValue("step", "Switches added between two samples (default 16)", step);
+    cmd.AddValue("ports", "CSMA ports per switch (default 2)", portsPerSwitch);
+    cmd.AddValue("jsonPath", "P4 JSON loaded into every switch", p4JsonPath);
+    cmd.AddValue("flowTable",
+                 "Flow table loaded into every switch, empty to keep the tables empty "
+                 "(loading costs about 1 s per switch)",
+                 flowTablePath);
+    cmd.AddValue("out", "CSV output file (default p4-switch-scaling.csv)", outFile);
+    cmd.Parse(argc, argv);
+
+    if (step == 0)
+    {
+        step = 1;
+    }
+
+    std::ofstream csv(outFile);
+    if (!csv.is_open())
+    {
+        NS_LOG_ERROR("Cannot open output file " << outFile);
+        return -1;
+    }
+    csv << "switches,rss_bytes,rss_per_switch,report_per_switch,program_per_switch,init_ms"
+        << std::endl;
+
+    P4Helper p4Helper;
+    p4Helper.SetDeviceAttribute("JsonPath", StringValue(p4JsonPath));
+    p4Helper.SetDeviceAttribute("FlowTablePath", StringValue(flowTablePath));
+    p4Helper.SetDeviceAttribute("ChannelType", UintegerValue(P4CHANNELCSMA));
+    p4Helper.SetDeviceAttribute("P4SwitchArch", UintegerValue(P4SWITCH_ARCH_V1MODEL));
+
+    CsmaHelper csma;
+    std::vector<Ptr<P4SwitchNetDevice>> switches;
+
+    uint64_t baseline = GetResidentBytes();
+    NS_LOG_INFO("Baseline resident memory: " << baseline << " bytes");
+
+    while (switches.size() < maxSwitches)
+    {
+        uint32_t target = std::min<uint32_t>(switches.size() + step, maxSwitches);
+        uint64_t initStart = getTickCount();
+
+        while (switches.size() < target)
+        {
+            Ptr<Node> node = CreateObject<Node>();
+            NetDeviceContainer ports;
+            for (uint32_t p = 0; p < portsPerSwitch; p++)
+            {
+                // one idle CSMA segment per port, looped back onto the switch node
+                ports.Add(csma.Install(NodeContainer(node)).Get(0));
+            }
+            NetDeviceContainer dev = p4Helper.Install(node, ports);
+            Ptr<P4SwitchNetDevice> sw = DynamicCast<P4SwitchNetDevice>(dev.Get(0));
+            // build the switch core now instead of at Simulator::Run
+            node->Initialize();
+            switches.push_back(sw);
+        }
+
+        uint64_t initMs = getTickCount() - initStart;
+        uint64_t rss = GetResidentBytes();
+        uint64_t grown = (rss > baseline) ? rss - baseline : 0;
+
+        uint64_t reportTotal = 0;
+        uint64_t programTotal = 0;
+        for (const auto& sw : switches)
+        {
+            P4SwitchMemoryReport report;
+            if (sw->GetMemoryReport(&report))
+            {
+                reportTotal += report.Total();
+                programTotal += report.programBytes;
+            }
+        }
+
+        uint64_t n = switches.size();
+        csv << n << "," << rss << "," << grown / n << "," << reportTotal / n << ","
+            << programTotal / n << "," << initMs << std::endl;
+        NS_LOG_INFO("switches=" << n << " rss=" << rss << " rss/switch=" << grown / n
+                                << " report/switch=" << reportTotal / n
+                                << " init=" << initMs << "ms");
+    }
+
+    switches.clear();
+    Simulator::Destroy();
+
+    NS_LOG_INFO("Results written to " << outFile);
+    return 0;
+}
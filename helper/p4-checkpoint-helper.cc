@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#include "ns3/p4-checkpoint-helper.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/node-list.h"
+#include "ns3/node.h"
+#include "ns3/p4-state-stream.h"
+#include "ns3/p4-switch-net-device.h"
+#include "ns3/simulator.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("P4CheckpointHelper");
+
+namespace
+{
+const uint32_t CHECKPOINT_MAGIC = 0x4b433450; //!< "P4CK"
+const uint32_t CHECKPOINT_VERSION = 1;        //!< Version of the checkpoint file
+} // namespace
+
+P4CheckpointHelper::P4CheckpointHelper()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+int
+P4CheckpointHelper::Save(const std::string& path) const
+{
+    NS_LOG_FUNCTION(this << path);
+
+    // collect first, the count goes in front of the records
+    P4StateWriter records;
+    uint32_t count = 0;
+    for (auto node = NodeList::Begin(); node != NodeList::End(); ++node)
+    {
+        for (uint32_t i = 0; i < (*node)->GetNDevices(); i++)
+        {
+            Ptr<P4SwitchNetDevice> sw = DynamicCast<P4SwitchNetDevice>((*node)->GetDevice(i));
+            if (!sw)
+            {
+                continue;
+            }
+            std::string state;
+            if (sw->SaveState(&state) != 0)
+            {
+                NS_LOG_WARN("Switch on node " << (*node)->GetId() << " not saved");
+                continue;
+            }
+            records.WriteU32((*node)->GetId());
+            records.WriteU32(i);
+            records.WriteString(state);
+            count++;
+        }
+    }
+
+    P4StateWriter header;
+    header.WriteU32(CHECKPOINT_MAGIC);
+    header.WriteU32(CHECKPOINT_VERSION);
+    header.WriteU64(Simulator::Now().GetNanoSeconds());
+    header.WriteU32(count);
+
+    std::ofstream file(path, std::ios::binary);
+    file << header.GetData() << records.GetData();
+    if (!file.good())
+    {
+        NS_LOG_ERROR("Cannot write checkpoint " << path);
+        return -1;
+    }
+    NS_LOG_INFO("Checkpoint of " << count << " switches at " << Simulator::Now().As(Time::S)
+                                 << " written to " << path);
+    return count;
+}
+
+void
+P4CheckpointHelper::ScheduleSave(Time at, const std::string& path) const
+{
+    NS_LOG_FUNCTION(this << at << path);
+    Simulator::Schedule(at, [path]() { P4CheckpointHelper().Save(path); });
+}
+
+Time
+P4CheckpointHelper::Restore(const std::string& path) const
+{
+    NS_LOG_FUNCTION(this << path);
+    std::ifstream file(path, std::ios::binary);
+    NS_ABORT_MSG_IF(!file.is_open(), "P4CheckpointHelper: cannot open " << path);
+    std::ostringstream content;
+    content << file.rdbuf();
+    std::string data = content.str();
+
+    P4StateReader reader(data);
+    NS_ABORT_MSG_IF(reader.ReadU32() != CHECKPOINT_MAGIC ||
+                        reader.ReadU32() != CHECKPOINT_VERSION,
+                    "P4CheckpointHelper: " << path << " is not a checkpoint file");
+    Time at = NanoSeconds(reader.ReadU64());
+    uint32_t count = reader.ReadU32();
+
+    for (uint32_t k = 0; k < count; k++)
+    {
+        uint32_t nodeId = reader.ReadU32();
+        uint32_t ifIndex = reader.ReadU32();
+        std::string state = reader.ReadString();
+        NS_ABORT_MSG_IF(!reader.IsOk(), "P4CheckpointHelper: " << path << " is truncated");
+
+        Ptr<P4SwitchNetDevice> sw;
+        if (nodeId < NodeList::GetNNodes() && ifIndex < NodeList::GetNode(nodeId)->GetNDevices())
+        {
+            sw = DynamicCast<P4SwitchNetDevice>(NodeList::GetNode(nodeId)->GetDevice(ifIndex));
+        }
+        NS_ABORT_MSG_IF(!sw,
+                        "P4CheckpointHelper: no P4 switch at node " << nodeId << " device "
+                                                                    << ifIndex);
+        sw->SetRestoreState(state);
+    }
+
+    NS_LOG_INFO("Restoring " << count << " switches from the checkpoint taken at "
+                             << at.As(Time::S));
+    return at;
+}
+
+} // namespace ns3
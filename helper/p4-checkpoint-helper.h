@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#ifndef P4_CHECKPOINT_HELPER_H
+#define P4_CHECKPOINT_HELPER_H
+
+#include "ns3/nstime.h"
+
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * \ingroup p4sim
+ * \brief Checkpoints the data-plane state of all P4 switches to skip warm-up.
+ *
+ * A warm-up run saves the state of every P4SwitchNetDevice at a chosen
+ * simulated time into one binary file: table entries, action profiles,
+ * registers, counters, meters, mirroring sessions and multicast groups (see
+ * P4SwitchCore::SaveState). A later run that builds the same topology, with
+ * the same P4 programs, restores that state when the switches are initialized
+ * instead of loading their flow tables, and can start the measured phase
+ * right away.
+ *
+ * Switches are matched by node id and interface index, so the restoring run
+ * must create its nodes and switch devices in the same order. Packets in
+ * flight, queue contents and host state are not checkpointed.
+ *
+ * Usage:
+ * \code
+ *   // warm-up run
+ *   P4CheckpointHelper checkpoint;
+ *   checkpoint.ScheduleSave(Seconds(5), "warm.ckpt");
+ *
+ *   // measurement run, after installing the switches and before Simulator::Run
+ *   P4CheckpointHelper checkpoint;
+ *   Time warmUp = checkpoint.Restore("warm.ckpt");
+ * \endcode
+ */
+class P4CheckpointHelper
+{
+  public:
+    P4CheckpointHelper();
+
+    /**
+     * \brief Save the state of all initialized P4 switches now
+     * \param path the checkpoint file
+     * \return the number of switches saved, -1 on failure
+     */
+    int Save(const std::string& path) const;
+
+    /**
+     * \brief Save the state of all P4 switches at a simulated time
+     * \param at the simulated time of the checkpoint
+     * \param path the checkpoint file
+     */
+    void ScheduleSave(Time at, const std::string& path) const;
+
+    /**
+     * \brief Restore a checkpoint into the P4 switches of this run
+     *
+     * Must be called after the switches are installed and before the
+     * simulation starts. Aborts if the file cannot be read or names a switch
+     * this run does not have.
+     *
+     * \param path the checkpoint file
+     * \return the simulated time the checkpoint was taken at
+     */
+    Time Restore(const std::string& path) const;
+};
+
+} // namespace ns3
+
+#endif /* P4_CHECKPOINT_HELPER_H */
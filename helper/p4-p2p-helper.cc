@@ -299,4 +299,17 @@ P4PointToPointHelper::Install(std::string aName, std::string bName)
     return Install(a, b);
 }
 
+void
+P4PointToPointHelper::AddBackgroundFlow(Ptr<NetDevice> device,
+                                        DataRate rate,
+                                        uint32_t packetSize,
+                                        Time start,
+                                        Time stop)
+{
+    Ptr<CustomP2PNetDevice> dev = DynamicCast<CustomP2PNetDevice>(device);
+    NS_ABORT_MSG_IF(!dev, "Background flows need a CustomP2PNetDevice");
+    NS_ABORT_MSG_IF(dev->AddBackgroundFlow(rate, packetSize, start, stop) < 0,
+                    "Invalid background flow on " << device);
+}
+
 } // namespace ns3
@@ -19,8 +19,10 @@
 #ifndef P4_POINT_TO_POINT_HELPER_H
 #define P4_POINT_TO_POINT_HELPER_H
 
+#include "ns3/data-rate.h"
 #include "ns3/net-device-container.h"
 #include "ns3/node-container.h"
+#include "ns3/nstime.h"
 #include "ns3/object-factory.h"
 #include "ns3/trace-helper.h"
 
@@ -155,6 +157,27 @@ class P4PointToPointHelper : public PcapHelperForDevice, public AsciiTraceHelper
      */
     NetDeviceContainer Install(std::string aNode, std::string bNode);
 
+    /**
+     * \brief Declare a background flow on a link created by this helper
+     *
+     * The flow is modeled as a fluid on the direction leaving the given
+     * device: it costs no events, reserves its rate on the link and delays
+     * the packets simulated on that direction by the resulting queueing.
+     *
+     * \param device the CustomP2PNetDevice the flow leaves through
+     * \param rate the rate of the flow
+     * \param packetSize the mean packet size of the flow, in bytes
+     * \param start the simulation time at which the flow starts
+     * \param stop the simulation time at which the flow stops
+     *
+     * \see CustomP2PNetDevice::AddBackgroundFlow
+     */
+    void AddBackgroundFlow(Ptr<NetDevice> device,
+                           DataRate rate,
+                           uint32_t packetSize = 1500,
+                           Time start = Seconds(0),
+                           Time stop = Time::Max());
+
   private:
     /**
      * \brief Enable pcap output the indicated net device.
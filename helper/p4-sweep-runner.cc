@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#include "ns3/p4-sweep-runner.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/p4-switch-core.h"
+#include "ns3/rng-seed-manager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("P4SweepRunner");
+
+namespace
+{
+const char* RESULT_FILE = "result.txt"; //!< Results of a point, inside its directory
+const int THRIFT_PORT_BASE = 9090;      //!< First thrift port of worker 0
+
+/**
+ * \brief Escape the backslashes and line breaks of a name or value of the
+ * result file
+ * \param value the name or value
+ * \return the value on one line
+ */
+std::string
+EscapeResult(const std::string& value)
+{
+    std::string escaped;
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\r':
+            escaped += "\\r";
+            break;
+        default:
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/**
+ * \brief Undo EscapeResult
+ * \param escaped the value as read from the result file
+ * \return the value
+ */
+std::string
+UnescapeResult(const std::string& escaped)
+{
+    std::string value;
+    for (size_t i = 0; i < escaped.size(); i++)
+    {
+        if (escaped[i] == '\\' && i + 1 < escaped.size())
+        {
+            char c = escaped[++i];
+            value += (c == 'n') ? '\n' : (c == 'r') ? '\r' : c;
+        }
+        else
+        {
+            value += escaped[i];
+        }
+    }
+    return value;
+}
+
+/**
+ * \brief Quote a field of the summary if it holds a separator, a quote or a
+ * line break, as in RFC 4180
+ * \param field the field
+ * \return the field as written to the summary
+ */
+std::string
+CsvField(const std::string& field)
+{
+    if (field.find_first_of(",\"\r\n") == std::string::npos)
+    {
+        return field;
+    }
+    std::string quoted = "\"";
+    for (char c : field)
+    {
+        if (c == '"')
+        {
+            quoted += '"';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+} // namespace
+
+std::string
+P4SweepRunner::Point::Get(const std::string& name) const
+{
+    for (const auto& value : values)
+    {
+        if (value.first == name)
+        {
+            return value.second;
+        }
+    }
+    return "";
+}
+
+P4SweepRunner::P4SweepRunner()
+    : m_repetitions(1),
+      m_seed(1),
+      m_workers(0),
+      m_portsPerWorker(100),
+      m_outputDirectory("sweep")
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+P4SweepRunner::AddParameter(const std::string& name, const std::vector<std::string>& values)
+{
+    NS_LOG_FUNCTION(this << name << values.size());
+    NS_ABORT_MSG_IF(values.empty(), "P4SweepRunner: parameter " << name << " has no values");
+    m_parameters.emplace_back(name, values);
+}
+
+void
+P4SweepRunner::SetRepetitions(uint32_t repetitions)
+{
+    m_repetitions = std::max<uint32_t>(repetitions, 1);
+}
+
+void
+P4SweepRunner::SetSeed(uint32_t seed)
+{
+    m_seed = seed;
+}
+
+void
+P4SweepRunner::SetWorkers(uint32_t workers)
+{
+    m_workers = workers;
+}
+
+void
+P4SweepRunner::SetPortsPerWorker(uint32_t ports)
+{
+    m_portsPerWorker = std::max<uint32_t>(ports, 1);
+}
+
+void
+P4SweepRunner::SetOutputDirectory(const std::string& directory)
+{
+    m_outputDirectory = directory;
+}
+
+void
+P4SweepRunner::SetSummaryFile(const std::string& path)
+{
+    m_summaryFile = path;
+}
+
+uint32_t
+P4SweepRunner::GetNPoints() const
+{
+    uint32_t n = m_repetitions;
+    for (const auto& parameter : m_parameters)
+    {
+        n *= parameter.second.size();
+    }
+    return n;
+}
+
+P4SweepRunner::Point
+P4SweepRunner::GetPoint(uint32_t index) const
+{
+    NS_ASSERT(index < GetNPoints());
+    Point point;
+    point.index = index;
+    point.seed = m_seed;
+    point.run = index % m_repetitions + 1;
+    point.worker = 0;
+
+    // the first parameter varies slowest, repetitions fastest
+    uint32_t rest = index / m_repetitions;
+    point.values.resize(m_parameters.size());
+    for (size_t i = m_parameters.size(); i-- > 0;)
+    {
+        const auto& parameter = m_parameters[i];
+        point.values[i] = {parameter.first, parameter.second[rest % parameter.second.size()]};
+        rest /= parameter.second.size();
+    }
+
+    point.outputPath = m_outputDirectory + "/point-" + std::to_string(index);
+    return point;
+}
+
+int
+P4SweepRunner::Run(RunFunction run)
+{
+    NS_LOG_FUNCTION(this);
+    uint32_t nPoints = GetNPoints();
+    uint32_t workers = m_workers;
+    if (workers == 0)
+    {
+        workers = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_outputDirectory, ec);
+    if (ec)
+    {
+        NS_LOG_ERROR("Cannot create output directory " << m_outputDirectory << ": "
+                                                       << ec.message());
+        return -1;
+    }
+
+    NS_LOG_INFO("Sweep of " << nPoints << " points on " << workers << " workers");
+
+    // points that never ran keep -1
+    std::vector<int> status(nPoints, -1);
+    bool aborted = false;
+    std::map<pid_t, std::pair<uint32_t, uint32_t>> running; // pid -> point, worker slot
+    std::vector<bool> slotBusy(workers, false);
+    uint32_t next = 0;
+    while (next < nPoints || !running.empty())
+    {
+        if (next < nPoints && running.size() < workers)
+        {
+            Point point = GetPoint(next);
+            point.worker = std::find(slotBusy.begin(), slotBusy.end(), false) - slotBusy.begin();
+            // buffered output would otherwise be written by the worker as well
+            std::cout.flush();
+            std::fflush(nullptr);
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                P4SwitchCore::SetThriftPortBase(THRIFT_PORT_BASE +
+                                                point.worker * m_portsPerWorker);
+                _exit(RunPoint(run, point));
+            }
+            if (pid < 0)
+            {
+                NS_LOG_ERROR("Cannot fork worker for point " << next);
+                if (running.empty())
+                {
+                    // no worker left to wait for, a later fork would fail as well
+                    aborted = true;
+                    break;
+                }
+            }
+            else
+            {
+                slotBusy[point.worker] = true;
+                running[pid] = {next++, point.worker};
+                continue;
+            }
+        }
+
+        int wstatus = 0;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if (pid < 0)
+        {
+            NS_LOG_ERROR("waitpid failed with " << running.size() << " workers running");
+            aborted = true;
+            break;
+        }
+        auto it = running.find(pid);
+        if (it == running.end())
+        {
+            continue; // not one of ours
+        }
+        uint32_t index = it->second.first;
+        slotBusy[it->second.second] = false;
+        running.erase(it);
+        if (WIFEXITED(wstatus))
+        {
+            status[index] = WEXITSTATUS(wstatus);
+        }
+        else if (WIFSIGNALED(wstatus))
+        {
+            status[index] = 128 + WTERMSIG(wstatus);
+        }
+        NS_LOG_INFO("Point " << index << " finished with status " << status[index]);
+    }
+
+    // an aborted sweep still leaves the summary of the points that ran
+    if (WriteSummary(status) != 0 || aborted)
+    {
+        return -1;
+    }
+    return std::count_if(status.begin(), status.end(), [](int s) { return s != 0; });
+}
+
+int
+P4SweepRunner::RunPoint(RunFunction run, const Point& point)
+{
+    RngSeedManager::SetSeed(point.seed);
+    RngSeedManager::SetRun(point.run);
+
+    std::error_code ec;
+    std::filesystem::create_directories(point.outputPath, ec);
+    if (ec)
+    {
+        std::cerr << "Cannot create " << point.outputPath << ": " << ec.message() << std::endl;
+        return 1;
+    }
+
+    Results results;
+    int status = 1;
+    try
+    {
+        status = run(point, &results);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Point " << point.index << " failed: " << e.what() << std::endl;
+    }
+
+    if (status == 0)
+    {
+        std::ofstream out(point.outputPath + "/" + RESULT_FILE);
+        for (const auto& result : results)
+        {
+            out << EscapeResult(result.first) << "=" << EscapeResult(result.second) << "\n";
+        }
+        if (!out.good())
+        {
+            status = 1;
+        }
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    return status;
+}
+
+int
+P4SweepRunner::WriteSummary(const std::vector<int>& status) const
+{
+    std::string path =
+        m_summaryFile.empty() ? m_outputDirectory + "/summary.csv" : m_summaryFile;
+
+    // result columns in order of first appearance
+    std::vector<Results> results(status.size());
+    std::vector<std::string> columns;
+    for (uint32_t i = 0; i < status.size(); i++)
+    {
+        if (status[i] != 0)
+        {
+            continue;
+        }
+        std::ifstream in(GetPoint(i).outputPath + "/" + RESULT_FILE);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            size_t eq = line.find('=');
+            if (eq == std::string::npos)
+            {
+                continue;
+            }
+            std::string key = UnescapeResult(line.substr(0, eq));
+            if (std::find(columns.begin(), columns.end(), key) == columns.end())
+            {
+                columns.push_back(key);
+            }
+            results[i][key] = UnescapeResult(line.substr(eq + 1));
+        }
+    }
+
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        NS_LOG_ERROR("Cannot open summary file " << path);
+        return -1;
+    }
+    out << "index,seed,run";
+    for (const auto& parameter : m_parameters)
+    {
+        out << "," << CsvField(parameter.first);
+    }
+    out << ",status";
+    for (const auto& column : columns)
+    {
+        out << "," << CsvField(column);
+    }
+    out << "\n";
+
+    for (uint32_t i = 0; i < status.size(); i++)
+    {
+        Point point = GetPoint(i);
+        out << point.index << "," << point.seed << "," << point.run;
+        for (const auto& value : point.values)
+        {
+            out << "," << CsvField(value.second);
+        }
+        out << "," << status[i];
+        for (const auto& column : columns)
+        {
+            auto it = results[i].find(column);
+            out << "," << (it != results[i].end() ? CsvField(it->second) : "");
+        }
+        out << "\n";
+    }
+    NS_LOG_INFO("Sweep summary written to " << path);
+    return out.good() ? 0 : -1;
+}
+
+} // namespace ns3
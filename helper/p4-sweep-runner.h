@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#ifndef P4_SWEEP_RUNNER_H
+#define P4_SWEEP_RUNNER_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup p4sim
+ * \brief Runs a parameter sweep in parallel worker processes.
+ *
+ * The sweep is the cartesian product of the parameter values, each point
+ * repeated with different RNG runs. Every point runs in its own process, forked
+ * from the calling process, with at most the configured number of points
+ * running at the same time.
+ *
+ * Whatever the caller prepared before Run, such as the generated topology and
+ * flow-table files or tables held in memory, is inherited by the workers
+ * copy-on-write and is not rebuilt per point. The caller must not have started
+ * the simulator before Run: each worker starts from a clean simulator and
+ * global ns-3 state, as a separate program run would. Workers running at the
+ * same time get disjoint bmv2 thrift port ranges, see
+ * P4SwitchCore::SetThriftPortBase.
+ *
+ * A worker seeds the ns-3 RNG with the point's seed and run number, creates the
+ * point's output directory and calls the run function. The results it returns
+ * are collected into one CSV summary file, one row per point in sweep order.
+ *
+ * Usage:
+ * \code
+ *   P4SweepRunner sweep;
+ *   sweep.AddParameter("SwitchRate", {"1000", "2000", "4000"});
+ *   sweep.SetRepetitions(5);
+ *   sweep.Run([](const P4SweepRunner::Point& p, P4SweepRunner::Results* r) {
+ *       ... build and run the simulation using p.Get("SwitchRate") ...
+ *       (*r)["rxPackets"] = rx;
+ *       return 0;
+ *   });
+ * \endcode
+ */
+class P4SweepRunner
+{
+  public:
+    /**
+     * \brief One point of the sweep, as seen by the run function
+     */
+    struct Point
+    {
+        uint32_t index;  //!< Index in sweep order
+        uint32_t seed;   //!< RNG seed
+        uint32_t run;    //!< RNG run number
+        uint32_t worker; //!< Worker slot running the point, below the worker count
+        std::vector<std::pair<std::string, std::string>> values; //!< Parameter values
+        std::string outputPath; //!< Directory for the output files of the point
+
+        /**
+         * \brief Get the value of a parameter
+         * \param name the parameter name
+         * \return the value, empty if the sweep has no such parameter
+         */
+        std::string Get(const std::string& name) const;
+    };
+
+    /**
+     * Results of one point, written as columns of the summary
+     */
+    typedef std::map<std::string, std::string> Results;
+
+    /**
+     * Simulates one point. Returns 0 on success.
+     */
+    typedef std::function<int(const Point& point, Results* results)> RunFunction;
+
+    P4SweepRunner();
+
+    /**
+     * \brief Add a swept parameter
+     * \param name the parameter name
+     * \param values the values, in sweep order
+     */
+    void AddParameter(const std::string& name, const std::vector<std::string>& values);
+
+    /**
+     * \brief Set the number of runs of every parameter point (default 1)
+     * \param repetitions the number of runs, each with its own RNG run number
+     */
+    void SetRepetitions(uint32_t repetitions);
+
+    /**
+     * \brief Set the RNG seed of all points (default 1)
+     * \param seed the seed
+     */
+    void SetSeed(uint32_t seed);
+
+    /**
+     * \brief Set the maximum number of points running at the same time
+     * \param workers the number of workers, 0 for one per hardware thread (default)
+     */
+    void SetWorkers(uint32_t workers);
+
+    /**
+     * \brief Set the thrift ports reserved per worker (default 100)
+     * \param ports the number of ports, at least the number of switches per point
+     */
+    void SetPortsPerWorker(uint32_t ports);
+
+    /**
+     * \brief Set the directory holding the per-point directories (default "sweep")
+     * \param directory the directory
+     */
+    void SetOutputDirectory(const std::string& directory);
+
+    /**
+     * \brief Set the summary file (default "<output directory>/summary.csv")
+     * \param path the file path
+     */
+    void SetSummaryFile(const std::string& path);
+
+    /**
+     * \brief Get the number of points of the sweep
+     * \return the number of points, repetitions included
+     */
+    uint32_t GetNPoints() const;
+
+    /**
+     * \brief Get one point of the sweep
+     * \param index the index in sweep order, below GetNPoints()
+     * \return the point
+     */
+    Point GetPoint(uint32_t index) const;
+
+    /**
+     * \brief Run the sweep and write the summary
+     *
+     * Blocks until all points finished. A point whose worker returns non-zero,
+     * or dies, is reported with its status and without results. If no worker
+     * can be started while none is running, the sweep stops and the summary
+     * reports the points that did not run with status -1.
+     *
+     * Fields of the summary holding a comma, a quote or a line break are
+     * quoted as in RFC 4180.
+     *
+     * \param run the function simulating one point
+     * \return the number of failed points, or -1 if the sweep could not run or
+     *         was stopped
+     */
+    int Run(RunFunction run);
+
+  private:
+    /**
+     * \brief Body of a worker process
+     * \param run the function simulating one point
+     * \param point the point
+     * \return the exit status of the worker
+     */
+    static int RunPoint(RunFunction run, const Point& point);
+
+    /**
+     * \brief Write the summary file from the per-point result files
+     * \param status exit status of every point
+     * \return 0 on success
+     */
+    int WriteSummary(const std::vector<int>& status) const;
+
+    std::vector<std::pair<std::string, std::vector<std::string>>> m_parameters; //!< Parameters
+    uint32_t m_repetitions;        //!< Runs per parameter point
+    uint32_t m_seed;               //!< RNG seed
+    uint32_t m_workers;            //!< Maximum concurrent points
+    uint32_t m_portsPerWorker;     //!< Thrift ports reserved per worker
+    std::string m_outputDirectory; //!< Root of the per-point directories
+    std::string m_summaryFile;     //!< Summary file, empty for the default
+};
+
+} // namespace ns3
+
+#endif /* P4_SWEEP_RUNNER_H */
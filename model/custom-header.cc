@@ -23,11 +23,200 @@
 #include "ns3/log.h"
 #include "ns3/string.h" // For StringValue
 
+#include <algorithm>
+
 namespace ns3
 {
 
 NS_LOG_COMPONENT_DEFINE("CustomHeader");
 
+namespace
+{
+
+/**
+ * Big-endian bit stream writer. Fields are collected in a 64-bit accumulator
+ * that is stored with a single byte-swapped write once it is full; only the
+ * final partial word is written byte by byte.
+ */
+class BitWriter
+{
+  public:
+    explicit BitWriter(Buffer::Iterator& it)
+        : m_it(it),
+          m_acc(0),
+          m_bits(0)
+    {
+    }
+
+    // Append the low bitWidth bits of value, 0 < bitWidth <= 64, value already masked
+    void Put(uint64_t value, uint32_t bitWidth)
+    {
+        if (m_bits + bitWidth < 64)
+        {
+            m_acc = (m_acc << bitWidth) | value;
+            m_bits += bitWidth;
+            return;
+        }
+        uint32_t fill = 64 - m_bits; // 1..64, bits still free in the word
+        uint32_t rest = bitWidth - fill;
+        uint64_t word = value >> rest;
+        if (m_bits > 0)
+        {
+            word |= m_acc << fill;
+        }
+        m_it.WriteHtonU64(word);
+        m_acc = (rest > 0) ? (value & ((1ULL << rest) - 1)) : 0;
+        m_bits = rest;
+    }
+
+    // Write the pending bits, the last byte is padded with zeros
+    void Flush()
+    {
+        if (m_bits == 0)
+        {
+            return;
+        }
+        uint64_t word = m_acc << (64 - m_bits);
+        for (uint32_t i = 0; i < (m_bits + 7) / 8; ++i)
+        {
+            m_it.WriteU8(static_cast<uint8_t>(word >> (56 - 8 * i)));
+        }
+        m_acc = 0;
+        m_bits = 0;
+    }
+
+  private:
+    Buffer::Iterator& m_it;
+    uint64_t m_acc;  // Pending bits, right-aligned
+    uint32_t m_bits; // Number of pending bits, < 64
+};
+
+/**
+ * Big-endian bit stream reader, the counterpart of BitWriter. Reads at most
+ * the given number of bytes, 64 bits at a time while enough bytes remain.
+ * Source is a Buffer::Iterator or a RawReader.
+ */
+template <class Source>
+class BitReader
+{
+  public:
+    BitReader(Source& it, uint32_t bytes)
+        : m_it(it),
+          m_remaining(bytes),
+          m_acc(0),
+          m_bits(0)
+    {
+    }
+
+    // Take the next bitWidth bits, 0 < bitWidth <= 64, mask is the field mask
+    uint64_t Get(uint32_t bitWidth, uint64_t mask)
+    {
+        if (m_bits >= bitWidth)
+        {
+            m_bits -= bitWidth;
+            return (m_acc >> m_bits) & mask;
+        }
+        uint32_t need = bitWidth - m_bits;
+        uint64_t high = (m_bits > 0) ? (m_acc & ((1ULL << m_bits) - 1)) : 0;
+        Refill();
+        m_bits -= need;
+        uint64_t low = (m_acc >> m_bits) & ((need >= 64) ? ~0ULL : ((1ULL << need) - 1));
+        return (need >= 64) ? low : ((high << need) | low);
+    }
+
+  private:
+    void Refill()
+    {
+        if (m_remaining >= 8)
+        {
+            m_acc = m_it.ReadNtohU64();
+            m_bits = 64;
+            m_remaining -= 8;
+            return;
+        }
+        m_acc = 0;
+        m_bits = 8 * m_remaining;
+        for (; m_remaining > 0; --m_remaining)
+        {
+            m_acc = (m_acc << 8) | m_it.ReadU8();
+        }
+    }
+
+    Source& m_it;
+    uint32_t m_remaining; // Bytes not read yet
+    uint64_t m_acc;       // Buffered bits, right-aligned
+    uint32_t m_bits;      // Number of buffered bits, <= 64
+};
+
+/**
+ * Byte source over plain memory with the read interface of Buffer::Iterator
+ */
+class RawReader
+{
+  public:
+    explicit RawReader(const uint8_t* data)
+        : m_data(data)
+    {
+    }
+
+    uint8_t ReadU8()
+    {
+        return *m_data++;
+    }
+
+    uint64_t ReadNtohU64()
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            value = (value << 8) | m_data[i];
+        }
+        m_data += 8;
+        return value;
+    }
+
+  private:
+    const uint8_t* m_data;
+};
+
+} // namespace
+
+CustomHeaderLayout::CustomHeaderLayout()
+    : m_totalBits(0)
+{
+}
+
+std::shared_ptr<const CustomHeaderLayout>
+CustomHeaderLayout::GetEmpty()
+{
+    static std::shared_ptr<const CustomHeaderLayout> empty =
+        std::make_shared<const CustomHeaderLayout>();
+    return empty;
+}
+
+std::shared_ptr<const CustomHeaderLayout>
+CustomHeaderLayout::WithField(const std::string& name, uint32_t bitWidth) const
+{
+    auto layout = std::make_shared<CustomHeaderLayout>(*this);
+    uint64_t mask = (bitWidth >= 64) ? ~0ULL : ((1ULL << bitWidth) - 1);
+    layout->m_fields.push_back(FieldInfo{name, bitWidth, m_totalBits, mask});
+    // keep the first field when a name is repeated, as the linear search did
+    layout->m_fieldIndex.emplace(name, m_fields.size());
+    layout->m_totalBits += bitWidth;
+    return layout;
+}
+
+int
+CustomHeaderLayout::FindField(const std::string& name) const
+{
+    auto it = m_fieldIndex.find(name);
+    if (it == m_fieldIndex.end())
+    {
+        return -1;
+    }
+    return static_cast<int>(it->second);
+}
+
 TypeId
 CustomHeader::GetTypeId(void)
 {
@@ -39,7 +228,9 @@ CustomHeader::GetTypeId(void)
 }
 
 CustomHeader::CustomHeader()
-    : m_protocol_index(0),
+    : m_layout(CustomHeaderLayout::GetEmpty()),
+      m_values{},
+      m_protocol_index(0),
       m_offset_bytes(0)
 {
     InitFields();
@@ -49,11 +240,12 @@ CustomHeader::CustomHeader(const CustomHeader& other)
     : Header(),
       m_layer(other.m_layer),
       m_op(other.m_op),
+      m_layout(other.m_layout),
+      m_extraValues(other.m_extraValues),
       m_protocol_index(other.m_protocol_index),
-      m_fields(other.m_fields),
       m_offset_bytes(other.m_offset_bytes)
 {
-    NS_LOG_DEBUG("Copy constructor called");
+    std::copy(other.m_values, other.m_values + INLINE_FIELDS, m_values);
 }
 
 CustomHeader::~CustomHeader()
@@ -63,7 +255,9 @@ CustomHeader::~CustomHeader()
 void
 CustomHeader::InitFields()
 {
-    m_fields.clear();
+    m_layout = CustomHeaderLayout::GetEmpty();
+    std::fill(m_values, m_values + INLINE_FIELDS, 0);
+    m_extraValues.clear();
 }
 
 CustomHeader&
@@ -76,14 +270,15 @@ CustomHeader::operator=(const CustomHeader& other)
 
     // Header::operator= (other);
 
-    // Copy other members
+    // Copy other members, the layout is shared
     m_layer = other.m_layer;
     m_op = other.m_op;
+    m_layout = other.m_layout;
+    std::copy(other.m_values, other.m_values + INLINE_FIELDS, m_values);
+    m_extraValues = other.m_extraValues;
     m_protocol_index = other.m_protocol_index;
-    m_fields = other.m_fields; // Use std::vector's copy constructor
     m_offset_bytes = other.m_offset_bytes;
 
-    NS_LOG_DEBUG("Assignment operator called");
     return *this;
 }
 
@@ -164,53 +359,90 @@ CustomHeader::AddField(const std::string& name, uint32_t bitWidth)
     {
         throw std::invalid_argument("Bit width cannot exceed 64 bits.");
     }
-    Field field{name, bitWidth, 0};
-    m_fields.push_back(field);
+    if (m_layout->GetNFields() >= INLINE_FIELDS)
+    {
+        m_extraValues.push_back(0);
+    }
+    m_layout = m_layout->WithField(name, bitWidth);
 }
 
 void
 CustomHeader::SetField(const std::string& name, uint64_t value)
 {
-    for (auto& field : m_fields)
+    int index = m_layout->FindField(name);
+    if (index < 0)
     {
-        if (field.name == name)
-        {
-            if (value >= (1ULL << field.bitWidth))
-            {
-                throw std::out_of_range("Value exceeds the maximum allowed by field width.");
-            }
-            field.value = value;
-            return;
-        }
+        throw std::invalid_argument("Field not found: " + name);
     }
-    throw std::invalid_argument("Field not found: " + name);
+    SetFieldByIndex(index, value);
 }
 
 uint64_t
 CustomHeader::GetField(const std::string& name) const
 {
-    for (const auto& field : m_fields)
+    int index = m_layout->FindField(name);
+    if (index < 0)
     {
-        if (field.name == name)
-        {
-            return field.value;
-        }
+        throw std::invalid_argument("Field not found: " + name);
+    }
+    return ValueAt(index);
+}
+
+int
+CustomHeader::GetFieldIndex(const std::string& name) const
+{
+    return m_layout->FindField(name);
+}
+
+void
+CustomHeader::SetFieldByIndex(size_t index, uint64_t value)
+{
+    if (index >= m_layout->GetNFields())
+    {
+        throw std::out_of_range("Field index out of range.");
     }
-    throw std::invalid_argument("Field not found: " + name);
+    uint32_t bitWidth = m_layout->GetFieldInfo(index).bitWidth;
+    if (bitWidth < 64 && value >= (1ULL << bitWidth))
+    {
+        throw std::out_of_range("Value exceeds the maximum allowed by field width.");
+    }
+    ValueAt(index) = value;
+}
+
+uint64_t
+CustomHeader::GetFieldByIndex(size_t index) const
+{
+    if (index >= m_layout->GetNFields())
+    {
+        throw std::out_of_range("Field index out of range.");
+    }
+    return ValueAt(index);
+}
+
+size_t
+CustomHeader::GetNFields() const
+{
+    return m_layout->GetNFields();
+}
+
+std::shared_ptr<const CustomHeaderLayout>
+CustomHeader::GetLayout() const
+{
+    return m_layout;
 }
 
 void
 CustomHeader::SetProtocolFieldNumber(uint64_t id)
 {
-    if (m_fields.empty())
+    if (m_layout->GetNFields() == 0)
     {
         NS_LOG_WARN("m_fields is empty! Set protocol number.");
     }
 
-    else if (id >= m_fields.size())
+    else if (id >= m_layout->GetNFields())
     {
-        NS_LOG_WARN("Invalid protocol number assignment: id = " << id << ", but m_fields size = "
-                                                                << m_fields.size());
+        NS_LOG_WARN("Invalid protocol number assignment: id = "
+                    << id << ", but m_fields size = " << m_layout->GetNFields());
         return;
     }
 
@@ -222,14 +454,14 @@ CustomHeader::GetProtocolNumber()
 {
     NS_LOG_INFO("Protocol number: " << m_protocol_index);
 
-    if (m_protocol_index >= m_fields.size())
+    if (m_protocol_index >= m_layout->GetNFields())
     {
         NS_LOG_ERROR("Index out of bounds: m_protocol_index = "
-                     << m_protocol_index << ", but m_fields size = " << m_fields.size());
+                     << m_protocol_index << ", but m_fields size = " << m_layout->GetNFields());
         return 0;
     }
 
-    return m_fields[m_protocol_index].value;
+    return ValueAt(m_protocol_index);
 }
 
 void
@@ -265,105 +497,72 @@ CustomHeader::GetInstanceTypeId(void) const
 void
 CustomHeader::Serialize(Buffer::Iterator start) const
 {
-    uint32_t currentBit = 0;
-    uint8_t currentByte = 0;
-
-    for (const auto& field : m_fields)
+    BitWriter writer(start);
+    for (size_t i = 0; i < m_layout->GetNFields(); ++i)
     {
-        uint32_t bitsToWrite = field.bitWidth;
-        uint64_t value = field.value;
-
-        while (bitsToWrite > 0)
+        const CustomHeaderLayout::FieldInfo& field = m_layout->GetFieldInfo(i);
+        if (field.bitWidth > 0)
         {
-            uint32_t freeBits = 8 - currentBit;
-            uint32_t bitsToWriteNow = std::min(freeBits, bitsToWrite);
-
-            currentByte |= ((value >> (bitsToWrite - bitsToWriteNow)) & ((1 << bitsToWriteNow) - 1))
-                           << (freeBits - bitsToWriteNow);
-            bitsToWrite -= bitsToWriteNow;
-            currentBit += bitsToWriteNow;
-
-            if (currentBit == 8)
-            {
-                start.WriteU8(currentByte);
-                currentByte = 0;
-                currentBit = 0;
-            }
+            writer.Put(ValueAt(i) & field.mask, field.bitWidth);
         }
     }
-
-    if (currentBit > 0)
-    {
-        start.WriteU8(currentByte);
-    }
+    writer.Flush();
 }
 
 uint32_t
 CustomHeader::Deserialize(Buffer::Iterator start)
 {
-    uint32_t totalBits = 0;
-    for (const auto& field : m_fields)
-    {
-        totalBits += field.bitWidth;
-    }
-
-    uint32_t bytesToRead = (totalBits + 7) / 8;
+    uint32_t bytesToRead = GetSerializedSize();
+    NS_LOG_DEBUG("Deserializing " << bytesToRead << " bytes...");
 
-    std::vector<uint8_t> buffer(bytesToRead);
+    BitReader<Buffer::Iterator> reader(start, bytesToRead);
+    DeserializeFields(reader);
+    return bytesToRead;
+}
 
-    NS_LOG_DEBUG("Deserializing " << bytesToRead << " bytes...");
-    for (uint32_t i = 0; i < bytesToRead; ++i)
+uint32_t
+CustomHeader::Deserialize(const uint8_t* data, uint32_t size)
+{
+    uint32_t bytesToRead = GetSerializedSize();
+    if (size < bytesToRead)
     {
-        buffer[i] = start.ReadU8();
+        return 0;
     }
 
-    uint32_t currentBit = 0;
-    for (auto& field : m_fields)
-    {
-        uint32_t bitsToRead = field.bitWidth;
-        uint64_t value = 0;
-
-        while (bitsToRead > 0)
-        {
-            uint32_t byteIndex = currentBit / 8;
-            uint32_t bitIndex = currentBit % 8;
-
-            uint32_t freeBits = 8 - bitIndex;
-            uint32_t bitsToReadNow = std::min(freeBits, bitsToRead);
-
-            value = (value << bitsToReadNow) | ((buffer[byteIndex] >> (freeBits - bitsToReadNow)) &
-                                                ((1 << bitsToReadNow) - 1));
-
-            bitsToRead -= bitsToReadNow;
-            currentBit += bitsToReadNow;
-        }
+    RawReader source(data);
+    BitReader<RawReader> reader(source, bytesToRead);
+    DeserializeFields(reader);
+    return bytesToRead;
+}
 
-        field.value = value;
-        NS_LOG_DEBUG("Field " << field.name << ": 0x" << std::hex << std::uppercase << field.value);
+template <class Reader>
+void
+CustomHeader::DeserializeFields(Reader& reader)
+{
+    for (size_t i = 0; i < m_layout->GetNFields(); ++i)
+    {
+        const CustomHeaderLayout::FieldInfo& field = m_layout->GetFieldInfo(i);
+        uint64_t value = (field.bitWidth > 0) ? reader.Get(field.bitWidth, field.mask) : 0;
+        ValueAt(i) = value;
+        NS_LOG_DEBUG("Field " << field.name << ": 0x" << std::hex << std::uppercase << value);
     }
-
-    return bytesToRead;
 }
 
 uint32_t
 CustomHeader::GetSerializedSize(void) const
 {
     // Bytes required to store all fields
-    uint32_t totalBits = 0;
-    for (const auto& field : m_fields)
-    {
-        totalBits += field.bitWidth;
-    }
-    return (totalBits + 7) / 8;
+    return (m_layout->GetTotalBits() + 7) / 8;
 }
 
 void
 CustomHeader::Print(std::ostream& os) const
 {
     os << "CustomHeader { ";
-    for (const auto& field : m_fields)
+    for (size_t i = 0; i < m_layout->GetNFields(); ++i)
     {
-        os << field.name << ": 0x" << std::hex << std::uppercase << field.value << " ";
+        os << m_layout->GetFieldInfo(i).name << ": 0x" << std::hex << std::uppercase << ValueAt(i)
+           << " ";
     }
     os << "}";
 }
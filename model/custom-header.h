@@ -23,8 +23,10 @@
 #include "ns3/header.h"
 #include "ns3/packet.h"
 
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace ns3
@@ -45,16 +47,64 @@ enum HeaderLayerOperator
     ADD_AFTER = 3   // add after the current header exsit in this layer
 };
 
-class CustomHeader : public Header
+/**
+ * \brief Immutable field layout shared by CustomHeader instances
+ *
+ * The layout holds everything that does not change from one packet to the
+ * next: field names, widths and bit offsets. A layout is never modified once
+ * built; adding a field builds a new layout. Copies of a CustomHeader therefore
+ * only share a pointer to it.
+ */
+class CustomHeaderLayout
 {
   public:
-    struct Field
+    struct FieldInfo
     {
-        std::string name;  // Field name
-        uint32_t bitWidth; // Field bit-width
-        uint64_t value;    // Field value
+        std::string name;   // Field name
+        uint32_t bitWidth;  // Field bit-width
+        uint32_t bitOffset; // Offset of the first bit from the start of the header
+        uint64_t mask;      // Mask of the low bitWidth bits, precomputed for the codec
     };
 
+    CustomHeaderLayout();
+
+    // Get the shared empty layout
+    static std::shared_ptr<const CustomHeaderLayout> GetEmpty();
+
+    // Build a new layout with one more field appended
+    std::shared_ptr<const CustomHeaderLayout> WithField(const std::string& name,
+                                                        uint32_t bitWidth) const;
+
+    // Index of a field by name, -1 if not found
+    int FindField(const std::string& name) const;
+
+    size_t GetNFields() const
+    {
+        return m_fields.size();
+    }
+
+    const FieldInfo& GetFieldInfo(size_t index) const
+    {
+        return m_fields[index];
+    }
+
+    uint32_t GetTotalBits() const
+    {
+        return m_totalBits;
+    }
+
+  private:
+    std::vector<FieldInfo> m_fields;                      // Field descriptors in wire order
+    std::unordered_map<std::string, size_t> m_fieldIndex; // Field name to index
+    uint32_t m_totalBits;                                 // Sum of all field widths
+};
+
+class CustomHeader : public Header
+{
+  public:
+    // Number of field values stored inline, more fields spill to the heap
+    static constexpr size_t INLINE_FIELDS = 8;
+
     CustomHeader();
     virtual ~CustomHeader();
 
@@ -86,6 +136,22 @@ class CustomHeader : public Header
     // Get a field value
     uint64_t GetField(const std::string& name) const;
 
+    // Index of a field by name, -1 if not found. Resolve once, then use the
+    // index based accessors on the per-packet path.
+    int GetFieldIndex(const std::string& name) const;
+
+    // Set a field value by index
+    void SetFieldByIndex(size_t index, uint64_t value);
+
+    // Get a field value by index
+    uint64_t GetFieldByIndex(size_t index) const;
+
+    // Number of fields
+    size_t GetNFields() const;
+
+    // Shared field layout
+    std::shared_ptr<const CustomHeaderLayout> GetLayout() const;
+
     // Set and get header layer
     void SetLayer(HeaderLayer layer);
     HeaderLayer GetLayer() const;
@@ -108,14 +174,33 @@ class CustomHeader : public Header
     virtual uint32_t GetSerializedSize(void) const override;
     virtual void Print(std::ostream& os) const override;
 
+    // Decode the fields from plain memory, e.g. bytes copied out of a packet.
+    // Returns the number of bytes consumed, 0 if size is too small.
+    uint32_t Deserialize(const uint8_t* data, uint32_t size);
+
     // static void InsertCustomHeader (Ptr<Packet> packet, const CustomHeader &header);
     // static void RemoveHeaderAtOffset (Ptr<Packet> packet, CustomHeader &header);
 
   private:
-    HeaderLayer m_layer;         // OSI Layer for this header
-    HeaderLayerOperator m_op;    // Operator for this header
-    uint64_t m_protocol_index;   // Protocol number
-    std::vector<Field> m_fields; // Dynamic list of fields
+    template <class Reader>
+    void DeserializeFields(Reader& reader);
+
+    uint64_t& ValueAt(size_t index)
+    {
+        return index < INLINE_FIELDS ? m_values[index] : m_extraValues[index - INLINE_FIELDS];
+    }
+
+    uint64_t ValueAt(size_t index) const
+    {
+        return index < INLINE_FIELDS ? m_values[index] : m_extraValues[index - INLINE_FIELDS];
+    }
+
+    HeaderLayer m_layer;                                // OSI Layer for this header
+    HeaderLayerOperator m_op;                           // Operator for this header
+    std::shared_ptr<const CustomHeaderLayout> m_layout; // Shared field layout
+    uint64_t m_values[INLINE_FIELDS];                   // Values of the first fields
+    std::vector<uint64_t> m_extraValues;                // Values beyond INLINE_FIELDS
+    uint64_t m_protocol_index;                          // Index of the protocol field
 
     uint16_t m_offset_bytes; // Offset in bytes
 };
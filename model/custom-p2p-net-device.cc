@@ -18,17 +18,21 @@
  */
 
 #include "ns3/custom-p2p-net-device.h"
+#include "ns3/double.h"
 #include "ns3/error-model.h"
 #include "ns3/llc-snap-header.h"
 #include "ns3/log.h"
 #include "ns3/mac48-address.h"
+#include "ns3/node.h"
+#include "ns3/p4-event-profiler.h"
 #include "ns3/pointer.h"
 #include "ns3/queue.h"
 #include "ns3/simulator.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
 
-#include <stack>
+#include <algorithm>
+#include <array>
 
 namespace ns3
 {
@@ -37,6 +41,93 @@ NS_LOG_COMPONENT_DEFINE("CustomP2PNetDevice");
 
 NS_OBJECT_ENSURE_REGISTERED(CustomP2PNetDevice);
 
+namespace
+{
+
+const uint32_t ETH_HEADER_LENGTH = 14;      //!< Ethernet header without preamble
+const uint32_t IPV4_HEADER_LENGTH = 20;     //!< IPv4 header without options
+const uint32_t UDP_HEADER_LENGTH = 8;       //!< UDP header
+const uint32_t TCP_HEADER_LENGTH = 20;      //!< TCP header without options
+const uint32_t MAX_IPV4_HEADER_LENGTH = 60; //!< IPv4 header with all options
+const uint32_t MAX_TCP_HEADER_LENGTH = 60;  //!< TCP header with all options
+
+/**
+ * Header made of raw bytes. Used to put back the bytes lifted off the front of
+ * a packet when a custom header is spliced in or out behind them.
+ */
+class RawBytesHeader : public Header
+{
+  public:
+    RawBytesHeader(const uint8_t* data, uint32_t size)
+        : m_data(data),
+          m_size(size)
+    {
+    }
+
+    static TypeId GetTypeId(void)
+    {
+        static TypeId tid =
+            TypeId("ns3::CustomP2PRawBytesHeader").SetParent<Header>().SetGroupName("P4sim");
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId(void) const override
+    {
+        return GetTypeId();
+    }
+
+    uint32_t GetSerializedSize(void) const override
+    {
+        return m_size;
+    }
+
+    void Serialize(Buffer::Iterator start) const override
+    {
+        start.Write(m_data, m_size);
+    }
+
+    uint32_t Deserialize(Buffer::Iterator start) override
+    {
+        return 0; // only ever added, the bytes are parsed as the original headers
+    }
+
+    void Print(std::ostream& os) const override
+    {
+        os << "raw " << m_size << " bytes";
+    }
+
+  private:
+    const uint8_t* m_data;
+    uint32_t m_size;
+};
+
+/**
+ * Rewrite the protocol field of a serialized IPv4 header. A non-zero checksum
+ * is updated incrementally (RFC 1624); a zero checksum means checksums are
+ * disabled and is left alone.
+ */
+void
+SetIpv4Protocol(uint8_t* ipv4, uint8_t protocol)
+{
+    uint16_t oldWord = (ipv4[8] << 8) | ipv4[9];
+    ipv4[9] = protocol;
+    uint16_t newWord = (ipv4[8] << 8) | ipv4[9];
+
+    uint16_t checksum = (ipv4[10] << 8) | ipv4[11];
+    if (checksum == 0)
+    {
+        return;
+    }
+    uint32_t sum = static_cast<uint16_t>(~checksum) + static_cast<uint16_t>(~oldWord) + newWord;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    checksum = ~sum;
+    ipv4[10] = checksum >> 8;
+    ipv4[11] = checksum & 0xff;
+}
+
+} // namespace
+
 TypeId
 CustomP2PNetDevice::GetTypeId(void)
 {
@@ -79,6 +170,24 @@ CustomP2PNetDevice::GetTypeId(void)
                           PointerValue(),
                           MakePointerAccessor(&CustomP2PNetDevice::m_queue),
                           MakePointerChecker<Queue<Packet>>())
+            .AddAttribute("TrainLength",
+                          "Maximum number of back-to-back packets sent with a single "
+                          "transmit-complete event while the transmit queue is backlogged. "
+                          "Queued packets stay in the queue until their own start time, are "
+                          "taken off lazily, and reach the peer at the same times as without "
+                          "trains. No trains are formed while the PhyTxBegin or sniffer traces "
+                          "have sinks, or across a start or stop of a background flow. "
+                          "1 disables trains.",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&CustomP2PNetDevice::m_trainLength),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MaxBackgroundLoad",
+                          "Upper bound of the share of the data rate that background flows "
+                          "can take. Keeps the modeled queueing delay finite when the "
+                          "declared flows overload the link.",
+                          DoubleValue(0.95),
+                          MakeDoubleAccessor(&CustomP2PNetDevice::m_maxBackgroundLoad),
+                          MakeDoubleChecker<double>(0.0, 0.99))
 
             //
             // In [CUSTOM_DST_PORT_MIN, CUSTOM_DST_PORT_MAX], the packet will be assigned a custom
@@ -173,8 +282,12 @@ CustomP2PNetDevice::CustomP2PNetDevice()
     : m_txMachineState(READY),
       m_channel(0),
       m_NeedProcessHeader(false),
+      m_framePassThrough(false),
+      m_switchPort(0),
       m_linkUp(false),
-      m_currentPkt(0)
+      m_currentPkt(0),
+      m_trainLength(1),
+      m_maxBackgroundLoad(0.95)
 {
     NS_LOG_FUNCTION(this);
 }
@@ -188,86 +301,92 @@ uint16_t
 CustomP2PNetDevice::GetDstPort(Ptr<Packet> p)
 {
     NS_LOG_FUNCTION(this);
-    Ipv4Header ip_hd;
-    uint16_t dst_port = 0;
-    CustomHeader cus_hd = m_header;
+    P4PacketLayout layout;
+    ParseHeaderChain(p, layout);
+    return layout.dstPort;
+}
 
-    bool hasIpv4 = p->RemoveHeader(ip_hd); // Remove IPv4 header
-    if (hasIpv4)
+void
+CustomP2PNetDevice::ParseHeaderChain(Ptr<Packet> p, P4PacketLayout& layout)
+{
+    NS_LOG_FUNCTION(this << p);
+    layout = P4PacketLayout();
+
+    // One copy covers the longest IPv4 and TCP headers
+    uint32_t copied = CopyPacketFront(p, MAX_IPV4_HEADER_LENGTH + MAX_TCP_HEADER_LENGTH);
+    const uint8_t* buf = m_spliceBuffer.data();
+
+    if (copied < IPV4_HEADER_LENGTH || (buf[0] >> 4) != 4 ||
+        (buf[0] & 0x0f) * 4 < IPV4_HEADER_LENGTH || (buf[0] & 0x0f) * 4 > copied)
     {
-        // Set the ipv4'protocol number to the custom header
-        uint16_t protocol_temp = ip_hd.GetProtocol();
-        cus_hd.SetProtocolFieldNumber(0);
+        NS_LOG_WARN("No IPv4 header found in the packet, no des port information");
+        return;
+    }
+    layout.ipv4Length = (buf[0] & 0x0f) * 4;
+    layout.ipProtocol = buf[9];
 
-        // With OnOffApplication, the protocol will be UDP or TCP.
-        if (protocol_temp == 0x11) // UDP
-        {
-            NS_LOG_DEBUG("UDP protocol, return the dst port number");
-            UdpHeader udp_hd;
-            p->PeekHeader(udp_hd);
-            dst_port = udp_hd.GetDestinationPort();
-        }
-        else if (protocol_temp == 0x06) // TCP
-        {
-            NS_LOG_DEBUG("TCP protocol, return the dst port number");
-            TcpHeader tcp_hd;
-            p->PeekHeader(tcp_hd);
-            dst_port = tcp_hd.GetDestinationPort();
-        }
-        else
+    // With OnOffApplication, the protocol will be UDP or TCP.
+    const uint8_t* l4 = buf + layout.ipv4Length;
+    uint32_t l4Copied = copied - layout.ipv4Length;
+    if (layout.ipProtocol == 0x11 && l4Copied >= UDP_HEADER_LENGTH) // UDP
+    {
+        NS_LOG_DEBUG("UDP protocol, return the dst port number");
+        layout.transportLength = UDP_HEADER_LENGTH;
+        layout.dstPort = (l4[2] << 8) | l4[3];
+    }
+    else if (layout.ipProtocol == 0x06 && l4Copied >= TCP_HEADER_LENGTH) // TCP
+    {
+        NS_LOG_DEBUG("TCP protocol, return the dst port number");
+        // the data offset gives the header length including options
+        uint32_t tcpLength = (l4[12] >> 4) * 4;
+        if (tcpLength >= TCP_HEADER_LENGTH && tcpLength <= l4Copied)
         {
-            NS_LOG_WARN("Unknown protocol number, unable to get the dst port number");
+            layout.transportLength = tcpLength;
         }
-
-        // Add back the IPv4 header
-        p->AddHeader(ip_hd);
+        layout.dstPort = (l4[2] << 8) | l4[3];
     }
     else
     {
-        NS_LOG_WARN("No IPv4 header found in the packet, no des port information");
+        NS_LOG_WARN("Unknown protocol number, unable to get the dst port number");
     }
-    return dst_port;
 }
 
 bool
 CustomP2PNetDevice::HandleTransportLayerHeader(Ptr<Packet> p,
                                                CustomHeader& cus_hd,
-                                               uint16_t protocol,
+                                               const P4PacketLayout& layout,
                                                bool removeHeader)
 {
-    if (protocol == 0x11) // UDP
+    if (layout.ipProtocol != 0x11 && layout.ipProtocol != 0x06)
+    {
+        NS_LOG_WARN("Unknown transport protocol, skipping custom header addition.");
+        return false;
+    }
+    NS_LOG_DEBUG("Processing " << (layout.ipProtocol == 0x11 ? "UDP" : "TCP") << " protocol");
+
+    if (removeHeader)
     {
-        NS_LOG_DEBUG("Processing UDP protocol");
-        UdpHeader udp_hd;
-        if (removeHeader)
+        if (layout.transportLength == 0)
         {
-            p->RemoveHeader(udp_hd); // Remove UDP header
-        }
-        p->AddHeader(cus_hd); // Insert custom header
-        if (!removeHeader)
-        {
-            p->AddHeader(udp_hd);
+            NS_LOG_WARN("Packet too short for the transport header");
+            return false;
         }
+        p->RemoveAtStart(layout.transportLength); // Remove UDP/TCP header
     }
-    else if (protocol == 0x06) // TCP
+    p->AddHeader(cus_hd); // Insert custom header
+    if (!removeHeader)
     {
-        NS_LOG_DEBUG("Processing TCP protocol");
-        TcpHeader tcp_hd;
-        if (removeHeader)
+        if (layout.ipProtocol == 0x11)
         {
-            p->RemoveHeader(tcp_hd); // Remove TCP header
+            UdpHeader udp_hd;
+            p->AddHeader(udp_hd);
         }
-        p->AddHeader(cus_hd); // Insert custom header
-        if (!removeHeader)
+        else
         {
+            TcpHeader tcp_hd;
             p->AddHeader(tcp_hd);
         }
     }
-    else
-    {
-        NS_LOG_WARN("Unknown transport protocol, skipping custom header addition.");
-        return false;
-    }
 
     return true;
 }
@@ -306,12 +425,13 @@ CustomP2PNetDevice::HandleLayer2(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHe
 }
 
 void
-CustomP2PNetDevice::HandleLayer3(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHeader& eeh_header)
+CustomP2PNetDevice::HandleLayer3(Ptr<Packet> p,
+                                 CustomHeader& cus_hd,
+                                 EthernetHeader& eeh_header,
+                                 const P4PacketLayout& layout)
 {
     NS_LOG_FUNCTION(this);
-    Ipv4Header ip_hd;
-    uint16_t protocol_temp = 0;
-    bool hasIpv4 = false;
+    uint32_t ipLength = layout.ipv4Length;
 
     switch (cus_hd.GetOperator())
     {
@@ -325,15 +445,14 @@ CustomP2PNetDevice::HandleLayer3(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHe
         break;
     case HeaderLayerOperator::ADD_AFTER:
         // Layer 2: [ethernet] layer 3: [ipv4] [custom] layer 4: [udp/tcp]
-        hasIpv4 = p->RemoveHeader(ip_hd); // Remove IPv4 header
-        if (hasIpv4)
+        if (ipLength > 0)
         {
-            ip_hd.SetProtocol(m_p4ProtocolNumber);
-            protocol_temp = ip_hd.GetProtocol();
-            cus_hd.SetProtocolFieldNumber(protocol_temp);
+            SetIpv4Protocol(m_spliceBuffer.data(), m_p4ProtocolNumber);
+            cus_hd.SetProtocolFieldNumber(m_p4ProtocolNumber);
 
+            p->RemoveAtStart(ipLength);
             p->AddHeader(cus_hd);
-            p->AddHeader(ip_hd);
+            PutBackFront(p, ipLength);
             p->AddHeader(eeh_header);
         }
         else
@@ -345,12 +464,11 @@ CustomP2PNetDevice::HandleLayer3(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHe
         // Layer 2: [ethernet] layer 3: [custom] layer 4: [udp/tcp]
         eeh_header.SetLengthType(m_p4ProtocolNumber);
 
-        hasIpv4 = p->RemoveHeader(ip_hd); // Remove IPv4 header
-        if (hasIpv4)
+        if (ipLength > 0)
         {
-            protocol_temp = ip_hd.GetProtocol();
-            cus_hd.SetProtocolFieldNumber(protocol_temp);
+            cus_hd.SetProtocolFieldNumber(layout.ipProtocol);
 
+            p->RemoveAtStart(ipLength);
             p->AddHeader(cus_hd);
             p->AddHeader(eeh_header);
         }
@@ -366,32 +484,37 @@ CustomP2PNetDevice::HandleLayer3(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHe
 }
 
 void
-CustomP2PNetDevice::HandleLayer4(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHeader& eeh_header)
+CustomP2PNetDevice::HandleLayer4(Ptr<Packet> p,
+                                 CustomHeader& cus_hd,
+                                 EthernetHeader& eeh_header,
+                                 const P4PacketLayout& layout)
 {
     NS_LOG_FUNCTION(this);
 
-    Ipv4Header ip_hd;
-    bool hasIpv4 = p->RemoveHeader(ip_hd); // Remove IPv4 header
-    if (!hasIpv4)
+    // The custom header goes right behind the IPv4 header: the IPv4 bytes are
+    // already in the splice buffer, insert at the front and put them back.
+    uint32_t ipLength = layout.ipv4Length;
+    if (ipLength == 0)
     {
         NS_LOG_WARN("No IPv4 header found in the packet");
         return;
     }
 
-    uint16_t protocol_temp = ip_hd.GetProtocol();
+    uint16_t protocol_temp = layout.ipProtocol;
     cus_hd.SetProtocolFieldNumber(0);
+    p->RemoveAtStart(ipLength);
 
     switch (cus_hd.GetOperator())
     {
     case HeaderLayerOperator::ADD_BEFORE:
-        ip_hd.SetProtocol(m_p4ProtocolNumber);
+        SetIpv4Protocol(m_spliceBuffer.data(), m_p4ProtocolNumber);
         cus_hd.SetProtocolFieldNumber(protocol_temp);
 
         p->AddHeader(cus_hd);
         break;
 
     case HeaderLayerOperator::ADD_AFTER:
-        if (HandleTransportLayerHeader(p, cus_hd, protocol_temp)) // Processing TCP/UDP headers
+        if (HandleTransportLayerHeader(p, cus_hd, layout)) // Processing TCP/UDP headers
         {
             NS_LOG_DEBUG("Custom header added after transport layer");
         }
@@ -400,7 +523,7 @@ CustomP2PNetDevice::HandleLayer4(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHe
     case HeaderLayerOperator::REPLACE:
         if (HandleTransportLayerHeader(p,
                                        cus_hd,
-                                       protocol_temp,
+                                       layout,
                                        true)) // Process TCP/UDP header and remove
         {
             NS_LOG_DEBUG("Custom header replaced transport layer");
@@ -412,12 +535,31 @@ CustomP2PNetDevice::HandleLayer4(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHe
         break;
     }
 
-    p->AddHeader(ip_hd);
+    PutBackFront(p, ipLength);
     p->AddHeader(eeh_header);
 
     NS_LOG_DEBUG("Final packet size after HandleLayer4: " << p->GetSize());
 }
 
+uint32_t
+CustomP2PNetDevice::CopyPacketFront(Ptr<Packet> p, uint32_t size)
+{
+    if (m_spliceBuffer.size() < size)
+    {
+        m_spliceBuffer.resize(size);
+    }
+    return p->CopyData(m_spliceBuffer.data(), size);
+}
+
+void
+CustomP2PNetDevice::PutBackFront(Ptr<Packet> p, uint32_t size)
+{
+    if (size > 0)
+    {
+        p->AddHeader(RawBytesHeader(m_spliceBuffer.data(), size));
+    }
+}
+
 void
 CustomP2PNetDevice::SetCustomHeader(CustomHeader customHeader)
 {
@@ -468,7 +610,10 @@ CustomP2PNetDevice::AddHeader(Ptr<Packet> p,
     // uint16_t ttt = eeh_header.GetLengthType ();
     // NS_LOG_DEBUG ("*** Ethernet protocolNumber: " << std::hex << "0x" << ttt << std::dec);
 
-    uint16_t dst_port = GetDstPort(p);
+    // Parse once, the port check and the layer handlers share the result
+    P4PacketLayout layout;
+    ParseHeaderChain(p, layout);
+    uint16_t dst_port = layout.dstPort;
 
     if ((dst_port < m_customDstPortMin) || (dst_port > m_customDstPortMax))
     {
@@ -493,11 +638,11 @@ CustomP2PNetDevice::AddHeader(Ptr<Packet> p,
     }
     else if (cus_hd.GetLayer() == HeaderLayer::LAYER_3)
     {
-        HandleLayer3(p, cus_hd, eeh_header);
+        HandleLayer3(p, cus_hd, eeh_header, layout);
     }
     else if (cus_hd.GetLayer() == HeaderLayer::LAYER_4)
     {
-        HandleLayer4(p, cus_hd, eeh_header);
+        HandleLayer4(p, cus_hd, eeh_header, layout);
     }
     else
     {
@@ -580,127 +725,156 @@ CustomP2PNetDevice::RestoreHeaders(Ptr<Packet> p)
     // Restore the original headers
     // for the switch port net-device, no need to processing the header.
 
-    // // @PrintHD
-    // std::cout << "*** [Receiver] Custom header detected, start parsering the custom header"
-    //           << std::endl;
-    // p->Print(std::cout);
-    // std::cout << " " << std::endl;
+    // The header chain is walked on a copy of the packet front. Only the byte
+    // ranges to drop are recorded: the Ethernet header, the custom header(s) and
+    // ARP. The headers in between are kept byte for byte, and the packet is then
+    // rebuilt with one RemoveAtStart and one AddHeader.
+    const uint32_t packetSize = p->GetSize();
+    if (packetSize < ETH_HEADER_LENGTH)
+    {
+        NS_LOG_DEBUG("RestoreHeaders: packet too short for an Ethernet header");
+        return;
+    }
 
-    EthernetHeader eeh_hd;
-    Ipv4Header ip_hd;
-    ArpHeader arp_hd;
-    UdpHeader udp_hd;
-    TcpHeader tcp_hd;
     CustomHeader cus_hd = m_header;
-
-    uint64_t protocol = CheckIfEthernetHeader(p, eeh_hd);
-    std::stack<uint64_t> protocolStack; // Storage protocol stack path
+    uint32_t window = CopyPacketFront(
+        p,
+        std::min(packetSize,
+                 ETH_HEADER_LENGTH + 2 * (IPV4_HEADER_LENGTH + TCP_HEADER_LENGTH) +
+                     cus_hd.GetSerializedSize()));
+
+    // Make sure the bytes [0, end) are in the splice buffer
+    auto available = [&](uint32_t end) {
+        if (end > window && end <= packetSize)
+        {
+            window = CopyPacketFront(p, std::max(end, std::min(packetSize, 2 * window)));
+        }
+        return end <= window;
+    };
+
+    std::array<std::pair<uint32_t, uint32_t>, 8> cuts; // Byte ranges to drop
+    size_t nCuts = 0;
+    auto cut = [&](uint32_t begin, uint32_t end) {
+        cuts[nCuts++] = std::make_pair(begin, end);
+    };
+
+    // Parse a custom header at offset, cut it and return the next protocol
+    auto parseCustom = [&](uint32_t& offset) -> uint64_t {
+        uint32_t size = cus_hd.GetSerializedSize();
+        if (size == 0 || !available(offset + size) ||
+            cus_hd.Deserialize(m_spliceBuffer.data() + offset, window - offset) == 0)
+        {
+            return 0;
+        }
+        NS_LOG_DEBUG("Parser: Custom P4 Header at offset " << offset);
+        cut(offset, offset + size);
+        offset += size;
+        return cus_hd.GetProtocolNumber();
+    };
+
+    // The Ethernet header is always dropped
+    uint32_t offset = ETH_HEADER_LENGTH;
+    uint64_t protocol = (m_spliceBuffer[12] << 8) | m_spliceBuffer[13];
+    cut(0, ETH_HEADER_LENGTH);
+    NS_LOG_DEBUG("Parser: Ethernet protocol: 0x" << std::hex << protocol << std::dec);
 
     // The P4 switch strips the Ethernet header before calling Send() on the
     // outgoing port device (see P4SwitchNetDevice::SendNs3Packet).  When the
-    // packet therefore arrives at the destination host WITHOUT an Ethernet
-    // header, CheckIfEthernetHeader returns 0 and the while-loop below would
-    // never run, leaving the custom tunnel header (and all following headers)
-    // un-parsed.  To handle this, we fall back to attempting to parse the
-    // custom header directly at the front of the packet.
+    // first 14 bytes carry no EtherType, fall back to parsing the custom header
+    // directly behind them (switch-stripped path).  If there is no custom header
+    // either, leave the rest as-is and let ProcessHeader deal with it.
     if (protocol == 0)
     {
-        NS_LOG_DEBUG("RestoreHeaders: no Ethernet header found; "
+        NS_LOG_DEBUG("RestoreHeaders: no Ethernet protocol found; "
                      "attempting direct custom-header parse (switch-stripped path)");
-        uint64_t nextProto = CheckIfCustomHeader(p);
-        if (nextProto != 0)
-        {
-            // Custom header was present and removed.  Push a synthetic
-            // "0x1" (Ethernet sentinel) so the reverse loop adds nothing
-            // back, then continue parsing from the next protocol.
-            protocol = nextProto;
-        }
-        // If there is no custom header either, leave the packet as-is and
-        // let ProcessHeader deal with a bare IPv4/ARP packet.
+        protocol = parseCustom(offset);
     }
 
-    while (protocol != 0)
+    bool customAfterTransport = cus_hd.GetLayer() == HeaderLayer::LAYER_4 &&
+                                cus_hd.GetOperator() == HeaderLayerOperator::ADD_AFTER;
+
+    while (protocol != 0 && nCuts < cuts.size())
     {
-        protocolStack.push(protocol);
+        // available() may grow the buffer, so bytes are always indexed freshly
+        const std::vector<uint8_t>& buf = m_spliceBuffer;
+        uint32_t length = 0;
 
         switch (protocol)
         {
-        case 0x1: // Ethernet (Assume in p4sim)
-            NS_LOG_DEBUG("Parser: Ethernet protocol: " << protocol);
-            break;
         case 0x0800: // IPv4
-            protocol = CheckIfIpv4Header(p, ip_hd);
+            if (!available(offset + IPV4_HEADER_LENGTH) || (buf[offset] >> 4) != 4)
+            {
+                protocol = 0;
+                break;
+            }
+            length = (buf[offset] & 0x0f) * 4;
+            if (length < IPV4_HEADER_LENGTH || !available(offset + length))
+            {
+                protocol = 0;
+                break;
+            }
+            protocol = buf[offset + 9];
             NS_LOG_DEBUG("Parser: IPv4 protocol: " << (uint32_t)protocol);
+            offset += length;
             break;
-        case 0x0806: // ARP
-            protocol = CheckIfArpHeader(p, arp_hd);
-            break;
-        case 0x86DD: // IPv6
+        case 0x0806: // ARP, the end of the chain and dropped as well
+            if (available(offset + 8))
+            {
+                length = 8 + 2 * buf[offset + 4] + 2 * buf[offset + 5];
+                if (available(offset + length))
+                {
+                    cut(offset, offset + length);
+                    offset += length;
+                }
+            }
             protocol = 0;
             break;
         case 0x11: // UDP (0x11 == 17)
-            protocol = CheckIfUdpHeader(p, udp_hd);
-            if (cus_hd.GetLayer() == HeaderLayer::LAYER_4 &&
-                cus_hd.GetOperator() == HeaderLayerOperator::ADD_AFTER)
+            if (!available(offset + UDP_HEADER_LENGTH))
             {
-                protocol = m_p4ProtocolNumber;
+                protocol = 0;
+                break;
             }
+            offset += UDP_HEADER_LENGTH;
+            protocol = customAfterTransport ? m_p4ProtocolNumber : 0;
             break;
         case 0x06: // TCP
-            protocol = CheckIfTcpHeader(p, tcp_hd);
-            if (cus_hd.GetLayer() == HeaderLayer::LAYER_4 &&
-                cus_hd.GetOperator() == HeaderLayerOperator::ADD_AFTER)
+            if (!available(offset + TCP_HEADER_LENGTH))
             {
-                protocol = m_p4ProtocolNumber;
+                protocol = 0;
+                break;
             }
+            length = (buf[offset + 12] >> 4) * 4;
+            if (length < TCP_HEADER_LENGTH || !available(offset + length))
+            {
+                protocol = 0;
+                break;
+            }
+            offset += length;
+            protocol = customAfterTransport ? m_p4ProtocolNumber : 0;
             break;
         case m_p4ProtocolNumber: // Custom Protocol
-            protocol = CheckIfCustomHeader(p);
+            protocol = parseCustom(offset);
             break;
-        default:
-            protocol = 0; // End
+        default: // 0x1 (Ethernet), 0x86DD (IPv6) and unknown protocols end the chain
+            protocol = 0;
             break;
         }
     }
 
-    // **Reverse traversal**
-    NS_LOG_DEBUG("Start reverse parsing");
-    while (!protocolStack.empty())
+    // Compact the kept bytes in front of the last cut and splice them back
+    uint8_t* data = m_spliceBuffer.data();
+    uint32_t kept = 0;
+    uint32_t from = 0;
+    for (size_t i = 0; i < nCuts; ++i)
     {
-        uint64_t reverseProtocol = protocolStack.top();
-        protocolStack.pop();
-
-        switch (reverseProtocol)
-        {
-        case m_p4ProtocolNumber:
-            NS_LOG_DEBUG("Reverse Parser: Custom P4 Header");
-            break;
-        case 0x11:
-            NS_LOG_DEBUG("Reverse Parser: UDP Header");
-            p->AddHeader(udp_hd);
-            break;
-        case 0x06:
-            NS_LOG_DEBUG("Reverse Parser: TCP Header");
-            p->AddHeader(tcp_hd);
-            break;
-        case 0x0800:
-            NS_LOG_DEBUG("Reverse Parser: IPv4 Header");
-            p->AddHeader(ip_hd);
-            break;
-        case 0x1:
-            NS_LOG_DEBUG("Reverse Parser: Ethernet Header");
-            p->AddHeader(eeh_hd);
-            break;
-        default:
-            NS_LOG_DEBUG("Reverse Parser: Unknown Header");
-            break;
-        }
+        std::memmove(data + kept, data + from, cuts[i].first - from);
+        kept += cuts[i].first - from;
+        from = cuts[i].second;
     }
 
-    // // @PrintHD
-    // std::cout << "[Receiver] After reverse parsing to normal packet: " << std::endl;
-    // p->Print(std::cout);
-    // std::cout << " " << std::endl;
+    p->RemoveAtStart(from);
+    PutBackFront(p, kept);
 }
 
 void
@@ -711,6 +885,10 @@ CustomP2PNetDevice::DoDispose()
     m_channel = 0;
     m_receiveErrorModel = 0;
     m_currentPkt = 0;
+    m_currentTrain.clear();
+    m_trainStarts.clear();
+    m_backgroundFlows.clear();
+    m_switchPortCallback.Nullify();
     NetDevice::DoDispose();
 }
 
@@ -728,6 +906,102 @@ CustomP2PNetDevice::SetInterframeGap(Time t)
     m_tInterframeGap = t;
 }
 
+int
+CustomP2PNetDevice::AddBackgroundFlow(DataRate rate, uint32_t packetSize, Time start, Time stop)
+{
+    NS_LOG_FUNCTION(this << rate << packetSize << start.As(Time::S) << stop.As(Time::S));
+    if (rate.GetBitRate() == 0 || packetSize == 0 || stop <= start)
+    {
+        NS_LOG_WARN("Ignoring invalid background flow: rate " << rate << ", packet size "
+                                                              << packetSize << ", active from "
+                                                              << start.As(Time::S) << " to "
+                                                              << stop.As(Time::S));
+        return -1;
+    }
+    m_backgroundFlows.push_back(BackgroundFlow{rate, packetSize, start, stop});
+    return static_cast<int>(m_backgroundFlows.size() - 1);
+}
+
+void
+CustomP2PNetDevice::ClearBackgroundFlows(void)
+{
+    NS_LOG_FUNCTION(this);
+    m_backgroundFlows.clear();
+}
+
+double
+CustomP2PNetDevice::GetBackgroundLoad(void) const
+{
+    double meanService;
+    return GetBackgroundLoad(meanService);
+}
+
+double
+CustomP2PNetDevice::GetBackgroundLoad(double& meanService) const
+{
+    meanService = 0;
+    double linkBps = m_bps.GetBitRate();
+    if (m_backgroundFlows.empty() || linkBps == 0)
+    {
+        return 0;
+    }
+
+    Time now = Simulator::Now();
+    double bgBps = 0;
+    double bgPacketRate = 0;
+    for (const BackgroundFlow& flow : m_backgroundFlows)
+    {
+        if (flow.start <= now && now < flow.stop)
+        {
+            bgBps += flow.rate.GetBitRate();
+            bgPacketRate += flow.rate.GetBitRate() / (8.0 * flow.packetSize);
+        }
+    }
+    if (bgBps == 0)
+    {
+        return 0;
+    }
+    meanService = bgBps / bgPacketRate / linkBps;
+    return std::min(bgBps / linkBps, m_maxBackgroundLoad);
+}
+
+Time
+CustomP2PNetDevice::GetNextBackgroundChange(void) const
+{
+    Time now = Simulator::Now();
+    Time next = Time::Max();
+    for (const BackgroundFlow& flow : m_backgroundFlows)
+    {
+        if (now < flow.start)
+        {
+            next = std::min(next, flow.start);
+        }
+        else if (now < flow.stop)
+        {
+            next = std::min(next, flow.stop);
+        }
+    }
+    return next;
+}
+
+Time
+CustomP2PNetDevice::CalculateTxTime(uint32_t bytes, Time& queueDelay) const
+{
+    queueDelay = Time(0);
+    double meanService;
+    double rho = GetBackgroundLoad(meanService);
+    if (rho == 0)
+    {
+        return m_bps.CalculateBytesTxTime(bytes);
+    }
+
+    // Fluid model: the background takes its share of the rate, and a packet
+    // waits behind the background packets as in an M/D/1 queue:
+    // Wq = rho * S / (2 * (1 - rho)), S being the mean background service time.
+    queueDelay = Seconds(rho * meanService / (2 * (1 - rho)));
+    return Seconds(8.0 * bytes / (m_bps.GetBitRate() * (1 - rho)));
+}
+
 bool
 CustomP2PNetDevice::TransmitStart(Ptr<Packet> p)
 {
@@ -740,17 +1014,31 @@ CustomP2PNetDevice::TransmitStart(Ptr<Packet> p)
     // schedule an event that will be executed when the transmission is complete.
     //
     NS_ASSERT_MSG(m_txMachineState == READY, "Must be READY to transmit");
+    // The queued packets of a train are traced when they are taken off the
+    // queue, which can be after their start. Keep single packets for sinks
+    // that need the exact times.
+    if (m_trainLength > 1 && !m_queue->IsEmpty() && m_phyTxBeginTrace.IsEmpty() &&
+        m_snifferTrace.IsEmpty() && m_promiscSnifferTrace.IsEmpty())
+    {
+        return TransmitTrain(p);
+    }
+
     m_txMachineState = BUSY;
     m_currentPkt = p;
     m_phyTxBeginTrace(m_currentPkt);
 
-    Time txTime = m_bps.CalculateBytesTxTime(p->GetSize());
+    Time queueDelay;
+    Time txTime = CalculateTxTime(p->GetSize(), queueDelay);
     Time txCompleteTime = txTime + m_tInterframeGap;
 
     NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.As(Time::S));
     Simulator::Schedule(txCompleteTime, &CustomP2PNetDevice::TransmitComplete, this);
+    if (P4EventProfiler::IsEnabled())
+    {
+        P4EventProfiler::RecordScheduled(P4EventProfiler::DEVICE_TRANSMIT, m_nodeId);
+    }
 
-    bool result = m_channel->TransmitStart(p, this, txTime);
+    bool result = m_channel->TransmitStart(p, this, txTime, queueDelay);
     if (result == false)
     {
         m_phyTxDropTrace(p);
@@ -758,10 +1046,92 @@ CustomP2PNetDevice::TransmitStart(Ptr<Packet> p)
     return result;
 }
 
+bool
+CustomP2PNetDevice::TransmitTrain(Ptr<Packet> p)
+{
+    NS_LOG_FUNCTION(this << p);
+    m_txMachineState = BUSY;
+    m_currentTrain.clear();
+    m_trainTx.clear();
+    m_trainStarts.clear();
+
+    m_phyTxBeginTrace(p);
+    Time queueDelay;
+    Time txTime = CalculateTxTime(p->GetSize(), queueDelay);
+    m_trainTx.push_back(P4P2PChannel::TrainPacket{p, Seconds(0), txTime, queueDelay});
+    Time start = txTime + m_tInterframeGap;
+
+    // The packets already queued go out back to back, so their start times are
+    // known now: each one starts when the previous one and its gap are done.
+    // They stay in the queue until then, see DequeueStartedTrainPackets. The
+    // train stops before the background load changes, as the transmission
+    // times are computed with the load of now.
+    Time now = Simulator::Now();
+    Time loadChange = GetNextBackgroundChange();
+    for (const Ptr<Packet>& next : m_queue->GetContainer())
+    {
+        if (m_trainTx.size() >= m_trainLength || now + start >= loadChange)
+        {
+            break;
+        }
+        txTime = CalculateTxTime(next->GetSize(), queueDelay);
+        m_trainTx.push_back(P4P2PChannel::TrainPacket{next, start, txTime, queueDelay});
+        m_trainStarts.push_back(now + start);
+        start += txTime + m_tInterframeGap;
+    }
+    m_currentPkt = m_trainTx.back().packet;
+
+    NS_LOG_LOGIC("Train of " << m_trainTx.size() << " packets, TransmitCompleteEvent in "
+                             << start.As(Time::S));
+    Simulator::Schedule(start, &CustomP2PNetDevice::TransmitComplete, this);
+    if (P4EventProfiler::IsEnabled())
+    {
+        P4EventProfiler::RecordScheduled(P4EventProfiler::DEVICE_TRANSMIT, m_nodeId);
+    }
+
+    bool result = m_channel->TransmitTrain(m_trainTx, this);
+    if (result == false)
+    {
+        for (const auto& entry : m_trainTx)
+        {
+            m_phyTxDropTrace(entry.packet);
+        }
+    }
+
+    // The packets are only kept until the end of the train for the PhyTxEnd
+    // sinks. Holding them otherwise would make the channel copy every packet
+    // of the train that arrives before the train is done.
+    if (!m_phyTxEndTrace.IsEmpty())
+    {
+        for (const auto& entry : m_trainTx)
+        {
+            m_currentTrain.push_back(entry.packet);
+        }
+    }
+    m_trainTx.clear();
+    return result;
+}
+
+void
+CustomP2PNetDevice::DequeueStartedTrainPackets(void)
+{
+    Time now = Simulator::Now();
+    while (!m_trainStarts.empty() && m_trainStarts.front() <= now)
+    {
+        m_trainStarts.pop_front();
+        Ptr<Packet> p = m_queue->Dequeue();
+        NS_ASSERT_MSG(p != nullptr, "Packet of the current train missing from the queue");
+        m_snifferTrace(p);
+        m_promiscSnifferTrace(p);
+        m_phyTxBeginTrace(p);
+    }
+}
+
 void
 CustomP2PNetDevice::TransmitComplete(void)
 {
     NS_LOG_FUNCTION(this);
+    P4EventProfiler::Scope profile(P4EventProfiler::DEVICE_TRANSMIT, m_nodeId);
 
     //
     // This function is called to when we're all done transmitting a packet.
@@ -775,9 +1145,22 @@ CustomP2PNetDevice::TransmitComplete(void)
     NS_ASSERT_MSG(m_currentPkt != nullptr,
                   "CustomP2PNetDevice::TransmitComplete(): m_currentPkt zero");
 
-    m_phyTxEndTrace(m_currentPkt);
+    if (m_currentTrain.empty())
+    {
+        m_phyTxEndTrace(m_currentPkt);
+    }
+    else
+    {
+        for (const auto& packet : m_currentTrain)
+        {
+            m_phyTxEndTrace(packet);
+        }
+        m_currentTrain.clear();
+    }
     m_currentPkt = nullptr;
 
+    DequeueStartedTrainPackets();
+    NS_ASSERT_MSG(m_trainStarts.empty(), "Train packets left in the queue after the train");
     Ptr<Packet> p = m_queue->Dequeue();
     if (p == nullptr)
     {
@@ -829,6 +1212,7 @@ void
 CustomP2PNetDevice::Receive(Ptr<Packet> packet)
 {
     NS_LOG_FUNCTION(this << packet);
+    P4EventProfiler::Scope profile(P4EventProfiler::CHANNEL_DELIVERY, m_nodeId);
     uint16_t protocol = 0;
 
     NS_LOG_LOGIC("Receiver SIDE Start: ");
@@ -857,9 +1241,13 @@ CustomP2PNetDevice::Receive(Ptr<Packet> packet)
 
         //
         // Trace sinks will expect complete packets, not packets without some of the
-        // headers.
+        // headers. Only pay for the copy when one of them is connected.
         //
-        Ptr<Packet> originalPacket = packet->Copy();
+        Ptr<Packet> originalPacket;
+        if (!m_macRxTrace.IsEmpty() || !m_macPromiscRxTrace.IsEmpty())
+        {
+            originalPacket = packet->Copy();
+        }
 
         // EthernetHeader eeh_hd;
         // bool hasEthernet = originalPacket->PeekHeader(eeh_hd);
@@ -874,7 +1262,33 @@ CustomP2PNetDevice::Receive(Ptr<Packet> packet)
         // there is no difference in what the promisc callback sees and what the
         // normal receive callback sees.
         //
-        ProcessHeader(packet, protocol); // the original pacekt have etherent header
+        Address source;
+        Address destination;
+        if (IsFramePassThrough())
+        {
+            // Hand the frame up as it is, its Ethernet header only provides
+            // the metadata
+            uint8_t eth[ETH_HEADER_LENGTH];
+            if (packet->CopyData(eth, ETH_HEADER_LENGTH) < ETH_HEADER_LENGTH)
+            {
+                NS_LOG_WARN("Frame shorter than an Ethernet header, dropped");
+                m_phyRxDropTrace(packet);
+                return;
+            }
+            Mac48Address dst48;
+            Mac48Address src48;
+            dst48.CopyFrom(eth);
+            src48.CopyFrom(eth + 6);
+            destination = dst48;
+            source = src48;
+            protocol = (eth[12] << 8) | eth[13];
+        }
+        else
+        {
+            ProcessHeader(packet, protocol); // the original pacekt have etherent header
+            source = GetRemote();
+            destination = GetAddress();
+        }
 
         // RemoveEthernetHeader(packet);
         // if (hasEthernet)
@@ -895,19 +1309,42 @@ CustomP2PNetDevice::Receive(Ptr<Packet> packet)
         // originalPacket->Print(std::cout);
         // std::cout << " " << std::endl;
 
+        if (!m_switchPortCallback.IsNull())
+        {
+            // Bound as a switch port: skip the dispatch of the node
+            if (originalPacket)
+            {
+                m_macPromiscRxTrace(originalPacket);
+                m_macRxTrace(originalPacket);
+            }
+            m_switchPortCallback(m_switchPort,
+                                 packet,
+                                 protocol,
+                                 source,
+                                 destination,
+                                 NetDevice::PACKET_HOST);
+            return;
+        }
+
         if (!m_promiscCallback.IsNull())
         {
-            m_macPromiscRxTrace(originalPacket);
+            if (originalPacket)
+            {
+                m_macPromiscRxTrace(originalPacket);
+            }
             m_promiscCallback(this,
                               packet,
                               protocol,
-                              GetRemote(),
-                              GetAddress(),
+                              source,
+                              destination,
                               NetDevice::PACKET_HOST);
         }
 
-        m_macRxTrace(originalPacket);
-        m_rxCallback(this, packet, protocol, GetRemote());
+        if (originalPacket)
+        {
+            m_macRxTrace(originalPacket);
+        }
+        m_rxCallback(this, packet, protocol, source);
     }
 }
 
@@ -1099,11 +1536,28 @@ CustomP2PNetDevice::SendFrom(Ptr<Packet> packet,
     NS_LOG_DEBUG("### Packet length total " << packet->GetSize());
 
     m_macTxTrace(packet);
+    return EnqueueFrame(packet);
+}
+
+bool
+CustomP2PNetDevice::SendFrame(Ptr<Packet> frame)
+{
+    NS_LOG_FUNCTION(this << frame);
+    NS_ASSERT(IsLinkUp());
+
+    m_macTxTrace(frame);
+    return EnqueueFrame(frame);
+}
 
+bool
+CustomP2PNetDevice::EnqueueFrame(Ptr<Packet> packet)
+{
     //
     // Place the packet to be sent on the send queue.  Note that the
-    // queue may fire a drop trace, but we will too.
+    // queue may fire a drop trace, but we will too. Packets of the current
+    // train that have started must leave the queue first.
     //
+    DequeueStartedTrainPackets();
     if (m_queue->Enqueue(packet) == false)
     {
         m_macTxDropTrace(packet);
@@ -1121,7 +1575,7 @@ CustomP2PNetDevice::SendFrom(Ptr<Packet> packet,
         {
             Ptr<Packet> packet = m_queue->Dequeue();
             NS_ASSERT_MSG(packet != nullptr,
-                          "CustomP2PNetDevice::SendFrom(): IsEmpty false but no packet on queue?");
+                          "CustomP2PNetDevice::EnqueueFrame(): IsEmpty false but no packet on queue?");
             m_currentPkt = packet;
             m_promiscSnifferTrace(m_currentPkt);
             m_snifferTrace(m_currentPkt);
@@ -1143,6 +1597,7 @@ CustomP2PNetDevice::SetNode(Ptr<Node> node)
 {
     NS_LOG_FUNCTION(this);
     m_node = node;
+    m_nodeId = node ? node->GetId() : 0;
 }
 
 bool
@@ -1219,6 +1674,40 @@ CustomP2PNetDevice::SetWithCustomHeader(bool withHeader)
     m_NeedProcessHeader = withHeader;
 }
 
+void
+CustomP2PNetDevice::SetFramePassThrough(bool enable)
+{
+    NS_LOG_FUNCTION(this << enable);
+    m_framePassThrough = enable;
+}
+
+bool
+CustomP2PNetDevice::IsFramePassThrough(void) const
+{
+    return m_framePassThrough && !m_NeedProcessHeader;
+}
+
+void
+CustomP2PNetDevice::BindSwitchPort(SwitchPortCallback callback, uint32_t port)
+{
+    NS_LOG_FUNCTION(this << port);
+    m_switchPortCallback = callback;
+    m_switchPort = port;
+}
+
+void
+CustomP2PNetDevice::UnbindSwitchPort(void)
+{
+    NS_LOG_FUNCTION(this);
+    m_switchPortCallback.Nullify();
+}
+
+bool
+CustomP2PNetDevice::IsSwitchPortBound(void) const
+{
+    return !m_switchPortCallback.IsNull();
+}
+
 bool
 CustomP2PNetDevice::IsWithCustomHeader(void) const
 {
@@ -40,6 +40,8 @@
 #include <ns3/udp-header.h>
 
 #include <cstring>
+#include <deque>
+#include <vector>
 
 namespace ns3
 {
@@ -47,6 +49,21 @@ namespace ns3
 class ErrorModel;
 class P4P2PChannel;
 
+/**
+ * \brief Headers at the front of an outgoing packet, parsed once per packet
+ *
+ * Filled by CustomP2PNetDevice::ParseHeaderChain and shared by the custom
+ * port classification and the layer handlers. The IPv4 header bytes stay in
+ * the device's splice buffer until the handlers put them back.
+ */
+struct P4PacketLayout
+{
+    uint32_t ipv4Length{0};      //!< IPv4 header length, 0 if the packet does not start with IPv4
+    uint8_t ipProtocol{0};       //!< IPv4 protocol field
+    uint32_t transportLength{0}; //!< UDP/TCP header length right after IPv4, 0 if unknown
+    uint16_t dstPort{0};         //!< UDP/TCP destination port, 0 if unknown
+};
+
 class CustomP2PNetDevice : public NetDevice
 {
   public:
@@ -58,13 +75,28 @@ class CustomP2PNetDevice : public NetDevice
     bool RemoveEthernetHeader(Ptr<Packet> p);
 
     uint16_t GetDstPort(Ptr<Packet> p);
+
+    /**
+     * Parse the IPv4 and UDP/TCP headers at the front of an outgoing packet.
+     * The packet is not modified.
+     * \param p the packet, starting with the IPv4 header
+     * \param layout the parsed layout
+     */
+    void ParseHeaderChain(Ptr<Packet> p, P4PacketLayout& layout);
+
     bool HandleTransportLayerHeader(Ptr<Packet> p,
                                     CustomHeader& cus_hd,
-                                    uint16_t protocol,
+                                    const P4PacketLayout& layout,
                                     bool removeHeader = false);
     void HandleLayer2(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHeader& eeh_header);
-    void HandleLayer3(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHeader& eeh_header);
-    void HandleLayer4(Ptr<Packet> p, CustomHeader& cus_hd, EthernetHeader& eeh_header);
+    void HandleLayer3(Ptr<Packet> p,
+                      CustomHeader& cus_hd,
+                      EthernetHeader& eeh_header,
+                      const P4PacketLayout& layout);
+    void HandleLayer4(Ptr<Packet> p,
+                      CustomHeader& cus_hd,
+                      EthernetHeader& eeh_header,
+                      const P4PacketLayout& layout);
 
     /**
      * Set the Data Rate used for transmission of packets.  The data rate is
@@ -83,6 +115,35 @@ class CustomP2PNetDevice : public NetDevice
      */
     void SetInterframeGap(Time t);
 
+    /**
+     * Declare a background flow leaving through this device.
+     *
+     * Background flows are not simulated per packet and cost no events. While
+     * a flow is active, its rate is reserved on the link: packets sent through
+     * this device are serialized at the remaining data rate, and reach the wire
+     * after the mean waiting time of an M/D/1 queue fed by the background
+     * packets.
+     *
+     * \param rate the rate of the flow
+     * \param packetSize the mean packet size of the flow, in bytes
+     * \param start the simulation time at which the flow starts
+     * \param stop the simulation time at which the flow stops
+     * \return the index of the flow, or -1 if the flow is invalid
+     */
+    int AddBackgroundFlow(DataRate rate, uint32_t packetSize, Time start, Time stop);
+
+    /**
+     * Remove all the background flows of this device.
+     */
+    void ClearBackgroundFlows(void);
+
+    /**
+     * Get the share of the data rate currently taken by background flows.
+     *
+     * \return the background load, capped at the MaxBackgroundLoad attribute
+     */
+    double GetBackgroundLoad(void) const;
+
     /**
      * Attach the device to a channel.
      *
@@ -130,12 +191,86 @@ class CustomP2PNetDevice : public NetDevice
      */
     void Receive(Ptr<Packet> p);
 
+    /**
+     * Take the packets of the current train that have started by now off the
+     * transmit queue.
+     *
+     * Train packets are taken off lazily: before a packet is queued, at the
+     * end of the train, and by the channel before it hands a packet of this
+     * device to the peer.
+     */
+    void DequeueStartedTrainPackets(void);
+
     void SetWithCustomHeader(bool withHeader);
 
     bool IsWithCustomHeader(void) const;
 
     void SetCustomHeader(CustomHeader customHeader);
 
+    /**
+     * Let complete frames pass through the device unchanged.
+     *
+     * Used for the ports of a P4 switch, whose P4 program owns the L2
+     * header. Received frames are handed up with their Ethernet header, the
+     * EtherType and the addresses are taken from the frame as metadata, and
+     * frames given to SendFrame are transmitted as they are. Has no effect
+     * while the device handles a custom header.
+     *
+     * \param enable true to let frames pass through
+     */
+    void SetFramePassThrough(bool enable);
+
+    /**
+     * \returns true if frames currently pass through the device unchanged
+     */
+    bool IsFramePassThrough(void) const;
+
+    /**
+     * Transmit a complete frame as it is.
+     *
+     * The frame must start with its Ethernet header, no header is added.
+     *
+     * \param frame the frame to transmit
+     * \returns true if the frame was queued for transmission
+     */
+    bool SendFrame(Ptr<Packet> frame);
+
+    /**
+     * Callback handing a received frame directly to the switch owning the
+     * device: port number, packet, protocol, source, destination, packet type.
+     */
+    typedef Callback<void,
+                     uint32_t,
+                     Ptr<Packet>,
+                     uint16_t,
+                     const Address&,
+                     const Address&,
+                     NetDevice::PacketType>
+        SwitchPortCallback;
+
+    /**
+     * Bind the device as a port of a switch.
+     *
+     * Received frames go straight to the callback, tagged with the port
+     * number, instead of through the promiscuous and protocol handler
+     * dispatch of the node. Handlers registered on the node for this device
+     * are no longer called.
+     *
+     * \param callback the switch receive entry point
+     * \param port the number of the port on the switch
+     */
+    void BindSwitchPort(SwitchPortCallback callback, uint32_t port);
+
+    /**
+     * Remove the switch binding, received frames go to the node again.
+     */
+    void UnbindSwitchPort(void);
+
+    /**
+     * @returns true if the device is bound as a switch port
+     */
+    bool IsSwitchPortBound(void) const;
+
     // The remaining methods are documented in ns3::NetDevice*
 
     virtual void SetIfIndex(const uint32_t index);
@@ -271,6 +406,21 @@ class CustomP2PNetDevice : public NetDevice
     /** */
     void RestoreHeaders(Ptr<Packet> p);
 
+    /**
+     * Copy the first bytes of a packet into the splice buffer
+     * \param p the packet
+     * \param size number of bytes wanted
+     * \return number of bytes copied, less than size if the packet is shorter
+     */
+    uint32_t CopyPacketFront(Ptr<Packet> p, uint32_t size);
+
+    /**
+     * Add the first bytes of the splice buffer back in front of a packet
+     * \param p the packet
+     * \param size number of bytes
+     */
+    void PutBackFront(Ptr<Packet> p, uint32_t size);
+
     /**
      * Start Sending a Packet Down the Wire.
      *
@@ -288,6 +438,56 @@ class CustomP2PNetDevice : public NetDevice
      */
     bool TransmitStart(Ptr<Packet> p);
 
+    /**
+     * Queue a framed packet and start transmitting if the device is idle.
+     *
+     * \param packet the framed packet
+     * \returns true if the packet was queued
+     */
+    bool EnqueueFrame(Ptr<Packet> packet);
+
+    /**
+     * Start sending a train of back-to-back packets.
+     *
+     * Used instead of TransmitStart when trains are enabled and more packets
+     * are waiting in the queue. Up to m_trainLength packets, starting with p,
+     * are handed to the channel at once; a single TransmitComplete event is
+     * scheduled for the end of the train. The queued packets of the train stay
+     * in the queue until they have started, and the train ends before the next
+     * start or stop of a background flow.
+     *
+     * \see P4P2PChannel::TransmitTrain ()
+     * \param p the first packet of the train
+     * \returns true if success, false on failure
+     */
+    bool TransmitTrain(Ptr<Packet> p);
+
+    /**
+     * Get the next time at which a background flow starts or stops.
+     *
+     * \returns the time, or Time::Max () if the background load stays as it is
+     */
+    Time GetNextBackgroundChange(void) const;
+
+    /**
+     * Calculate the transmission time of a packet, given the background
+     * flows active now.
+     *
+     * \param bytes the size of the packet
+     * \param queueDelay set to the modeled waiting time behind background packets
+     * \returns the transmission time
+     */
+    Time CalculateTxTime(uint32_t bytes, Time& queueDelay) const;
+
+    /**
+     * Get the background load active now.
+     *
+     * \param meanService set to the mean transmission time of a background
+     * packet at the full data rate, in seconds
+     * \returns the background load, capped at m_maxBackgroundLoad
+     */
+    double GetBackgroundLoad(double& meanService) const;
+
     /**
      * Stop Sending a Packet Down the Wire and Begin the Interframe Gap.
      *
@@ -457,10 +657,18 @@ class CustomP2PNetDevice : public NetDevice
     TracedCallback<Ptr<const Packet>> m_promiscSnifferTrace;
 
     Ptr<Node> m_node;       //!< Node owning this NetDevice
+    uint32_t m_nodeId{0};   //!< Id of m_node, for the event profiler
     Mac48Address m_address; //!< Mac48Address of this NetDevice
 
     bool m_NeedProcessHeader; //!< Identify if the device should take care of custom header
     CustomHeader m_header;    //!< Custom header
+    bool m_framePassThrough;  //!< Frames pass through unchanged (P4 switch port)
+    SwitchPortCallback m_switchPortCallback; //!< Switch receive entry, if bound
+    uint32_t m_switchPort;                   //!< Port number on the bound switch
+
+    // Bytes lifted off the packet front while the custom header is spliced in
+    // or out at its offset. Kept across packets so splicing does not allocate.
+    std::vector<uint8_t> m_spliceBuffer;
 
     NetDevice::ReceiveCallback m_rxCallback;             //!< Receive callback
     NetDevice::PromiscReceiveCallback m_promiscCallback; //!< Receive callback
@@ -494,6 +702,25 @@ class CustomP2PNetDevice : public NetDevice
 
     Ptr<Packet> m_currentPkt; //!< Current packet processed
 
+    uint32_t m_trainLength;                           //!< Max packets per train, 1 disables trains
+    std::vector<Ptr<Packet>> m_currentTrain;          //!< Train in flight, kept for PhyTxEnd sinks
+    std::vector<P4P2PChannel::TrainPacket> m_trainTx; //!< Train handed to the channel
+    std::deque<Time> m_trainStarts;                   //!< Starts of the train packets still queued
+
+    /**
+     * \brief Background flow modeled as a fluid
+     */
+    struct BackgroundFlow
+    {
+        DataRate rate;       //!< Rate of the flow
+        uint32_t packetSize; //!< Mean packet size, in bytes
+        Time start;          //!< Start time of the flow
+        Time stop;           //!< Stop time of the flow
+    };
+
+    std::vector<BackgroundFlow> m_backgroundFlows; //!< Background flows of this device
+    double m_maxBackgroundLoad;                    //!< Cap of the background load
+
     // /**
     //  * \brief PPP to Ethernet protocol number mapping
     //  * \param protocol A PPP protocol number
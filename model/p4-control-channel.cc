@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#include "ns3/p4-control-channel.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("P4ControlChannel");
+NS_OBJECT_ENSURE_REGISTERED(P4ControlChannel);
+
+TypeId P4ControlChannel::GetTypeId(void) {
+  static TypeId tid =
+      TypeId("ns3::P4ControlChannel")
+          .SetParent<Object>()
+          .SetGroupName("P4sim")
+          .AddConstructor<P4ControlChannel>()
+          .AddAttribute("Delay",
+                        "One-way delay between the controller and a switch.",
+                        TimeValue(Seconds(0)),
+                        MakeTimeAccessor(&P4ControlChannel::m_delay),
+                        MakeTimeChecker())
+          .AddAttribute("DataRate",
+                        "Rate of the downlink to each switch, 0 for unlimited.",
+                        DataRateValue(DataRate(0)),
+                        MakeDataRateAccessor(&P4ControlChannel::m_rate),
+                        MakeDataRateChecker())
+          .AddAttribute("MaxBatchSize",
+                        "Maximum number of requests sent as one batch.",
+                        UintegerValue(1024),
+                        MakeUintegerAccessor(&P4ControlChannel::m_maxBatchSize),
+                        MakeUintegerChecker<uint32_t>(1))
+          .AddAttribute(
+              "BatchHeaderBytes", "Framing overhead of one batch in bytes.",
+              UintegerValue(64),
+              MakeUintegerAccessor(&P4ControlChannel::m_batchHeaderBytes),
+              MakeUintegerChecker<uint32_t>())
+          .AddTraceSource("BatchApplied",
+                          "A batch of requests was applied at a switch.",
+                          MakeTraceSourceAccessor(
+                              &P4ControlChannel::m_batchTrace),
+                          "ns3::P4ControlChannel::BatchTracedCallback");
+  return tid;
+}
+
+P4ControlChannel::P4ControlChannel() { NS_LOG_FUNCTION(this); }
+
+P4ControlChannel::~P4ControlChannel() { NS_LOG_FUNCTION(this); }
+
+void P4ControlChannel::DoDispose() {
+  NS_LOG_FUNCTION(this);
+  // Every pending event of the channel captures it, none may run after this.
+  for (auto &link : m_links) {
+    link.second.sendEvent.Cancel();
+    link.second.txEvent.Cancel();
+    for (EventId &event : link.second.batchEvents) {
+      event.Cancel();
+    }
+  }
+  m_links.clear();
+  Object::DoDispose();
+}
+
+bool P4ControlChannel::IsIdeal() const {
+  return m_delay.IsZero() && m_rate.GetBitRate() == 0;
+}
+
+void P4ControlChannel::Submit(uint32_t switchIndex, Operation operation,
+                              uint32_t bytes, Completion completion) {
+  NS_LOG_FUNCTION(this << switchIndex << bytes);
+
+  if (IsIdeal()) {
+    int result = operation();
+    if (completion) {
+      completion(result);
+    }
+    return;
+  }
+
+  Link &link = m_links[switchIndex];
+  link.queue.push_back({std::move(operation), std::move(completion), bytes, 0});
+  link.outstanding++;
+
+  // Requests submitted later in this event join the same batch.
+  if (!link.busy && !link.sendEvent.IsRunning()) {
+    link.sendEvent = Simulator::ScheduleNow(&P4ControlChannel::SendBatch, this,
+                                            switchIndex);
+  }
+}
+
+void P4ControlChannel::SendBatch(uint32_t switchIndex) {
+  Link &link = m_links[switchIndex];
+  if (link.queue.empty()) {
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  uint32_t count = std::min<size_t>(link.queue.size(), m_maxBatchSize);
+  batch->reserve(count);
+  uint64_t bytes = m_batchHeaderBytes;
+  for (uint32_t i = 0; i < count; i++) {
+    bytes += link.queue.front().bytes;
+    batch->push_back(std::move(link.queue.front()));
+    link.queue.pop_front();
+  }
+  link.batches++;
+
+  Time txTime = m_rate.GetBitRate() > 0 ? m_rate.CalculateBytesTxTime(bytes)
+                                        : Seconds(0);
+  NS_LOG_DEBUG("Switch " << switchIndex << ": batch of " << count
+                         << " requests, " << bytes << " bytes, tx " << txTime);
+
+  link.busy = true;
+  link.txEvent = Simulator::Schedule(
+      txTime, &P4ControlChannel::TransmitComplete, this, switchIndex);
+  EventId apply =
+      Simulator::Schedule(txTime + m_delay, [this, switchIndex, batch, bytes]() {
+        m_batchTrace(switchIndex, batch->size(), bytes);
+        ApplyBatch(switchIndex, batch);
+      });
+  TrackBatchEvent(link, apply);
+}
+
+void P4ControlChannel::TrackBatchEvent(Link &link, EventId event) {
+  // Events of earlier batches run first, drop those that are done.
+  while (!link.batchEvents.empty() && link.batchEvents.front().IsExpired()) {
+    link.batchEvents.pop_front();
+  }
+  link.batchEvents.push_back(event);
+}
+
+void P4ControlChannel::TransmitComplete(uint32_t switchIndex) {
+  Link &link = m_links[switchIndex];
+  link.busy = false;
+  if (!link.queue.empty()) {
+    SendBatch(switchIndex);
+  }
+}
+
+void P4ControlChannel::ApplyBatch(uint32_t switchIndex,
+                                  std::shared_ptr<Batch> batch) {
+  NS_LOG_FUNCTION(this << switchIndex << batch->size());
+  for (auto &request : *batch) {
+    request.result = request.operation();
+  }
+  // Replies are small, only the propagation delay is modeled on the way back.
+  EventId complete = Simulator::Schedule(
+      m_delay, &P4ControlChannel::CompleteBatch, this, switchIndex, batch);
+  TrackBatchEvent(m_links[switchIndex], complete);
+}
+
+void P4ControlChannel::CompleteBatch(uint32_t switchIndex,
+                                     std::shared_ptr<Batch> batch) {
+  NS_LOG_FUNCTION(this << switchIndex << batch->size());
+  Link &link = m_links[switchIndex];
+  link.outstanding -= batch->size();
+  for (auto &request : *batch) {
+    if (request.completion) {
+      request.completion(request.result);
+    }
+  }
+}
+
+uint32_t P4ControlChannel::GetOutstanding(uint32_t switchIndex) const {
+  auto it = m_links.find(switchIndex);
+  return it == m_links.end() ? 0 : it->second.outstanding;
+}
+
+uint64_t P4ControlChannel::GetBatchCount(uint32_t switchIndex) const {
+  auto it = m_links.find(switchIndex);
+  return it == m_links.end() ? 0 : it->second.batches;
+}
+
+} // namespace ns3
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#ifndef P4_CONTROL_CHANNEL_H
+#define P4_CONTROL_CHANNEL_H
+
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/traced-callback.h"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief Modeled control channel between a controller and its switches.
+ *
+ * Every switch has its own downlink from the controller. Requests submitted
+ * for a switch are queued on its downlink and sent in batches: all requests
+ * submitted during the same simulation event, up to MaxBatchSize, leave as
+ * one batch. A batch occupies the downlink for its serialization time at
+ * DataRate, reaches the switch Delay later, and is applied there in one
+ * event, in submission order. The results return to the controller after a
+ * further Delay, where the completion callbacks run in one event. While a
+ * batch is in flight the next one is already serialized, so a long stream of
+ * requests is pipelined instead of paying one round trip each.
+ *
+ * With a zero Delay and a zero DataRate (the defaults) the channel is ideal:
+ * a request is applied and completed within Submit, as with the synchronous
+ * P4Controller calls.
+ */
+class P4ControlChannel : public Object {
+public:
+  /**
+   * @brief The operation carried by a request, run at the switch.
+   *        Returns 0 on success.
+   */
+  typedef std::function<int()> Operation;
+
+  /**
+   * @brief Called at the controller with the result of the operation.
+   */
+  typedef std::function<void(int result)> Completion;
+
+  /**
+   * @brief Register the P4ControlChannel class with the NS-3 type system.
+   * @return TypeId for the P4ControlChannel class.
+   */
+  static TypeId GetTypeId(void);
+
+  P4ControlChannel();
+  ~P4ControlChannel() override;
+
+  /**
+   * @brief Queue a request for a switch.
+   * @param switchIndex Index of the switch, selects the downlink.
+   * @param operation The operation to apply at the switch.
+   * @param bytes Encoded size of the request, without the per-batch header.
+   * @param completion Called with the result once the reply is back, may be
+   * empty.
+   */
+  void Submit(uint32_t switchIndex, Operation operation, uint32_t bytes,
+              Completion completion = Completion());
+
+  /**
+   * @brief Check whether the channel applies requests within Submit.
+   * @return true for a zero Delay and a zero DataRate.
+   */
+  bool IsIdeal() const;
+
+  /**
+   * @brief Number of requests submitted for a switch and not yet completed.
+   * @param switchIndex Index of the switch.
+   * @return the number of outstanding requests.
+   */
+  uint32_t GetOutstanding(uint32_t switchIndex) const;
+
+  /**
+   * @brief Number of batches sent to a switch so far.
+   * @param switchIndex Index of the switch.
+   * @return the number of batches.
+   */
+  uint64_t GetBatchCount(uint32_t switchIndex) const;
+
+  /**
+   * @brief TracedCallback signature for delivered batches.
+   * @param switchIndex Index of the switch.
+   * @param requests Number of requests in the batch.
+   * @param bytes Size of the batch, header included.
+   */
+  typedef void (*BatchTracedCallback)(uint32_t switchIndex, uint32_t requests,
+                                      uint32_t bytes);
+
+protected:
+  void DoDispose() override;
+
+private:
+  /**
+   * @brief One queued request.
+   */
+  struct Request {
+    Operation operation;   //!< Applied at the switch
+    Completion completion; //!< Called with the result
+    uint32_t bytes;        //!< Encoded size
+    int result;            //!< Result of the operation, once applied
+  };
+
+  typedef std::vector<Request> Batch; //!< Requests sent together
+
+  /**
+   * @brief Downlink state of one switch.
+   */
+  struct Link {
+    std::deque<Request> queue; //!< Submitted, not yet sent
+    EventId sendEvent;         //!< Pending SendBatch
+    EventId txEvent;           //!< Pending TransmitComplete
+    std::deque<EventId> batchEvents; //!< Apply and completion of batches
+    bool busy{false};          //!< A batch is being serialized
+    uint32_t outstanding{0};   //!< Submitted, not yet completed
+    uint64_t batches{0};       //!< Batches sent
+  };
+
+  /**
+   * @brief Keep a batch event of a link, so it can be cancelled on dispose.
+   * @param link The link.
+   * @param event The event.
+   */
+  static void TrackBatchEvent(Link &link, EventId event);
+
+  /**
+   * @brief Take the next batch off the queue and put it on the downlink.
+   * @param switchIndex Index of the switch.
+   */
+  void SendBatch(uint32_t switchIndex);
+
+  /**
+   * @brief The downlink finished serializing a batch.
+   * @param switchIndex Index of the switch.
+   */
+  void TransmitComplete(uint32_t switchIndex);
+
+  /**
+   * @brief Apply a batch at the switch and send the results back.
+   * @param switchIndex Index of the switch.
+   * @param batch The batch.
+   */
+  void ApplyBatch(uint32_t switchIndex, std::shared_ptr<Batch> batch);
+
+  /**
+   * @brief Run the completion callbacks of a batch at the controller.
+   * @param switchIndex Index of the switch.
+   * @param batch The batch, with its results.
+   */
+  void CompleteBatch(uint32_t switchIndex, std::shared_ptr<Batch> batch);
+
+  Time m_delay;                   //!< One-way propagation delay
+  DataRate m_rate;                //!< Downlink rate, 0 for unlimited
+  uint32_t m_maxBatchSize;        //!< Requests per batch
+  uint32_t m_batchHeaderBytes;    //!< Framing overhead per batch
+  std::map<uint32_t, Link> m_links; //!< Downlink per switch
+
+  TracedCallback<uint32_t, uint32_t, uint32_t> m_batchTrace; //!< Batch applied
+};
+
+} // namespace ns3
+
+#endif // P4_CONTROL_CHANNEL_H
@@ -2,13 +2,77 @@
 
 #include "ns3/core-module.h"
 #include "ns3/log.h"
+#include "ns3/p4-flow-table-parser.h"
+#include "ns3/p4-state-stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE("P4Controller");
 NS_OBJECT_ENSURE_REGISTERED(P4Controller);
 
+namespace {
+// Rough P4Runtime-like encoding sizes, for the control channel model.
+const uint32_t REQUEST_HEADER_BYTES = 16; //!< Type, ids and lengths
+const uint32_t FIELD_HEADER_BYTES = 4;    //!< Per match field or parameter
+const uint32_t PARAM_BYTES = 4;           //!< Per action parameter value
+
+uint32_t MatchKeyBytes(const std::vector<bm::MatchKeyParam> &matchKey) {
+  uint32_t bytes = 0;
+  for (const auto &param : matchKey) {
+    bytes += FIELD_HEADER_BYTES + param.key.size() + param.mask.size();
+  }
+  return bytes;
+}
+
+uint32_t ActionDataBytes(const bm::ActionData &actionData) {
+  return actionData.size() * (FIELD_HEADER_BYTES + PARAM_BYTES);
+}
+
+P4FlowEntry ToFlowEntry(const P4ParsedTableEntry &parsed) {
+  P4FlowEntry entry;
+  for (const P4ParsedMatchField &field : parsed.match) {
+    bm::MatchKeyParam::Type type = bm::MatchKeyParam::Type::EXACT;
+    switch (field.type) {
+    case P4ParsedMatchField::RANGE:
+      type = bm::MatchKeyParam::Type::RANGE;
+      break;
+    case P4ParsedMatchField::VALID:
+      type = bm::MatchKeyParam::Type::VALID;
+      break;
+    case P4ParsedMatchField::EXACT:
+      type = bm::MatchKeyParam::Type::EXACT;
+      break;
+    case P4ParsedMatchField::LPM:
+      type = bm::MatchKeyParam::Type::LPM;
+      break;
+    case P4ParsedMatchField::TERNARY:
+      type = bm::MatchKeyParam::Type::TERNARY;
+      break;
+    }
+    entry.matchKey.emplace_back(type, field.key, field.mask,
+                                field.prefixLength);
+  }
+  entry.actionName = parsed.action;
+  for (const std::string &param : parsed.params) {
+    entry.actionData.push_back_action_data(param.data(), param.size());
+  }
+  entry.priority = parsed.priority;
+  return entry;
+}
+
+uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+} // namespace
+
 TypeId P4Controller::GetTypeId(void) {
   static TypeId tid = TypeId("ns3::P4Controller")
                           .SetParent<Object>()
@@ -20,6 +84,16 @@ P4Controller::P4Controller() { NS_LOG_FUNCTION(this); }
 
 P4Controller::~P4Controller() { NS_LOG_FUNCTION(this); }
 
+void P4Controller::DoDispose() {
+  NS_LOG_FUNCTION(this);
+  StopTelemetry();
+  for (auto &swap : m_configSwaps) {
+    swap->event.Cancel();
+  }
+  m_configSwaps.clear();
+  Object::DoDispose();
+}
+
 void P4Controller::RegisterSwitch(ns3::Ptr<ns3::P4SwitchNetDevice> sw) {
   m_connectedSwitches.push_back(sw);
   NS_LOG_INFO("Switch registered successfully");
@@ -55,6 +129,57 @@ void P4Controller::HandleSwitchEvent(uint32_t switchId,
   NS_LOG_INFO("[Controller] Event from switch " << switchId << ": " << message);
 }
 
+void P4Controller::SetDigestCallback(DigestCallback callback) {
+  m_digestCallback = std::move(callback);
+}
+
+void P4Controller::ConnectToSwitchDigests(uint32_t index) {
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    return;
+  }
+
+  m_connectedSwitches[index]->TraceConnectWithoutContext(
+      "Digest", MakeCallback(&P4Controller::HandleDigest, this).Bind(index));
+
+  NS_LOG_INFO("Connected to Digest trace source for switch " << index);
+}
+
+void P4Controller::HandleDigest(uint32_t index, const P4DigestBatch &batch) {
+  NS_LOG_INFO("[Controller] " << batch.numSamples << " digests of list "
+                              << batch.listName << " from switch " << index);
+  if (m_digestCallback) {
+    m_digestCallback(index, batch);
+  }
+}
+
+void P4Controller::SetAgeingCallback(AgeingCallback callback) {
+  m_ageingCallback = std::move(callback);
+}
+
+void P4Controller::ConnectToSwitchAgeing(uint32_t index) {
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    return;
+  }
+
+  m_connectedSwitches[index]->TraceConnectWithoutContext(
+      "EntriesExpired",
+      MakeCallback(&P4Controller::HandleEntriesExpired, this).Bind(index));
+
+  NS_LOG_INFO("Connected to EntriesExpired trace source for switch " << index);
+}
+
+void P4Controller::HandleEntriesExpired(uint32_t index,
+                                        const P4ExpiredEntries &entries) {
+  NS_LOG_INFO("[Controller] " << entries.handles.size()
+                              << " idle entries in table " << entries.tableName
+                              << " of switch " << index);
+  if (m_ageingCallback) {
+    m_ageingCallback(index, entries);
+  }
+}
+
 void P4Controller::ViewAllSwitchFlowTableInfo() {
   NS_LOG_INFO("\n==== Viewing All P4 Switch Flow Tables ====\n");
   for (uint32_t i = 0; i < m_connectedSwitches.size(); ++i) {
@@ -140,6 +265,7 @@ void P4Controller::ClearFlowTableEntries(uint32_t index,
     return;
   }
   int rc = core->ClearFlowTableEntries(tableName, resetDefault);
+  m_tableHandles.erase(std::make_pair(index, tableName));
 
   if (rc == 0) {
     NS_LOG_INFO("Successfully cleared entries in table ["
@@ -173,6 +299,7 @@ void P4Controller::AddFlowEntry(uint32_t index, const std::string &tableName,
   int result = core->AddFlowEntry(tableName, matchKey, actionName,
                                   std::move(actionData), &handle, priority);
   if (result == 0) {
+    UpdateTableHandle(index, tableName, handle, true);
     std::cout << "Successfully added flow entry to table [" << tableName
               << "] on switch " << index << " (handle = " << handle << ")"
               << std::endl;
@@ -265,6 +392,7 @@ void P4Controller::DeleteFlowEntry(uint32_t index, const std::string &tableName,
   int status = core->DeleteFlowEntry(tableName, handle);
 
   if (status == 0) {
+    UpdateTableHandle(index, tableName, handle, false);
     NS_LOG_INFO("Successfully deleted entry (handle = "
                 << handle << ") from table [" << tableName << "] on switch "
                 << index);
@@ -1653,6 +1781,79 @@ void P4Controller::RegisterReadAll(uint32_t index,
   }
 }
 
+int P4Controller::RegisterSnapshot(uint32_t index,
+                                   const std::string &registerName,
+                                   uint64_t *values, size_t capacity) {
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    return -1;
+  }
+
+  P4CoreV1model *core = m_connectedSwitches[index]->GetV1ModelCore();
+  if (!core) {
+    NS_LOG_ERROR("V1Model core not found for switch " << index);
+    return -1;
+  }
+
+  return core->RegisterSnapshot(registerName, values, capacity);
+}
+
+int P4Controller::RegisterSnapshotDelta(uint32_t index,
+                                        const std::string &registerName,
+                                        uint32_t *indices, uint64_t *values,
+                                        size_t capacity) {
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    return -1;
+  }
+
+  P4CoreV1model *core = m_connectedSwitches[index]->GetV1ModelCore();
+  if (!core) {
+    NS_LOG_ERROR("V1Model core not found for switch " << index);
+    return -1;
+  }
+
+  return core->RegisterSnapshotDelta(registerName, indices, values,
+                                     capacity);
+}
+
+int P4Controller::CounterSnapshot(uint32_t index,
+                                  const std::string &counterName,
+                                  uint64_t *bytes, uint64_t *packets,
+                                  size_t capacity) {
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    return -1;
+  }
+
+  P4CoreV1model *core = m_connectedSwitches[index]->GetV1ModelCore();
+  if (!core) {
+    NS_LOG_ERROR("V1Model core not found for switch " << index);
+    return -1;
+  }
+
+  return core->CounterSnapshot(counterName, bytes, packets, capacity);
+}
+
+int P4Controller::CounterSnapshotDelta(uint32_t index,
+                                       const std::string &counterName,
+                                       uint32_t *indices, uint64_t *bytes,
+                                       uint64_t *packets, size_t capacity) {
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    return -1;
+  }
+
+  P4CoreV1model *core = m_connectedSwitches[index]->GetV1ModelCore();
+  if (!core) {
+    NS_LOG_ERROR("V1Model core not found for switch " << index);
+    return -1;
+  }
+
+  return core->CounterSnapshotDelta(counterName, indices, bytes, packets,
+                                    capacity);
+}
+
 void P4Controller::RegisterWriteRange(uint32_t index,
                                       const std::string &registerName,
                                       size_t startIndex, size_t endIndex,
@@ -1907,6 +2108,114 @@ void P4Controller::SwapConfigs(uint32_t index) {
   }
 }
 
+int P4Controller::ScheduleConfigSwap(const std::string &jsonPath,
+                                     const std::vector<uint32_t> &switches,
+                                     Time swapTime, SwapCompletion completion) {
+  NS_LOG_FUNCTION(this << jsonPath << switches.size() << swapTime);
+
+  std::vector<uint32_t> indices = switches;
+  if (indices.empty()) {
+    for (uint32_t i = 0; i < m_connectedSwitches.size(); i++) {
+      indices.push_back(i);
+    }
+  }
+
+  auto swap = std::make_shared<ConfigSwap>();
+  for (uint32_t index : indices) {
+    if (index >= m_connectedSwitches.size()) {
+      NS_LOG_WARN("Invalid switch index " << index);
+      return -1;
+    }
+    P4ConfigSwapReport report;
+    report.switchIndex = index;
+    swap->reports.push_back(report);
+    swap->cores.push_back(m_connectedSwitches[index]->GetV1ModelCore());
+  }
+  swap->completion = std::move(completion);
+
+  // The program is read once and the same text is loaded into every switch,
+  // which parses and checks it. bmv2 serializes the loading with the runtime
+  // requests of the simulation, the running program is not touched until the
+  // swap.
+  // The loader does not log, ns-3 logging belongs to the simulation thread:
+  // errors are kept in the swap and logged by CommitConfigSwap.
+  ConfigSwap *pending = swap.get();
+  swap->loader = std::thread([pending, jsonPath]() {
+    std::ifstream file(jsonPath);
+    if (!file.is_open()) {
+      pending->error = "cannot open " + jsonPath;
+      return;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    std::string config = text.str();
+    for (size_t i = 0; i < pending->cores.size(); i++) {
+      if (!pending->cores[i]) {
+        pending->reports[i].error = "no V1Model core";
+        continue;
+      }
+      auto start = std::chrono::steady_clock::now();
+      pending->reports[i].result =
+          pending->cores[i]->LoadNewConfig(config, &pending->reports[i].error);
+      pending->reports[i].loadNs = ElapsedNs(start);
+    }
+  });
+
+  Time delay = Max(swapTime - Simulator::Now(), Seconds(0));
+  swap->event = Simulator::Schedule(delay, &P4Controller::CommitConfigSwap,
+                                    this, swap);
+  m_configSwaps.push_back(swap);
+  return 0;
+}
+
+void P4Controller::CommitConfigSwap(std::shared_ptr<ConfigSwap> swap) {
+  NS_LOG_FUNCTION(this << swap->reports.size());
+
+  auto start = std::chrono::steady_clock::now();
+  swap->loader.join();
+  NS_LOG_INFO("Waited " << ElapsedNs(start)
+                        << " ns for the new program to load");
+  if (!swap->error.empty()) {
+    NS_LOG_ERROR("Config swap failed: " << swap->error);
+  }
+
+  for (size_t i = 0; i < swap->reports.size(); i++) {
+    P4ConfigSwapReport &report = swap->reports[i];
+    if (report.result != 0) {
+      if (report.error.empty()) {
+        report.error = swap->error;
+      }
+      NS_LOG_ERROR("New program not loaded on switch "
+                   << report.switchIndex << ": " << report.error);
+      continue;
+    }
+    start = std::chrono::steady_clock::now();
+    report.result = swap->cores[i]->SwapConfigs();
+    report.orderNs = ElapsedNs(start);
+    if (report.result != 0) {
+      NS_LOG_ERROR("SwapConfigs failed on switch " << report.switchIndex);
+      continue;
+    }
+
+    // The new program starts with empty tables.
+    auto it = m_tableHandles.lower_bound(
+        std::make_pair(report.switchIndex, std::string()));
+    while (it != m_tableHandles.end() &&
+           it->first.first == report.switchIndex) {
+      it = m_tableHandles.erase(it);
+    }
+    NS_LOG_INFO("SwapConfigs succeeded on switch "
+                << report.switchIndex << ", load " << report.loadNs
+                << " ns, swap ordered in " << report.orderNs << " ns");
+  }
+
+  m_configSwaps.erase(
+      std::find(m_configSwaps.begin(), m_configSwaps.end(), swap));
+  if (swap->completion) {
+    swap->completion(swap->reports);
+  }
+}
+
 void P4Controller::GetConfig(uint32_t index) {
   NS_LOG_FUNCTION(this << index);
 
@@ -1955,6 +2264,350 @@ void P4Controller::GetConfigMd5(uint32_t index) {
   }
 }
 
+void P4Controller::SetControlChannel(Ptr<P4ControlChannel> channel) {
+  NS_LOG_FUNCTION(this << channel);
+  m_controlChannel = channel;
+}
+
+Ptr<P4ControlChannel> P4Controller::GetControlChannel() {
+  if (!m_controlChannel) {
+    m_controlChannel = CreateObject<P4ControlChannel>();
+  }
+  return m_controlChannel;
+}
+
+void P4Controller::SubmitAsync(uint32_t index,
+                               std::function<int(P4CoreV1model *)> operation,
+                               uint32_t bytes, Completion completion) {
+  NS_LOG_FUNCTION(this << index << bytes);
+
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    if (completion) {
+      completion(-1);
+    }
+    return;
+  }
+
+  // The core is looked up on arrival, it may have changed in the meantime.
+  Ptr<P4SwitchNetDevice> sw = m_connectedSwitches[index];
+  GetControlChannel()->Submit(
+      index,
+      [sw, index, operation]() {
+        P4CoreV1model *core = sw->GetV1ModelCore();
+        if (!core) {
+          NS_LOG_ERROR("V1Model core not found for switch " << index);
+          return -1;
+        }
+        return operation(core);
+      },
+      bytes, std::move(completion));
+}
+
+void P4Controller::AddFlowEntryAsync(
+    uint32_t index, const std::string &tableName,
+    const std::vector<bm::MatchKeyParam> &matchKey,
+    const std::string &actionName, bm::ActionData actionData, int priority,
+    AddEntryCompletion completion) {
+  NS_LOG_FUNCTION(this << index << tableName << actionName << priority);
+
+  uint32_t bytes = REQUEST_HEADER_BYTES + tableName.size() +
+                   actionName.size() + MatchKeyBytes(matchKey) +
+                   ActionDataBytes(actionData);
+  auto handle = std::make_shared<bm::entry_handle_t>(0);
+  SubmitAsync(
+      index,
+      [this, index, tableName, matchKey, actionName, actionData, priority,
+       handle](P4CoreV1model *core) {
+        int result = core->AddFlowEntry(tableName, matchKey, actionName,
+                                        bm::ActionData(actionData),
+                                        handle.get(), priority);
+        if (result == 0) {
+          UpdateTableHandle(index, tableName, *handle, true);
+        }
+        return result;
+      },
+      bytes, [completion, handle](int result) {
+        if (completion) {
+          completion(result, *handle);
+        }
+      });
+}
+
+void P4Controller::ModifyFlowEntryAsync(uint32_t index,
+                                        const std::string &tableName,
+                                        bm::entry_handle_t handle,
+                                        const std::string &actionName,
+                                        bm::ActionData actionData,
+                                        Completion completion) {
+  NS_LOG_FUNCTION(this << index << tableName << handle << actionName);
+
+  uint32_t bytes = REQUEST_HEADER_BYTES + tableName.size() +
+                   actionName.size() + sizeof(handle) +
+                   ActionDataBytes(actionData);
+  SubmitAsync(
+      index,
+      [tableName, handle, actionName, actionData](P4CoreV1model *core) {
+        return core->ModifyFlowEntry(tableName, handle, actionName,
+                                     actionData);
+      },
+      bytes, std::move(completion));
+}
+
+void P4Controller::DeleteFlowEntryAsync(uint32_t index,
+                                        const std::string &tableName,
+                                        bm::entry_handle_t handle,
+                                        Completion completion) {
+  NS_LOG_FUNCTION(this << index << tableName << handle);
+
+  uint32_t bytes = REQUEST_HEADER_BYTES + tableName.size() + sizeof(handle);
+  SubmitAsync(
+      index,
+      [this, index, tableName, handle](P4CoreV1model *core) {
+        int result = core->DeleteFlowEntry(tableName, handle);
+        if (result == 0) {
+          UpdateTableHandle(index, tableName, handle, false);
+        }
+        return result;
+      },
+      bytes, std::move(completion));
+}
+
+void P4Controller::RegisterWriteAsync(uint32_t index,
+                                      const std::string &registerName,
+                                      size_t registerIndex,
+                                      const bm::Data &value,
+                                      Completion completion) {
+  NS_LOG_FUNCTION(this << index << registerName << registerIndex);
+
+  uint32_t bytes = REQUEST_HEADER_BYTES + registerName.size() +
+                   sizeof(uint64_t) + FIELD_HEADER_BYTES + PARAM_BYTES;
+  SubmitAsync(
+      index,
+      [registerName, registerIndex, value](P4CoreV1model *core) {
+        return core->RegisterWrite(registerName, registerIndex, value);
+      },
+      bytes, std::move(completion));
+}
+
+int P4Controller::ApplyFlowTableDiff(uint32_t index,
+                                     const std::string &tableName,
+                                     const std::vector<P4FlowEntry> &desired,
+                                     DiffCompletion completion) {
+  NS_LOG_FUNCTION(this << index << tableName << desired.size());
+
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    return -1;
+  }
+
+  P4CoreV1model *core = m_connectedSwitches[index]->GetV1ModelCore();
+  if (!core) {
+    NS_LOG_ERROR("V1Model core not found for switch " << index);
+    return -1;
+  }
+
+  auto diff = std::make_shared<FlowTableDiff>();
+  if (PlanFlowTableDiff(index, core, tableName, desired, diff.get()) != 0) {
+    return -1;
+  }
+  SubmitFlowTableDiff(index, diff, std::move(completion));
+  return 0;
+}
+
+int P4Controller::ApplyFlowTableFile(uint32_t index, const std::string &path,
+                                     DiffCompletion completion) {
+  NS_LOG_FUNCTION(this << index << path);
+
+  if (index >= m_connectedSwitches.size()) {
+    NS_LOG_WARN("Invalid switch index " << index);
+    return -1;
+  }
+
+  P4CoreV1model *core = m_connectedSwitches[index]->GetV1ModelCore();
+  if (!core) {
+    NS_LOG_ERROR("V1Model core not found for switch " << index);
+    return -1;
+  }
+
+  std::string config;
+  P4FlowTableParser parser;
+  if (core->GetConfig(&config) != 0 || !parser.LoadConfig(config)) {
+    NS_LOG_ERROR("Cannot read the program of switch " << index);
+    return -1;
+  }
+  std::vector<P4ParsedTableEntry> parsed;
+  if (!parser.ParseFile(path, &parsed)) {
+    NS_LOG_ERROR("Cannot read flow table file " << path << ": "
+                                                << parser.GetError());
+    return -1;
+  }
+
+  std::map<std::string, std::vector<P4FlowEntry>> tables;
+  for (const P4ParsedTableEntry &entry : parsed) {
+    tables[entry.table].push_back(ToFlowEntry(entry));
+  }
+
+  // All tables go out in one request, so the switch never sees a partial
+  // reconfiguration.
+  auto diff = std::make_shared<FlowTableDiff>();
+  for (const auto &table : tables) {
+    if (PlanFlowTableDiff(index, core, table.first, table.second,
+                          diff.get()) != 0) {
+      return -1;
+    }
+  }
+  SubmitFlowTableDiff(index, diff, std::move(completion));
+  return 0;
+}
+
+int P4Controller::PlanFlowTableDiff(uint32_t index, P4CoreV1model *core,
+                                    const std::string &tableName,
+                                    const std::vector<P4FlowEntry> &desired,
+                                    FlowTableDiff *diff) {
+  if (core->GetNumEntries(tableName) < 0) {
+    NS_LOG_ERROR("Unknown table " << tableName << " on switch " << index);
+    return -1;
+  }
+
+  const std::unordered_set<bm::entry_handle_t> &handles =
+      GetTableHandles(index, core, tableName);
+  std::unordered_set<bm::entry_handle_t> kept;
+  bm::MatchTable::Entry current;
+  for (const P4FlowEntry &entry : desired) {
+    int found = core->FindEntryFromKey(tableName, entry.matchKey, &current,
+                                       entry.priority);
+    if (found < 0) {
+      diff->stats.failed++;
+    } else if (found == 0) {
+      diff->bytes += REQUEST_HEADER_BYTES + tableName.size() +
+                     entry.actionName.size() + MatchKeyBytes(entry.matchKey) +
+                     ActionDataBytes(entry.actionData);
+      diff->adds.push_back({tableName, 0, entry});
+    } else if (!kept.insert(current.handle).second) {
+      NS_LOG_WARN("Duplicate key in the desired state of table " << tableName);
+      diff->stats.failed++;
+    } else if (current.action_fn &&
+               current.action_fn->get_name() == entry.actionName &&
+               current.action_data.action_data ==
+                   entry.actionData.action_data) {
+      diff->stats.unchanged++;
+    } else {
+      diff->bytes += REQUEST_HEADER_BYTES + tableName.size() +
+                     entry.actionName.size() + sizeof(current.handle) +
+                     ActionDataBytes(entry.actionData);
+      diff->modifies.push_back({tableName, current.handle, entry});
+    }
+  }
+
+  for (bm::entry_handle_t handle : handles) {
+    if (!kept.count(handle)) {
+      diff->bytes += REQUEST_HEADER_BYTES + tableName.size() + sizeof(handle);
+      diff->deletes.push_back({tableName, handle, P4FlowEntry()});
+    }
+  }
+
+  NS_LOG_INFO("Table " << tableName << " on switch " << index << ": "
+                       << diff->adds.size() << " to add, "
+                       << diff->modifies.size() << " to modify, "
+                       << diff->deletes.size() << " to delete");
+  return 0;
+}
+
+void P4Controller::SubmitFlowTableDiff(uint32_t index,
+                                       std::shared_ptr<FlowTableDiff> diff,
+                                       DiffCompletion completion) {
+  if (diff->deletes.empty() && diff->modifies.empty() && diff->adds.empty()) {
+    if (completion) {
+      completion(diff->stats);
+    }
+    return;
+  }
+
+  // Deletions go first, so an entry can move to a key that is freed in the
+  // same reconfiguration without overflowing the table.
+  SubmitAsync(
+      index,
+      [this, index, diff](P4CoreV1model *core) {
+        P4FlowTableDiffStats &stats = diff->stats;
+        for (const auto &change : diff->deletes) {
+          if (core->DeleteFlowEntry(change.tableName, change.handle) == 0) {
+            UpdateTableHandle(index, change.tableName, change.handle, false);
+            stats.deleted++;
+          } else {
+            stats.failed++;
+          }
+        }
+        for (const auto &change : diff->modifies) {
+          if (core->ModifyFlowEntry(change.tableName, change.handle,
+                                    change.entry.actionName,
+                                    change.entry.actionData) == 0) {
+            stats.modified++;
+          } else {
+            stats.failed++;
+          }
+        }
+        for (const auto &change : diff->adds) {
+          bm::entry_handle_t handle = 0;
+          if (core->AddFlowEntry(change.tableName, change.entry.matchKey,
+                                 change.entry.actionName,
+                                 bm::ActionData(change.entry.actionData),
+                                 &handle, change.entry.priority) == 0) {
+            UpdateTableHandle(index, change.tableName, handle, true);
+            stats.added++;
+          } else {
+            stats.failed++;
+          }
+        }
+        return stats.failed == 0 ? 0 : -1;
+      },
+      diff->bytes, [diff, completion](int) {
+        if (completion) {
+          completion(diff->stats);
+        }
+      });
+}
+
+std::unordered_set<bm::entry_handle_t> &
+P4Controller::GetTableHandles(uint32_t index, P4CoreV1model *core,
+                              const std::string &tableName) {
+  std::unordered_set<bm::entry_handle_t> &handles =
+      m_tableHandles[std::make_pair(index, tableName)];
+  // Entries also come and go behind the controller's back: the flow table
+  // file at startup, ageing, or calls made on the core directly. A handle the
+  // switch no longer knows is dropped, which also catches a deletion hidden
+  // by an addition; a full read is only needed when the count still differs.
+  for (auto it = handles.begin(); it != handles.end();) {
+    if (core->HasEntry(tableName, *it)) {
+      ++it;
+    } else {
+      it = handles.erase(it);
+    }
+  }
+  int count = core->GetNumEntries(tableName);
+  if (count >= 0 && static_cast<size_t>(count) != handles.size()) {
+    handles.clear();
+    for (const auto &entry : core->GetFlowEntries(tableName)) {
+      handles.insert(entry.handle);
+    }
+  }
+  return handles;
+}
+
+void P4Controller::UpdateTableHandle(uint32_t index,
+                                     const std::string &tableName,
+                                     bm::entry_handle_t handle, bool present) {
+  auto it = m_tableHandles.find(std::make_pair(index, tableName));
+  if (it == m_tableHandles.end()) {
+    return;
+  }
+  if (present) {
+    it->second.insert(handle);
+  } else {
+    it->second.erase(handle);
+  }
+}
+
 void P4Controller::SetP4SwitchViewFlowTablePath(
     size_t index, const std::string &viewFlowTablePath) {}
 
@@ -1963,4 +2616,229 @@ void P4Controller::SetP4SwitchFlowTablePath(size_t index,
   NS_LOG_FUNCTION(this << index << flowTablePath);
 }
 
-} // namespace ns3
\ No newline at end of file
+uint32_t P4Controller::AddTelemetryMetric(TelemetryMetricType type,
+                                          const std::string &name,
+                                          const std::vector<uint32_t> &switches) {
+  NS_LOG_FUNCTION(this << type << name);
+  TelemetryMetric metric;
+  metric.type = type;
+  metric.name = name;
+  metric.switches = switches;
+  m_telemetryMetrics.push_back(metric);
+  return m_telemetryMetrics.size() - 1;
+}
+
+int P4Controller::StartTelemetry(Time interval, const std::string &path,
+                                 P4TelemetryWriter::Format format,
+                                 bool suppressUnchanged) {
+  NS_LOG_FUNCTION(this << interval << path);
+  StopTelemetry();
+  if (m_telemetryMetrics.empty() || !interval.IsStrictlyPositive()) {
+    NS_LOG_WARN("Telemetry needs a metric and a positive interval");
+    return -1;
+  }
+
+  std::vector<std::string> names;
+  for (TelemetryMetric &metric : m_telemetryMetrics) {
+    switch (metric.type) {
+    case TELEMETRY_REGISTER:
+      names.push_back("register:" + metric.name);
+      break;
+    case TELEMETRY_COUNTER:
+      names.push_back("counter:" + metric.name);
+      break;
+    case TELEMETRY_TABLE_COUNTERS:
+      names.push_back("table:" + metric.name);
+      break;
+    case TELEMETRY_QUEUE_DEPTH:
+      names.push_back("queue_depth");
+      break;
+    }
+
+    std::vector<uint32_t> switches = metric.switches;
+    if (switches.empty()) {
+      for (uint32_t i = 0; i < m_connectedSwitches.size(); i++) {
+        switches.push_back(i);
+      }
+    }
+    metric.series.clear();
+    for (uint32_t index : switches) {
+      if (index >= m_connectedSwitches.size() ||
+          !m_connectedSwitches[index]->GetV1ModelCore()) {
+        NS_LOG_WARN("Telemetry skips switch " << index
+                                              << ", not a v1model switch");
+        continue;
+      }
+      TelemetrySeries series;
+      series.switchIndex = index;
+      metric.series.push_back(series);
+    }
+  }
+
+  if (!m_telemetryWriter.Open(path, format, names)) {
+    NS_LOG_ERROR("Cannot create the telemetry file " << path);
+    return -1;
+  }
+  m_telemetryInterval = interval;
+  m_telemetrySuppress = suppressUnchanged;
+  m_telemetryEvent =
+      Simulator::ScheduleNow(&P4Controller::PollTelemetry, this);
+  return 0;
+}
+
+void P4Controller::StopTelemetry() {
+  m_telemetryEvent.Cancel();
+  m_telemetryWriter.Close();
+}
+
+uint64_t P4Controller::GetTelemetryRows() const {
+  return m_telemetryWriter.GetRows();
+}
+
+void P4Controller::PollTelemetry() {
+  uint64_t now = Simulator::Now().GetNanoSeconds();
+  for (uint32_t id = 0; id < m_telemetryMetrics.size(); id++) {
+    for (TelemetrySeries &series : m_telemetryMetrics[id].series) {
+      SampleTelemetry(id, series, now);
+      series.primed = true;
+    }
+  }
+  m_telemetryEvent = Simulator::Schedule(m_telemetryInterval,
+                                         &P4Controller::PollTelemetry, this);
+}
+
+void P4Controller::SampleTelemetry(uint32_t id, TelemetrySeries &series,
+                                   uint64_t now) {
+  const TelemetryMetric &metric = m_telemetryMetrics[id];
+  Ptr<P4SwitchNetDevice> sw = m_connectedSwitches[series.switchIndex];
+  P4CoreV1model *core = sw->GetV1ModelCore();
+
+  switch (metric.type) {
+  case TELEMETRY_REGISTER:
+  case TELEMETRY_COUNTER: {
+    bool isCounter = metric.type == TELEMETRY_COUNTER;
+    int size = core->GetSnapshotSize(metric.name, isCounter);
+    if (size <= 0) {
+      return;
+    }
+    // the buffers only grow, steady-state polls do not allocate
+    if (m_telemetryValues.size() < static_cast<size_t>(size)) {
+      m_telemetryValues.resize(size);
+      m_telemetryValues2.resize(size);
+      m_telemetryCells.resize(size);
+    }
+    // suppressed series write the full array once, then only what the delta
+    // snapshot reports; the first delta call sets its baseline
+    bool delta = m_telemetrySuppress && series.primed;
+    int cells = 0;
+    if (m_telemetrySuppress) {
+      cells = isCounter
+                  ? core->CounterSnapshotDelta(
+                        metric.name, m_telemetryCells.data(),
+                        m_telemetryValues.data(), m_telemetryValues2.data(),
+                        m_telemetryValues.size())
+                  : core->RegisterSnapshotDelta(
+                        metric.name, m_telemetryCells.data(),
+                        m_telemetryValues.data(), m_telemetryValues.size());
+    }
+    if (!delta) {
+      cells = isCounter
+                  ? core->CounterSnapshot(metric.name,
+                                          m_telemetryValues.data(),
+                                          m_telemetryValues2.data(),
+                                          m_telemetryValues.size())
+                  : core->RegisterSnapshot(metric.name,
+                                           m_telemetryValues.data(),
+                                           m_telemetryValues.size());
+    }
+    for (int i = 0; i < cells; i++) {
+      m_telemetryWriter.Write(now, series.switchIndex, id,
+                              delta ? m_telemetryCells[i] : i,
+                              m_telemetryValues[i],
+                              isCounter ? m_telemetryValues2[i] : 0);
+    }
+    break;
+  }
+  case TELEMETRY_TABLE_COUNTERS: {
+    // The entries are read by handle from the cache the flow table calls keep.
+    // It is checked against the switch only if the entry count differs or an
+    // entry was gone at the last sample.
+    auto cached =
+        m_tableHandles.find(std::make_pair(series.switchIndex, metric.name));
+    int count = core->GetNumEntries(metric.name);
+    bool check = series.staleHandles || cached == m_tableHandles.end() ||
+                 count < 0 || static_cast<size_t>(count) != cached->second.size();
+    const std::unordered_set<bm::entry_handle_t> &handles =
+        check ? GetTableHandles(series.switchIndex, core, metric.name)
+              : cached->second;
+    m_telemetryHandles.assign(handles.begin(), handles.end());
+    size_t entries = m_telemetryHandles.size();
+    if (m_telemetryValues.size() < entries) {
+      m_telemetryValues.resize(entries);
+      m_telemetryValues2.resize(entries);
+    }
+    if (m_telemetryChanged.size() < entries) {
+      m_telemetryChanged.resize(entries);
+    }
+
+    bool delta = m_telemetrySuppress && series.primed;
+    size_t gone = 0;
+    int changed = 0;
+    if (m_telemetrySuppress) {
+      changed = core->TableCounterSnapshotDelta(
+          metric.name, m_telemetryHandles.data(), entries,
+          m_telemetryChanged.data(), m_telemetryValues.data(),
+          m_telemetryValues2.data(), entries, &gone);
+    }
+    if (delta) {
+      for (int i = 0; i < changed; i++) {
+        m_telemetryWriter.Write(now, series.switchIndex, id,
+                                m_telemetryChanged[i], m_telemetryValues[i],
+                                m_telemetryValues2[i]);
+      }
+    } else {
+      gone = 0;
+      for (bm::entry_handle_t handle : m_telemetryHandles) {
+        uint64_t bytes = 0;
+        uint64_t packets = 0;
+        if (core->ReadTableCounters(metric.name, handle, &bytes, &packets) ==
+            0) {
+          m_telemetryWriter.Write(now, series.switchIndex, id, handle, bytes,
+                                  packets);
+        } else {
+          gone++;
+        }
+      }
+    }
+    series.staleHandles = gone > 0;
+    break;
+  }
+  case TELEMETRY_QUEUE_DEPTH: {
+    uint32_t ports = sw->GetNBridgePorts();
+    if (m_telemetrySuppress && series.last.size() < 2 * size_t(ports)) {
+      series.last.resize(2 * size_t(ports));
+    }
+    for (uint32_t port = 0; port < ports; port++) {
+      WriteTelemetry(id, series, now, port,
+                     core->GetEgressQueueOccupancy(port), 0);
+    }
+    break;
+  }
+  }
+}
+
+void P4Controller::WriteTelemetry(uint32_t id, TelemetrySeries &series,
+                                  uint64_t now, uint32_t cell, uint64_t value,
+                                  uint64_t value2) {
+  if (m_telemetrySuppress) {
+    uint64_t *last = &series.last[2 * size_t(cell)];
+    if (series.primed && last[0] == value && last[1] == value2) {
+      return;
+    }
+    last[0] = value;
+    last[1] = value2;
+  }
+  m_telemetryWriter.Write(now, series.switchIndex, id, cell, value, value2);
+}
+
+} // namespace ns3
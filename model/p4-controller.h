@@ -3,17 +3,59 @@
 
 #include "p4-switch-net-device.h"
 
+#include "ns3/event-id.h"
 #include "ns3/object.h"
+#include "ns3/p4-control-channel.h"
 #include "ns3/p4-core-v1model.h"
+#include "ns3/p4-telemetry-writer.h"
 #include <ns3/network-module.h>
 
+#include <map>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 namespace ns3 {
 
 class P4CoreV1model;
 
+/**
+ * @brief Desired state of one entry of a direct match-action table.
+ */
+struct P4FlowEntry {
+  std::vector<bm::MatchKeyParam> matchKey; //!< Match fields, in key order
+  std::string actionName;                  //!< Action to apply
+  bm::ActionData actionData;               //!< Action parameters
+  int priority{-1};                        //!< Priority, -1 for none
+};
+
+/**
+ * @brief Outcome of a flow table reconfiguration.
+ */
+struct P4FlowTableDiffStats {
+  uint32_t added{0};     //!< Entries added
+  uint32_t modified{0};  //!< Entries whose action changed
+  uint32_t deleted{0};   //!< Entries not in the desired state
+  uint32_t unchanged{0}; //!< Entries already as desired
+  uint32_t failed{0};    //!< Operations that failed, and duplicate keys
+};
+
+/**
+ * @brief Cost of a scheduled configuration swap on one switch.
+ *
+ * orderNs only covers swap_configs on the simulation thread, which orders the
+ * swap. bmv2 replaces the program later, in do_swap, once no packet is left
+ * in the pipeline, and that time is not included.
+ */
+struct P4ConfigSwapReport {
+  uint32_t switchIndex{0}; //!< The switch
+  int result{-1};          //!< 0 if the swap to the new program was ordered
+  uint64_t loadNs{0};      //!< Wall time to load the program, in background
+  uint64_t orderNs{0};     //!< Wall time of swap_configs, on the simulation thread
+  std::string error;       //!< Why the new program was not loaded, if it was not
+};
+
 /**
  * @brief Controller for managing multiple P4 switches in an NS-3 simulation.
  *
@@ -52,6 +94,60 @@ public:
    */
   void ConnectToSwitchEvents(uint32_t switchIndex);
   void HandleSwitchEvent(uint32_t switchId, const std::string &message);
+
+  /**
+   * @brief Called with the index of the switch and a batch of its digests.
+   */
+  typedef std::function<void(uint32_t switchIndex, const P4DigestBatch &batch)>
+      DigestCallback;
+
+  /**
+   * @brief Sets the callback receiving the digests of the connected switches.
+   * @param callback The callback, empty to only log the batches.
+   */
+  void SetDigestCallback(DigestCallback callback);
+
+  /**
+   * @brief Connect controller to the Digest trace source of a switch
+   * @param switchIndex Index of the switch in m_connectedSwitches
+   */
+  void ConnectToSwitchDigests(uint32_t switchIndex);
+
+  /**
+   * @brief Handles a batch of digests from a switch.
+   * @param switchIndex Index of the switch in m_connectedSwitches
+   * @param batch The digests
+   */
+  void HandleDigest(uint32_t switchIndex, const P4DigestBatch &batch);
+
+  /**
+   * @brief Called with the index of the switch and its entries whose idle
+   * timeout expired.
+   */
+  typedef std::function<void(uint32_t switchIndex,
+                             const P4ExpiredEntries &entries)>
+      AgeingCallback;
+
+  /**
+   * @brief Sets the callback receiving the expired entries of the connected
+   * switches.
+   * @param callback The callback, empty to only log the entries.
+   */
+  void SetAgeingCallback(AgeingCallback callback);
+
+  /**
+   * @brief Connect controller to the EntriesExpired trace source of a switch
+   * @param switchIndex Index of the switch in m_connectedSwitches
+   */
+  void ConnectToSwitchAgeing(uint32_t switchIndex);
+
+  /**
+   * @brief Handles the expired entries of a switch.
+   * @param switchIndex Index of the switch in m_connectedSwitches
+   * @param entries The expired entries of one table
+   */
+  void HandleEntriesExpired(uint32_t switchIndex,
+                            const P4ExpiredEntries &entries);
   /**
    * @brief Gives the count of the p4 switches registered with the controller
    */
@@ -172,6 +268,9 @@ public:
   /**
    * @brief Sets a timeout (TTL) for a specific flow entry in a match-action
    * table.
+   *
+   * With simulated ageing an idle entry is reported between one and two
+   * timeouts after its last hit, see P4SwitchCore::SetEntryIdleTimeout.
    * @param index The switch index.
    * @param tableName The name of the table.
    * @param handle The entry handle.
@@ -654,6 +753,62 @@ public:
    */
   void RegisterReadAll(uint32_t index, const std::string &registerName);
 
+  /**
+   * @brief Copies a whole register array of a switch into a flat buffer.
+   * @param index Index of the target switch in the connected switches list.
+   * @param registerName Name of the register to read from.
+   * @param[out] values Buffer receiving cell i at values[i].
+   * @param capacity Number of cells the buffer holds.
+   * @return The number of cells copied, -1 on failure.
+   * @see P4CoreV1model::RegisterSnapshot
+   */
+  int RegisterSnapshot(uint32_t index, const std::string &registerName,
+                       uint64_t *values, size_t capacity);
+
+  /**
+   * @brief Copies the register cells of a switch changed since the last delta
+   * snapshot.
+   * @param index Index of the target switch in the connected switches list.
+   * @param registerName Name of the register to read from.
+   * @param[out] indices Buffer receiving the indices of the changed cells.
+   * @param[out] values Buffer receiving their values.
+   * @param capacity Number of cells each buffer holds.
+   * @return The number of changed cells copied, -1 on failure.
+   * @see P4CoreV1model::RegisterSnapshotDelta
+   */
+  int RegisterSnapshotDelta(uint32_t index, const std::string &registerName,
+                            uint32_t *indices, uint64_t *values,
+                            size_t capacity);
+
+  /**
+   * @brief Copies a whole counter array of a switch into flat buffers.
+   * @param index Index of the target switch in the connected switches list.
+   * @param counterName Name of the counter to read.
+   * @param[out] bytes Buffer receiving the byte count of cell i at bytes[i].
+   * @param[out] packets Buffer receiving the packet count of cell i.
+   * @param capacity Number of cells each buffer holds.
+   * @return The number of cells copied, -1 on failure.
+   * @see P4CoreV1model::CounterSnapshot
+   */
+  int CounterSnapshot(uint32_t index, const std::string &counterName,
+                      uint64_t *bytes, uint64_t *packets, size_t capacity);
+
+  /**
+   * @brief Copies the counter cells of a switch changed since the last delta
+   * snapshot.
+   * @param index Index of the target switch in the connected switches list.
+   * @param counterName Name of the counter to read.
+   * @param[out] indices Buffer receiving the indices of the changed cells.
+   * @param[out] bytes Buffer receiving their byte counts.
+   * @param[out] packets Buffer receiving their packet counts.
+   * @param capacity Number of cells each buffer holds.
+   * @return The number of changed cells copied, -1 on failure.
+   * @see P4CoreV1model::CounterSnapshotDelta
+   */
+  int CounterSnapshotDelta(uint32_t index, const std::string &counterName,
+                           uint32_t *indices, uint64_t *bytes,
+                           uint64_t *packets, size_t capacity);
+
   /**
    * @brief Writes the same value to a range of register indices in the switch.
    * @param index Index of the target switch in the connected switches list.
@@ -736,6 +891,30 @@ public:
    */
   void SwapConfigs(uint32_t index);
 
+  /**
+   * @brief Called with the swap cost on each switch of a scheduled swap.
+   */
+  typedef std::function<void(const std::vector<P4ConfigSwapReport> &reports)>
+      SwapCompletion;
+
+  /**
+   * @brief Loads a new program on a set of switches in the background and
+   * swaps it in on all of them at a given simulated time.
+   *
+   * A background thread reads the JSON once, then loads it into every switch
+   * while the simulation keeps running; each switch parses and checks it. At
+   * the swap time the simulation waits for the loading to finish if needed,
+   * and the swap is ordered on all loaded switches within one event.
+   * @param jsonPath The bmv2 JSON of the new program.
+   * @param switches Indices of the switches, all connected switches if empty.
+   * @param swapTime Absolute simulated time of the swap, now if in the past.
+   * @param completion Called after the swap with one report per switch.
+   * @return 0 if the swap is scheduled, -1 on an invalid switch index.
+   */
+  int ScheduleConfigSwap(const std::string &jsonPath,
+                         const std::vector<uint32_t> &switches, Time swapTime,
+                         SwapCompletion completion = SwapCompletion());
+
   /**
    * @brief Retrieves the current runtime configuration as a string and logs it.
    * @param index The switch index.
@@ -749,7 +928,332 @@ public:
    */
   void GetConfigMd5(uint32_t index);
 
+  // ========== Asynchronous Operations ==========
+
+  /**
+   * @brief Called with the result of an asynchronous operation, 0 on success.
+   */
+  typedef P4ControlChannel::Completion Completion;
+
+  /**
+   * @brief Called with the result and the handle of an added entry.
+   */
+  typedef std::function<void(int result, bm::entry_handle_t handle)>
+      AddEntryCompletion;
+
+  /**
+   * @brief Sets the channel carrying the asynchronous operations.
+   * @param channel The control channel, shared by all switches.
+   */
+  void SetControlChannel(Ptr<P4ControlChannel> channel);
+
+  /**
+   * @brief Gets the channel carrying the asynchronous operations, an ideal
+   * (zero-latency) channel unless one was set.
+   */
+  Ptr<P4ControlChannel> GetControlChannel();
+
+  /**
+   * @brief Sends an operation on the v1model core of a switch over the control
+   * channel.
+   * @param index The switch index.
+   * @param operation The operation, run at the switch when the request
+   * arrives. Returns 0 on success.
+   * @param bytes Encoded size of the request.
+   * @param completion Called with the result once the reply is back.
+   */
+  void SubmitAsync(uint32_t index,
+                   std::function<int(P4CoreV1model *)> operation,
+                   uint32_t bytes, Completion completion = Completion());
+
+  /**
+   * @brief Asynchronous AddFlowEntry.
+   * @param index The switch index.
+   * @param tableName The name of the match-action table.
+   * @param matchKey The list of match fields for the entry.
+   * @param actionName The name of the action to apply.
+   * @param actionData The action parameters.
+   * @param priority Priority value, -1 for none.
+   * @param completion Called with the result and the entry handle.
+   */
+  void AddFlowEntryAsync(uint32_t index, const std::string &tableName,
+                         const std::vector<bm::MatchKeyParam> &matchKey,
+                         const std::string &actionName,
+                         bm::ActionData actionData, int priority = -1,
+                         AddEntryCompletion completion = AddEntryCompletion());
+
+  /**
+   * @brief Asynchronous ModifyFlowEntry.
+   * @param index The switch index.
+   * @param tableName The name of the table.
+   * @param handle The handle of the entry to modify.
+   * @param actionName The new action name.
+   * @param actionData The new action parameters.
+   * @param completion Called with the result.
+   */
+  void ModifyFlowEntryAsync(uint32_t index, const std::string &tableName,
+                            bm::entry_handle_t handle,
+                            const std::string &actionName,
+                            bm::ActionData actionData,
+                            Completion completion = Completion());
+
+  /**
+   * @brief Asynchronous DeleteFlowEntry.
+   * @param index The switch index.
+   * @param tableName The name of the table.
+   * @param handle The handle of the entry to delete.
+   * @param completion Called with the result.
+   */
+  void DeleteFlowEntryAsync(uint32_t index, const std::string &tableName,
+                            bm::entry_handle_t handle,
+                            Completion completion = Completion());
+
+  /**
+   * @brief Asynchronous RegisterWrite.
+   * @param index The switch index.
+   * @param registerName Name of the register array.
+   * @param registerIndex Index within the register array.
+   * @param value Value to write.
+   * @param completion Called with the result.
+   */
+  void RegisterWriteAsync(uint32_t index, const std::string &registerName,
+                          size_t registerIndex, const bm::Data &value,
+                          Completion completion = Completion());
+
+  // ========== Flow Table Reconfiguration ==========
+
+  /**
+   * @brief Called with the outcome of a flow table reconfiguration.
+   */
+  typedef std::function<void(const P4FlowTableDiffStats &stats)>
+      DiffCompletion;
+
+  /**
+   * @brief Brings a direct table to a desired state with the fewest changes.
+   *
+   * Each desired entry is looked up by its key: missing entries are added,
+   * entries with another action or parameters are modified, and entries not
+   * in the desired state are deleted. The current entries are not copied; the
+   * controller keeps the entry handles of each table it manages and reads them
+   * again only if the entry count of the table disagrees. The changes are sent
+   * as one request over the control channel, deletions first.
+   * @param index The switch index.
+   * @param tableName The name of the table.
+   * @param desired The complete desired content of the table.
+   * @param completion Called once the changes are applied.
+   * @return 0 if the changes were sent, -1 on an invalid switch or table.
+   */
+  int ApplyFlowTableDiff(uint32_t index, const std::string &tableName,
+                         const std::vector<P4FlowEntry> &desired,
+                         DiffCompletion completion = DiffCompletion());
+
+  /**
+   * @brief Brings the tables named in a flow table file to the state the file
+   * describes, see ApplyFlowTableDiff.
+   *
+   * The table_add commands are read with the program of the switch; tables
+   * not named in the file are left alone, other commands are ignored.
+   * @param index The switch index.
+   * @param path The flow table file, in runtime CLI syntax.
+   * @param completion Called once the changes to all tables are applied.
+   * @return 0 if the changes were sent, -1 if the file cannot be read.
+   */
+  int ApplyFlowTableFile(uint32_t index, const std::string &path,
+                         DiffCompletion completion = DiffCompletion());
+
+  /**
+   * @brief Kinds of values sampled by the telemetry poller.
+   */
+  enum TelemetryMetricType {
+    TELEMETRY_REGISTER,       //!< Register array, one cell per index
+    TELEMETRY_COUNTER,        //!< Indirect counter array, bytes and packets
+    TELEMETRY_TABLE_COUNTERS, //!< Direct counters, one cell per entry handle
+    TELEMETRY_QUEUE_DEPTH     //!< Egress queue occupancy, one cell per port
+  };
+
+  /**
+   * @brief Adds a metric to the telemetry poller.
+   * @param type The kind of metric.
+   * @param name The register, counter or table name, ignored for queue depths.
+   * @param switches Indices of the switches to sample, all connected switches
+   * (at StartTelemetry) if empty.
+   * @return The metric ID used in the output.
+   */
+  uint32_t AddTelemetryMetric(TelemetryMetricType type,
+                              const std::string &name = "",
+                              const std::vector<uint32_t> &switches = {});
+
+  /**
+   * @brief Starts sampling the metrics.
+   *
+   * Every interval, one event samples all metrics on all their switches and
+   * streams the rows through a buffered P4TelemetryWriter.
+   * @param interval Time between samples, the first one is taken now.
+   * @param path The output file.
+   * @param format CSV or binary rows.
+   * @param suppressUnchanged Write a cell only if it changed since it was last
+   * written. Registers, counters and tables then go through the delta
+   * snapshots of the core, whose baselines the poller takes over.
+   * @return 0 on success, -1 if no metric was added or the file cannot be
+   * created.
+   */
+  int StartTelemetry(Time interval, const std::string &path,
+                     P4TelemetryWriter::Format format = P4TelemetryWriter::CSV,
+                     bool suppressUnchanged = false);
+
+  /**
+   * @brief Stops the poller and writes the buffered rows to the file.
+   */
+  void StopTelemetry();
+
+  /**
+   * @brief Gets the number of rows the poller wrote since it started.
+   */
+  uint64_t GetTelemetryRows() const;
+
+protected:
+  void DoDispose() override;
+
 private:
+  /**
+   * @brief Samples of one metric on one switch.
+   */
+  struct TelemetrySeries {
+    uint32_t switchIndex;          //!< The switch
+    bool primed{false};            //!< Sampled at least once
+    bool staleHandles{false};      //!< An entry was gone at the last sample
+    std::vector<uint64_t> last;    //!< Last written queue depths, two per port
+  };
+
+  /**
+   * @brief Metric of the telemetry poller.
+   */
+  struct TelemetryMetric {
+    TelemetryMetricType type;            //!< Kind of metric
+    std::string name;                    //!< Register, counter or table
+    std::vector<uint32_t> switches;      //!< Requested switches
+    std::vector<TelemetrySeries> series; //!< One per sampled switch
+  };
+
+  /**
+   * @brief Samples all metrics and schedules the next poll.
+   */
+  void PollTelemetry();
+
+  /**
+   * @brief Samples one metric on one switch.
+   * @param id The metric ID.
+   * @param series The switch.
+   * @param now The sample time in nanoseconds.
+   */
+  void SampleTelemetry(uint32_t id, TelemetrySeries &series, uint64_t now);
+
+  /**
+   * @brief Writes one queue depth, unless it is unchanged and suppressed.
+   *
+   * Register, counter and table cells are suppressed by the delta snapshots
+   * of the core instead.
+   * @param id The metric ID.
+   * @param series The switch.
+   * @param now The sample time in nanoseconds.
+   * @param cell The cell.
+   * @param value The value.
+   * @param value2 The second value.
+   */
+  void WriteTelemetry(uint32_t id, TelemetrySeries &series, uint64_t now,
+                      uint32_t cell, uint64_t value, uint64_t value2);
+
+  /**
+   * @brief Changes of a flow table reconfiguration, in application order.
+   */
+  struct FlowTableDiff {
+    /**
+     * @brief One change of one table.
+     */
+    struct Change {
+      std::string tableName;       //!< The table
+      bm::entry_handle_t handle{}; //!< Entry to delete or modify
+      P4FlowEntry entry;           //!< Entry to add, or the new action
+    };
+
+    std::vector<Change> deletes;  //!< Entries to delete
+    std::vector<Change> modifies; //!< Entries to modify
+    std::vector<Change> adds;     //!< Entries to add
+    uint32_t bytes{0};            //!< Encoded size of the changes
+    P4FlowTableDiffStats stats;   //!< Outcome
+  };
+
+  /**
+   * @brief Compares a table with its desired state and records the changes.
+   * @param index The switch index.
+   * @param core The core of the switch.
+   * @param tableName The name of the table.
+   * @param desired The complete desired content of the table.
+   * @param diff Receives the changes.
+   * @return 0 on success, -1 if the table does not exist.
+   */
+  int PlanFlowTableDiff(uint32_t index, P4CoreV1model *core,
+                        const std::string &tableName,
+                        const std::vector<P4FlowEntry> &desired,
+                        FlowTableDiff *diff);
+
+  /**
+   * @brief Sends the changes as one request.
+   * @param index The switch index.
+   * @param diff The changes.
+   * @param completion Called once they are applied.
+   */
+  void SubmitFlowTableDiff(uint32_t index, std::shared_ptr<FlowTableDiff> diff,
+                           DiffCompletion completion);
+
+  /**
+   * @brief Gets the known entry handles of a table. Handles the switch no
+   * longer knows are dropped, and the handles are read from the switch if
+   * their number still does not match the entry count.
+   * @param index The switch index.
+   * @param core The core of the switch.
+   * @param tableName The name of the table.
+   * @return The handles.
+   */
+  std::unordered_set<bm::entry_handle_t> &
+  GetTableHandles(uint32_t index, P4CoreV1model *core,
+                  const std::string &tableName);
+
+  /**
+   * @brief Records an entry added or deleted through the controller in the
+   * known handles of its table, if they were read already.
+   * @param index The switch index.
+   * @param tableName The name of the table.
+   * @param handle The entry handle.
+   * @param present True if the entry was added, false if deleted.
+   */
+  void UpdateTableHandle(uint32_t index, const std::string &tableName,
+                         bm::entry_handle_t handle, bool present);
+
+  /**
+   * @brief A configuration swap waiting for its time.
+   */
+  struct ConfigSwap {
+    std::vector<P4CoreV1model *> cores;      //!< Cores of the switches
+    std::vector<P4ConfigSwapReport> reports; //!< One per switch
+    std::thread loader;                      //!< Loads the new program
+    std::string error;                       //!< Why the program was not read
+    EventId event;                           //!< The swap
+    SwapCompletion completion;               //!< Receives the reports
+
+    ~ConfigSwap() {
+      if (loader.joinable()) {
+        loader.join();
+      }
+    }
+  };
+
+  /**
+   * @brief Swaps the loaded program in on the switches of a scheduled swap.
+   * @param swap The swap.
+   */
+  void CommitConfigSwap(std::shared_ptr<ConfigSwap> swap);
+
   /**
    * @brief Collection of P4 switch interfaces managed by the controller.
    *        Each switch is identified by its index in this vector.
@@ -761,6 +1265,26 @@ private:
   P4Controller &operator=(const P4Controller &) = delete;
 
   std::vector<ns3::Ptr<ns3::P4SwitchNetDevice>> m_connectedSwitches;
+  Ptr<P4ControlChannel> m_controlChannel; //!< Carries the async operations
+  DigestCallback m_digestCallback;        //!< Receives the digests
+  AgeingCallback m_ageingCallback;        //!< Receives the expired entries
+
+  std::vector<TelemetryMetric> m_telemetryMetrics; //!< Metrics by ID
+  Time m_telemetryInterval;                        //!< Time between samples
+  bool m_telemetrySuppress{false};          //!< Unchanged cells are skipped
+  EventId m_telemetryEvent;                 //!< Next poll
+  P4TelemetryWriter m_telemetryWriter;      //!< Output of the poller
+  std::vector<uint64_t> m_telemetryValues;  //!< Snapshot buffer
+  std::vector<uint64_t> m_telemetryValues2; //!< Snapshot buffer, packets
+  std::vector<uint32_t> m_telemetryCells;   //!< Delta snapshot buffer, indices
+  std::vector<bm::entry_handle_t> m_telemetryHandles; //!< Entries to read
+  std::vector<bm::entry_handle_t> m_telemetryChanged; //!< Changed entries
+
+  std::map<std::pair<uint32_t, std::string>,
+           std::unordered_set<bm::entry_handle_t>>
+      m_tableHandles; //!< Entry handles by switch and table
+
+  std::vector<std::shared_ptr<ConfigSwap>> m_configSwaps; //!< Pending swaps
 };
 
 } // namespace ns3
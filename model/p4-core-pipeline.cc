@@ -125,7 +125,7 @@ P4CorePipeline::ReceivePacket(Ptr<Packet> packetIn,
     int learn_id = RegisterAccess::get_lf_field_list(bm_packet.get());
     if (learn_id > 0)
     {
-        get_learn_engine()->learn(learn_id, *bm_packet.get());
+        Learn(learn_id, *bm_packet.get());
     }
 
     // === Egress
@@ -166,6 +166,7 @@ void
 P4CorePipeline::swap_notify_()
 {
     NS_LOG_FUNCTION("p4_switch has been notified of a config swap");
+    P4SwitchCore::swap_notify_();
 }
 
 void
@@ -179,6 +179,7 @@ void
 P4CorePsa::swap_notify_()
 {
     NS_LOG_FUNCTION("p4_switch has been notified of a config swap");
+    P4SwitchCore::swap_notify_();
     CheckQueueingMetadata();
 }
 
@@ -196,6 +197,7 @@ P4CorePsa::ReceivePacket(Ptr<Packet> packetIn,
                          const Address& destination)
 {
     NS_LOG_FUNCTION(this);
+    ClockLatch latch(this);
     std::unique_ptr<bm::Packet> bm_packet = ConvertToBmPacket(packetIn, inPort);
 
     bm::PHV* phv = bm_packet->get_phv();
@@ -211,6 +213,11 @@ P4CorePsa::ReceivePacket(Ptr<Packet> packetIn,
     RegisterAccess::clear_all(bm_packet.get());
     RegisterAccess::set_ns_protocol(bm_packet.get(), protocol);
     int addr_index = GetAddressIndex(destination);
+    if (addr_index < 0)
+    {
+        NS_LOG_WARN("No address index left, dropping packet");
+        return -1;
+    }
     RegisterAccess::set_ns_address(bm_packet.get(), addr_index);
 
     // TODO use appropriate enum member from JSON
@@ -242,10 +249,17 @@ P4CorePsa::Enqueue(uint32_t egress_port, std::unique_ptr<bm::Packet>&& packet)
     if (priority >= m_nbQueuesPerPort)
     {
         NS_LOG_ERROR("Priority out of range, dropping packet");
+        ReleaseAddress(packet.get());
         return;
     }
 
-    egress_buffer.push_front(egress_port, m_nbQueuesPerPort - 1 - priority, std::move(packet));
+    if (egress_buffer.push_front(egress_port, m_nbQueuesPerPort - 1 - priority, std::move(packet)) ==
+        0)
+    {
+        // the queue is full, the packet was not moved
+        ReleaseAddress(packet.get());
+        return;
+    }
     NS_LOG_DEBUG("Packet enqueued in P4QueueDisc, Port: " << egress_port
                                                           << ", Priority: " << priority);
 }
@@ -254,6 +268,7 @@ void
 P4CorePsa::HandleIngressPipeline()
 {
     NS_LOG_FUNCTION(this);
+    ClockLatch latch(this);
 
     std::unique_ptr<bm::Packet> bm_packet;
     input_buffer.pop_back(&bm_packet);
@@ -327,6 +342,7 @@ P4CorePsa::HandleIngressPipeline()
             bm_packet->restore_buffer_state(packet_in_state);
 
             std::unique_ptr<bm::Packet> packet_copy = bm_packet->clone_no_phv_ptr();
+            CopyAddress(packet_copy.get());
             packet_copy->set_register(RegisterAccess::PACKET_LENGTH_REG_IDX, ingress_packet_size);
             auto phv_copy = packet_copy->get_phv();
             phv_copy->reset_metadata();
@@ -346,6 +362,10 @@ P4CorePsa::HandleIngressPipeline()
                 NS_LOG_DEBUG("Cloning packet to egress port " << config.egress_port);
                 Enqueue(config.egress_port, std::move(packet_copy));
             }
+            else
+            {
+                ReleaseAddress(packet_copy.get());
+            }
 
             bm_packet->restore_buffer_state(packet_out_state);
         }
@@ -364,6 +384,7 @@ P4CorePsa::HandleIngressPipeline()
     if (drop)
     {
         NS_LOG_DEBUG("Dropping packet at the end of ingress");
+        ReleaseAddress(bm_packet.get());
         return;
     }
 
@@ -397,6 +418,8 @@ P4CorePsa::HandleIngressPipeline()
         NS_LOG_DEBUG("Multicast requested for packet with multicast group " << mgid);
         // MulticastPacket (packet_copy.get (), config.mgid);
         MultiCastPacket(bm_packet.get(), mgid, PACKET_PATH_NORMAL_MULTICAST, ig_cos);
+        // the copies hold their own references, the original is discarded
+        ReleaseAddress(bm_packet.get());
         return;
     }
 
@@ -417,6 +440,7 @@ bool
 P4CorePsa::HandleEgressPipeline(size_t worker_id)
 {
     NS_LOG_FUNCTION("Dequeue packet from QueueBuffer");
+    ClockLatch latch(this);
     std::unique_ptr<bm::Packet> bm_packet;
     size_t port;
     size_t priority;
@@ -486,6 +510,7 @@ P4CorePsa::HandleEgressPipeline(size_t worker_id)
         {
             NS_LOG_DEBUG("Cloning packet after egress to session id " << clone_session_id);
             std::unique_ptr<bm::Packet> packet_copy = bm_packet->clone_no_phv_ptr();
+            CopyAddress(packet_copy.get());
             auto phv_copy = packet_copy->get_phv();
             phv_copy->reset_metadata();
             phv_copy->get_field("psa_egress_parser_input_metadata.packet_path")
@@ -504,6 +529,10 @@ P4CorePsa::HandleEgressPipeline(size_t worker_id)
                 NS_LOG_DEBUG("Cloning packet to egress port " << config.egress_port);
                 Enqueue(config.egress_port, std::move(packet_copy));
             }
+            else
+            {
+                ReleaseAddress(packet_copy.get());
+            }
         }
         else
         {
@@ -516,6 +545,7 @@ P4CorePsa::HandleEgressPipeline(size_t worker_id)
     if (drop)
     {
         NS_LOG_DEBUG("Dropping packet at the end of egress");
+        ReleaseAddress(bm_packet.get());
         return true;
     }
 
@@ -538,9 +568,11 @@ P4CorePsa::HandleEgressPipeline(size_t worker_id)
 
     uint16_t protocol = RegisterAccess::get_ns_protocol(bm_packet.get());
     int addr_index = RegisterAccess::get_ns_address(bm_packet.get());
+    Address destination =
+        GetDestinationAddress(addr_index, RegisterAccess::get_ns_address_held(bm_packet.get()));
 
     Ptr<Packet> ns_packet = this->ConvertToNs3Packet(std::move(bm_packet));
-    m_switchNetDevice->SendNs3Packet(ns_packet, port, protocol, m_destinationList[addr_index]);
+    m_switchNetDevice->SendNs3Packet(ns_packet, port, protocol, destination);
     return true;
 }
 
@@ -566,6 +598,7 @@ P4CorePsa::MultiCastPacket(bm::Packet* packet,
         // TODO use appropriate enum member from JSON
         f_packet_path.set(path);
         std::unique_ptr<bm::Packet> packet_copy = packet->clone_with_phv_ptr();
+        CopyAddress(packet_copy.get());
         packet_copy->set_register(RegisterAccess::PACKET_LENGTH_REG_IDX, packet_size);
         Enqueue(egress_port, std::move(packet_copy));
     }
@@ -19,6 +19,9 @@
 
 #include "ns3/p4-core-v1model.h"
 
+#include "ns3/node.h"
+#include "ns3/p4-event-profiler.h"
+#include "ns3/p4-state-stream.h"
 #include "ns3/p4-switch-net-device.h"
 #include "ns3/primitives-v1model.h"
 #include "ns3/register-access-v1model.h"
@@ -26,6 +29,12 @@
 
 #include <fstream> // tracing info to file
 #include <sstream>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 NS_LOG_COMPONENT_DEFINE("P4CoreV1model");
 
@@ -69,9 +78,11 @@ P4CoreV1model::P4CoreV1model(P4SwitchNetDevice *net_device, bool enable_swap,
                              size_t input_buffer_size_low,
                              size_t input_buffer_size_high,
                              size_t queue_buffer_size,
-                             size_t nb_queues_per_port)
+                             size_t nb_queues_per_port,
+                             size_t nb_egress_threads)
     : P4SwitchCore(net_device, enable_swap, enableTracing), m_packetId(0),
       m_switchRate(packet_rate), m_nbQueuesPerPort(nb_queues_per_port),
+      m_nbEgressThreads(nb_egress_threads > 0 ? nb_egress_threads : 1),
       input_buffer(std::make_unique<InputBuffer>(input_buffer_size_low,
                                                  input_buffer_size_high)),
       egress_buffer(m_nbEgressThreads, queue_buffer_size,
@@ -113,16 +124,12 @@ P4CoreV1model::P4CoreV1model(P4SwitchNetDevice *net_device, bool enable_swap,
 P4CoreV1model::~P4CoreV1model() {
   NS_LOG_FUNCTION(this << " Destructing P4CoreV1model...");
 
+  StopEmulation();
+
   if (input_buffer) {
     input_buffer->push_front(InputBuffer::PacketType::SENTINEL, nullptr);
   }
 
-  for (size_t i = 0; i < m_nbEgressThreads; i++) {
-    while (egress_buffer.push_front(i, 0, nullptr) == 0) {
-      continue;
-    }
-  }
-
   output_buffer.push_front(nullptr);
 
   NS_LOG_INFO("P4CoreV1model destroyed successfully.");
@@ -261,25 +268,144 @@ void P4CoreV1model::start_and_return_() {
   NS_LOG_FUNCTION("Switch ID: " << m_p4SwitchId << " start");
   CheckQueueingMetadata();
 
-  if (!m_egressTimeRef.IsZero()) {
+  Ptr<Node> node = m_switchNetDevice->GetNode();
+  m_nodeId = node ? node->GetId() : 0;
+
+  if (m_emulation) {
+    NS_LOG_INFO("Switch ID: " << m_p4SwitchId << " starting 1 ingress and "
+                              << m_nbEgressThreads << " egress threads");
+    m_emitToken = std::make_shared<bool>(true);
+    m_workers.emplace_back(&P4CoreV1model::IngressThread, this);
+    for (size_t i = 0; i < m_nbEgressThreads; i++) {
+      m_workers.emplace_back(&P4CoreV1model::EgressThread, this, i);
+    }
+  } else if (!m_egressTimeRef.IsZero()) {
     NS_LOG_DEBUG("Switch ID: "
                  << m_p4SwitchId
                  << " Scheduling initial timer event using m_egressTimeRef = "
                  << m_egressTimeRef.GetNanoSeconds() << " ns");
     m_egressTimeEvent = Simulator::Schedule(
         m_egressTimeRef, &P4CoreV1model::SetEgressTimerEvent, this);
+    if (P4EventProfiler::IsEnabled()) {
+      P4EventProfiler::RecordScheduled(P4EventProfiler::EGRESS_TIMER,
+                                       GetNodeId());
+    }
   }
 
   if (m_enableTracing) {
     NS_LOG_INFO("Enabling tracing in P4 Switch ID: " << m_p4SwitchId);
     Simulator::Schedule(m_timeInterval,
                         &P4CoreV1model::CalculatePacketsPerSecond, this);
+    if (P4EventProfiler::IsEnabled()) {
+      P4EventProfiler::RecordScheduled(P4EventProfiler::STATS_TIMER,
+                                       GetNodeId());
+    }
+  }
+}
+
+int P4CoreV1model::EnableEmulation(const std::vector<int> &cpuAffinity) {
+  NS_LOG_FUNCTION(this);
+  Ptr<RealtimeSimulatorImpl> realtime =
+      DynamicCast<RealtimeSimulatorImpl>(Simulator::GetImplementation());
+  if (!realtime) {
+    NS_LOG_ERROR("Emulation mode requires ns3::RealtimeSimulatorImpl");
+    return -1;
   }
+  m_emulation = true;
+  m_cpuAffinity = cpuAffinity;
+  // worker threads must not read the simulator time
+  SetRealtimeClock(realtime);
+  egress_buffer.set_clock([this]() -> Time { return GetClock(); });
+  return 0;
+}
+
+void P4CoreV1model::StopEmulation() {
+  if (m_workers.empty()) {
+    return;
+  }
+  NS_LOG_FUNCTION(this);
+  // the workers drop what is still queued instead of draining the backlog at
+  // the queue rates
+  m_stopping = true;
+  input_buffer->push_front(InputBuffer::PacketType::SENTINEL, nullptr);
+  egress_buffer.stop();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+  // packets already handed over to the simulator thread are dropped too
+  m_emitToken.reset();
+}
+
+bool P4CoreV1model::IsEmulation() const { return m_emulation; }
+
+void P4CoreV1model::PinWorkerThread(size_t threadIndex) {
+  if (m_cpuAffinity.empty()) {
+    return;
+  }
+  int cpu = m_cpuAffinity[threadIndex % m_cpuAffinity.size()];
+#ifdef __linux__
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+    NS_LOG_WARN("Cannot pin worker thread " << threadIndex << " to CPU "
+                                            << cpu);
+  }
+#else
+  NS_LOG_WARN("Thread affinity is not supported on this platform, CPU "
+              << cpu << " ignored");
+#endif
+}
+
+void P4CoreV1model::IngressThread() {
+  PinWorkerThread(0);
+  while (true) {
+    std::unique_ptr<bm::Packet> bm_packet;
+    input_buffer->pop_back_wait(&bm_packet);
+    if (bm_packet == nullptr) {
+      break; // sentinel
+    }
+    if (m_stopping) {
+      ReleaseAddress(bm_packet.get());
+      continue;
+    }
+    ProcessIngress(std::move(bm_packet));
+  }
+}
+
+void P4CoreV1model::EgressThread(size_t workerId) {
+  PinWorkerThread(1 + workerId);
+  while (true) {
+    std::unique_ptr<bm::Packet> bm_packet;
+    size_t port;
+    size_t priority;
+    egress_buffer.pop_back_wait(workerId, &port, &priority, &bm_packet);
+    if (bm_packet == nullptr) {
+      break; // sentinel
+    }
+    ProcessEgress(port, priority, std::move(bm_packet));
+  }
+}
+
+void P4CoreV1model::EmitPacket(std::shared_ptr<bm::Packet> bm_packet,
+                               uint32_t port, uint16_t protocol,
+                               Address destination) {
+  Ptr<Packet> ns_packet = Create<Packet>(
+      reinterpret_cast<uint8_t *>(bm_packet->data()),
+      bm_packet->get_data_size());
+  m_switchNetDevice->SendNs3Packet(ns_packet, port, protocol, destination);
 }
 
 void P4CoreV1model::swap_notify_() {
   NS_LOG_FUNCTION("p4_switch has been notified of a config swap");
+  P4SwitchCore::swap_notify_();
   CheckQueueingMetadata();
+  // the new program may declare other arrays
+  m_snapshotArraysLoaded = false;
+  m_registerSnapshots.clear();
+  m_counterSnapshots.clear();
+  m_tableSnapshots.clear();
 }
 
 void P4CoreV1model::reset_target_state_() {
@@ -289,9 +415,14 @@ void P4CoreV1model::reset_target_state_() {
 
 void P4CoreV1model::SetEgressTimerEvent() {
   NS_LOG_FUNCTION("p4_switch has been triggered by the egress timer event");
+  P4EventProfiler::Scope profile(P4EventProfiler::EGRESS_TIMER, GetNodeId());
   bool checkflag = HandleEgressPipeline(0);
   m_egressTimeEvent = Simulator::Schedule(
       m_egressTimeRef, &P4CoreV1model::SetEgressTimerEvent, this);
+  if (P4EventProfiler::IsEnabled()) {
+    P4EventProfiler::RecordScheduled(P4EventProfiler::EGRESS_TIMER,
+                                     GetNodeId());
+  }
   if (!m_firstPacket && checkflag) {
     m_firstPacket = true;
   }
@@ -299,14 +430,26 @@ void P4CoreV1model::SetEgressTimerEvent() {
     NS_LOG_INFO(
         "Egress timer event needs additional scheduling due to !checkflag.");
     Simulator::Schedule(Time(NanoSeconds(10)),
-                        &P4CoreV1model::HandleEgressPipeline, this, 0);
+                        &P4CoreV1model::RetryEgressPipeline, this);
+    if (P4EventProfiler::IsEnabled()) {
+      P4EventProfiler::RecordScheduled(P4EventProfiler::EGRESS_RETRY,
+                                       GetNodeId());
+    }
   }
 }
 
+void P4CoreV1model::RetryEgressPipeline() {
+  P4EventProfiler::Scope profile(P4EventProfiler::EGRESS_RETRY, GetNodeId());
+  HandleEgressPipeline(0);
+}
+
+uint32_t P4CoreV1model::GetNodeId() const { return m_nodeId; }
+
 int P4CoreV1model::ReceivePacket(Ptr<Packet> packetIn, int inPort,
                                  uint16_t protocol,
                                  const Address &destination) {
   NS_LOG_FUNCTION(this);
+  ClockLatch latch(this);
 
   std::unique_ptr<bm::Packet> bm_packet = ConvertToBmPacket(packetIn, inPort);
 
@@ -325,6 +468,10 @@ int P4CoreV1model::ReceivePacket(Ptr<Packet> packetIn, int inPort,
   RegisterAccess::clear_all(bm_packet.get());
   RegisterAccess::set_ns_protocol(bm_packet.get(), protocol);
   int addr_index = GetAddressIndex(destination);
+  if (addr_index < 0) {
+    NS_LOG_WARN("No address index left, dropping packet");
+    return -1;
+  }
   RegisterAccess::set_ns_address(bm_packet.get(), addr_index);
 
   // setting standard metadata
@@ -344,7 +491,9 @@ int P4CoreV1model::ReceivePacket(Ptr<Packet> packetIn, int inPort,
 
   input_buffer->push_front(InputBuffer::PacketType::NORMAL,
                            std::move(bm_packet));
-  HandleIngressPipeline();
+  if (!m_emulation) {
+    HandleIngressPipeline();
+  }
   NS_LOG_DEBUG("Packet received by P4CoreV1model, Port: "
                << inPort << ", Packet ID: " << m_packetId << ", Size: " << len
                << " bytes");
@@ -358,7 +507,11 @@ void P4CoreV1model::HandleIngressPipeline() {
   input_buffer->pop_back(&bm_packet);
   if (bm_packet == nullptr)
     return;
+  ProcessIngress(std::move(bm_packet));
+}
 
+void P4CoreV1model::ProcessIngress(std::unique_ptr<bm::Packet> &&bm_packet) {
+  ClockLatch latch(this);
   bm::Parser *parser = this->get_parser("parser");
   bm::Pipeline *ingress_mau = this->get_pipeline("ingress");
   bm::PHV *phv = bm_packet->get_phv();
@@ -469,7 +622,7 @@ void P4CoreV1model::HandleIngressPipeline() {
 
   // LEARNING
   if (learn_id > 0) {
-    get_learn_engine()->learn(learn_id, *bm_packet.get());
+    Learn(learn_id, *bm_packet.get());
   }
 
   // RESUBMIT
@@ -493,10 +646,13 @@ void P4CoreV1model::HandleIngressPipeline() {
                                  ingress_packet_size);
     phv_copy->get_field("standard_metadata.packet_length")
         .set(ingress_packet_size);
+    ReleaseAddress(bm_packet.get());
 
     input_buffer->push_front(InputBuffer::PacketType::RESUBMIT,
                              std::move(bm_packet_copy));
-    HandleIngressPipeline();
+    if (!m_emulation) {
+      HandleIngressPipeline();
+    }
     return;
   }
 
@@ -507,6 +663,7 @@ void P4CoreV1model::HandleIngressPipeline() {
     f_instance_type.set(PKT_INSTANCE_TYPE_REPLICATION);
     MulticastPacket(bm_packet.get(), mgid);
     // when doing MulticastPacket, we discard the original packet
+    ReleaseAddress(bm_packet.get());
     return;
   }
 
@@ -516,6 +673,7 @@ void P4CoreV1model::HandleIngressPipeline() {
   if (egress_port == m_dropPort) {
     // drop packet
     NS_LOG_DEBUG("Dropping packet at the end of ingress");
+    ReleaseAddress(bm_packet.get());
     return;
   }
   auto &f_instance_type = phv->get_field("standard_metadata.instance_type");
@@ -545,11 +703,16 @@ void P4CoreV1model::Enqueue(uint32_t egress_port,
           : 0u;
   if (priority >= m_nbQueuesPerPort) {
     NS_LOG_ERROR("Priority out of range, dropping packet");
+    ReleaseAddress(packet.get());
     return;
   }
 
-  egress_buffer.push_front(egress_port, m_nbQueuesPerPort - 1 - priority,
-                           std::move(packet));
+  if (egress_buffer.push_front(egress_port, m_nbQueuesPerPort - 1 - priority,
+                               std::move(packet)) == 0) {
+    // the queue is full, the packet was not moved
+    ReleaseAddress(packet.get());
+    return;
+  }
 
   NS_LOG_DEBUG("Packet enqueued in queue buffer with Port: "
                << egress_port << ", Priority: " << priority);
@@ -575,7 +738,12 @@ bool P4CoreV1model::HandleEgressPipeline(size_t workerId) {
   egress_buffer.pop_back(workerId, &port, &priority, &bm_packet);
   if (bm_packet == nullptr)
     return false;
+  return ProcessEgress(port, priority, std::move(bm_packet));
+}
 
+bool P4CoreV1model::ProcessEgress(size_t port, size_t priority,
+                                  std::unique_ptr<bm::Packet> &&bm_packet) {
+  ClockLatch latch(this);
   if (m_enableTracing) {
     m_egressPps++; // egress pps
     int len = bm_packet->get_data_size();
@@ -605,6 +773,7 @@ bool P4CoreV1model::HandleEgressPipeline(size_t workerId) {
     if (priority >= m_nbQueuesPerPort) {
       NS_LOG_ERROR("Priority out of range (m_nbQueuesPerPort = "
                    << m_nbQueuesPerPort << "), dropping packet");
+      ReleaseAddress(bm_packet.get());
       return true;
     }
 
@@ -675,6 +844,7 @@ bool P4CoreV1model::HandleEgressPipeline(size_t workerId) {
   if (egress_spec == m_dropPort) {
     // drop packet
     NS_LOG_DEBUG("Dropping packet at the end of egress");
+    ReleaseAddress(bm_packet.get());
     return true;
   }
 
@@ -706,18 +876,35 @@ bool P4CoreV1model::HandleEgressPipeline(size_t workerId) {
     packet_copy->set_ingress_length(packet_size);
     input_buffer->push_front(InputBuffer::PacketType::RECIRCULATE,
                              std::move(packet_copy));
+    ReleaseAddress(bm_packet.get());
     return true;
   }
 
   uint16_t protocol = RegisterAccess::get_ns_protocol(bm_packet.get());
   int addr_index = RegisterAccess::get_ns_address(bm_packet.get());
+  Address destination = GetDestinationAddress(
+      addr_index, RegisterAccess::get_ns_address_held(bm_packet.get()));
+
+  if (m_emulation) {
+    // ns-3 objects belong to the simulator thread, hand the packet over. The
+    // switch may be stopped, and destroyed, before the event runs.
+    std::weak_ptr<bool> alive = m_emitToken;
+    std::shared_ptr<bm::Packet> packet(bm_packet.release());
+    Simulator::ScheduleWithContext(
+        m_nodeId, Time(0),
+        [this, alive, packet, port, protocol, destination]() {
+          if (!alive.expired()) {
+            EmitPacket(packet, port, protocol, destination);
+          }
+        });
+    return true;
+  }
 
   Ptr<Packet> ns_packet = this->ConvertToNs3Packet(std::move(bm_packet));
   NS_LOG_DEBUG("Sending packet to NS-3 stack, Packet ID: "
                << ns_packet->GetUid() << ", Size: " << ns_packet->GetSize()
                << " bytes");
-  m_switchNetDevice->SendNs3Packet(ns_packet, port, protocol,
-                                   m_destinationList[addr_index]);
+  m_switchNetDevice->SendNs3Packet(ns_packet, port, protocol, destination);
   return true;
 }
 
@@ -735,6 +922,20 @@ void P4CoreV1model::CalculateScheduleTime() {
                              << m_egressTimeRef.GetNanoSeconds() << " [ns])");
 }
 
+void P4CoreV1model::GetMemoryReport(P4SwitchMemoryReport *report) const {
+  P4SwitchCore::GetMemoryReport(report);
+  report->coreBytes = sizeof(*this);
+
+  // each queued bm packet holds its buffer (frame + headroom, see
+  // ConvertToBmPacket); PHVs come from the per-context pool counted at load
+  size_t queued = input_buffer->get_occupancy() + egress_buffer.total_size();
+  size_t perPacket =
+      sizeof(bm::Packet) + m_switchNetDevice->GetMtu() + BM_PACKET_HEADROOM;
+  report->queuedPackets = queued;
+  report->queueBytes = sizeof(InputBuffer) + egress_buffer.footprint_bytes() +
+                       queued * perPacket;
+}
+
 void P4CoreV1model::MulticastPacket(bm::Packet *packet, unsigned int mgid) {
   NS_LOG_FUNCTION(this);
   auto *phv = packet->get_phv();
@@ -755,11 +956,18 @@ void P4CoreV1model::MulticastPacket(bm::Packet *packet, unsigned int mgid) {
 }
 
 void P4CoreV1model::CalculatePacketsPerSecond() {
-  // Calculating P4 switch statistics
-  m_inputBp += m_inputBps;
-  m_inputPp += m_inputPps;
-  m_egressBp += m_egressBp;
-  m_egressPp += m_egressPps;
+  P4EventProfiler::Scope profile(P4EventProfiler::STATS_TIMER, GetNodeId());
+
+  // Calculating P4 switch statistics, the interval counters are taken at
+  // once since the worker threads keep counting
+  uint64_t inputPps = m_inputPps.exchange(0);
+  uint64_t inputBps = m_inputBps.exchange(0);
+  uint64_t egressPps = m_egressPps.exchange(0);
+  uint64_t egressBps = m_egressBps.exchange(0);
+  m_inputBp += inputBps;
+  m_inputPp += inputPps;
+  m_egressBp += egressBps;
+  m_egressPp += egressPps;
 
   // Construct log file path
   std::string log_filename =
@@ -774,22 +982,17 @@ void P4CoreV1model::CalculatePacketsPerSecond() {
   std::ostringstream log_stream;
   log_stream << "P4 switch ID: " << m_p4SwitchId << "\n";
   log_stream << "Time: " << Simulator::Now().GetSeconds() << " [s]\n";
-  log_stream << "Input packets per time interval: " << m_inputPps << " [pps]\n";
-  log_stream << "Input bits per time interval: " << m_inputBps << " [bps]\n";
-  log_stream << "Egress packets per time interval: " << m_egressPps
+  log_stream << "Input packets per time interval: " << inputPps << " [pps]\n";
+  log_stream << "Input bits per time interval: " << inputBps << " [bps]\n";
+  log_stream << "Egress packets per time interval: " << egressPps
              << " [pps]\n";
-  log_stream << "Egress bits per time interval: " << m_egressBps << " [bps]\n";
+  log_stream << "Egress bits per time interval: " << egressBps << " [bps]\n";
 
   log_stream << "Total input packets: " << m_inputPp << " [pp]\n";
   log_stream << "Total input bits: " << m_inputBp << " [bp]\n";
   log_stream << "Total egress packets: " << m_egressPp << " [pp]\n";
   log_stream << "Total egress bits: " << m_egressBp << " [bp]\n";
 
-  m_inputPps = 0;
-  m_inputBps = 0;
-  m_egressPps = 0;
-  m_egressBps = 0;
-
   size_t input_buffer_size = input_buffer->get_size();
   log_stream << "Input buffer size: " << input_buffer_size << "\n";
 
@@ -817,6 +1020,10 @@ void P4CoreV1model::CalculatePacketsPerSecond() {
 
   Simulator::Schedule(m_timeInterval, &P4CoreV1model::CalculatePacketsPerSecond,
                       this);
+  if (P4EventProfiler::IsEnabled()) {
+    P4EventProfiler::RecordScheduled(P4EventProfiler::STATS_TIMER,
+                                     GetNodeId());
+  }
 }
 
 void P4CoreV1model::CopyFieldList(const std::unique_ptr<bm::Packet> &packet,
@@ -846,6 +1053,10 @@ int P4CoreV1model::SetAllEgressQueueDepths(const size_t depth_pkts) {
   return 0;
 }
 
+size_t P4CoreV1model::GetEgressQueueOccupancy(size_t port) {
+  return egress_buffer.size(port);
+}
+
 int P4CoreV1model::SetEgressPriorityQueueRate(size_t port, size_t priority,
                                               const uint64_t rate_pps) {
   egress_buffer.set_rate(port, priority, rate_pps);
@@ -945,6 +1156,7 @@ int P4CoreV1model::DeleteFlowEntry(const std::string &tableName,
               << static_cast<int>(rc) << " (" << MatchErrorCodeToStr(rc) << ")";
     return -1;
   }
+  ClearEntryIdleTimeout(tableName, handle);
 
   return 0;
 }
@@ -967,6 +1179,9 @@ int P4CoreV1model::ModifyFlowEntry(const std::string &tableName,
 }
 int P4CoreV1model::SetEntryTtl(const std::string &tableName,
                                bm::entry_handle_t handle, unsigned int ttlMs) {
+  if (IsSimulatedAgeing()) {
+    return SetEntryIdleTimeout(tableName, handle, ttlMs);
+  }
 
   bm::MatchErrorCode rc = this->mt_set_entry_ttl(0, tableName, handle, ttlMs);
 
@@ -1192,11 +1407,15 @@ int P4CoreV1model::DeleteIndirectEntry(const std::string &tableName,
     return -1;
   }
 
+  ClearEntryIdleTimeout(tableName, entryHandle);
   return 0;
 }
 int P4CoreV1model::SetIndirectEntryTtl(const std::string &tableName,
                                        bm::entry_handle_t handle,
                                        unsigned int ttlMs) {
+  if (IsSimulatedAgeing()) {
+    return SetEntryIdleTimeout(tableName, handle, ttlMs, true);
+  }
 
   bm::MatchErrorCode rc =
       this->mt_indirect_set_entry_ttl(0, tableName, handle, ttlMs);
@@ -1351,6 +1570,13 @@ int P4CoreV1model::GetEntry(const std::string &tableName,
   return 0;
 }
 
+bool P4CoreV1model::HasEntry(const std::string &tableName,
+                             bm::entry_handle_t handle) {
+  bm::MatchTable::Entry entry;
+  return this->mt_get_entry(0, tableName, handle, &entry) ==
+         bm::MatchErrorCode::SUCCESS;
+}
+
 int P4CoreV1model::GetIndirectEntry(const std::string &tableName,
                                     bm::entry_handle_t handle,
                                     bm::MatchTableIndirect::Entry *entry) {
@@ -1434,6 +1660,24 @@ int P4CoreV1model::GetEntryFromKey(
   return 0;
 }
 
+int P4CoreV1model::FindEntryFromKey(
+    const std::string &tableName,
+    const std::vector<bm::MatchKeyParam> &matchKey,
+    bm::MatchTable::Entry *entry, int priority) {
+
+  bm::MatchErrorCode rc =
+      this->mt_get_entry_from_key(0, tableName, matchKey, entry, priority);
+  if (rc == bm::MatchErrorCode::SUCCESS) {
+    return 1;
+  }
+  if (rc == bm::MatchErrorCode::BAD_MATCH_KEY) {
+    return 0;
+  }
+  NS_LOG_WARN("FindEntryFromKey failed for table: "
+              << tableName << ", error: " << MatchErrorCodeToStr(rc));
+  return -1;
+}
+
 int P4CoreV1model::GetIndirectEntryFromKey(
     const std::string &tableName,
     const std::vector<bm::MatchKeyParam> &matchKey,
@@ -1720,6 +1964,207 @@ int P4CoreV1model::RegisterReset(const std::string &registerName) {
   }
   return 0;
 }
+P4CoreV1model::SnapshotArray *
+P4CoreV1model::GetSnapshotArray(const std::string &name, bool isCounter) {
+  if (!m_snapshotArraysLoaded) {
+    m_snapshotArraysLoaded = true;
+    P4JsonValue root;
+    if (!P4JsonValue::Parse(get_config(), &root)) {
+      NS_LOG_WARN("Cannot read the register and counter arrays");
+    } else {
+      if (const P4JsonValue *arrays = root.Get("register_arrays")) {
+        for (const P4JsonValue &array : arrays->GetElements()) {
+          const P4JsonValue *arrayName = array.Get("name");
+          const P4JsonValue *size = array.Get("size");
+          if (arrayName && size) {
+            m_registerSnapshots[arrayName->GetString()].size = size->GetUint();
+          }
+        }
+      }
+      if (const P4JsonValue *arrays = root.Get("counter_arrays")) {
+        for (const P4JsonValue &array : arrays->GetElements()) {
+          const P4JsonValue *arrayName = array.Get("name");
+          const P4JsonValue *size = array.Get("size");
+          const P4JsonValue *isDirect = array.Get("is_direct");
+          // direct counters are read per entry, see ReadTableCounters
+          if (arrayName && size && !(isDirect && isDirect->GetBool())) {
+            m_counterSnapshots[arrayName->GetString()].size = size->GetUint();
+          }
+        }
+      }
+    }
+  }
+
+  auto &arrays = isCounter ? m_counterSnapshots : m_registerSnapshots;
+  auto it = arrays.find(name);
+  if (it == arrays.end()) {
+    NS_LOG_WARN("No " << (isCounter ? "counter" : "register") << " array "
+                      << name);
+    return nullptr;
+  }
+  return &it->second;
+}
+
+int P4CoreV1model::GetSnapshotSize(const std::string &name, bool isCounter) {
+  SnapshotArray *array = GetSnapshotArray(name, isCounter);
+  return array ? static_cast<int>(array->size) : -1;
+}
+
+int P4CoreV1model::RegisterSnapshot(const std::string &registerName,
+                                    uint64_t *values, size_t capacity) {
+  SnapshotArray *array = GetSnapshotArray(registerName, false);
+  if (!array) {
+    return -1;
+  }
+  if (capacity < array->size) {
+    NS_LOG_WARN("RegisterSnapshot of " << registerName << " needs "
+                                       << array->size << " cells, buffer has "
+                                       << capacity);
+    return -1;
+  }
+  for (size_t i = 0; i < array->size; i++) {
+    if (register_read(0, registerName, i, &m_snapshotCell) !=
+        bm::Register::RegisterErrorCode::SUCCESS) {
+      NS_LOG_WARN("RegisterSnapshot failed for register "
+                  << registerName << " at index " << i);
+      return -1;
+    }
+    values[i] = m_snapshotCell.get_uint64();
+  }
+  return static_cast<int>(array->size);
+}
+
+int P4CoreV1model::RegisterSnapshotDelta(const std::string &registerName,
+                                         uint32_t *indices, uint64_t *values,
+                                         size_t capacity) {
+  SnapshotArray *array = GetSnapshotArray(registerName, false);
+  if (!array) {
+    return -1;
+  }
+  if (array->baseline.size() != array->size) {
+    array->baseline.assign(array->size, 0);
+  }
+  size_t changed = 0;
+  for (size_t i = 0; i < array->size && changed < capacity; i++) {
+    if (register_read(0, registerName, i, &m_snapshotCell) !=
+        bm::Register::RegisterErrorCode::SUCCESS) {
+      NS_LOG_WARN("RegisterSnapshotDelta failed for register "
+                  << registerName << " at index " << i);
+      return -1;
+    }
+    uint64_t value = m_snapshotCell.get_uint64();
+    if (value != array->baseline[i]) {
+      array->baseline[i] = value;
+      indices[changed] = i;
+      values[changed] = value;
+      changed++;
+    }
+  }
+  return static_cast<int>(changed);
+}
+
+int P4CoreV1model::CounterSnapshot(const std::string &counterName,
+                                   uint64_t *bytes, uint64_t *packets,
+                                   size_t capacity) {
+  SnapshotArray *array = GetSnapshotArray(counterName, true);
+  if (!array) {
+    return -1;
+  }
+  if (capacity < array->size) {
+    NS_LOG_WARN("CounterSnapshot of " << counterName << " needs "
+                                      << array->size << " cells, buffers have "
+                                      << capacity);
+    return -1;
+  }
+  for (size_t i = 0; i < array->size; i++) {
+    bm::MatchTableAbstract::counter_value_t cellBytes = 0;
+    bm::MatchTableAbstract::counter_value_t cellPackets = 0;
+    auto rc = read_counters(0, counterName, i, &cellBytes, &cellPackets);
+    if (rc != bm::Counter::CounterErrorCode::SUCCESS) {
+      NS_LOG_WARN("CounterSnapshot failed for counter "
+                  << counterName << " at index " << i
+                  << ", reason: " << CounterErrorCodeToStr(rc));
+      return -1;
+    }
+    bytes[i] = cellBytes;
+    packets[i] = cellPackets;
+  }
+  return static_cast<int>(array->size);
+}
+
+int P4CoreV1model::CounterSnapshotDelta(const std::string &counterName,
+                                        uint32_t *indices, uint64_t *bytes,
+                                        uint64_t *packets, size_t capacity) {
+  SnapshotArray *array = GetSnapshotArray(counterName, true);
+  if (!array) {
+    return -1;
+  }
+  if (array->baseline.size() != 2 * array->size) {
+    array->baseline.assign(2 * array->size, 0);
+  }
+  size_t changed = 0;
+  for (size_t i = 0; i < array->size && changed < capacity; i++) {
+    bm::MatchTableAbstract::counter_value_t cellBytes = 0;
+    bm::MatchTableAbstract::counter_value_t cellPackets = 0;
+    auto rc = read_counters(0, counterName, i, &cellBytes, &cellPackets);
+    if (rc != bm::Counter::CounterErrorCode::SUCCESS) {
+      NS_LOG_WARN("CounterSnapshotDelta failed for counter "
+                  << counterName << " at index " << i
+                  << ", reason: " << CounterErrorCodeToStr(rc));
+      return -1;
+    }
+    if (cellBytes != array->baseline[2 * i] ||
+        cellPackets != array->baseline[2 * i + 1]) {
+      array->baseline[2 * i] = cellBytes;
+      array->baseline[2 * i + 1] = cellPackets;
+      indices[changed] = i;
+      bytes[changed] = cellBytes;
+      packets[changed] = cellPackets;
+      changed++;
+    }
+  }
+  return static_cast<int>(changed);
+}
+
+int P4CoreV1model::TableCounterSnapshotDelta(
+    const std::string &tableName, const bm::entry_handle_t *handles,
+    size_t count, bm::entry_handle_t *changed, uint64_t *bytes,
+    uint64_t *packets, size_t capacity, size_t *gone) {
+  auto &baseline = m_tableSnapshots[tableName];
+  size_t copied = 0;
+  *gone = 0;
+  for (size_t i = 0; i < count && copied < capacity; i++) {
+    uint64_t entryBytes = 0;
+    uint64_t entryPackets = 0;
+    if (this->mt_read_counters(0, tableName, handles[i], &entryBytes,
+                               &entryPackets) != bm::MatchErrorCode::SUCCESS) {
+      baseline.erase(handles[i]);
+      (*gone)++;
+      continue;
+    }
+    auto &last = baseline[handles[i]];
+    if (entryBytes != last.first || entryPackets != last.second) {
+      last = {entryBytes, entryPackets};
+      changed[copied] = handles[i];
+      bytes[copied] = entryBytes;
+      packets[copied] = entryPackets;
+      copied++;
+    }
+  }
+  // entries deleted without being asked for again are dropped as well
+  if (baseline.size() > count) {
+    std::unordered_set<bm::entry_handle_t> given(handles, handles + count);
+    for (auto it = baseline.begin(); it != baseline.end();) {
+      if (given.count(it->first)) {
+        ++it;
+      } else {
+        it = baseline.erase(it);
+      }
+    }
+  }
+  return static_cast<int>(copied);
+}
+
 int P4CoreV1model::ParseVsetAdd(const std::string &vsetName,
                                 const bm::ByteContainer &value) {
   bm::ParseVSet::ErrorCode rc = this->parse_vset_add(0, vsetName, value);
@@ -1781,10 +2226,19 @@ int P4CoreV1model::Serialize(std::ostream *out) {
 }
 
 int P4CoreV1model::LoadNewConfig(const std::string &newConfig) {
+  std::string error;
+  if (LoadNewConfig(newConfig, &error) != 0) {
+    NS_LOG_WARN("LoadNewConfig failed with error: " << error);
+    return -1;
+  }
+  return 0;
+}
+
+int P4CoreV1model::LoadNewConfig(const std::string &newConfig,
+                                 std::string *error) {
   bm::RuntimeInterface::ErrorCode rc = this->load_new_config(newConfig);
   if (rc != bm::RuntimeInterface::SUCCESS) {
-    NS_LOG_WARN(
-        "LoadNewConfig failed with error: " << RuntimeErrorCodeToStr(rc));
+    *error = RuntimeErrorCodeToStr(rc);
     return -1;
   }
   return 0;
@@ -26,6 +26,13 @@
 
 #include <bm/bm_sim/counters.h>
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #define SSWITCH_VIRTUAL_QUEUE_NUM_V1MODEL 8
 
 namespace ns3 {
@@ -38,7 +45,8 @@ public:
                 bool enableTracing, uint64_t packet_rate,
                 size_t input_buffer_size_low, size_t input_buffer_size_high,
                 size_t queue_buffer_size,
-                size_t nb_queues_per_port = SSWITCH_VIRTUAL_QUEUE_NUM_V1MODEL);
+                size_t nb_queues_per_port = SSWITCH_VIRTUAL_QUEUE_NUM_V1MODEL,
+                size_t nb_egress_threads = 1);
   ~P4CoreV1model();
 
   /**
@@ -87,6 +95,33 @@ public:
    */
   void reset_target_state_() override;
 
+  /**
+   * @brief Run the pipelines on worker threads, in real time
+   * @details Emulation mode, as in the upstream simple_switch: one ingress
+   * thread and the egress threads given at construction block on the input
+   * buffer and the queue buffer instead of being driven by simulator events.
+   * Timestamps and queue rates follow the wall clock of the real-time
+   * simulator, and packets leaving egress are handed back to the simulator
+   * thread. Must be called before start_and_return_().
+   * @param cpuAffinity CPUs the threads are pinned to, the ingress thread
+   * first, then the egress threads, reused round robin; empty for no pinning
+   * @return 0 on success, -1 if the simulator is not RealtimeSimulatorImpl
+   */
+  int EnableEmulation(const std::vector<int> &cpuAffinity);
+
+  /**
+   * @brief Stop the worker threads of the emulation mode and wait for them
+   * @details Does nothing when the threads are not running. The packets still
+   * queued, or handed over to the simulator thread, are dropped.
+   */
+  void StopEmulation();
+
+  /**
+   * @brief Check whether the switch runs in emulation mode
+   * @return true if the pipelines run on worker threads
+   */
+  bool IsEmulation() const;
+
   /**
    * @brief Handle the ingress pipeline
    */
@@ -128,6 +163,18 @@ public:
    */
   void SetEgressTimerEvent();
 
+  /**
+   * @brief Short-delay egress retry, scheduled by the egress timer event when
+   * the queue had nothing eligible to send
+   */
+  void RetryEgressPipeline();
+
+  /**
+   * @brief Fill a memory report, adding the input and egress queue usage
+   * @param report the report to fill
+   */
+  void GetMemoryReport(P4SwitchMemoryReport *report) const override;
+
   /**
    * @brief Multicast a packet to a multicast group ID
    * @param packet The packet to be multicast
@@ -167,6 +214,13 @@ public:
    */
   int SetAllEgressQueueDepths(size_t depthPkts);
 
+  /**
+   * @brief Get the occupancy of the queues of an egress port
+   * @param port The egress port
+   * @return size_t The packets queued in all priority queues of the port
+   */
+  size_t GetEgressQueueOccupancy(size_t port);
+
   /**
    * @brief Set the rate of a priority queue
    * @param port The egress port
@@ -252,6 +306,10 @@ public:
   /**
    * @brief Sets a time-to-live (TTL) in milliseconds for a specific match table
    * entry
+   *
+   * With simulated ageing the timeout runs in simulator time, and an idle
+   * entry is reported between one and two timeouts after its last hit, see
+   * P4SwitchCore::SetEntryIdleTimeout.
    * @param tableName Name of the match table
    * @param handle Entry handle identifying the rule
    * @param ttlMs Timeout duration in milliseconds
@@ -414,6 +472,8 @@ public:
 
   /**
    * @brief Sets a timeout (TTL) in milliseconds for an indirect table entry.
+   *
+   * With simulated ageing it behaves as SetEntryTtl.
    * @param tableName Name of the table.
    * @param handle Handle of the entry.
    * @param ttlMs Timeout value in milliseconds.
@@ -522,6 +582,14 @@ public:
   int GetEntry(const std::string &tableName, bm::entry_handle_t handle,
                bm::MatchTable::Entry *entry);
 
+  /**
+   * @brief Checks whether a handle still refers to an entry of a table.
+   * @param tableName Name of the match table.
+   * @param handle    The entry handle.
+   * @return true if the entry exists, false if it was deleted or aged out.
+   */
+  bool HasEntry(const std::string &tableName, bm::entry_handle_t handle);
+
   /**
    * @brief Retrieves an entry from an indirect match table.
    * @param tableName  Name of the indirect match table to query.
@@ -587,6 +655,18 @@ public:
   int GetEntryFromKey(const std::string &tableName,
                       const std::vector<bm::MatchKeyParam> &matchKey,
                       bm::MatchTable::Entry *entry, int priority = 1);
+  /**
+   * @brief Look up a direct table entry by its match key, without logging a
+   * missing key.
+   * @param tableName Name of the match-action table.
+   * @param matchKey Match key parameters to locate the entry.
+   * @param entry Receives the entry if it exists.
+   * @param priority Priority of the match (default is 1).
+   * @return 1 if the entry exists, 0 if it does not, -1 on error.
+   */
+  int FindEntryFromKey(const std::string &tableName,
+                       const std::vector<bm::MatchKeyParam> &matchKey,
+                       bm::MatchTable::Entry *entry, int priority = 1);
   /**
    * @brief Retrieve an entry from an indirect match-action table using a
    * specific match key.
@@ -795,6 +875,95 @@ public:
    */
   int RegisterReset(const std::string &registerName);
 
+  // ======= Bulk Snapshots  =======
+  /**
+   * @brief Copies a whole register array into a flat buffer.
+   *
+   * Cells wider than 64 bits are truncated to their low 64 bits. Unlike
+   * RegisterReadAll, no memory is allocated per call.
+   * @param registerName Name of the register array.
+   * @param[out] values Buffer receiving cell i at values[i].
+   * @param capacity Number of cells the buffer holds.
+   * @return The number of cells copied, -1 if the register is unknown or the
+   * buffer is too small.
+   */
+  int RegisterSnapshot(const std::string &registerName, uint64_t *values,
+                       size_t capacity);
+
+  /**
+   * @brief Copies the register cells changed since the last delta snapshot.
+   *
+   * The first delta snapshot of an array compares against zero. If more cells
+   * changed than the buffers hold, the next call reports the rest.
+   * @param registerName Name of the register array.
+   * @param[out] indices Buffer receiving the indices of the changed cells.
+   * @param[out] values Buffer receiving their values.
+   * @param capacity Number of cells each buffer holds.
+   * @return The number of changed cells copied, -1 if the register is unknown.
+   */
+  int RegisterSnapshotDelta(const std::string &registerName,
+                            uint32_t *indices, uint64_t *values,
+                            size_t capacity);
+
+  /**
+   * @brief Copies a whole indirect counter array into flat buffers.
+   * @param counterName Name of the counter array.
+   * @param[out] bytes Buffer receiving the byte count of cell i at bytes[i].
+   * @param[out] packets Buffer receiving the packet count of cell i.
+   * @param capacity Number of cells each buffer holds.
+   * @return The number of cells copied, -1 if the counter is unknown or the
+   * buffers are too small.
+   */
+  int CounterSnapshot(const std::string &counterName, uint64_t *bytes,
+                      uint64_t *packets, size_t capacity);
+
+  /**
+   * @brief Copies the counter cells changed since the last delta snapshot.
+   *
+   * Same rules as RegisterSnapshotDelta, a cell changed if either count did.
+   * @param counterName Name of the counter array.
+   * @param[out] indices Buffer receiving the indices of the changed cells.
+   * @param[out] bytes Buffer receiving their byte counts.
+   * @param[out] packets Buffer receiving their packet counts.
+   * @param capacity Number of cells each buffer holds.
+   * @return The number of changed cells copied, -1 if the counter is unknown.
+   */
+  int CounterSnapshotDelta(const std::string &counterName, uint32_t *indices,
+                           uint64_t *bytes, uint64_t *packets,
+                           size_t capacity);
+
+  /**
+   * @brief Copies the direct counters of table entries changed since the last
+   * delta snapshot of the table.
+   *
+   * Same rules as CounterSnapshotDelta, with entry handles in place of cell
+   * indices. Only the given entries are read, each by its handle; an entry the
+   * table no longer holds is skipped, counted in gone and forgotten.
+   * @param tableName Name of the table, with direct counters.
+   * @param handles The entries to read.
+   * @param count Number of entries in handles.
+   * @param[out] changed Buffer receiving the handles of the changed entries.
+   * @param[out] bytes Buffer receiving their byte counts.
+   * @param[out] packets Buffer receiving their packet counts.
+   * @param capacity Number of entries each buffer holds.
+   * @param[out] gone Receives the number of given entries no longer in the
+   * table.
+   * @return The number of changed entries copied.
+   */
+  int TableCounterSnapshotDelta(const std::string &tableName,
+                                const bm::entry_handle_t *handles,
+                                size_t count, bm::entry_handle_t *changed,
+                                uint64_t *bytes, uint64_t *packets,
+                                size_t capacity, size_t *gone);
+
+  /**
+   * @brief Gets the number of cells of a register or indirect counter array.
+   * @param name Name of the array.
+   * @param isCounter True for a counter array, false for a register array.
+   * @return The number of cells, -1 if the array is unknown.
+   */
+  int GetSnapshotSize(const std::string &name, bool isCounter);
+
   // ======= Parse Value Set Functions  =======
 
   /**
@@ -852,6 +1021,17 @@ public:
    */
   int LoadNewConfig(const std::string &newConfig);
 
+  /**
+   * @brief Loads a new runtime configuration from a JSON string, without
+   * logging.
+   *
+   * Safe to call off the simulation thread, the caller reports the error.
+   * @param newConfig JSON string containing the new configuration.
+   * @param[out] error Set to the reason of a failure.
+   * @return 0 on success, -1 on failure.
+   */
+  int LoadNewConfig(const std::string &newConfig, std::string *error);
+
   /**
    * @brief Swaps the currently active configuration with a newly loaded one.
    * @return 0 on success, -1 on failure.
@@ -875,7 +1055,8 @@ public:
 protected:
   /**
    * @brief The egress thread mapper for dequeue process of queue buffer
-   * bmv2 using 4u default, in ns-3 only single thread for processing
+   * bmv2 using 4u default, in ns-3 only single thread for processing unless
+   * the switch runs in emulation mode
    */
   struct EgressThreadMapper {
     explicit EgressThreadMapper(size_t nb_threads) : nb_threads(nb_threads) {}
@@ -888,18 +1069,86 @@ protected:
   };
 
 private:
+  /**
+   * @brief Run the ingress pipeline on a packet taken from the input buffer
+   * @param bm_packet the packet
+   */
+  void ProcessIngress(std::unique_ptr<bm::Packet> &&bm_packet);
+
+  /**
+   * @brief Run the egress pipeline on a packet taken from the queue buffer
+   * @param port the egress port of the packet
+   * @param priority the priority queue the packet was taken from
+   * @param bm_packet the packet
+   * @return bool always true, the packet was consumed
+   */
+  bool ProcessEgress(size_t port, size_t priority,
+                     std::unique_ptr<bm::Packet> &&bm_packet);
+
+  /**
+   * @brief Body of the ingress thread in emulation mode
+   */
+  void IngressThread();
+
+  /**
+   * @brief Body of an egress thread in emulation mode
+   * @param workerId the egress worker served by the thread
+   */
+  void EgressThread(size_t workerId);
+
+  /**
+   * @brief Pin the calling worker thread to its CPU, if configured
+   * @param threadIndex 0 for the ingress thread, 1 + worker id for egress
+   */
+  void PinWorkerThread(size_t threadIndex);
+
+  /**
+   * @brief Send a packet that left egress on a worker thread, runs in the
+   * simulator thread
+   * @param bm_packet the deparsed packet
+   * @param port the egress port
+   * @param protocol the ns-3 protocol number carried with the packet
+   * @param destination the ns-3 destination address, resolved on the worker
+   */
+  void EmitPacket(std::shared_ptr<bm::Packet> bm_packet, uint32_t port,
+                  uint16_t protocol, Address destination);
+
+  /**
+   * @brief Register or counter array read by the bulk snapshots
+   */
+  struct SnapshotArray {
+    size_t size{0};                //!< Number of cells
+    std::vector<uint64_t> baseline; //!< Values at the last delta snapshot,
+                                    //!< bytes then packets for counters
+  };
+
+  /**
+   * @brief Looks up an array for the bulk snapshots
+   * @param name Name of the array.
+   * @param isCounter True for a counter array, false for a register array.
+   * @return The array, nullptr if unknown.
+   */
+  SnapshotArray *GetSnapshotArray(const std::string &name, bool isCounter);
+
+  /**
+   * @brief Get the id of the node owning this switch (for event profiling)
+   * @return the node id cached at start, 0 if the device has no node
+   */
+  uint32_t GetNodeId() const;
+
   uint64_t m_packetId;
   uint64_t m_switchRate;
 
-  // enable tracing
-  uint64_t m_inputBps;  // bps
-  uint64_t m_inputBp;   // bp
-  uint64_t m_inputPps;  // pps
-  uint64_t m_inputPp;   // pp
-  uint64_t m_egressBps; // bps
-  uint64_t m_egressBp;  // bp
-  uint64_t m_egressPps; // pps
-  uint64_t m_egressPp;  // pp
+  // enable tracing, the interval counters are updated by the worker threads
+  // in emulation and taken by CalculatePacketsPerSecond
+  std::atomic<uint64_t> m_inputBps;  // bps
+  uint64_t m_inputBp;                // bp
+  std::atomic<uint64_t> m_inputPps;  // pps
+  uint64_t m_inputPp;                // pp
+  std::atomic<uint64_t> m_egressBps; // bps
+  uint64_t m_egressBp;               // bp
+  std::atomic<uint64_t> m_egressPps; // pps
+  uint64_t m_egressPp;               // pp
 
   Time m_timeInterval;       // s
   double m_virtualQueueRate; // pps
@@ -908,8 +1157,15 @@ private:
   EventId m_egressTimeEvent; //!< The timer event ID for dequeue
   Time m_egressTimeRef;      //!< Desired time between timer event triggers
   uint64_t m_startTimestamp; //!< Start time of the switch
+  uint32_t m_nodeId{0};      //!< Id of the owning node, set at start
 
-  static constexpr size_t m_nbEgressThreads = 1u; // 4u default in bmv2
+  size_t m_nbEgressThreads; // 1 in simulation, 4 default in bmv2
+
+  bool m_emulation{false};             //!< Pipelines run on worker threads
+  std::atomic<bool> m_stopping{false}; //!< Workers drop their packets
+  std::shared_ptr<bool> m_emitToken;   //!< Expires when the workers stop
+  std::vector<int> m_cpuAffinity;      //!< CPUs of the worker threads
+  std::vector<std::thread> m_workers;  //!< Ingress and egress threads
 
   std::unique_ptr<InputBuffer> input_buffer;
   NSQueueingLogicPriRL<std::unique_ptr<bm::Packet>, EgressThreadMapper>
@@ -917,6 +1173,15 @@ private:
   bm::Queue<std::unique_ptr<bm::Packet>> output_buffer;
 
   bool m_firstPacket;
+
+  bool m_snapshotArraysLoaded{false}; //!< Array sizes read from the program
+  std::map<std::string, SnapshotArray> m_registerSnapshots; //!< By name
+  std::map<std::string, SnapshotArray> m_counterSnapshots;  //!< By name
+  bm::Data m_snapshotCell; //!< Register cell reused across snapshots
+  std::map<std::string,
+           std::unordered_map<bm::entry_handle_t,
+                              std::pair<uint64_t, uint64_t>>>
+      m_tableSnapshots; //!< Direct counters at the last delta snapshot, by table
 };
 
 } // namespace ns3
@@ -60,6 +60,7 @@ bool
 P4PnaNic::main_processing_pipeline()
 {
     NS_LOG_FUNCTION(this);
+    ClockLatch latch(this);
 
     std::unique_ptr<bm::Packet> bm_packet;
     input_buffer.pop_back(&bm_packet);
@@ -94,9 +95,11 @@ P4PnaNic::main_processing_pipeline()
     int port = bm_packet->get_egress_port();
     uint16_t protocol = RegisterAccess::get_ns_protocol(bm_packet.get());
     int addr_index = RegisterAccess::get_ns_address(bm_packet.get());
+    Address destination =
+        GetDestinationAddress(addr_index, RegisterAccess::get_ns_address_held(bm_packet.get()));
 
     Ptr<Packet> ns_packet = this->ConvertToNs3Packet(std::move(bm_packet));
-    m_switchNetDevice->SendNs3Packet(ns_packet, port, protocol, m_destinationList[addr_index]);
+    m_switchNetDevice->SendNs3Packet(ns_packet, port, protocol, destination);
     return true;
 }
 
@@ -119,6 +122,11 @@ P4PnaNic::ReceivePacket(Ptr<Packet> packetIn,
     RegisterAccess::clear_all(bm_packet.get());
     RegisterAccess::set_ns_protocol(bm_packet.get(), protocol);
     int addr_index = GetAddressIndex(destination);
+    if (addr_index < 0)
+    {
+        NS_LOG_WARN("No address index left, dropping packet");
+        return -1;
+    }
     RegisterAccess::set_ns_address(bm_packet.get(), addr_index);
 
     phv->get_field("pna_main_parser_input_metadata.recirculated").set(0);
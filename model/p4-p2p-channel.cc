@@ -1,4 +1,6 @@
 #include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/p4-event-profiler.h"
 #include "ns3/p4-p2p-channel.h"
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
@@ -68,7 +70,10 @@ P4P2PChannel::Attach(Ptr<CustomP2PNetDevice> device)
 }
 
 bool
-P4P2PChannel::TransmitStart(Ptr<const Packet> p, Ptr<CustomP2PNetDevice> src, Time txTime)
+P4P2PChannel::TransmitStart(Ptr<const Packet> p,
+                            Ptr<CustomP2PNetDevice> src,
+                            Time txTime,
+                            Time queueDelay)
 {
     NS_LOG_FUNCTION(this << p << src);
     NS_LOG_LOGIC("UID is " << p->GetUid() << ")");
@@ -77,18 +82,106 @@ P4P2PChannel::TransmitStart(Ptr<const Packet> p, Ptr<CustomP2PNetDevice> src, Ti
     NS_ASSERT(m_link[1].m_state != INITIALIZING);
 
     uint32_t wire = src == m_link[0].m_src ? 0 : 1;
+    Link& link = m_link[wire];
 
-    Simulator::ScheduleWithContext(m_link[wire].m_dst->GetNode()->GetId(),
-                                   txTime + m_delay,
-                                   &CustomP2PNetDevice::Receive,
-                                   m_link[wire].m_dst,
-                                   p->Copy());
+    // No copy here: DeliverNext copies only if the packet is still shared
+    Time now = Simulator::Now();
+    Time arrival =
+        AddInFlight(wire, now + queueDelay + txTime + m_delay, ConstCast<Packet>(p));
+    ScheduleDelivery(wire);
 
     // Call the tx anim callback on the net device
-    m_txrxPointToPoint(p, src, m_link[wire].m_dst, txTime, txTime + m_delay);
+    if (!m_txrxPointToPoint.IsEmpty())
+    {
+        m_txrxPointToPoint(p, src, link.m_dst, txTime, arrival - now);
+    }
     return true;
 }
 
+bool
+P4P2PChannel::TransmitTrain(const std::vector<TrainPacket>& train, Ptr<CustomP2PNetDevice> src)
+{
+    NS_LOG_FUNCTION(this << train.size() << src);
+
+    NS_ASSERT(m_link[0].m_state != INITIALIZING);
+    NS_ASSERT(m_link[1].m_state != INITIALIZING);
+
+    uint32_t wire = src == m_link[0].m_src ? 0 : 1;
+    Link& link = m_link[wire];
+    Time now = Simulator::Now();
+
+    for (const TrainPacket& entry : train)
+    {
+        NS_LOG_LOGIC("UID is " << entry.packet->GetUid() << ")");
+        Time lastBit = entry.start + entry.queueDelay + entry.txTime + m_delay;
+        Time arrival = AddInFlight(wire, now + lastBit, entry.packet);
+        if (!m_txrxPointToPoint.IsEmpty())
+        {
+            m_txrxPointToPoint(entry.packet, src, link.m_dst, entry.txTime, arrival - now);
+        }
+    }
+    ScheduleDelivery(wire);
+    return true;
+}
+
+Time
+P4P2PChannel::AddInFlight(uint32_t wire, Time arrival, Ptr<Packet> p)
+{
+    std::deque<std::pair<Time, Ptr<Packet>>>& inFlight = m_link[wire].m_inFlight;
+    if (!inFlight.empty() && arrival < inFlight.back().first)
+    {
+        arrival = inFlight.back().first;
+    }
+    inFlight.emplace_back(arrival, p);
+    return arrival;
+}
+
+void
+P4P2PChannel::ScheduleDelivery(uint32_t wire)
+{
+    Link& link = m_link[wire];
+    if (link.m_deliveryPending || link.m_inFlight.empty())
+    {
+        return;
+    }
+
+    link.m_deliveryPending = true;
+    uint32_t dstNode = link.m_dst->GetNode()->GetId();
+    Simulator::ScheduleWithContext(dstNode,
+                                   link.m_inFlight.front().first - Simulator::Now(),
+                                   &P4P2PChannel::DeliverNext,
+                                   this,
+                                   wire);
+    if (P4EventProfiler::IsEnabled())
+    {
+        P4EventProfiler::RecordScheduled(P4EventProfiler::CHANNEL_DELIVERY, dstNode);
+    }
+}
+
+void
+P4P2PChannel::DeliverNext(uint32_t wire)
+{
+    NS_LOG_FUNCTION(this << wire);
+    Link& link = m_link[wire];
+    link.m_deliveryPending = false;
+
+    NS_ASSERT(!link.m_inFlight.empty() && link.m_inFlight.front().first == Simulator::Now());
+    Ptr<Packet> p = link.m_inFlight.front().second;
+    link.m_inFlight.pop_front();
+    link.m_src->DequeueStartedTrainPackets();
+
+    // The receiver strips and adds headers in place. If the sender or a trace
+    // sink still holds the packet, give the receiver its own copy as before.
+    if (p->GetReferenceCount() > 1)
+    {
+        p = p->Copy();
+    }
+
+    // Keep exactly one delivery event pending while packets are in flight
+    ScheduleDelivery(wire);
+    link.m_dst->Receive(p);
+}
+
 std::size_t
 P4P2PChannel::GetNDevices(void) const
 {
@@ -8,7 +8,9 @@
 #include "ns3/ptr.h"
 #include "ns3/traced-callback.h"
 
+#include <deque>
 #include <list>
+#include <vector>
 
 namespace ns3
 {
@@ -45,9 +47,39 @@ class P4P2PChannel : public Channel
      * \param p Packet to transmit
      * \param src Source CustomP2PNetDevice
      * \param txTime Transmit time to apply
+     * \param queueDelay Extra delay before the packet reaches the wire, e.g.
+     * the modeled queueing behind background traffic of the sender
      * \returns true if successful (currently always true)
      */
-    virtual bool TransmitStart(Ptr<const Packet> p, Ptr<CustomP2PNetDevice> src, Time txTime);
+    virtual bool TransmitStart(Ptr<const Packet> p,
+                               Ptr<CustomP2PNetDevice> src,
+                               Time txTime,
+                               Time queueDelay = Time(0));
+
+    /**
+     * \brief One packet of a train of back-to-back packets
+     */
+    struct TrainPacket
+    {
+        Ptr<Packet> packet; //!< Packet to transmit
+        Time start;         //!< Start of its transmission, relative to now
+        Time txTime;        //!< Its transmission time
+        Time queueDelay;    //!< Extra delay before it reaches the wire
+    };
+
+    /**
+     * \brief Transmit a train of back-to-back packets over this channel
+     *
+     * Every packet arrives at the peer at the same time as if it had been sent
+     * with TransmitStart at its own start time. The packets are still handed to
+     * the peer one DeliverNext event each, at their own arrival times; a train
+     * only saves the events of the sender.
+     *
+     * \param train the packets, in transmission order
+     * \param src Source CustomP2PNetDevice
+     * \returns true if successful (currently always true)
+     */
+    virtual bool TransmitTrain(const std::vector<TrainPacket>& train, Ptr<CustomP2PNetDevice> src);
 
     /**
      * \brief Get number of devices on this channel
@@ -116,6 +148,37 @@ class P4P2PChannel : public Channel
                                           Time lastBitTime);
 
   private:
+    /**
+     * \brief Schedule the delivery of the next in-flight packet of a wire,
+     * unless one is already scheduled
+     * \param wire the wire index
+     */
+    void ScheduleDelivery(uint32_t wire);
+
+    /**
+     * \brief Queue a packet for delivery on a wire
+     *
+     * The link does not reorder: a packet never arrives before the packets
+     * sent ahead of it, even if their queueing delay was larger.
+     *
+     * \param wire the wire index
+     * \param arrival the arrival time of the last bit
+     * \param p the packet
+     * \returns the arrival time actually used
+     */
+    Time AddInFlight(uint32_t wire, Time arrival, Ptr<Packet> p);
+
+    /**
+     * \brief Hand the next in-flight packet of a wire to its destination
+     *
+     * The packet is handed over without a copy when the channel holds the only
+     * reference to it. Started train packets are taken off the sender's queue
+     * first, so that the queue does not hold a reference either.
+     *
+     * \param wire the wire index
+     */
+    void DeliverNext(uint32_t wire);
+
     /** Each point to point link has exactly two net devices. */
     static const std::size_t N_DEVICES = 2;
 
@@ -168,13 +231,17 @@ class P4P2PChannel : public Channel
         Link()
             : m_state(INITIALIZING),
               m_src(0),
-              m_dst(0)
+              m_dst(0),
+              m_deliveryPending(false)
         {
         }
 
         WireState m_state;             //!< State of the link
         Ptr<CustomP2PNetDevice> m_src; //!< First NetDevice
         Ptr<CustomP2PNetDevice> m_dst; //!< Second NetDevice
+
+        std::deque<std::pair<Time, Ptr<Packet>>> m_inFlight; //!< Packets by arrival time
+        bool m_deliveryPending; //!< A DeliverNext event is scheduled
     };
 
     Link m_link[N_DEVICES]; //!< Link model
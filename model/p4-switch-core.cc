@@ -33,14 +33,23 @@
 #undef LOG_ERROR
 #undef LOG_DEBUG
 
+#include "ns3/abort.h"
+#include "ns3/format-utils.h"
 #include "ns3/log.h"
+#include "ns3/node.h"
 #include "ns3/p4-switch-core.h"
+#include "ns3/p4-state-stream.h"
 #include "ns3/p4-switch-net-device.h"
+#include "ns3/register-access-v1model.h"
 #include "ns3/simulator.h"
 
 #include <bm/bm_runtime/bm_runtime.h>
 #include <bm/bm_sim/options_parse.h>
+#include <algorithm>
+#include <boost/dynamic_bitset.hpp>
 #include <fstream>
+#include <map>
+#include <sstream>
 
 NS_LOG_COMPONENT_DEFINE("P4SwitchCore");
 
@@ -49,6 +58,14 @@ namespace ns3
 
 static constexpr uint16_t MAX_MIRROR_SESSION_ID = (1u << 15) - 1;
 
+/// Thrift port of the next switch initialized in this process
+static int g_nextThriftPort = 9090;
+
+/// Switch whose pipeline pass runs on this thread, see P4SwitchCore::ClockLatch
+static thread_local P4SwitchCore* t_latchedCore = nullptr;
+/// Time latched for t_latchedCore
+static thread_local Time t_latchedClock;
+
 class P4SwitchCore::MirroringSessions
 {
   public:
@@ -105,6 +122,21 @@ class P4SwitchCore::MirroringSessions
         return true;
     }
 
+    std::vector<std::pair<int, MirroringSessionConfig>> get_sessions() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::pair<int, MirroringSessionConfig>> sessions(sessions_map.begin(),
+                                                                      sessions_map.end());
+        return sessions;
+    }
+
+    size_t footprint_bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return sizeof(*this) + sessions_map.bucket_count() * sizeof(void*) +
+               sessions_map.size() * (sizeof(int) + sizeof(MirroringSessionConfig) + 2 * sizeof(void*));
+    }
+
   private:
     mutable std::mutex mutex;
     std::unordered_map<int, MirroringSessionConfig> sessions_map;
@@ -120,6 +152,7 @@ P4SwitchCore::P4SwitchCore(P4SwitchNetDevice* netDevice,
       m_enableTracing(enableTracing),
       m_dropPort(dropPort),
       m_pre(new bm::McSimplePreLAG()),
+      m_addressTable(ADDRESS_TABLE_CAPACITY),
       m_startTimestamp(Simulator::Now().GetNanoSeconds()),
       m_mirroringSessions(new MirroringSessions())
 {
@@ -139,7 +172,7 @@ P4SwitchCore::InitializeSwitchFromP4Json(const std::string& jsonPath)
     NS_LOG_INFO("Applying p4 json to switch.");
     int status = 0;
 
-    static int p4_switch_ctrl_plane_thrift_port = 9090;
+    int p4_switch_ctrl_plane_thrift_port = g_nextThriftPort++;
     m_thriftPort = p4_switch_ctrl_plane_thrift_port;
 
     std::cout << "P4 switch " << m_p4SwitchId
@@ -154,11 +187,15 @@ P4SwitchCore::InitializeSwitchFromP4Json(const std::string& jsonPath)
                                     "-notifications.ipc";
     opt_parser.file_logger =
         "/tmp/bmv2-" + std::to_string(p4_switch_ctrl_plane_thrift_port) + "-pipeline.log";
-    opt_parser.thrift_port = p4_switch_ctrl_plane_thrift_port++;
+    opt_parser.thrift_port = p4_switch_ctrl_plane_thrift_port;
     opt_parser.console_logging = false;
 
     // Initialize the switch
+    // an estimate only, see GetResidentBytes
+    uint64_t rssBefore = GetResidentBytes();
     status = init_from_options_parser(opt_parser);
+    uint64_t rssAfter = GetResidentBytes();
+    m_programFootprint += (rssAfter > rssBefore) ? rssAfter - rssBefore : 0;
     if (status != 0)
     {
         NS_LOG_ERROR("Failed to apply p4 json for switch core.");
@@ -168,6 +205,12 @@ P4SwitchCore::InitializeSwitchFromP4Json(const std::string& jsonPath)
     NS_LOG_INFO("P4 json applied successfully.");
 }
 
+void
+P4SwitchCore::SetThriftPortBase(int port)
+{
+    g_nextThriftPort = port;
+}
+
 int
 P4SwitchCore::InitFromCommandLineOptions(int argc, char* argv[])
 {
@@ -189,7 +232,11 @@ int
 P4SwitchCore::LoadFlowTableToSwitch(const std::string& flowTablePath)
 {
     NS_LOG_INFO("Loading flow table from: " << flowTablePath);
-    return ExecuteCliCommands(flowTablePath);
+    uint64_t rssBefore = GetResidentBytes();
+    int status = ExecuteCliCommands(flowTablePath);
+    uint64_t rssAfter = GetResidentBytes();
+    m_programFootprint += (rssAfter > rssBefore) ? rssAfter - rssBefore : 0;
+    return status;
 }
 
 int
@@ -238,7 +285,154 @@ P4SwitchCore::ExecuteCliCommands(const std::string& commandsFile)
 uint64_t
 P4SwitchCore::GetTimeStamp()
 {
-    return Simulator::Now().GetNanoSeconds() - m_startTimestamp;
+    return GetClock().GetNanoSeconds() - m_startTimestamp;
+}
+
+void
+P4SwitchCore::SetRealtimeClock(Ptr<RealtimeSimulatorImpl> realtime)
+{
+    m_realtimeClock = realtime;
+}
+
+Time
+P4SwitchCore::GetClock() const
+{
+    return t_latchedCore == this ? t_latchedClock : ReadClock();
+}
+
+Time
+P4SwitchCore::ReadClock() const
+{
+    return m_realtimeClock ? m_realtimeClock->RealtimeNow() : Simulator::Now();
+}
+
+P4SwitchCore::ClockLatch::ClockLatch(P4SwitchCore* core)
+    : m_prevCore(t_latchedCore),
+      m_prevClock(t_latchedClock)
+{
+    if (t_latchedCore != core)
+    {
+        t_latchedClock = core->ReadClock();
+        t_latchedCore = core;
+    }
+}
+
+P4SwitchCore::ClockLatch::~ClockLatch()
+{
+    t_latchedCore = m_prevCore;
+    t_latchedClock = m_prevClock;
+}
+
+P4SwitchCore*
+P4SwitchCore::GetLatchedCore()
+{
+    return t_latchedCore;
+}
+
+void
+P4SwitchCore::LoadMeterTypes()
+{
+    m_meterBytes.clear();
+    m_meterTypesLoaded = true;
+
+    P4JsonValue root;
+    if (!P4JsonValue::Parse(get_config(), &root))
+    {
+        NS_LOG_WARN("Switch " << m_p4SwitchId << ": cannot read the meter arrays");
+        return;
+    }
+    const P4JsonValue* arrays = root.Get("meter_arrays");
+    if (!arrays)
+    {
+        return;
+    }
+    for (const P4JsonValue& array : arrays->GetElements())
+    {
+        const P4JsonValue* name = array.Get("name");
+        const P4JsonValue* type = array.Get("type");
+        if (name)
+        {
+            m_meterBytes[name->GetString()] = type && type->GetString() == "bytes";
+        }
+    }
+}
+
+uint32_t
+P4SwitchCore::ExecuteMeter(bm::MeterArray& meterArray, size_t index, const bm::Packet& packet)
+{
+    uint64_t now = GetClock().GetNanoSeconds();
+
+    std::lock_guard<std::mutex> lock(m_meterMutex);
+    if (!m_meterTypesLoaded)
+    {
+        LoadMeterTypes();
+    }
+    MeterCells& meters = m_meters[&meterArray];
+    if (meters.cells.size() != meterArray.size())
+    {
+        meters.cells.resize(meterArray.size());
+        meters.synced.resize(meterArray.size(), 0);
+    }
+    if (index >= meters.cells.size())
+    {
+        NS_LOG_WARN("Switch " << m_p4SwitchId << ": meter " << meterArray.get_name() << "["
+                              << index << "] out of range");
+        return 0;
+    }
+
+    // the rates stay in bm, where the runtime CLI and the controller set them;
+    // they are read again only after they changed there
+    if (meters.synced[index] != m_meterRatesVersion)
+    {
+        std::vector<P4RateMeter::Rate> rates;
+        for (const auto& rate : meterArray.get_meter(index).get_rates())
+        {
+            rates.push_back({rate.info_rate, rate.burst_size});
+        }
+        meters.cells[index].SetRates(rates);
+        meters.synced[index] = m_meterRatesVersion;
+    }
+
+    auto bytes = m_meterBytes.find(meterArray.get_name());
+    uint64_t input =
+        (bytes != m_meterBytes.end() && bytes->second) ? packet.get_ingress_length() : 1;
+    return meters.cells[index].Execute(now, input);
+}
+
+void
+P4SwitchCore::InvalidateMeterRates()
+{
+    std::lock_guard<std::mutex> lock(m_meterMutex);
+    m_meterRatesVersion++;
+}
+
+bm::Meter::MeterErrorCode
+P4SwitchCore::meter_array_set_rates(size_t cxt_id,
+                                    const std::string& meter_name,
+                                    const std::vector<bm::Meter::rate_config_t>& configs)
+{
+    bm::Meter::MeterErrorCode rc = bm::Switch::meter_array_set_rates(cxt_id, meter_name, configs);
+    InvalidateMeterRates();
+    return rc;
+}
+
+bm::Meter::MeterErrorCode
+P4SwitchCore::meter_set_rates(size_t cxt_id,
+                              const std::string& meter_name,
+                              size_t idx,
+                              const std::vector<bm::Meter::rate_config_t>& configs)
+{
+    bm::Meter::MeterErrorCode rc = bm::Switch::meter_set_rates(cxt_id, meter_name, idx, configs);
+    InvalidateMeterRates();
+    return rc;
+}
+
+bm::Meter::MeterErrorCode
+P4SwitchCore::meter_reset_rates(size_t cxt_id, const std::string& meter_name, size_t idx)
+{
+    bm::Meter::MeterErrorCode rc = bm::Switch::meter_reset_rates(cxt_id, meter_name, idx);
+    InvalidateMeterRates();
+    return rc;
 }
 
 Ptr<Packet>
@@ -255,32 +449,68 @@ P4SwitchCore::ConvertToNs3Packet(std::unique_ptr<bm::Packet>&& bm_packet)
 std::unique_ptr<bm::Packet>
 P4SwitchCore::ConvertToBmPacket(Ptr<Packet> nsPacket, int inPort)
 {
-    int len = nsPacket->GetSize();
-    uint8_t* pkt_buffer = new uint8_t[len];
-    nsPacket->CopyData(pkt_buffer, len);
-    bm::PacketBuffer buffer(len + 512, (char*)pkt_buffer, len);
+    uint32_t len = nsPacket->GetSize();
+    // Copy the frame once, directly behind the headroom of the bm buffer,
+    // instead of going through a temporary array
+    bm::PacketBuffer buffer(len + BM_PACKET_HEADROOM);
+    nsPacket->CopyData(reinterpret_cast<uint8_t*>(buffer.push(len)), len);
     std::unique_ptr<bm::Packet> bm_packet(
         new_packet_ptr(inPort, m_packetId++, len, std::move(buffer)));
-    delete[] pkt_buffer;
 
     return bm_packet;
 }
 
+void
+P4SwitchCore::GetMemoryReport(P4SwitchMemoryReport* report) const
+{
+    *report = P4SwitchMemoryReport();
+    report->coreBytes = sizeof(*this);
+    report->programBytes = m_programFootprint;
+    report->addressCacheBytes = m_addressTable.GetMemoryBytes();
+    report->mirroringBytes = m_mirroringSessions->footprint_bytes();
+}
+
 int
 P4SwitchCore::GetAddressIndex(const Address& destination)
 {
-    auto it = m_addressMap.find(destination);
-    if (it != m_addressMap.end())
+    std::lock_guard<std::mutex> lock(m_addressMutex);
+    uint32_t index = m_addressTable.Acquire(Mac48Address::ConvertFrom(destination));
+    return index == Mac48AddressTable::FULL ? -1 : static_cast<int>(index);
+}
+
+Address
+P4SwitchCore::GetDestinationAddress(int index, bool release)
+{
+    std::lock_guard<std::mutex> lock(m_addressMutex);
+    Address address = m_addressTable.Get(index);
+    if (release)
     {
-        return it->second;
+        m_addressTable.Release(index);
     }
-    else
+    return address;
+}
+
+void
+P4SwitchCore::ReleaseAddress(bm::Packet* packet)
+{
+    if (!RegisterAccess::get_ns_address_held(packet))
+    {
+        return;
+    }
+    RegisterAccess::clear_ns_address_held(packet);
+    std::lock_guard<std::mutex> lock(m_addressMutex);
+    m_addressTable.Release(RegisterAccess::get_ns_address(packet));
+}
+
+void
+P4SwitchCore::CopyAddress(bm::Packet* copy)
+{
+    if (!RegisterAccess::get_ns_address_held(copy))
     {
-        int new_index = m_destinationList.size();
-        m_destinationList.push_back(destination);
-        m_addressMap[destination] = new_index;
-        return new_index;
+        return;
     }
+    std::lock_guard<std::mutex> lock(m_addressMutex);
+    m_addressTable.AddReference(RegisterAccess::get_ns_address(copy));
 }
 
 int
@@ -300,6 +530,28 @@ void
 P4SwitchCore::swap_notify_()
 {
     NS_LOG_FUNCTION("P4 switch has been notified of a config swap.");
+    {
+        std::lock_guard<std::mutex> lock(m_meterMutex);
+        m_meters.clear();
+        m_meterTypesLoaded = false;
+    }
+    if (m_digestSink)
+    {
+        // samples of the old program are still delivered, with its layout
+        std::vector<std::pair<int, uint64_t>> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_digestMutex);
+            for (const auto& list : m_digestLists)
+            {
+                pending.emplace_back(list.first, list.second.batch);
+            }
+        }
+        for (const auto& batch : pending)
+        {
+            FlushDigests(batch.first, batch.second);
+        }
+        LoadDigestLists();
+    }
 }
 
 void
@@ -307,6 +559,8 @@ P4SwitchCore::reset_target_state_()
 {
     NS_LOG_DEBUG("Resetting simple_switch target-specific state");
     get_component<bm::McSimplePreLAG>()->reset_state();
+    // the meter rates in bm are reset with the rest of the state
+    InvalidateMeterRates();
 }
 
 bool
@@ -327,6 +581,346 @@ P4SwitchCore::GetMirroringSession(int mirror_id, MirroringSessionConfig* config)
     return m_mirroringSessions->get_session(mirror_id, config);
 }
 
+namespace
+{
+
+const uint32_t STATE_MAGIC = 0x53533450; //!< "P4SS", switch state record
+const uint32_t STATE_VERSION = 1;        //!< Version of the switch state record
+
+/**
+ * @brief Counter array declared by the P4 program
+ */
+struct CounterArrayInfo
+{
+    std::string name;  //!< Name of the array
+    uint32_t size;     //!< Number of cells
+    bool isDirect;     //!< Bound to the entries of a table
+    std::string table; //!< Table of a direct counter
+};
+
+/**
+ * @brief List the counter arrays of the loaded program
+ * @param config the bmv2 JSON of the program
+ * @return the counter arrays, empty if the document cannot be read
+ */
+std::vector<CounterArrayInfo>
+GetCounterArrays(const std::string& config)
+{
+    std::vector<CounterArrayInfo> counters;
+    P4JsonValue root;
+    if (!P4JsonValue::Parse(config, &root) || !root.Get("counter_arrays"))
+    {
+        return counters;
+    }
+    for (const P4JsonValue& array : root.Get("counter_arrays")->GetElements())
+    {
+        const P4JsonValue* name = array.Get("name");
+        const P4JsonValue* size = array.Get("size");
+        const P4JsonValue* isDirect = array.Get("is_direct");
+        const P4JsonValue* binding = array.Get("binding");
+        if (!name)
+        {
+            continue;
+        }
+        CounterArrayInfo info;
+        info.name = name->GetString();
+        info.size = size ? size->GetUint() : 0;
+        info.isDirect = isDirect && isDirect->GetBool();
+        info.table = binding ? binding->GetString() : "";
+        counters.push_back(info);
+    }
+    return counters;
+}
+
+/**
+ * @brief Build a bitmap of ports or LAG indices from a JSON array
+ * @param indices the JSON array of indices
+ * @return the bitmap
+ */
+boost::dynamic_bitset<>
+ToBitmap(const P4JsonValue* indices)
+{
+    boost::dynamic_bitset<> bitmap;
+    if (!indices)
+    {
+        return bitmap;
+    }
+    for (const P4JsonValue& index : indices->GetElements())
+    {
+        size_t i = index.GetUint();
+        if (bitmap.size() <= i)
+        {
+            bitmap.resize(i + 1);
+        }
+        bitmap.set(i);
+    }
+    return bitmap;
+}
+
+} // namespace
+
+int
+P4SwitchCore::SaveState(std::string* state)
+{
+    NS_LOG_FUNCTION(this << " Switch ID: " << m_p4SwitchId);
+    P4StateWriter writer;
+    writer.WriteU32(STATE_MAGIC);
+    writer.WriteU32(STATE_VERSION);
+    writer.WriteString(get_config_md5());
+
+    // tables, action profiles, meters and registers, in bmv2's own format
+    std::ostringstream bmState;
+    if (serialize(&bmState) != bm::RuntimeInterface::SUCCESS)
+    {
+        NS_LOG_ERROR("Switch ID: " << m_p4SwitchId << " failed to serialize the bm state");
+        return -1;
+    }
+    writer.WriteString(bmState.str());
+
+    // bmv2 does not serialize counters
+    std::vector<CounterArrayInfo> counters = GetCounterArrays(get_config());
+    std::vector<const CounterArrayInfo*> indirect;
+    std::vector<const CounterArrayInfo*> direct;
+    for (const CounterArrayInfo& info : counters)
+    {
+        (info.isDirect ? direct : indirect).push_back(&info);
+    }
+
+    writer.WriteU32(indirect.size());
+    for (const CounterArrayInfo* info : indirect)
+    {
+        writer.WriteString(info->name);
+        writer.WriteU32(info->size);
+        for (uint32_t i = 0; i < info->size; i++)
+        {
+            bm::MatchTableAbstract::counter_value_t bytes = 0;
+            bm::MatchTableAbstract::counter_value_t packets = 0;
+            read_counters(0, info->name, i, &bytes, &packets);
+            writer.WriteU64(bytes);
+            writer.WriteU64(packets);
+        }
+    }
+
+    writer.WriteU32(direct.size());
+    for (const CounterArrayInfo* info : direct)
+    {
+        std::vector<bm::MatchTable::Entry> entries = mt_get_entries(0, info->table);
+        writer.WriteString(info->table);
+        writer.WriteU32(entries.size());
+        for (const bm::MatchTable::Entry& entry : entries)
+        {
+            bm::MatchTableAbstract::counter_value_t bytes = 0;
+            bm::MatchTableAbstract::counter_value_t packets = 0;
+            mt_read_counters(0, info->table, entry.handle, &bytes, &packets);
+            writer.WriteU64(entry.handle);
+            writer.WriteU64(bytes);
+            writer.WriteU64(packets);
+        }
+    }
+
+    std::vector<std::pair<int, MirroringSessionConfig>> sessions =
+        m_mirroringSessions->get_sessions();
+    writer.WriteU32(sessions.size());
+    for (const auto& session : sessions)
+    {
+        writer.WriteU32(session.first);
+        writer.WriteU32(session.second.egress_port);
+        writer.WriteU8(session.second.egress_port_valid);
+        writer.WriteU32(session.second.mgid);
+        writer.WriteU8(session.second.mgid_valid);
+    }
+
+    auto pre = get_component<bm::McSimplePreLAG>();
+    writer.WriteString(pre ? pre->mc_get_entries() : "");
+
+    *state = writer.GetData();
+    NS_LOG_INFO("Switch ID: " << m_p4SwitchId << " saved " << state->size()
+                              << " bytes of state");
+    return 0;
+}
+
+int
+P4SwitchCore::RestoreState(const std::string& state)
+{
+    NS_LOG_FUNCTION(this << " Switch ID: " << m_p4SwitchId);
+    P4StateReader reader(state);
+    if (reader.ReadU32() != STATE_MAGIC || reader.ReadU32() != STATE_VERSION)
+    {
+        NS_LOG_ERROR("Switch ID: " << m_p4SwitchId << " not a switch state record");
+        return -1;
+    }
+    if (reader.ReadString() != get_config_md5())
+    {
+        NS_LOG_ERROR("Switch ID: " << m_p4SwitchId
+                                   << " state was saved with a different P4 program");
+        return -1;
+    }
+
+    std::istringstream bmState(reader.ReadString());
+    if (!reader.IsOk() || deserialize(&bmState) != 0)
+    {
+        NS_LOG_ERROR("Switch ID: " << m_p4SwitchId << " failed to restore the bm state");
+        return -1;
+    }
+
+    uint32_t nCounters = reader.ReadU32();
+    for (uint32_t c = 0; c < nCounters && reader.IsOk(); c++)
+    {
+        std::string name = reader.ReadString();
+        uint32_t size = reader.ReadU32();
+        for (uint32_t i = 0; i < size && reader.IsOk(); i++)
+        {
+            uint64_t bytes = reader.ReadU64();
+            uint64_t packets = reader.ReadU64();
+            write_counters(0, name, i, bytes, packets);
+        }
+    }
+
+    uint32_t nDirect = reader.ReadU32();
+    for (uint32_t c = 0; c < nDirect && reader.IsOk(); c++)
+    {
+        std::string table = reader.ReadString();
+        uint32_t nEntries = reader.ReadU32();
+        for (uint32_t i = 0; i < nEntries && reader.IsOk(); i++)
+        {
+            // entries keep their handles through serialize and deserialize
+            bm::entry_handle_t handle = reader.ReadU64();
+            uint64_t bytes = reader.ReadU64();
+            uint64_t packets = reader.ReadU64();
+            mt_write_counters(0, table, handle, bytes, packets);
+        }
+    }
+
+    uint32_t nSessions = reader.ReadU32();
+    for (uint32_t i = 0; i < nSessions && reader.IsOk(); i++)
+    {
+        int id = reader.ReadU32();
+        MirroringSessionConfig config;
+        config.egress_port = reader.ReadU32();
+        config.egress_port_valid = reader.ReadU8();
+        config.mgid = reader.ReadU32();
+        config.mgid_valid = reader.ReadU8();
+        AddMirroringSession(id, config);
+    }
+
+    std::string preState = reader.ReadString();
+    if (!reader.IsOk() || !reader.AtEnd())
+    {
+        NS_LOG_ERROR("Switch ID: " << m_p4SwitchId << " truncated switch state record");
+        return -1;
+    }
+    if (!preState.empty() && RestoreMulticastState(preState) != 0)
+    {
+        return -1;
+    }
+
+    NS_LOG_INFO("Switch ID: " << m_p4SwitchId << " restored " << state.size()
+                              << " bytes of state");
+    return 0;
+}
+
+int
+P4SwitchCore::RestoreMulticastState(const std::string& entries)
+{
+    auto pre = get_component<bm::McSimplePreLAG>();
+    P4JsonValue root;
+    if (!pre || !P4JsonValue::Parse(entries, &root))
+    {
+        NS_LOG_ERROR("Switch ID: " << m_p4SwitchId << " cannot restore the multicast groups");
+        return -1;
+    }
+
+    const P4JsonValue* lags = root.Get("lags");
+    if (lags)
+    {
+        for (const P4JsonValue& lag : lags->GetElements())
+        {
+            const P4JsonValue* id = lag.Get("id");
+            if (id)
+            {
+                pre->mc_set_lag_membership(id->GetUint(), ToBitmap(lag.Get("ports")));
+            }
+        }
+    }
+
+    // replication nodes, with the ports and LAGs of their level-2 entry
+    std::map<uint64_t, const P4JsonValue*> l2ByHandle;
+    if (root.Get("l2_handles"))
+    {
+        for (const P4JsonValue& l2 : root.Get("l2_handles")->GetElements())
+        {
+            if (l2.Get("handle"))
+            {
+                l2ByHandle[l2.Get("handle")->GetUint()] = &l2;
+            }
+        }
+    }
+    std::map<uint64_t, bm::McSimplePre::l1_hdl_t> nodeByOldHandle;
+    if (root.Get("l1_handles"))
+    {
+        for (const P4JsonValue& l1 : root.Get("l1_handles")->GetElements())
+        {
+            const P4JsonValue* handle = l1.Get("handle");
+            const P4JsonValue* rid = l1.Get("rid");
+            const P4JsonValue* l2Handle = l1.Get("l2_handle");
+            if (!handle || !rid)
+            {
+                continue;
+            }
+            const P4JsonValue* l2 = nullptr;
+            if (l2Handle && l2ByHandle.count(l2Handle->GetUint()))
+            {
+                l2 = l2ByHandle[l2Handle->GetUint()];
+            }
+            bm::McSimplePre::l1_hdl_t node;
+            if (pre->mc_node_create(rid->GetUint(),
+                                    ToBitmap(l2 ? l2->Get("ports") : nullptr),
+                                    ToBitmap(l2 ? l2->Get("lags") : nullptr),
+                                    &node) != bm::McSimplePre::SUCCESS)
+            {
+                NS_LOG_ERROR("Switch ID: " << m_p4SwitchId << " cannot restore multicast node "
+                                           << handle->GetUint());
+                return -1;
+            }
+            nodeByOldHandle[handle->GetUint()] = node;
+        }
+    }
+
+    if (root.Get("mgrps"))
+    {
+        for (const P4JsonValue& group : root.Get("mgrps")->GetElements())
+        {
+            const P4JsonValue* id = group.Get("id");
+            if (!id)
+            {
+                continue;
+            }
+            bm::McSimplePre::mgrp_hdl_t groupHandle;
+            if (pre->mc_mgrp_create(id->GetUint(), &groupHandle) != bm::McSimplePre::SUCCESS)
+            {
+                NS_LOG_ERROR("Switch ID: " << m_p4SwitchId
+                                           << " cannot restore multicast group "
+                                           << id->GetUint());
+                return -1;
+            }
+            const P4JsonValue* members = group.Get("l1_handles");
+            if (!members)
+            {
+                continue;
+            }
+            for (const P4JsonValue& member : members->GetElements())
+            {
+                auto it = nodeByOldHandle.find(member.GetUint());
+                if (it != nodeByOldHandle.end())
+                {
+                    pre->mc_node_associate(groupHandle, it->second);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
 void
 P4SwitchCore::CheckQueueingMetadata()
 {
@@ -357,4 +951,396 @@ P4SwitchCore::CheckQueueingMetadata()
     }
     m_enableQueueingMetadata = false;
 }
+
+void
+P4SwitchCore::EnableDigestSink(uint32_t maxBatchSize, Time maxDelay)
+{
+    NS_LOG_FUNCTION(this << maxBatchSize << maxDelay);
+    m_digestSink = true;
+    m_digestMaxBatchSize = std::max<uint32_t>(maxBatchSize, 1);
+    m_digestMaxDelay = maxDelay;
+    m_digestContext = m_switchNetDevice->GetNode()->GetId();
+    LoadDigestLists();
+}
+
+void
+P4SwitchCore::LoadDigestLists()
+{
+    std::lock_guard<std::mutex> lock(m_digestMutex);
+    m_digestLists.clear();
+
+    P4JsonValue root;
+    if (!P4JsonValue::Parse(get_config(), &root))
+    {
+        NS_LOG_WARN("Switch " << m_p4SwitchId << ": cannot read the learn lists");
+        return;
+    }
+    const P4JsonValue* lists = root.Get("learn_lists");
+    if (!lists)
+    {
+        return;
+    }
+    for (const P4JsonValue& list : lists->GetElements())
+    {
+        const P4JsonValue* id = list.Get("id");
+        const P4JsonValue* name = list.Get("name");
+        const P4JsonValue* elements = list.Get("elements");
+        if (!id || !elements)
+        {
+            continue;
+        }
+        DigestList& digests = m_digestLists[id->GetUint()];
+        // a max-delay flush pending for the old program must not match
+        digests.batch = ++m_digestLastBatch;
+        digests.name = name ? name->GetString() : "";
+        for (const P4JsonValue& element : elements->GetElements())
+        {
+            const P4JsonValue* type = element.Get("type");
+            const P4JsonValue* value = element.Get("value");
+            if (!type || !value)
+            {
+                continue;
+            }
+            if (type->GetString() == "field" && value->GetElements().size() == 2)
+            {
+                digests.fields.push_back(value->GetElements()[0].GetString() + "." +
+                                         value->GetElements()[1].GetString());
+                digests.constants.emplace_back();
+            }
+            else if (type->GetString() == "hexstr")
+            {
+                std::string hex = value->GetString();
+                if (hex.compare(0, 2, "0x") == 0)
+                {
+                    hex = hex.substr(2);
+                }
+                if (hex.size() % 2)
+                {
+                    hex = "0" + hex;
+                }
+                std::string bytes;
+                for (size_t i = 0; i < hex.size(); i += 2)
+                {
+                    bytes.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+                }
+                digests.fields.emplace_back();
+                digests.constants.push_back(bytes);
+            }
+        }
+        NS_LOG_DEBUG("Switch " << m_p4SwitchId << ": learn list " << id->GetUint() << " "
+                               << digests.name << " with " << digests.fields.size()
+                               << " elements");
+    }
+}
+
+void
+P4SwitchCore::Learn(int listId, const bm::Packet& packet)
+{
+    if (!m_digestSink)
+    {
+        get_learn_engine()->learn(listId, packet);
+        return;
+    }
+
+    const bm::PHV* phv = packet.get_phv();
+    bool full = false;
+    bool first = false;
+    uint64_t batch = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_digestMutex);
+        auto it = m_digestLists.find(listId);
+        if (it == m_digestLists.end())
+        {
+            NS_LOG_WARN("Switch " << m_p4SwitchId << ": unknown learn list " << listId);
+            return;
+        }
+        DigestList& list = it->second;
+        size_t start = list.data.size();
+        for (size_t i = 0; i < list.fields.size(); i++)
+        {
+            if (list.fields[i].empty())
+            {
+                list.data.append(list.constants[i]);
+                continue;
+            }
+            const bm::ByteContainer& bytes = phv->get_field(list.fields[i]).get_bytes();
+            list.data.append(bytes.data(), bytes.size());
+        }
+        list.sampleSize = list.data.size() - start;
+        list.numSamples++;
+        first = list.numSamples == 1;
+        full = list.numSamples >= m_digestMaxBatchSize;
+        batch = list.batch;
+    }
+
+    if (full && !m_realtimeClock)
+    {
+        FlushDigests(listId, batch);
+    }
+    else if (full)
+    {
+        // learning runs on the ingress thread in emulation mode
+        Simulator::ScheduleWithContext(m_digestContext,
+                                       Time(0),
+                                       &P4SwitchCore::FlushDigests,
+                                       this,
+                                       listId,
+                                       batch);
+    }
+    else if (first)
+    {
+        Simulator::ScheduleWithContext(m_digestContext,
+                                       m_digestMaxDelay,
+                                       &P4SwitchCore::FlushDigests,
+                                       this,
+                                       listId,
+                                       batch);
+    }
+}
+
+void
+P4SwitchCore::FlushDigests(int listId, uint64_t batch)
+{
+    P4DigestBatch digests;
+    {
+        std::lock_guard<std::mutex> lock(m_digestMutex);
+        auto it = m_digestLists.find(listId);
+        if (it == m_digestLists.end() || it->second.batch != batch ||
+            it->second.numSamples == 0)
+        {
+            return; // delivered when it filled up
+        }
+        DigestList& list = it->second;
+        digests.switchId = m_p4SwitchId;
+        digests.listId = listId;
+        digests.listName = list.name;
+        digests.sampleSize = list.sampleSize;
+        digests.numSamples = list.numSamples;
+        digests.data.swap(list.data);
+        list.numSamples = 0;
+        list.batch = ++m_digestLastBatch;
+    }
+    NS_LOG_DEBUG("Switch " << m_p4SwitchId << ": " << digests.numSamples << " digests of list "
+                           << digests.listName);
+    m_switchNetDevice->EmitDigest(digests);
+}
+
+void
+P4SwitchCore::EnableSimulatedAgeing(Time tick)
+{
+    NS_LOG_FUNCTION(this << tick);
+    NS_ABORT_MSG_IF(!tick.IsStrictlyPositive(), "Ageing tick must be positive");
+    m_simulatedAgeing = true;
+    m_ageingTick = tick;
+}
+
+bool
+P4SwitchCore::IsSimulatedAgeing() const
+{
+    return m_simulatedAgeing;
+}
+
+uint64_t
+P4SwitchCore::GetAgeingNow() const
+{
+    return Simulator::Now().GetTimeStep() / m_ageingTick.GetTimeStep();
+}
+
+bool
+P4SwitchCore::GetAgeingKey(const std::string& tableName,
+                           bm::entry_handle_t handle,
+                           bool add,
+                           uint64_t* key)
+{
+    auto it = std::find(m_ageingTables.begin(), m_ageingTables.end(), tableName);
+    if (it == m_ageingTables.end())
+    {
+        if (!add)
+        {
+            return false;
+        }
+        it = m_ageingTables.insert(m_ageingTables.end(), tableName);
+    }
+    *key = (static_cast<uint64_t>(it - m_ageingTables.begin()) << 32) | handle;
+    return true;
+}
+
+int
+P4SwitchCore::SetEntryIdleTimeout(const std::string& tableName,
+                                  bm::entry_handle_t handle,
+                                  unsigned int ttlMs,
+                                  bool indirect)
+{
+    NS_LOG_FUNCTION(this << tableName << handle << ttlMs);
+    if (ttlMs == 0)
+    {
+        ClearEntryIdleTimeout(tableName, handle);
+        return 0;
+    }
+
+    uint64_t key = 0;
+    GetAgeingKey(tableName, handle, true, &key);
+    AgeingEntry entry;
+    entry.table = key >> 32;
+    entry.handle = handle;
+    entry.ttlTicks = std::max<uint64_t>(
+        1,
+        (MilliSeconds(ttlMs).GetTimeStep() + m_ageingTick.GetTimeStep() - 1) /
+            m_ageingTick.GetTimeStep());
+    entry.indirect = indirect;
+    uint64_t bytes = 0;
+    bm::MatchErrorCode rc = mt_read_counters(0, tableName, handle, &bytes, &entry.packets);
+    entry.counted = rc == bm::MatchErrorCode::SUCCESS;
+    entry.lastCheck = std::chrono::steady_clock::now();
+    uint64_t sinceHit = 0;
+    if (!entry.counted && !GetTimeSinceHit(entry, &sinceHit))
+    {
+        NS_LOG_WARN("Switch " << m_p4SwitchId << ": no entry " << handle << " in table "
+                              << tableName << " to age");
+        return -1;
+    }
+
+    // the wheel may have been idle, bring it to the present first
+    std::vector<uint64_t> expired;
+    uint64_t now = GetAgeingNow();
+    if (m_ageingWheel.GetSize() == 0)
+    {
+        m_ageingWheel.Advance(now, &expired);
+    }
+    m_ageingEntries[key] = entry;
+    m_ageingWheel.Insert(key, now + entry.ttlTicks);
+    ScheduleAgeing();
+    return 0;
+}
+
+void
+P4SwitchCore::ClearEntryIdleTimeout(const std::string& tableName, bm::entry_handle_t handle)
+{
+    uint64_t key = 0;
+    if (GetAgeingKey(tableName, handle, false, &key) && m_ageingWheel.Remove(key))
+    {
+        m_ageingEntries.erase(key);
+        ScheduleAgeing();
+    }
+}
+
+bool
+P4SwitchCore::GetTimeSinceHit(const AgeingEntry& entry, uint64_t* ms)
+{
+    const std::string& tableName = m_ageingTables[entry.table];
+    if (entry.indirect)
+    {
+        bm::MatchTableIndirect::Entry indirectEntry;
+        if (mt_indirect_get_entry(0, tableName, entry.handle, &indirectEntry) !=
+            bm::MatchErrorCode::SUCCESS)
+        {
+            return false;
+        }
+        *ms = indirectEntry.time_since_hit_ms;
+        return true;
+    }
+    bm::MatchTable::Entry directEntry;
+    if (mt_get_entry(0, tableName, entry.handle, &directEntry) != bm::MatchErrorCode::SUCCESS)
+    {
+        return false;
+    }
+    *ms = directEntry.time_since_hit_ms;
+    return true;
+}
+
+void
+P4SwitchCore::ScheduleAgeing()
+{
+    uint64_t next = 0;
+    if (!m_ageingWheel.GetNextExpiry(&next))
+    {
+        m_ageingEvent.Cancel();
+        return;
+    }
+    Time at = TimeStep(next * m_ageingTick.GetTimeStep());
+    if (m_ageingEvent.IsRunning() && TimeStep(m_ageingEvent.GetTs()) == at)
+    {
+        return;
+    }
+    m_ageingEvent.Cancel();
+    m_ageingEvent = Simulator::Schedule(std::max(at - Simulator::Now(), Time(0)),
+                                        &P4SwitchCore::AgeingTick,
+                                        this);
+}
+
+void
+P4SwitchCore::AgeingTick()
+{
+    uint64_t now = GetAgeingNow();
+    std::vector<uint64_t> expired;
+    m_ageingWheel.Advance(now, &expired);
+    auto wallNow = std::chrono::steady_clock::now();
+
+    // one report per table, in the order the tables were first aged
+    std::map<uint32_t, P4ExpiredEntries> reports;
+    for (uint64_t key : expired)
+    {
+        auto it = m_ageingEntries.find(key);
+        if (it == m_ageingEntries.end())
+        {
+            continue;
+        }
+        AgeingEntry& entry = it->second;
+        const std::string& tableName = m_ageingTables[entry.table];
+        if (entry.counted)
+        {
+            uint64_t bytes = 0;
+            uint64_t packets = 0;
+            bm::MatchErrorCode rc =
+                mt_read_counters(0, tableName, entry.handle, &bytes, &packets);
+            if (rc != bm::MatchErrorCode::SUCCESS)
+            {
+                m_ageingEntries.erase(it); // deleted behind our back
+                continue;
+            }
+            if (packets != entry.packets)
+            {
+                // hit since the last check, not idle yet
+                entry.packets = packets;
+                m_ageingWheel.Insert(key, now + entry.ttlTicks);
+                continue;
+            }
+        }
+        else
+        {
+            // bm keeps the wall-clock time of the last hit: a hit more recent
+            // than the last check means the entry was used since
+            uint64_t sinceHit = 0;
+            if (!GetTimeSinceHit(entry, &sinceHit))
+            {
+                m_ageingEntries.erase(it); // deleted behind our back
+                continue;
+            }
+            uint64_t sinceCheck = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      wallNow - entry.lastCheck)
+                                      .count();
+            entry.lastCheck = wallNow;
+            if (sinceHit < sinceCheck)
+            {
+                m_ageingWheel.Insert(key, now + entry.ttlTicks);
+                continue;
+            }
+        }
+
+        P4ExpiredEntries& report = reports[entry.table];
+        report.switchId = m_p4SwitchId;
+        report.tableName = tableName;
+        report.handles.push_back(entry.handle);
+        m_ageingEntries.erase(it);
+    }
+
+    for (const auto& report : reports)
+    {
+        NS_LOG_DEBUG("Switch " << m_p4SwitchId << ": " << report.second.handles.size()
+                               << " idle entries in table " << report.second.tableName);
+        m_switchNetDevice->EmitEntriesExpired(report.second);
+    }
+    ScheduleAgeing();
+}
+
 } // namespace ns3
\ No newline at end of file
@@ -20,12 +20,21 @@
 #ifndef P4_SWITCH_CORE_H
 #define P4_SWITCH_CORE_H
 
+#include "ns3/event-id.h"
+#include "ns3/mac48-address-table.h"
+#include "ns3/p4-rate-meter.h"
 #include "ns3/p4-switch-net-device.h"
+#include "ns3/p4-timing-wheel.h"
+#include "ns3/realtime-simulator-impl.h"
 
+#include <bm/bm_sim/meters.h>
 #include <bm/bm_sim/packet.h>
 #include <bm/bm_sim/simple_pre_lag.h>
 #include <bm/bm_sim/switch.h>
+#include <chrono>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #define SSWITCH_DROP_PORT 511
@@ -67,6 +76,17 @@ class P4SwitchCore : public bm::Switch
      */
     int LoadFlowTableToSwitch(const std::string& flowTablePath);
 
+    /**
+     * @brief Set the thrift port of the next switch initialized in this process
+     *
+     * Switches take consecutive ports from 9090 by default. Processes running
+     * side by side, such as the workers of a P4SweepRunner, must use disjoint
+     * ranges. The port also names the bmv2 IPC sockets and log files.
+     *
+     * @param port the first thrift port
+     */
+    static void SetThriftPortBase(int port);
+
     /**
      * @brief Initialize the switch from command line options
      * @param argc the number of command line arguments
@@ -98,14 +118,21 @@ class P4SwitchCore : public bm::Switch
     /**
      * @brief Convert a bm packet to ns-3 packet
      *
+     * The ns-3 packet holds the deparsed frame as one flat buffer, without
+     * header objects. Switch-facing ports send it as it is, see
+     * CustomP2PNetDevice::SendFrame.
+     *
      * @param bmPacket the bm packet
-     * @return Ptr<Packet> the ns-3 packetclear
+     * @return Ptr<Packet> the ns-3 packet
      */
     Ptr<Packet> ConvertToNs3Packet(std::unique_ptr<bm::Packet>&& bmPacket);
 
     /**
      * @brief Convert a ns-3 packet to bm packet
      *
+     * The frame bytes are copied once, straight into the bm packet buffer,
+     * behind BM_PACKET_HEADROOM bytes left for headers added by the pipeline.
+     *
      * @param nsPacket the ns-3 packet
      * @param inPort the port where the packet is received
      * @return std::unique_ptr<bm::Packet> the bm packet
@@ -123,6 +150,146 @@ class P4SwitchCore : public bm::Switch
      */
     uint64_t GetTimeStamp();
 
+    /**
+     * @brief Take the time from the wall clock of a real-time simulator
+     *
+     * In emulation mode the pipelines run on worker threads, which must not read
+     * the simulator time. RealtimeSimulatorImpl::RealtimeNow can be called from
+     * any thread and runs on the same time base as the simulator.
+     *
+     * @param realtime the real-time simulator, nullptr to go back to Simulator::Now
+     */
+    void SetRealtimeClock(Ptr<RealtimeSimulatorImpl> realtime);
+
+    /**
+     * @brief Get the current time of the switch
+     *
+     * Inside a pipeline pass this is the time latched by ClockLatch, so every
+     * timestamp and meter of the pass reads the same value and the clock is
+     * read once per event.
+     *
+     * @return the real time when a real-time clock is set, the simulator time
+     * otherwise
+     */
+    Time GetClock() const;
+
+    /**
+     * @brief Latches the switch clock on the current thread for one pipeline pass
+     *
+     * Nested latches of the same switch keep the outer time, the previous latch
+     * comes back on destruction.
+     */
+    class ClockLatch
+    {
+      public:
+        /**
+         * @brief Latch the clock of a switch
+         * @param core the switch
+         */
+        explicit ClockLatch(P4SwitchCore* core);
+        ~ClockLatch();
+
+        ClockLatch(const ClockLatch&) = delete;
+        ClockLatch& operator=(const ClockLatch&) = delete;
+
+      private:
+        P4SwitchCore* m_prevCore; //!< Switch latched before
+        Time m_prevClock;               //!< Time latched before
+    };
+
+    /**
+     * @brief Get the switch whose pipeline runs on the current thread
+     * @return the switch of the innermost ClockLatch, nullptr outside a pass
+     */
+    static P4SwitchCore* GetLatchedCore();
+
+    /**
+     * @brief Execute an indirect meter on the switch clock, the execute_meter extern
+     *
+     * bm::Meter reads the wall clock, which makes colors depend on how fast the
+     * host runs the simulation. Here each meter cell runs a P4RateMeter with the
+     * rates configured in bm, on the simulator time.
+     *
+     * @param meterArray the meter array
+     * @param index the cell
+     * @param packet the packet, its ingress length counts for byte meters
+     * @return the color, 0 for GREEN
+     */
+    uint32_t ExecuteMeter(bm::MeterArray& meterArray, size_t index, const bm::Packet& packet);
+
+    /**
+     * @brief Deliver digests in process instead of through the bm transport
+     *
+     * The samples of each learn list are collected into a batch. The batch goes
+     * to P4SwitchNetDevice::EmitDigest when it holds maxBatchSize samples, or
+     * maxDelay of simulated time after its first sample. This costs at most
+     * one event per batch and no IPC. Call after InitializeSwitchFromP4Json.
+     *
+     * @param maxBatchSize samples per batch, at least 1
+     * @param maxDelay longest time a sample waits for its batch
+     */
+    void EnableDigestSink(uint32_t maxBatchSize, Time maxDelay);
+
+    /**
+     * @brief Age table entries in simulator time instead of in bm
+     *
+     * Entry timeouts then run on a timing wheel driven by simulator events,
+     * scheduled only while some entry has a timeout, instead of on the wall
+     * clock of the bm ageing monitor. Expired entries are reported in batches,
+     * one per table, to P4SwitchNetDevice::EmitEntriesExpired; like in bm they
+     * stay in the table until the controller deletes them.
+     *
+     * @param tick resolution of the timeouts
+     */
+    void EnableSimulatedAgeing(Time tick);
+
+    /**
+     * @brief Check whether entries are aged in simulator time
+     * @return true after EnableSimulatedAgeing
+     */
+    bool IsSimulatedAgeing() const;
+
+    /**
+     * @brief Set the idle timeout of a table entry, in simulator time
+     *
+     * An entry expires once it has not been hit for ttlMs. Hits are only seen
+     * when the timeout runs out, and a hit re-arms the timeout from there, so
+     * an idle entry is reported between one and two timeouts after its last
+     * hit.
+     *
+     * Hits are read from the direct counters of the table if it has them.
+     * Otherwise the time since the last hit kept by bm is compared with the
+     * wall-clock time since the previous check, which needs a table with
+     * support_timeout. Hits in the same wall-clock millisecond as the previous
+     * check are missed.
+     *
+     * @param tableName the table
+     * @param handle the entry
+     * @param ttlMs the timeout in milliseconds, 0 to stop ageing the entry
+     * @param indirect true for an indirect table
+     * @return int 0 on success, -1 if the entry does not exist
+     */
+    int SetEntryIdleTimeout(const std::string& tableName,
+                            bm::entry_handle_t handle,
+                            unsigned int ttlMs,
+                            bool indirect = false);
+
+    /**
+     * @brief Stop ageing a table entry, when it is deleted
+     * @param tableName the table
+     * @param handle the entry
+     */
+    void ClearEntryIdleTimeout(const std::string& tableName, bm::entry_handle_t handle);
+
+    /**
+     * @brief Fill a memory report for this switch core
+     * @details The base class accounts for the core object, the load-time footprint,
+     * the address cache and the mirroring sessions. Architectures with queues add
+     * their queue usage on top.
+     * @param report the report to fill, previous content is overwritten
+     */
+    virtual void GetMemoryReport(P4SwitchMemoryReport* report) const;
+
     // === override ===
     /**
      * @brief [Deprecated] Receive a packet from the network, using ReceivePacket instead.
@@ -147,6 +314,33 @@ class P4SwitchCore : public bm::Switch
      */
     void reset_target_state_() override;
 
+    /**
+     * @brief Set the rates of a meter array, see bm::RuntimeInterface
+     * @details Marks the rates cached by ExecuteMeter as stale.
+     */
+    bm::Meter::MeterErrorCode meter_array_set_rates(
+        size_t cxt_id,
+        const std::string& meter_name,
+        const std::vector<bm::Meter::rate_config_t>& configs) override;
+
+    /**
+     * @brief Set the rates of a meter, see bm::RuntimeInterface
+     * @details Marks the rates cached by ExecuteMeter as stale.
+     */
+    bm::Meter::MeterErrorCode meter_set_rates(
+        size_t cxt_id,
+        const std::string& meter_name,
+        size_t idx,
+        const std::vector<bm::Meter::rate_config_t>& configs) override;
+
+    /**
+     * @brief Reset the rates of a meter, see bm::RuntimeInterface
+     * @details Marks the rates cached by ExecuteMeter as stale.
+     */
+    bm::Meter::MeterErrorCode meter_reset_rates(size_t cxt_id,
+                                                const std::string& meter_name,
+                                                size_t idx) override;
+
     // Disabling copy and move operations
     P4SwitchCore(const P4SwitchCore&) = delete;
     P4SwitchCore& operator=(const P4SwitchCore&) = delete;
@@ -191,6 +385,41 @@ class P4SwitchCore : public bm::Switch
      */
     bool GetMirroringSession(int mirrorId, MirroringSessionConfig* config) const;
 
+    /**
+     * @brief Save the data-plane state of the switch in a compact binary record
+     *
+     * The record holds the table entries, action profiles, meters and registers
+     * (serialized by bmv2), the counter arrays and the direct counters, the
+     * mirroring sessions and the multicast groups. Packets in flight and queue
+     * contents are not part of it.
+     *
+     * @param state the record
+     * @return int 0 on success, -1 on failure
+     */
+    int SaveState(std::string* state);
+
+    /**
+     * @brief Restore a record written by SaveState
+     *
+     * The switch must run the same P4 program, with empty tables: the record
+     * replaces loading the flow table.
+     *
+     * @param state the record
+     * @return int 0 on success, -1 on failure
+     */
+    int RestoreState(const std::string& state);
+
+    /**
+     * @brief Generate a digest for a packet, the learn step of the ingress pipeline
+     *
+     * Goes to the in-process sink when it is enabled, to the bm learn engine
+     * otherwise.
+     *
+     * @param listId the learn list
+     * @param packet the packet, after ingress processing
+     */
+    void Learn(int listId, const bm::Packet& packet);
+
     /**
      * @brief Check the queueing metadata
      */
@@ -218,19 +447,53 @@ class P4SwitchCore : public bm::Switch
     /**
      * @brief Retrieves the index of the given destination address.
      *
-     * This function checks if the specified destination address already exists
-     * in the internal address map. If it exists, the corresponding index is returned.
-     * If not, a new index is assigned by adding the address to the destination list,
-     * updating the map, and then returning the newly assigned index.
+     * The index is carried through the pipeline in the ns-3 address field of
+     * the packet registers. It is looked up in constant time in a bounded
+     * table; when the table is full, the least recently used address gives up
+     * its index. The returned index holds a reference on its entry, so it is
+     * not reclaimed while the packet is buffered; the reference is given up
+     * by GetDestinationAddress or ReleaseAddress.
      *
-     * @param destination The destination address to look up.
-     * @return The index of the destination address in the internal list.
-     *
-     * @note This function updates the internal address map and destination list
-     *       if the address is not found, ensuring a unique index for each address.
+     * @param destination The destination address to look up, a Mac48Address.
+     * @return The index of the destination address, or -1 if every index is
+     *         held by a packet in flight.
      */
     int GetAddressIndex(const Address& destination);
 
+    /**
+     * @brief Resolves an index returned by GetAddressIndex back to its address.
+     * @param index The address index.
+     * @param release Whether to give up the reference held on the index.
+     * @return The destination address.
+     */
+    Address GetDestinationAddress(int index, bool release);
+
+    /**
+     * @brief Gives up the address reference held by a packet that is dropped
+     *        or discarded without being emitted.
+     * @param packet The packet.
+     */
+    void ReleaseAddress(bm::Packet* packet);
+
+    /**
+     * @brief Takes an extra address reference for a copy of a packet that
+     *        kept the original's address index.
+     * @param copy The copied packet.
+     */
+    void CopyAddress(bm::Packet* copy);
+
+    /**
+     * @brief Number of destination addresses a switch can track at once,
+     * matching the 16-bit address index field of the packet registers.
+     */
+    static constexpr uint32_t ADDRESS_TABLE_CAPACITY = 1u << 16;
+
+    /**
+     * @brief Bytes reserved in front of a frame in the bm packet buffer, for
+     * the headers the P4 program pushes.
+     */
+    static constexpr uint32_t BM_PACKET_HEADROOM = 512;
+
     int m_p4SwitchId;                          //!< ID of the switch
     P4SwitchNetDevice* m_switchNetDevice;      //!< Pointer to the switch net device
     bool m_enableTracing;                      //!< Enable tracing
@@ -239,16 +502,154 @@ class P4SwitchCore : public bm::Switch
     std::string m_thriftCommand;               //!< Thrift command
     std::shared_ptr<bm::McSimplePreLAG> m_pre; //!< Multicast pre-LAG
 
-    std::vector<Address> m_destinationList; //!< List of addresses (O(log n) search)
-    std::map<Address, int> m_addressMap;    //!< Map for fast lookup
+    Mac48AddressTable m_addressTable; //!< Destination addresses by index
+    std::mutex m_addressMutex;        //!< Guards m_addressTable, workers release indices
   private:
+    /**
+     * @brief Recreate the multicast groups, nodes and LAGs of a switch
+     * @param entries the multicast state, as reported by mc_get_entries
+     * @return int 0 on success, -1 on failure
+     */
+    int RestoreMulticastState(const std::string& entries);
+
+    /**
+     * @brief Digests of one learn list waiting for delivery
+     */
+    struct DigestList
+    {
+        std::string name;                 //!< Name of the learn list
+        std::vector<std::string> fields;  //!< PHV field names, empty for constants
+        std::vector<std::string> constants; //!< Bytes of the constant elements
+        uint32_t sampleSize{0};           //!< Bytes per sample, known after one sample
+        uint32_t numSamples{0};           //!< Samples in data
+        uint64_t batch{0};                //!< Id of the current batch, unique in the switch
+        std::string data;                 //!< The samples
+    };
+
+    /**
+     * @brief Entry aged in simulator time
+     */
+    struct AgeingEntry
+    {
+        uint32_t table;            //!< Index in m_ageingTables
+        bm::entry_handle_t handle; //!< The entry
+        uint64_t ttlTicks;         //!< Idle timeout in wheel ticks
+        bool indirect;             //!< Entry of an indirect table
+        bool counted;              //!< The table has direct counters
+        uint64_t packets;          //!< Hit count at the last check, with counters
+        std::chrono::steady_clock::time_point lastCheck; //!< Wall clock at the last check
+    };
+
+    /**
+     * @brief Key of an entry in the timing wheel
+     * @param tableName the table
+     * @param handle the entry
+     * @param add give an unknown table an index
+     * @param key the key
+     * @return false if the table is unknown and add is false
+     */
+    bool GetAgeingKey(const std::string& tableName,
+                      bm::entry_handle_t handle,
+                      bool add,
+                      uint64_t* key);
+
+    /**
+     * @brief Read the time since the last hit of an aged entry, as kept by bm
+     * @param entry the entry
+     * @param ms set to the wall-clock time since the last hit, in milliseconds
+     * @return false if the entry is no longer in its table
+     */
+    bool GetTimeSinceHit(const AgeingEntry& entry, uint64_t* ms);
+
+    /**
+     * @brief Expire the timers due now and report the idle entries
+     *
+     * Entries hit since their last check are re-armed for a full timeout from
+     * now, see SetEntryIdleTimeout.
+     */
+    void AgeingTick();
+
+    /**
+     * @brief Schedule AgeingTick at the next expiry, if any
+     */
+    void ScheduleAgeing();
+
+    /**
+     * @brief Get the current wheel tick
+     * @return the tick
+     */
+    uint64_t GetAgeingNow() const;
+
+    /**
+     * @brief Read the clock, ignoring any latch
+     * @return the real time when a real-time clock is set, the simulator time
+     * otherwise
+     */
+    Time ReadClock() const;
+
+    /**
+     * @brief Read the units of the meter arrays of the running P4 program
+     */
+    void LoadMeterTypes();
+
+    /**
+     * @brief Read the learn lists of the running P4 program
+     */
+    void LoadDigestLists();
+
+    /**
+     * @brief Deliver the current batch of a learn list
+     * @param listId the learn list
+     * @param batch id of the batch, nothing is sent if it was delivered
+     * already or its list was reloaded since
+     */
+    void FlushDigests(int listId, uint64_t batch);
+
     class MirroringSessions;            //!< Mirroring sessions for clone .etc
     int m_thriftPort;                   //!< Thrift port for the switch (default 9090)
     size_t m_nbQueuesPerPort;           //!< Number of queues per port (default 8)
     uint64_t m_packetId;                //!< Packet ID
     uint64_t m_startTimestamp;          //!< Start time of the switch
+    Ptr<RealtimeSimulatorImpl> m_realtimeClock; //!< Wall clock in emulation mode
     bm::TargetParserBasic* m_argParser; //!< Structure of parsers
     std::unique_ptr<MirroringSessions> m_mirroringSessions; //!< Mirroring sessions
+    size_t m_programFootprint{0}; //!< Resident memory growth while loading the program
+
+    bool m_digestSink{false};                //!< Digests are delivered in process
+    uint32_t m_digestMaxBatchSize{1};        //!< Samples per digest batch
+    Time m_digestMaxDelay;                   //!< Longest wait of a digest
+    uint32_t m_digestContext{0};             //!< Node ID for the delivery events
+    std::map<int, DigestList> m_digestLists; //!< Learn lists by ID
+    uint64_t m_digestLastBatch{0};           //!< Last batch id, kept across reloads
+    std::mutex m_digestMutex; //!< Guards m_digestLists, learn may run on a worker thread
+
+    bool m_simulatedAgeing{false};          //!< Entries are aged in simulator time
+    Time m_ageingTick;                      //!< Resolution of the timeouts
+    P4TimingWheel m_ageingWheel;            //!< Timeouts of the aged entries
+    EventId m_ageingEvent;                  //!< Pending AgeingTick
+    std::vector<std::string> m_ageingTables; //!< Tables with aged entries
+    std::unordered_map<uint64_t, AgeingEntry> m_ageingEntries; //!< Aged entries by key
+
+    /**
+     * @brief Meter cells of one array on the switch clock
+     */
+    struct MeterCells
+    {
+        std::vector<P4RateMeter> cells; //!< One meter per cell
+        std::vector<uint64_t> synced;   //!< m_meterRatesVersion the rates of each cell are from
+    };
+
+    /**
+     * @brief Make ExecuteMeter read the rates from bm again
+     */
+    void InvalidateMeterRates();
+
+    bool m_meterTypesLoaded{false};                  //!< m_meterBytes is read
+    std::map<std::string, bool> m_meterBytes;        //!< Byte meter arrays by name
+    std::unordered_map<const bm::MeterArray*, MeterCells>
+        m_meters;                       //!< Meter cells on the switch clock, by array
+    uint64_t m_meterRatesVersion{1};    //!< Bumped whenever the rates in bm change
+    std::mutex m_meterMutex; //!< Guards the meters, ingress and egress may run in parallel
 };
 
 } // namespace ns3
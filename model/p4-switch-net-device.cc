@@ -32,10 +32,35 @@
 #include "ns3/string.h"
 #include "ns3/uinteger.h"
 
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE("P4SwitchNetDevice");
 
+namespace {
+
+// Parse a comma separated list of CPU ids, e.g. "2,3,4"
+std::vector<int> ParseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::istringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    char *end = nullptr;
+    long cpu = std::strtol(item.c_str(), &end, 10);
+    if (end == item.c_str() || cpu < 0) {
+      NS_LOG_WARN("Ignoring invalid CPU '" << item << "' in " << list);
+      continue;
+    }
+    cpus.push_back(static_cast<int>(cpu));
+  }
+  return cpus;
+}
+
+} // namespace
+
 NS_OBJECT_ENSURE_REGISTERED(P4SwitchNetDevice);
 
 TypeId P4SwitchNetDevice::GetTypeId() {
@@ -50,6 +75,13 @@ TypeId P4SwitchNetDevice::GetTypeId() {
               MakeBooleanAccessor(&P4SwitchNetDevice::m_enableTracing),
               MakeBooleanChecker())
 
+          .AddAttribute(
+              "PrintMemoryReport",
+              "Print the approximate memory held by the switch at teardown.",
+              BooleanValue(false),
+              MakeBooleanAccessor(&P4SwitchNetDevice::m_printMemoryReport),
+              MakeBooleanChecker())
+
           .AddAttribute("EnableSwap", "Enable swapping in the switch.",
                         BooleanValue(false),
                         MakeBooleanAccessor(&P4SwitchNetDevice::m_enableSwap),
@@ -100,6 +132,59 @@ TypeId P4SwitchNetDevice::GetTypeId() {
                         MakeUintegerAccessor(&P4SwitchNetDevice::m_switchRate),
                         MakeUintegerChecker<uint64_t>())
 
+          .AddAttribute(
+              "EmulationMode",
+              "Run the v1model pipelines on worker threads in real time, for "
+              "use with RealtimeSimulatorImpl in front of TapBridge or "
+              "FdNetDevice.",
+              BooleanValue(false),
+              MakeBooleanAccessor(&P4SwitchNetDevice::m_emulationMode),
+              MakeBooleanChecker())
+
+          .AddAttribute(
+              "EmulationEgressThreads",
+              "Number of egress threads in emulation mode.", UintegerValue(4),
+              MakeUintegerAccessor(&P4SwitchNetDevice::m_emulationEgressThreads),
+              MakeUintegerChecker<uint32_t>(1, 64))
+
+          .AddAttribute(
+              "EmulationCpuAffinity",
+              "Comma separated CPUs the emulation threads are pinned to, the "
+              "ingress thread first, then the egress threads. Empty for no "
+              "pinning.",
+              StringValue(""),
+              MakeStringAccessor(&P4SwitchNetDevice::m_emulationCpuAffinity),
+              MakeStringChecker())
+
+          .AddAttribute(
+              "DigestBatchSize",
+              "Digests of a learn list delivered together to the Digest trace "
+              "source. 0 sends digests through the bmv2 notifications "
+              "transport instead.",
+              UintegerValue(64),
+              MakeUintegerAccessor(&P4SwitchNetDevice::m_digestBatchSize),
+              MakeUintegerChecker<uint32_t>())
+
+          .AddAttribute(
+              "DigestMaxDelay",
+              "Longest time a digest waits for its batch to fill up.",
+              TimeValue(MilliSeconds(1)),
+              MakeTimeAccessor(&P4SwitchNetDevice::m_digestMaxDelay),
+              MakeTimeChecker())
+
+          .AddAttribute(
+              "SimulatedAgeing",
+              "Age v1model table entries with a TTL in simulator time, instead "
+              "of with the wall-clock bmv2 ageing monitor.",
+              BooleanValue(true),
+              MakeBooleanAccessor(&P4SwitchNetDevice::m_simulatedAgeing),
+              MakeBooleanChecker())
+
+          .AddAttribute("AgeingTick", "Resolution of the entry timeouts.",
+                        TimeValue(MilliSeconds(1)),
+                        MakeTimeAccessor(&P4SwitchNetDevice::m_ageingTick),
+                        MakeTimeChecker())
+
           .AddAttribute("ChannelType",
                         "Channel type for the switch, csma with 0, p2p with 1.",
                         UintegerValue(0),
@@ -115,12 +200,24 @@ TypeId P4SwitchNetDevice::GetTypeId() {
           .AddTraceSource(
               "SwitchEvent", "Emitted when a switch event occurs",
               MakeTraceSourceAccessor(&P4SwitchNetDevice::m_switchEvent),
-              "ns3::TracedCallback::Uint32String");
+              "ns3::TracedCallback::Uint32String")
+
+          .AddTraceSource(
+              "Digest", "A batch of digests of one learn list",
+              MakeTraceSourceAccessor(&P4SwitchNetDevice::m_digestTrace),
+              "ns3::P4SwitchNetDevice::DigestTracedCallback")
+
+          .AddTraceSource(
+              "EntriesExpired", "Table entries whose idle timeout expired",
+              MakeTraceSourceAccessor(&P4SwitchNetDevice::m_entriesExpiredTrace),
+              "ns3::P4SwitchNetDevice::EntriesExpiredTracedCallback");
 
   return tid;
 }
 
-P4SwitchNetDevice::P4SwitchNetDevice() : m_node(nullptr), m_ifIndex(0) {
+P4SwitchNetDevice::P4SwitchNetDevice()
+    : m_v1modelSwitch(nullptr), m_p4Pipeline(nullptr), m_psaSwitch(nullptr),
+      m_pnaNic(nullptr), m_node(nullptr), m_ifIndex(0) {
   NS_LOG_FUNCTION_NOARGS();
   m_channel = CreateObject<P4BridgeChannel>();
 }
@@ -131,14 +228,32 @@ void P4SwitchNetDevice::DoInitialize() {
   NS_LOG_FUNCTION(this);
   NS_LOG_DEBUG("P4 architecture: v1model");
 
+  if (m_emulationMode && m_switchArch != P4SWITCH_ARCH_V1MODEL) {
+    NS_LOG_WARN("EmulationMode is only supported by v1model, ignored");
+  }
+
   switch (m_switchArch) {
   case P4SWITCH_ARCH_V1MODEL:
     NS_LOG_DEBUG("P4 architecture: v1model");
     m_v1modelSwitch = new P4CoreV1model(
         this, m_enableSwap, m_enableTracing, m_switchRate, m_InputBufferSizeLow,
-        m_InputBufferSizeHigh, m_queueBufferSize);
+        m_InputBufferSizeHigh, m_queueBufferSize,
+        SSWITCH_VIRTUAL_QUEUE_NUM_V1MODEL,
+        m_emulationMode ? m_emulationEgressThreads : 1);
     m_v1modelSwitch->InitializeSwitchFromP4Json(m_jsonPath);
-    m_v1modelSwitch->LoadFlowTableToSwitch(m_flowTablePath);
+    if (m_digestBatchSize > 0) {
+      m_v1modelSwitch->EnableDigestSink(m_digestBatchSize, m_digestMaxDelay);
+    }
+    if (m_simulatedAgeing) {
+      m_v1modelSwitch->EnableSimulatedAgeing(m_ageingTick);
+    }
+    LoadTables(m_v1modelSwitch);
+    if (m_emulationMode &&
+        m_v1modelSwitch->EnableEmulation(
+            ParseCpuList(m_emulationCpuAffinity)) != 0) {
+      NS_FATAL_ERROR("EmulationMode requires SimulatorImplementationType "
+                     "ns3::RealtimeSimulatorImpl");
+    }
     m_v1modelSwitch->start_and_return_();
     break;
 
@@ -149,7 +264,7 @@ void P4SwitchNetDevice::DoInitialize() {
                       m_InputBufferSizeLow, // normal input queue size
                       m_queueBufferSize);
     m_psaSwitch->InitializeSwitchFromP4Json(m_jsonPath);
-    m_psaSwitch->LoadFlowTableToSwitch(m_flowTablePath);
+    LoadTables(m_psaSwitch);
     m_psaSwitch->start_and_return_();
     break;
 
@@ -158,6 +273,9 @@ void P4SwitchNetDevice::DoInitialize() {
     m_pnaNic = new P4PnaNic(this, m_enableSwap);
     m_pnaNic->InitializeSwitchFromP4Json(m_jsonPath);
     // m_pnaNic->LoadFlowTableToSwitch(m_flowTablePath); // Now not supported
+    if (!m_restoreState.empty()) {
+      LoadTables(m_pnaNic);
+    }
     m_pnaNic->start_and_return_();
     break;
 
@@ -166,7 +284,10 @@ void P4SwitchNetDevice::DoInitialize() {
     NS_LOG_DEBUG("P4 architecture: Pipeline");
     m_p4Pipeline = new P4CorePipeline(this, m_enableSwap, m_enableTracing);
     m_p4Pipeline->InitializeSwitchFromP4Json(m_jsonPath);
-    m_p4Pipeline->LoadFlowTableToSwitch(m_flowTablePath);
+    if (m_digestBatchSize > 0) {
+      m_p4Pipeline->EnableDigestSink(m_digestBatchSize, m_digestMaxDelay);
+    }
+    LoadTables(m_p4Pipeline);
     // m_p4Pipeline->InitSwitchWithP4(m_jsonPath, m_flowTablePath);
     m_p4Pipeline->start_and_return_();
     break;
@@ -176,10 +297,20 @@ void P4SwitchNetDevice::DoInitialize() {
 
 void P4SwitchNetDevice::DoDispose() {
   NS_LOG_FUNCTION_NOARGS();
-  for (auto iter = m_ports.begin(); iter != m_ports.end(); iter++) {
-    *iter = nullptr;
+  if (m_printMemoryReport) {
+    PrintMemoryReport(std::cout);
+  }
+  if (m_v1modelSwitch) {
+    // no packet may reach the ports once they are gone
+    m_v1modelSwitch->StopEmulation();
+  }
+  for (PortContext &port : m_ports) {
+    if (port.frameDevice) {
+      port.frameDevice->UnbindSwitchPort();
+    }
   }
   m_ports.clear();
+  m_portByIfIndex.clear();
   m_channel = nullptr;
   m_node = nullptr;
   NetDevice::DoDispose();
@@ -191,36 +322,56 @@ void P4SwitchNetDevice::ReceiveFromDevice(Ptr<NetDevice> incomingPort,
                                           const Address &dst,
                                           PacketType packetType) {
   NS_LOG_FUNCTION_NOARGS();
-  NS_LOG_DEBUG("UID is " << packet->GetUid());
 
-  Mac48Address src48 = Mac48Address::ConvertFrom(src);
+  int inPort = LookupPort(incomingPort);
+  if (inPort < 0) {
+    NS_LOG_ERROR("Packet received from a device that is not a bridged port");
+    return;
+  }
+  ReceiveFromPort(inPort, ConstCast<Packet>(packet), protocol, src, dst,
+                  packetType);
+}
+
+void P4SwitchNetDevice::ReceiveFromPort(uint32_t inPort,
+                                        Ptr<Packet> ns3Packet,
+                                        uint16_t protocol, const Address &src,
+                                        const Address &dst,
+                                        PacketType packetType) {
+  NS_LOG_FUNCTION_NOARGS();
+  NS_LOG_DEBUG("UID is " << ns3Packet->GetUid());
+
   Mac48Address dst48 = Mac48Address::ConvertFrom(dst);
 
   if (!m_promiscRxCallback.IsNull()) {
-    m_promiscRxCallback(this, packet, protocol, src, dst, packetType);
+    m_promiscRxCallback(this, ns3Packet, protocol, src, dst, packetType);
   }
 
   if (dst48 == m_address) {
-    m_rxCallback(this, packet, protocol, src);
+    m_rxCallback(this, ns3Packet, protocol, src);
   }
 
-  int inPort = GetPortNumber(incomingPort);
-
-  Ptr<ns3::Packet> ns3Packet((ns3::Packet *)PeekPointer(packet));
+  PortContext &port = m_ports[inPort];
+  port.counters.rxPackets++;
+  port.counters.rxBytes += ns3Packet->GetSize();
 
-  if (m_channelType == P4CHANNELCSMA) {
+  if (port.frameDevice && port.frameDevice->IsFramePassThrough()) {
+    // The port handed us the frame as received, Ethernet header included
+    NS_LOG_DEBUG("* Frame passed through, EtherType: 0x" << std::hex << protocol
+                                                         << std::dec);
+  } else if (port.channelType == P4CHANNELCSMA) {
     EthernetHeader eeh;
     eeh.SetDestination(dst48);
-    eeh.SetSource(src48);
+    eeh.SetSource(Mac48Address::ConvertFrom(src));
     eeh.SetLengthType(protocol);
 
     ns3Packet->AddHeader(eeh);
-  } else if (m_channelType == P4CHANNELP2P) {
+  } else if (port.channelType == P4CHANNELP2P) {
     // The P4 processing pipeline requires an Ethernet header at the front of
     // the packet so that the P4 parser can extract hdr.ethernet.  When the
-    // P2P port device (CustomP2PNetDevice) delivers a packet to us via the
-    // registered protocol handler it has already stripped the wire-level
-    // Ethernet wrapper and passed its EtherType as the 'protocol' parameter.
+    // P2P port device (CustomP2PNetDevice) delivers a packet to us without
+    // frame pass-through (custom header mode) it has already stripped the
+    // wire-level Ethernet wrapper and passed its EtherType as the 'protocol'
+    // parameter.
     // We must therefore build a fresh Ethernet header from the metadata
     // (src, dst, protocol) rather than trying to re-parse packet bytes that
     // are NOT an Ethernet header.  The previous approach of calling
@@ -229,7 +380,7 @@ void P4SwitchNetDevice::ReceiveFromDevice(Ptr<NetDevice> incomingPort,
     // of the actual payload (IPv4 / tunnel header), corrupting the packet.
     EthernetHeader eeh_1;
     eeh_1.SetDestination(dst48);
-    eeh_1.SetSource(src48);
+    eeh_1.SetSource(Mac48Address::ConvertFrom(src));
     eeh_1.SetLengthType(protocol); // EtherType from the stripped wire header
 
     NS_LOG_DEBUG("* Reconstructed Ethernet header: Source MAC: "
@@ -277,7 +428,7 @@ Ptr<NetDevice> P4SwitchNetDevice::GetBridgePort(uint32_t n) const {
   NS_LOG_FUNCTION_NOARGS();
   if (n >= m_ports.size())
     return NULL;
-  return m_ports[n];
+  return m_ports[n].device;
 }
 
 void P4SwitchNetDevice::AddBridgePort(Ptr<NetDevice> bridgePort) {
@@ -295,27 +446,79 @@ void P4SwitchNetDevice::AddBridgePort(Ptr<NetDevice> bridgePort) {
     m_address = Mac48Address::ConvertFrom(bridgePort->GetAddress());
   }
 
-  NS_LOG_DEBUG("RegisterProtocolHandler for "
-               << bridgePort->GetInstanceTypeId().GetName());
+  // Register the port with its number, so ingress resolves it by the
+  // interface index of the device instead of scanning the port list.
+  uint32_t ifIndex = bridgePort->GetIfIndex();
+  if (ifIndex >= m_portByIfIndex.size()) {
+    m_portByIfIndex.resize(ifIndex + 1, -1);
+  }
+  m_portByIfIndex[ifIndex] = static_cast<int32_t>(m_ports.size());
+
+  PortContext port;
+  port.device = bridgePort;
+  port.channelType = m_channelType;
+  if (m_channelType == P4CHANNELP2P) {
+    // The P4 program owns the L2 header: let frames pass through the port
+    // instead of stripping and rebuilding the Ethernet header on every hop.
+    port.frameDevice = DynamicCast<CustomP2PNetDevice>(bridgePort);
+    if (port.frameDevice) {
+      port.frameDevice->SetFramePassThrough(true);
+    }
+  }
 
-  m_node->RegisterProtocolHandler(
-      MakeCallback(&P4SwitchNetDevice::ReceiveFromDevice, this), 0, bridgePort,
-      true);
-  m_ports.push_back(bridgePort);
+  if (port.frameDevice) {
+    // Our own port device: it calls us directly with the port number,
+    // bypassing the protocol handler dispatch of the node.
+    port.frameDevice->BindSwitchPort(
+        MakeCallback(&P4SwitchNetDevice::ReceiveFromPort, this),
+        m_ports.size());
+  } else {
+    NS_LOG_DEBUG("RegisterProtocolHandler for "
+                 << bridgePort->GetInstanceTypeId().GetName());
+    m_node->RegisterProtocolHandler(
+        MakeCallback(&P4SwitchNetDevice::ReceiveFromDevice, this), 0,
+        bridgePort, true);
+  }
+  m_ports.push_back(port);
   m_channel->AddChannel(bridgePort->GetChannel());
 }
 
-uint32_t P4SwitchNetDevice::GetPortNumber(Ptr<NetDevice> port) const {
-  int portsNum = GetNBridgePorts();
-  for (int i = 0; i < portsNum; i++) {
-    if (GetBridgePort(i) == port)
-      NS_LOG_DEBUG("Port found: " << i);
-    return i;
+int P4SwitchNetDevice::LookupPort(const Ptr<NetDevice> &device) const {
+  uint32_t ifIndex = device->GetIfIndex();
+  if (ifIndex < m_portByIfIndex.size()) {
+    int32_t n = m_portByIfIndex[ifIndex];
+    if (n >= 0 && m_ports[n].device == device) {
+      return n;
+    }
+  }
+  // A port registered before it was added to the node has a stale interface
+  // index. Such ports are not expected, keep them working anyway.
+  for (uint32_t i = 0; i < m_ports.size(); i++) {
+    if (m_ports[i].device == device) {
+      NS_LOG_WARN("Port " << i << " not found by its interface index");
+      return i;
+    }
   }
-  NS_LOG_ERROR("Port not found");
   return -1;
 }
 
+uint32_t P4SwitchNetDevice::GetPortNumber(Ptr<NetDevice> port) const {
+  int n = LookupPort(port);
+  if (n < 0) {
+    NS_LOG_ERROR("Port not found");
+    return -1;
+  }
+  NS_LOG_DEBUG("Port found: " << n);
+  return n;
+}
+
+P4SwitchPortCounters P4SwitchNetDevice::GetPortCounters(uint32_t n) const {
+  if (n >= m_ports.size()) {
+    return P4SwitchPortCounters();
+  }
+  return m_ports[n].counters;
+}
+
 void P4SwitchNetDevice::SetIfIndex(const uint32_t index) {
   NS_LOG_FUNCTION_NOARGS();
   m_ifIndex = index;
@@ -433,7 +636,7 @@ bool P4SwitchNetDevice::SendFrom(Ptr<Packet> packet, const Address &src,
   Ptr<Packet> pktCopy;
   for (auto iter = m_ports.begin(); iter != m_ports.end(); iter++) {
     pktCopy = packet->Copy();
-    Ptr<NetDevice> port = *iter;
+    Ptr<NetDevice> port = iter->device;
     port->SendFrom(pktCopy, src, dst, protocolNumber);
   }
 
@@ -455,6 +658,24 @@ void P4SwitchNetDevice::SendNs3Packet(Ptr<Packet> packetOut, int outPort,
   // length" << std::endl; packetOut->Print(std::cout); std::cout << std::endl;
 
   if (packetOut) {
+    if (outPort == 511) {
+      return;
+    }
+    NS_LOG_DEBUG("EgressPortNum: " << outPort);
+    if (outPort < 0 || static_cast<uint32_t>(outPort) >= m_ports.size()) {
+      NS_LOG_WARN("Dropping packet for non-existent egress port " << outPort);
+      return;
+    }
+    PortContext &port = m_ports[outPort];
+    port.counters.txPackets++;
+    port.counters.txBytes += packetOut->GetSize();
+
+    if (port.frameDevice && port.frameDevice->IsFramePassThrough()) {
+      // Send the deparsed frame unchanged, the P4 program wrote its L2 header
+      port.frameDevice->SendFrame(packetOut);
+      return;
+    }
+
     // Print the packet's header
     EthernetHeader eeh_1;
 
@@ -470,11 +691,7 @@ void P4SwitchNetDevice::SendNs3Packet(Ptr<Packet> packetOut, int outPort,
     // packetOut->Print(std::cout);
     // std::cout << "packet length: " << packetOut->GetSize() << std::endl;
 
-    if (outPort != 511) {
-      NS_LOG_DEBUG("EgressPortNum: " << outPort);
-      Ptr<NetDevice> outNetDevice = GetBridgePort(outPort);
-      outNetDevice->Send(packetOut, destination, protocol);
-    }
+    port.device->Send(packetOut, destination, protocol);
   } else
     NS_LOG_DEBUG("Null Packet!");
 }
@@ -518,8 +735,89 @@ Address P4SwitchNetDevice::GetMulticast(Ipv6Address addr) const {
 P4CoreV1model *P4SwitchNetDevice::GetV1ModelCore() const {
   return m_v1modelSwitch;
 }
+void P4SwitchNetDevice::LoadTables(P4SwitchCore *core) {
+  if (m_restoreState.empty()) {
+    core->LoadFlowTableToSwitch(m_flowTablePath);
+    return;
+  }
+  if (core->RestoreState(m_restoreState) != 0) {
+    NS_FATAL_ERROR("Cannot restore the checkpointed state of switch on node "
+                   << (m_node ? m_node->GetId() : 0));
+  }
+  // the record is not needed any more
+  std::string().swap(m_restoreState);
+}
+
+void P4SwitchNetDevice::SetRestoreState(const std::string &state) {
+  NS_LOG_FUNCTION(this << state.size());
+  m_restoreState = state;
+}
+
+int P4SwitchNetDevice::SaveState(std::string *state) const {
+  P4SwitchCore *core = GetCore();
+  if (!core) {
+    NS_LOG_WARN("Switch core not created yet, no state to save");
+    return -1;
+  }
+  return core->SaveState(state);
+}
+
+P4SwitchCore *P4SwitchNetDevice::GetCore() const {
+  switch (m_switchArch) {
+  case P4SWITCH_ARCH_V1MODEL:
+    return m_v1modelSwitch;
+  case P4SWITCH_ARCH_PSA:
+    return m_psaSwitch;
+  case P4NIC_ARCH_PNA:
+    return m_pnaNic;
+  case P4SWITCH_ARCH_PIPELINE:
+    return m_p4Pipeline;
+  }
+  return nullptr;
+}
+
+bool P4SwitchNetDevice::GetMemoryReport(P4SwitchMemoryReport *report) const {
+  P4SwitchCore *core = GetCore();
+  if (!core) {
+    NS_LOG_WARN("Switch core not created yet, no memory report available");
+    *report = P4SwitchMemoryReport();
+    return false;
+  }
+  core->GetMemoryReport(report);
+  report->deviceBytes = sizeof(*this) +
+                        m_ports.capacity() * sizeof(PortContext) +
+                        m_portByIfIndex.capacity() * sizeof(int32_t);
+  return true;
+}
+
+void P4SwitchNetDevice::PrintMemoryReport(std::ostream &os) const {
+  P4SwitchMemoryReport report;
+  if (!GetMemoryReport(&report)) {
+    return;
+  }
+  os << "P4 switch (node " << (m_node ? m_node->GetId() : 0)
+     << ") memory report [bytes]:"
+     << " core=" << report.coreBytes << " program=" << report.programBytes
+     << " queues=" << report.queueBytes << " (" << report.queuedPackets
+     << " pkts)"
+     << " addressCache=" << report.addressCacheBytes
+     << " mirroring=" << report.mirroringBytes
+     << " device=" << report.deviceBytes << " total=" << report.Total()
+     << std::endl;
+}
+
 void P4SwitchNetDevice::EmitSwitchEvent(uint32_t id, const std::string &msg) {
   m_switchEvent(id, msg);
 }
 
+void P4SwitchNetDevice::EmitDigest(const P4DigestBatch &batch) {
+  NS_LOG_FUNCTION(this << batch.listId << batch.numSamples);
+  m_digestTrace(batch);
+}
+
+void P4SwitchNetDevice::EmitEntriesExpired(const P4ExpiredEntries &entries) {
+  NS_LOG_FUNCTION(this << entries.tableName << entries.handles.size());
+  m_entriesExpiredTrace(entries);
+}
+
 } // namespace ns3
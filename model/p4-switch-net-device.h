@@ -20,13 +20,17 @@
 #ifndef P4_SWITCH_NET_DEVICE
 #define P4_SWITCH_NET_DEVICE
 
+#include "ns3/custom-p2p-net-device.h"
 #include "ns3/net-device.h"
+#include "ns3/nstime.h"
 #include "ns3/p4-bridge-channel.h"
 #include "ns3/traced-callback.h"
 
 #include <map>
+#include <ostream>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 /**
  * \file
@@ -45,11 +49,88 @@ namespace ns3 {
 #define P4SWITCH_ARCH_PIPELINE 3
 
 class Node;
+class P4SwitchCore;
 class P4CoreV1model;
 class P4CorePsa;
 class P4PnaNic;
 class P4CorePipeline;
 
+/**
+ * \brief Approximate memory held by one P4 switch, in bytes.
+ *
+ * All figures are estimates. programBytes is the growth of the process
+ * resident set measured while the P4 JSON and the flow table were loaded
+ * (bm P4 objects, match tables, PHV pools and the runtime server). queueBytes
+ * counts the queue bookkeeping plus a bm packet with its buffer for every
+ * packet currently queued.
+ */
+struct P4SwitchMemoryReport {
+  size_t coreBytes{0};         //!< The switch core object itself
+  size_t programBytes{0};      //!< P4 objects, tables and pools at load time,
+                               //!< estimated from the resident memory growth
+  size_t queueBytes{0};        //!< Queue structures and queued packets
+  size_t queuedPackets{0};     //!< Packets currently waiting in the queues
+  size_t addressCacheBytes{0}; //!< Destination address cache
+  size_t mirroringBytes{0};    //!< Mirroring session table
+  size_t deviceBytes{0};       //!< The net device and its port list
+
+  /**
+   * \brief Sum of all the byte figures
+   * \return total bytes
+   */
+  size_t Total() const {
+    return coreBytes + programBytes + queueBytes + addressCacheBytes +
+           mirroringBytes + deviceBytes;
+  }
+};
+
+/**
+ * \brief Packet counters of one port of a P4 switch.
+ */
+struct P4SwitchPortCounters {
+  uint64_t rxPackets{0}; //!< Packets received from the port
+  uint64_t rxBytes{0};   //!< Bytes received from the port
+  uint64_t txPackets{0}; //!< Packets sent out of the port
+  uint64_t txBytes{0};   //!< Bytes sent out of the port
+};
+
+/**
+ * \brief A batch of digests of one learn list, delivered in process.
+ *
+ * The samples are stored back to back in data, sampleSize bytes each. A sample
+ * holds the fields of the learn list in order, each in its bm byte width, as
+ * in the bmv2 learning notifications.
+ */
+struct P4DigestBatch {
+  uint32_t switchId{0};  //!< ID of the switch core
+  int listId{0};         //!< ID of the learn list
+  std::string listName;  //!< Name of the learn list
+  uint32_t sampleSize{0}; //!< Bytes per sample
+  uint32_t numSamples{0}; //!< Samples in data
+  std::string data;      //!< The samples
+
+  /**
+   * \brief Get one sample
+   * \param i the sample index, below numSamples
+   * \return pointer to the sampleSize bytes of the sample
+   */
+  const char *GetSample(uint32_t i) const {
+    return data.data() + static_cast<size_t>(i) * sampleSize;
+  }
+};
+
+/**
+ * \brief Table entries of one table whose idle timeout expired.
+ *
+ * As with the bmv2 ageing notifications, the entries stay in the table until
+ * the controller deletes them.
+ */
+struct P4ExpiredEntries {
+  uint32_t switchId{0};          //!< ID of the switch core
+  std::string tableName;         //!< The table
+  std::vector<uint32_t> handles; //!< Handles of the idle entries
+};
+
 /**
  * \defgroup P4 Switch Network Device
  *
@@ -85,6 +166,33 @@ public:
    * Call after P4CoreV1model is created.
    */
   void ConnectCoreEvent();
+
+  /**
+   * \brief Deliver a batch of digests to the Digest trace source (called by
+   * the switch core)
+   * \param batch the digests
+   */
+  void EmitDigest(const P4DigestBatch &batch);
+
+  /**
+   * \brief TracedCallback signature for digest batches
+   * \param batch the digests
+   */
+  typedef void (*DigestTracedCallback)(const P4DigestBatch &batch);
+
+  /**
+   * \brief Report table entries whose idle timeout expired to the
+   * EntriesExpired trace source (called by the switch core)
+   * \param entries the entries
+   */
+  void EmitEntriesExpired(const P4ExpiredEntries &entries);
+
+  /**
+   * \brief TracedCallback signature for expired entries
+   * \param entries the entries
+   */
+  typedef void (*EntriesExpiredTracedCallback)(const P4ExpiredEntries &entries);
+
   /**
    * \brief Add a 'port' to a P4 bridge device
    * \param bridgePort the NetDevice to add
@@ -93,6 +201,10 @@ public:
    * the new bridge port NetDevice becomes part of the bridge and L2
    * frames start being forwarded to/from this NetDevice.
    *
+   * CustomP2PNetDevice ports are bound directly to the switch and deliver
+   * their frames with the port number attached. Other devices are served
+   * through a promiscuous protocol handler registered on the node.
+   *
    * \attention The netdevice that is being added as bridge port must
    * _not_ have an IP address.  In order to add IP connectivity to a
    * bridging node you must enable IP on the BridgeNetDevice itself,
@@ -110,11 +222,19 @@ public:
 
   /**
    * \brief Gets the number ID of a 'port' connected to P4 net device.
-   * \param netdevice
-   * \return the port number of the p4 bridge device
+   * \param port the bridged NetDevice
+   * \return the port number of the p4 bridge device, or (uint32_t)-1 if the
+   * device is not a bridged port
    */
   uint32_t GetPortNumber(Ptr<NetDevice> port) const;
 
+  /**
+   * \brief Gets the packet counters of a port.
+   * \param n the port index
+   * \return the counters, all zero if the port does not exist
+   */
+  P4SwitchPortCounters GetPortCounters(uint32_t n) const;
+
   /**
    * \brief Gets the n-th bridged port.
    * \param n the port index
@@ -155,6 +275,38 @@ public:
                      const Address &destination);
   P4CoreV1model *GetV1ModelCore() const;
 
+  /**
+   * \brief Save the data-plane state of the switch, see
+   * P4SwitchCore::SaveState
+   * \param state the binary record
+   * \return 0 on success, -1 on failure or before the switch is initialized
+   */
+  int SaveState(std::string *state) const;
+
+  /**
+   * \brief Restore a saved state when the switch is initialized
+   *
+   * Must be called before the switch is initialized. The record replaces the
+   * flow table file: tables, registers, counters, meters, mirroring sessions
+   * and multicast groups are restored in bulk.
+   *
+   * \param state the binary record written by SaveState
+   */
+  void SetRestoreState(const std::string &state);
+
+  /**
+   * \brief Get an approximation of the memory held by this switch
+   * \param report the report to fill
+   * \return false if the switch core has not been created yet
+   */
+  bool GetMemoryReport(P4SwitchMemoryReport *report) const;
+
+  /**
+   * \brief Print the memory report of this switch
+   * \param os the output stream
+   */
+  void PrintMemoryReport(std::ostream &os) const;
+
   // inherited from NetDevice base class.
   void SetIfIndex(const uint32_t index) override;
   uint32_t GetIfIndex() const override;
@@ -194,7 +346,8 @@ protected:
   void DoDispose() override;
 
   /**
-   * \brief Receives a packet from one bridged port.
+   * \brief Receives a packet from one bridged port, through the protocol
+   * handler registered on the node.
    * \param device the originating port
    * \param packet the received packet
    * \param protocol the packet protocol (e.g., Ethertype)
@@ -206,6 +359,48 @@ protected:
                          uint16_t protocol, const Address &source,
                          const Address &destination, PacketType packetType);
 
+  /**
+   * \brief Receives a packet from a bridged port whose number is known.
+   *
+   * Entry point of the ports bound directly to the switch, see
+   * CustomP2PNetDevice::BindSwitchPort. ReceiveFromDevice resolves the port
+   * of the other devices and continues here.
+   *
+   * \param inPort the number of the originating port
+   * \param packet the received packet
+   * \param protocol the packet protocol (e.g., Ethertype)
+   * \param source the packet source
+   * \param destination the packet destination
+   * \param packetType the packet type (e.g., host, broadcast, etc.)
+   */
+  void ReceiveFromPort(uint32_t inPort, Ptr<Packet> packet, uint16_t protocol,
+                       const Address &source, const Address &destination,
+                       PacketType packetType);
+
+  /**
+   * \brief Gets the switch core of the configured architecture
+   * \return the core, or nullptr before DoInitialize
+   */
+  P4SwitchCore *GetCore() const;
+
+  /**
+   * \brief Fill the tables of a new core, from the checkpointed state if one
+   * was set, from the flow table file otherwise
+   * \param core the core
+   */
+  void LoadTables(P4SwitchCore *core);
+
+  /**
+   * \brief Resolves a bridged NetDevice to its port number
+   *
+   * Constant time: ports are indexed by the interface index they have on the
+   * switch node.
+   *
+   * \param device the NetDevice
+   * \return the port number, or -1 if the device is not a bridged port
+   */
+  int LookupPort(const Ptr<NetDevice> &device) const;
+
   // /**
   //  * \brief Gets the port associated to a source address
   //  * \param source the source address
@@ -215,14 +410,39 @@ protected:
   // Ptr<NetDevice> GetLearnedState(Mac48Address source);
 
 private:
+  /**
+   * \brief Context of one bridged port, set up by AddBridgePort
+   */
+  struct PortContext {
+    Ptr<NetDevice> device;              //!< The bridged NetDevice
+    Ptr<CustomP2PNetDevice> frameDevice; //!< Set if bound directly to us
+    uint32_t channelType;               //!< Channel type of the port
+    P4SwitchPortCounters counters;      //!< Packet counters of the port
+  };
+
   // === Basic configuration ===
   bool m_enableTracing;  //!< Enable tracing
   bool m_enableSwap;     //!< Enable swapping
+  bool m_printMemoryReport; //!< Print the memory report at teardown
   uint32_t m_switchArch; //!< Switch architecture type
 
+  // === Real-time emulation ===
+  bool m_emulationMode;                //!< Run the pipelines on threads
+  uint32_t m_emulationEgressThreads;   //!< Egress threads in emulation mode
+  std::string m_emulationCpuAffinity;  //!< CPUs of the emulation threads
+
+  // === Digests ===
+  uint32_t m_digestBatchSize; //!< Samples per digest batch, 0 for bm transport
+  Time m_digestMaxDelay;      //!< Longest wait of a sample for its batch
+
+  // === Entry ageing ===
+  bool m_simulatedAgeing; //!< Age entries in simulator time
+  Time m_ageingTick;      //!< Resolution of the entry timeouts
+
   // === P4 configuration and initialization ===
   std::string m_jsonPath;         //!< Path to the P4 JSON configuration file.
   std::string m_flowTablePath;    //!< Path to the flow table file.
+  std::string m_restoreState;     //!< Checkpointed state to restore, if any
   P4CoreV1model *m_v1modelSwitch; //!< V1model switch core
   P4CorePipeline *m_p4Pipeline;   //!< P4 pipeline core
   P4CorePsa *m_psaSwitch;         //!< PSA switch core
@@ -237,12 +457,13 @@ private:
                          //!< (unit: pps)
 
   // === Network device information ===
-  uint32_t m_channelType;              //!< Channel type
-  Mac48Address m_address;              //!< MAC address of NetDevice
-  Ptr<Node> m_node;                    //!< Node that owns this NetDevice
-  Ptr<P4BridgeChannel> m_channel;      //!< Virtual bridge channel
-  std::vector<Ptr<NetDevice>> m_ports; //!< List of bridged ports
-  uint32_t m_ifIndex;                  //!< Interface index
+  uint32_t m_channelType;               //!< Channel type
+  Mac48Address m_address;               //!< MAC address of NetDevice
+  Ptr<Node> m_node;                     //!< Node that owns this NetDevice
+  Ptr<P4BridgeChannel> m_channel;       //!< Virtual bridge channel
+  std::vector<PortContext> m_ports;     //!< Bridged ports, by port number
+  std::vector<int32_t> m_portByIfIndex; //!< Port number by interface index
+  uint32_t m_ifIndex;                   //!< Interface index
   uint16_t m_mtu; //!< [Deprecated] MTU (maximum transmission unit) of NetDevice
 
   // === Callback function ===
@@ -250,6 +471,9 @@ private:
   NetDevice::PromiscReceiveCallback
       m_promiscRxCallback; //!< Promiscuous mode receive callback
   TracedCallback<uint32_t, const std::string &> m_switchEvent;
+  TracedCallback<const P4DigestBatch &> m_digestTrace; //!< Digest batches
+  TracedCallback<const P4ExpiredEntries &>
+      m_entriesExpiredTrace; //!< Idle table entries
 };
 
 } // namespace ns3
@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/mac48-address-table.h"
+
+#include "ns3/test.h"
+
+#include <list>
+#include <map>
+#include <random>
+
+namespace ns3 {
+
+/**
+ * @brief TestCase checking Mac48AddressTable against a reference LRU model
+ */
+class Mac48AddressTableTestCase : public TestCase
+{
+public:
+  Mac48AddressTableTestCase ();
+
+private:
+  virtual void DoRun () override;
+};
+
+Mac48AddressTableTestCase::Mac48AddressTableTestCase ()
+    : TestCase ("Mac48AddressTable interning and reclamation")
+{
+}
+
+void
+Mac48AddressTableTestCase::DoRun ()
+{
+  const uint32_t capacity = 64;
+  Mac48AddressTable table (capacity);
+  std::mt19937_64 rng (4242);
+
+  // reference model: address key -> index, and keys from least to most recently used
+  std::map<uint64_t, uint32_t> indices;
+  std::list<uint64_t> useOrder;
+
+  for (int round = 0; round < 20000; ++round)
+    {
+      uint64_t key = (rng () % (3 * capacity)) * 0x010203ULL;
+      uint8_t bytes[6];
+      for (int i = 0; i < 6; ++i)
+        {
+          bytes[i] = static_cast<uint8_t> (key >> (8 * (5 - i)));
+        }
+      Mac48Address address;
+      address.CopyFrom (bytes);
+
+      uint32_t index = table.Intern (address);
+      NS_TEST_ASSERT_MSG_LT (index, capacity, "Index out of range in round " << round);
+      NS_TEST_ASSERT_MSG_EQ (table.Get (index), address, "Address lost in round " << round);
+
+      auto it = indices.find (key);
+      if (it != indices.end ())
+        {
+          NS_TEST_ASSERT_MSG_EQ (index, it->second, "Index changed in round " << round);
+          useOrder.remove (key);
+        }
+      else
+        {
+          if (indices.size () == capacity)
+            {
+              uint64_t oldest = useOrder.front ();
+              useOrder.pop_front ();
+              NS_TEST_ASSERT_MSG_EQ (index, indices[oldest],
+                                     "Least recently used index not reclaimed in round " << round);
+              indices.erase (oldest);
+            }
+          indices[key] = index;
+        }
+      useOrder.push_back (key);
+      NS_TEST_ASSERT_MSG_EQ (table.GetSize (), indices.size (), "Size in round " << round);
+    }
+  NS_TEST_EXPECT_MSG_GT (table.GetReclaimed (), 0u, "Full table reclaimed entries");
+}
+
+/**
+ * @brief TestCase checking that Mac48AddressTable keeps referenced entries
+ */
+class Mac48AddressTableReferenceTestCase : public TestCase
+{
+public:
+  Mac48AddressTableReferenceTestCase ();
+
+private:
+  virtual void DoRun () override;
+};
+
+Mac48AddressTableReferenceTestCase::Mac48AddressTableReferenceTestCase ()
+    : TestCase ("Mac48AddressTable keeps addresses of packets in flight")
+{
+}
+
+void
+Mac48AddressTableReferenceTestCase::DoRun ()
+{
+  const uint32_t capacity = 8;
+  Mac48AddressTable table (capacity);
+  auto makeAddress = [] (uint32_t n) {
+    uint8_t bytes[6] = {0x02, 0, 0, 0, static_cast<uint8_t> (n >> 8), static_cast<uint8_t> (n)};
+    Mac48Address address;
+    address.CopyFrom (bytes);
+    return address;
+  };
+
+  // a packet holds the first address while many others pass through
+  Mac48Address held = makeAddress (0);
+  uint32_t heldIndex = table.Acquire (held);
+  NS_TEST_ASSERT_MSG_LT (heldIndex, capacity, "Index for the held address");
+  for (uint32_t n = 1; n < 20 * capacity; ++n)
+    {
+      uint32_t index = table.Intern (makeAddress (n));
+      NS_TEST_ASSERT_MSG_NE (index, heldIndex, "Held index reclaimed for address " << n);
+      NS_TEST_ASSERT_MSG_EQ (table.Get (heldIndex), held, "Held address lost at address " << n);
+    }
+  NS_TEST_EXPECT_MSG_EQ (table.GetReferences (heldIndex), 1u, "One reference");
+
+  // once released it is reclaimed like any other entry
+  table.Release (heldIndex);
+  NS_TEST_EXPECT_MSG_EQ (table.GetReferences (heldIndex), 0u, "No reference");
+  bool reclaimed = false;
+  for (uint32_t n = 1000; n < 1000 + capacity; ++n)
+    {
+      reclaimed = reclaimed || table.Intern (makeAddress (n)) == heldIndex;
+    }
+  NS_TEST_EXPECT_MSG_EQ (reclaimed, true, "Released index reclaimed");
+
+  // with every entry in flight a new address gets no index
+  Mac48AddressTable full (capacity);
+  for (uint32_t n = 0; n < capacity; ++n)
+    {
+      NS_TEST_ASSERT_MSG_LT (full.Acquire (makeAddress (n)), capacity, "Acquire " << n);
+    }
+  NS_TEST_EXPECT_MSG_EQ (full.Acquire (makeAddress (capacity)), Mac48AddressTable::FULL,
+                         "No index left");
+  uint32_t index = full.Intern (makeAddress (3));
+  full.AddReference (index);
+  full.Release (index);
+  full.Release (index);
+  NS_TEST_EXPECT_MSG_EQ (full.Intern (makeAddress (capacity)), index, "Released entry reused");
+}
+
+/**
+ * @brief TestSuite for mac48-address-table.h
+ */
+class Mac48AddressTableTestSuite : public TestSuite
+{
+public:
+  Mac48AddressTableTestSuite ();
+};
+
+Mac48AddressTableTestSuite::Mac48AddressTableTestSuite ()
+    : TestSuite ("mac48-address-table", UNIT)
+{
+  AddTestCase (new Mac48AddressTableTestCase, TestCase::QUICK);
+  AddTestCase (new Mac48AddressTableReferenceTestCase, TestCase::QUICK);
+}
+
+static Mac48AddressTableTestSuite mac48AddressTableTestSuite;
+
+} // namespace ns3
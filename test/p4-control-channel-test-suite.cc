@@ -0,0 +1,190 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/p4-control-channel.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Checks that the default channel applies and completes a request
+ * within Submit.
+ */
+class P4ControlChannelIdealTestCase : public TestCase
+{
+public:
+  P4ControlChannelIdealTestCase ();
+  virtual void DoRun (void);
+};
+
+P4ControlChannelIdealTestCase::P4ControlChannelIdealTestCase ()
+    : TestCase ("P4ControlChannel without delay is synchronous")
+{
+}
+
+void
+P4ControlChannelIdealTestCase::DoRun (void)
+{
+  Ptr<P4ControlChannel> channel = CreateObject<P4ControlChannel> ();
+  NS_TEST_ASSERT_MSG_EQ (channel->IsIdeal (), true, "Default channel is ideal");
+
+  bool applied = false;
+  int result = -1;
+  channel->Submit (
+      0,
+      [&applied] () {
+        applied = true;
+        return 7;
+      },
+      100, [&result] (int r) { result = r; });
+  NS_TEST_EXPECT_MSG_EQ (applied, true, "Applied within Submit");
+  NS_TEST_EXPECT_MSG_EQ (result, 7, "Completed within Submit");
+  NS_TEST_EXPECT_MSG_EQ (channel->GetOutstanding (0), 0u, "Nothing outstanding");
+  channel->Dispose ();
+}
+
+/**
+ * \brief Checks batching, serialization and delay timing, and ordering on a
+ * modeled channel.
+ */
+class P4ControlChannelBatchTestCase : public TestCase
+{
+public:
+  P4ControlChannelBatchTestCase ();
+  virtual void DoRun (void);
+};
+
+P4ControlChannelBatchTestCase::P4ControlChannelBatchTestCase ()
+    : TestCase ("P4ControlChannel batches and pipelines requests")
+{
+}
+
+void
+P4ControlChannelBatchTestCase::DoRun (void)
+{
+  // 8 Mbps: one byte per microsecond
+  Ptr<P4ControlChannel> channel = CreateObject<P4ControlChannel> ();
+  channel->SetAttribute ("Delay", TimeValue (MilliSeconds (1)));
+  channel->SetAttribute ("DataRate", DataRateValue (DataRate ("8Mbps")));
+  channel->SetAttribute ("MaxBatchSize", UintegerValue (4));
+  channel->SetAttribute ("BatchHeaderBytes", UintegerValue (64));
+
+  std::vector<int> applied;
+  std::vector<Time> appliedAt;
+  std::vector<int> completed;
+  std::vector<Time> completedAt;
+  Simulator::Schedule (Seconds (1), [&] () {
+    for (int i = 0; i < 10; i++)
+      {
+        channel->Submit (
+            0,
+            [&, i] () {
+              applied.push_back (i);
+              appliedAt.push_back (Simulator::Now ());
+              return i;
+            },
+            100,
+            [&] (int r) {
+              completed.push_back (r);
+              completedAt.push_back (Simulator::Now ());
+            });
+      }
+    NS_TEST_EXPECT_MSG_EQ (applied.size (), 0u, "Not applied within Submit");
+    NS_TEST_EXPECT_MSG_EQ (channel->GetOutstanding (0), 10u, "All outstanding");
+  });
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (completed.size (), 10u, "All requests completed");
+  NS_TEST_EXPECT_MSG_EQ (channel->GetBatchCount (0), 3u, "Three batches of at most four");
+  NS_TEST_EXPECT_MSG_EQ (channel->GetOutstanding (0), 0u, "Nothing outstanding");
+  for (int i = 0; i < 10; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (applied[i], i, "Applied in submission order");
+      NS_TEST_EXPECT_MSG_EQ (completed[i], i, "Completed in order with its result");
+    }
+
+  // batches of 464, 464 and 264 bytes leave back to back
+  Time start = Seconds (1);
+  NS_TEST_EXPECT_MSG_EQ (appliedAt[0], start + MicroSeconds (464 + 1000), "First batch");
+  NS_TEST_EXPECT_MSG_EQ (appliedAt[3], appliedAt[0], "A batch is applied in one event");
+  NS_TEST_EXPECT_MSG_EQ (appliedAt[4], start + MicroSeconds (928 + 1000), "Second batch");
+  NS_TEST_EXPECT_MSG_EQ (appliedAt[9], start + MicroSeconds (1192 + 1000), "Third batch");
+  NS_TEST_EXPECT_MSG_EQ (completedAt[9], appliedAt[9] + MilliSeconds (1), "Reply delay");
+
+  channel->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \brief Checks that no event of a disposed channel runs, whatever stage its
+ * batches are in.
+ */
+class P4ControlChannelDisposeTestCase : public TestCase
+{
+public:
+  P4ControlChannelDisposeTestCase ();
+  virtual void DoRun (void);
+};
+
+P4ControlChannelDisposeTestCase::P4ControlChannelDisposeTestCase ()
+    : TestCase ("P4ControlChannel drops pending batches on dispose")
+{
+}
+
+void
+P4ControlChannelDisposeTestCase::DoRun (void)
+{
+  Ptr<P4ControlChannel> channel = CreateObject<P4ControlChannel> ();
+  channel->SetAttribute ("Delay", TimeValue (MilliSeconds (1)));
+  channel->SetAttribute ("DataRate", DataRateValue (DataRate ("8Mbps")));
+  channel->SetAttribute ("MaxBatchSize", UintegerValue (1));
+
+  int applied = 0;
+  int completed = 0;
+  Simulator::Schedule (Seconds (1), [&] () {
+    for (int i = 0; i < 3; i++)
+      {
+        channel->Submit (
+            0,
+            [&] () {
+              applied++;
+              return 0;
+            },
+            100, [&] (int) { completed++; });
+      }
+  });
+  // the first batch is applied, its reply and the other batches are pending
+  Simulator::Schedule (Seconds (1) + MicroSeconds (164 + 1001), [&] () {
+    NS_TEST_EXPECT_MSG_EQ (applied, 1, "First batch applied");
+    channel->Dispose ();
+    channel = nullptr;
+  });
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (applied, 1, "No batch applied after dispose");
+  NS_TEST_EXPECT_MSG_EQ (completed, 0, "No reply delivered after dispose");
+  Simulator::Destroy ();
+}
+
+/**
+ * \brief P4ControlChannel test suite
+ */
+class P4ControlChannelTestSuite : public TestSuite
+{
+public:
+  P4ControlChannelTestSuite ();
+};
+
+P4ControlChannelTestSuite::P4ControlChannelTestSuite () : TestSuite ("p4-control-channel", UNIT)
+{
+  AddTestCase (new P4ControlChannelIdealTestCase, TestCase::QUICK);
+  AddTestCase (new P4ControlChannelBatchTestCase, TestCase::QUICK);
+  AddTestCase (new P4ControlChannelDisposeTestCase, TestCase::QUICK);
+}
+
+static P4ControlChannelTestSuite g_p4ControlChannelTestSuite;
@@ -305,6 +305,106 @@ void P4ControllerActionProfileTestCase::DoRun() {
   Simulator::Run();
   Simulator::Destroy();
 }
+/**
+ * @brief Checks that ApplyFlowTableDiff sees the current entries of a table
+ * after an entry was added and another deleted behind the controller's back,
+ * which leaves the entry count unchanged.
+ */
+class P4ControllerFlowTableDiffTestCase : public TestCase {
+public:
+  P4ControllerFlowTableDiffTestCase();
+
+private:
+  void DoRun() override;
+};
+
+P4ControllerFlowTableDiffTestCase::P4ControllerFlowTableDiffTestCase()
+    : TestCase("P4 controller flow table diff after add and delete") {}
+
+void P4ControllerFlowTableDiffTestCase::DoRun() {
+  std::string p4SrcDir = GetP4ExamplePath() + "/simple_v1model";
+
+  P4TopologyReaderHelper p4TopoHelper;
+  p4TopoHelper.SetFileName(p4SrcDir + "/topo.txt");
+  p4TopoHelper.SetFileType("CsmaTopo");
+  Ptr<P4TopologyReader> topoReader = p4TopoHelper.GetTopologyReader();
+  NodeContainer switchNode = topoReader->GetSwitchNodeContainer();
+
+  P4Helper p4Helper;
+  p4Helper.SetDeviceAttribute(
+      "JsonPath", StringValue(p4SrcDir + "/simple_v1model.json"));
+  p4Helper.SetDeviceAttribute("FlowTablePath",
+                              StringValue(p4SrcDir + "/flowtable_0.txt"));
+  p4Helper.SetDeviceAttribute("ChannelType", UintegerValue(0));
+  p4Helper.SetDeviceAttribute("P4SwitchArch", UintegerValue(0)); // v1model
+
+  NetDeviceContainer devs;
+  for (uint32_t j = 0; j < switchNode.Get(0)->GetNDevices(); ++j) {
+    devs.Add(switchNode.Get(0)->GetDevice(j));
+  }
+  Ptr<P4SwitchNetDevice> p4dev = DynamicCast<P4SwitchNetDevice>(
+      p4Helper.Install(switchNode.Get(0), devs).Get(0));
+  NS_TEST_ASSERT_MSG_NE(p4dev, nullptr, "The switch should be installed");
+
+  P4Controller controller;
+  controller.RegisterSwitch(p4dev);
+
+  Simulator::Schedule(Seconds(1.0), [this, &controller, p4dev]() {
+    P4CoreV1model *core = p4dev->GetV1ModelCore();
+    std::string table = "MyIngress.ipv4_nhop";
+
+    // The current content is the desired state, this reads the handles.
+    std::vector<P4FlowEntry> desired;
+    for (const auto &entry : core->GetFlowEntries(table)) {
+      P4FlowEntry flow;
+      flow.matchKey = entry.match_key;
+      flow.actionName = entry.action_fn->get_name();
+      flow.actionData = entry.action_data;
+      desired.push_back(flow);
+    }
+    NS_TEST_ASSERT_MSG_EQ(desired.size(), 2, "The flow table file has two");
+
+    P4FlowTableDiffStats stats;
+    auto done = [&stats](const P4FlowTableDiffStats &result) {
+      stats = result;
+    };
+    NS_TEST_ASSERT_MSG_EQ(
+        controller.ApplyFlowTableDiff(0, table, desired, done), 0, "Applied");
+    NS_TEST_EXPECT_MSG_EQ(stats.unchanged, 2, "Nothing to change");
+
+    // Add an entry and delete the second one directly on the core.
+    std::vector<bm::MatchKeyParam> match = {bm::MatchKeyParam(
+        bm::MatchKeyParam::Type::EXACT, std::string("\x0a\x01\x01\x05", 4))};
+    bm::entry_handle_t added;
+    NS_TEST_ASSERT_MSG_EQ(core->AddFlowEntry(table, match, "MyIngress.drop",
+                                             bm::ActionData(), &added),
+                          0, "Entry added");
+    bm::MatchTable::Entry second;
+    NS_TEST_ASSERT_MSG_EQ(
+        core->FindEntryFromKey(table, desired[1].matchKey, &second), 1,
+        "Second entry found");
+    NS_TEST_ASSERT_MSG_EQ(core->DeleteFlowEntry(table, second.handle), 0,
+                          "Second entry deleted");
+    NS_TEST_ASSERT_MSG_EQ(core->GetNumEntries(table), 2,
+                          "The count is unchanged");
+
+    // Only the first entry is desired: the added one must go, and the
+    // deleted one must not be deleted again.
+    desired.pop_back();
+    NS_TEST_ASSERT_MSG_EQ(
+        controller.ApplyFlowTableDiff(0, table, desired, done), 0, "Applied");
+    NS_TEST_EXPECT_MSG_EQ(stats.deleted, 1, "The added entry is deleted");
+    NS_TEST_EXPECT_MSG_EQ(stats.unchanged, 1, "The first entry is kept");
+    NS_TEST_EXPECT_MSG_EQ(stats.failed, 0, "No stale handle is used");
+    NS_TEST_EXPECT_MSG_EQ(core->HasEntry(table, added), false,
+                          "The added entry is gone");
+    NS_TEST_EXPECT_MSG_EQ(core->GetNumEntries(table), 1, "One entry left");
+  });
+  Simulator::Stop(Seconds(2.0));
+  Simulator::Run();
+  Simulator::Destroy();
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -315,5 +415,6 @@ public:
     // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
     AddTestCase(new P4ControllerCheckFlowEntryTestCase, TestCase::QUICK);
     AddTestCase(new P4ControllerActionProfileTestCase, TestCase::QUICK);
+    AddTestCase(new P4ControllerFlowTableDiffTestCase, TestCase::QUICK);
   };
 } g_P4ControllerTestSuite;
@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/custom-p2p-net-device.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/node.h"
+#include "ns3/p4-event-profiler.h"
+#include "ns3/p4-p2p-channel.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Checks that the event profiler attributes the transmit and delivery
+ * events of one packet sent over a P4P2PChannel to the right nodes.
+ */
+class P4EventProfilerTestCase : public TestCase
+{
+public:
+  P4EventProfilerTestCase ();
+  virtual void DoRun (void);
+
+private:
+  void SendOnePacket (Ptr<CustomP2PNetDevice> device);
+};
+
+P4EventProfilerTestCase::P4EventProfilerTestCase () : TestCase ("P4EventProfiler counts")
+{
+}
+
+void
+P4EventProfilerTestCase::SendOnePacket (Ptr<CustomP2PNetDevice> device)
+{
+  device->Send (Create<Packet> (100), device->GetBroadcast (), 0x800);
+}
+
+void
+P4EventProfilerTestCase::DoRun (void)
+{
+  Ptr<Node> a = CreateObject<Node> ();
+  Ptr<Node> b = CreateObject<Node> ();
+  Ptr<CustomP2PNetDevice> devA = CreateObject<CustomP2PNetDevice> ();
+  Ptr<CustomP2PNetDevice> devB = CreateObject<CustomP2PNetDevice> ();
+  Ptr<P4P2PChannel> channel = CreateObject<P4P2PChannel> ();
+
+  devA->Attach (channel);
+  devA->SetAddress (Mac48Address::Allocate ());
+  devA->SetQueue (CreateObject<DropTailQueue<Packet>> ());
+  devB->Attach (channel);
+  devB->SetAddress (Mac48Address::Allocate ());
+  devB->SetQueue (CreateObject<DropTailQueue<Packet>> ());
+  a->AddDevice (devA);
+  b->AddDevice (devB);
+
+  // disabled: nothing is recorded
+  Simulator::Schedule (Seconds (1.0), &P4EventProfilerTestCase::SendOnePacket, this, devA);
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (P4EventProfiler::GetTotal (P4EventProfiler::DEVICE_TRANSMIT).scheduled,
+                         0u, "Disabled profiler must not count");
+
+  P4EventProfiler::Enable ();
+  Simulator::Schedule (Seconds (1.0), &P4EventProfilerTestCase::SendOnePacket, this, devA);
+  Simulator::Run ();
+
+  P4EventProfiler::Counters tx =
+      P4EventProfiler::Get (P4EventProfiler::DEVICE_TRANSMIT, a->GetId ());
+  NS_TEST_EXPECT_MSG_EQ (tx.scheduled, 1u, "One transmit-complete event scheduled on the sender");
+  NS_TEST_EXPECT_MSG_EQ (tx.executed, 1u, "One transmit-complete event executed on the sender");
+
+  P4EventProfiler::Counters rx =
+      P4EventProfiler::Get (P4EventProfiler::CHANNEL_DELIVERY, b->GetId ());
+  NS_TEST_EXPECT_MSG_EQ (rx.scheduled, 1u, "One delivery event scheduled for the receiver");
+  NS_TEST_EXPECT_MSG_EQ (rx.executed, 1u, "One delivery event executed on the receiver");
+  NS_TEST_EXPECT_MSG_EQ (
+      P4EventProfiler::Get (P4EventProfiler::CHANNEL_DELIVERY, a->GetId ()).executed, 0u,
+      "No delivery to the sender");
+
+  std::ostringstream report;
+  P4EventProfiler::Print (report);
+  NS_TEST_EXPECT_MSG_NE (report.str ().find ("channel-delivery"), std::string::npos,
+                         "Report lists the delivery origin");
+
+  P4EventProfiler::Disable ();
+  P4EventProfiler::Reset ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \brief Checks that hooks running on several threads at once lose no count.
+ */
+class P4EventProfilerThreadTestCase : public TestCase
+{
+public:
+  P4EventProfilerThreadTestCase ();
+  virtual void DoRun (void);
+};
+
+P4EventProfilerThreadTestCase::P4EventProfilerThreadTestCase ()
+    : TestCase ("P4EventProfiler counts from several threads")
+{
+}
+
+void
+P4EventProfilerThreadTestCase::DoRun (void)
+{
+  const uint32_t threads = 4;
+  const uint32_t events = 10000;
+
+  P4EventProfiler::Enable ();
+  std::vector<std::thread> workers;
+  for (uint32_t t = 0; t < threads; t++)
+    {
+      workers.emplace_back ([t, events] () {
+        for (uint32_t i = 0; i < events; i++)
+          {
+            // a new node per thread and a shared one, both touch the map
+            P4EventProfiler::RecordScheduled (P4EventProfiler::EGRESS_TIMER, 100 + t);
+            P4EventProfiler::Scope profile (P4EventProfiler::EGRESS_TIMER, 1);
+          }
+      });
+    }
+  for (auto &worker : workers)
+    {
+      worker.join ();
+    }
+
+  P4EventProfiler::Counters total = P4EventProfiler::GetTotal (P4EventProfiler::EGRESS_TIMER);
+  NS_TEST_EXPECT_MSG_EQ (total.scheduled, threads * events, "Every scheduled event is counted");
+  NS_TEST_EXPECT_MSG_EQ (total.executed, threads * events, "Every executed event is counted");
+  NS_TEST_EXPECT_MSG_EQ (P4EventProfiler::Get (P4EventProfiler::EGRESS_TIMER, 1).executed,
+                         threads * events, "Executions of all threads land on the shared node");
+
+  P4EventProfiler::Disable ();
+  P4EventProfiler::Reset ();
+}
+
+/**
+ * \brief TestSuite for P4EventProfiler
+ */
+class P4EventProfilerTestSuite : public TestSuite
+{
+public:
+  P4EventProfilerTestSuite ();
+};
+
+P4EventProfilerTestSuite::P4EventProfilerTestSuite () : TestSuite ("p4-event-profiler", UNIT)
+{
+  AddTestCase (new P4EventProfilerTestCase, TestCase::QUICK);
+  AddTestCase (new P4EventProfilerThreadTestCase, TestCase::QUICK);
+}
+
+static P4EventProfilerTestSuite g_p4EventProfilerTestSuite;
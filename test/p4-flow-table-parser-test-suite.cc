@@ -0,0 +1,202 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/format-utils.h"
+#include "ns3/p4-flow-table-parser.h"
+#include "ns3/test.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace ns3;
+
+/**
+ * \brief Checks the conversion of CLI values to field bytes.
+ */
+class P4FlowTableParserValueTestCase : public TestCase
+{
+public:
+  P4FlowTableParserValueTestCase ();
+  virtual void DoRun (void);
+};
+
+P4FlowTableParserValueTestCase::P4FlowTableParserValueTestCase ()
+    : TestCase ("P4FlowTableParser converts values to field bytes")
+{
+}
+
+void
+P4FlowTableParserValueTestCase::DoRun (void)
+{
+  std::string bytes;
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("10.1.1.2", 32, &bytes), true, "IPv4");
+  NS_TEST_EXPECT_MSG_EQ (bytes, std::string ("\x0a\x01\x01\x02", 4), "IPv4 bytes");
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("00:00:00:00:0a:FF", 48, &bytes), true,
+                         "MAC");
+  NS_TEST_EXPECT_MSG_EQ (bytes, std::string ("\0\0\0\0\x0a\xff", 6), "MAC bytes");
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("0x0a010101", 32, &bytes), true, "Hex");
+  NS_TEST_EXPECT_MSG_EQ (bytes, std::string ("\x0a\x01\x01\x01", 4), "Hex bytes");
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("511", 9, &bytes), true, "Decimal");
+  NS_TEST_EXPECT_MSG_EQ (bytes, std::string ("\x01\xff", 2), "Decimal bytes");
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("0", 9, &bytes), true, "Zero");
+  NS_TEST_EXPECT_MSG_EQ (bytes, std::string ("\0\0", 2), "Zero is padded");
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("340282366920938463463374607431768211455",
+                                                        128, &bytes),
+                         true, "128-bit decimal");
+  NS_TEST_EXPECT_MSG_EQ (bytes, std::string (16, '\xff'), "128-bit bytes");
+
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("512", 9, &bytes), false, "Too wide");
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("0x1ff", 8, &bytes), false, "Too wide");
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("10.1.1.256", 32, &bytes), false,
+                         "Bad octet");
+  NS_TEST_EXPECT_MSG_EQ (P4FlowTableParser::ParseValue ("12a", 16, &bytes), false, "Bad digit");
+}
+
+/**
+ * \brief Checks table_add commands against a small program.
+ */
+class P4FlowTableParserCommandTestCase : public TestCase
+{
+public:
+  P4FlowTableParserCommandTestCase ();
+  virtual void DoRun (void);
+};
+
+P4FlowTableParserCommandTestCase::P4FlowTableParserCommandTestCase ()
+    : TestCase ("P4FlowTableParser reads table_add commands")
+{
+}
+
+void
+P4FlowTableParserCommandTestCase::DoRun (void)
+{
+  std::string config = R"({
+    "header_types": [
+      {"name": "ipv4_t", "fields": [["dstAddr", 32, false], ["ttl", 8, false]]},
+      {"name": "ethernet_t", "fields": [["dstAddr", 48, false]]}
+    ],
+    "headers": [
+      {"name": "ipv4", "header_type": "ipv4_t"},
+      {"name": "ethernet", "header_type": "ethernet_t"}
+    ],
+    "pipelines": [{"name": "ingress", "tables": [
+      {"name": "MyIngress.routes",
+       "key": [{"match_type": "lpm", "target": ["ipv4", "dstAddr"]}]},
+      {"name": "MyIngress.acl",
+       "key": [{"match_type": "ternary", "target": ["ethernet", "dstAddr"]},
+               {"match_type": "range", "target": ["ipv4", "ttl"]}]}
+    ]}],
+    "actions": [
+      {"name": "MyIngress.forward", "runtime_data": [{"name": "port", "bitwidth": 9}]},
+      {"name": "MyIngress.drop", "runtime_data": []},
+      {"name": "MyEgress.drop", "runtime_data": []}
+    ]
+  })";
+
+  P4FlowTableParser parser;
+  NS_TEST_ASSERT_MSG_EQ (parser.LoadConfig (config), true, "Program read");
+
+  std::vector<P4ParsedTableEntry> entries;
+  std::string text = "table_set_default routes MyIngress.drop\n"
+                     "\n"
+                     "table_add routes forward 10.0.0.0/8 => 3\n"
+                     "table_add acl MyIngress.drop 00:00:00:00:00:01&&&ff:ff:ff:ff:ff:ff 1->64 "
+                     "=> 10\n";
+  NS_TEST_ASSERT_MSG_EQ (parser.ParseText (text, &entries), true, parser.GetError ());
+  NS_TEST_ASSERT_MSG_EQ (entries.size (), 2u, "Two table_add commands");
+
+  const P4ParsedTableEntry &route = entries[0];
+  NS_TEST_EXPECT_MSG_EQ (route.table, "MyIngress.routes", "Short table name resolved");
+  NS_TEST_EXPECT_MSG_EQ (route.action, "MyIngress.forward", "Short action name resolved");
+  NS_TEST_ASSERT_MSG_EQ (route.match.size (), 1u, "One match field");
+  NS_TEST_EXPECT_MSG_EQ (route.match[0].type, P4ParsedMatchField::LPM, "LPM");
+  NS_TEST_EXPECT_MSG_EQ (route.match[0].key, std::string ("\x0a\0\0\0", 4), "Prefix");
+  NS_TEST_EXPECT_MSG_EQ (route.match[0].prefixLength, 8, "Prefix length");
+  NS_TEST_ASSERT_MSG_EQ (route.params.size (), 1u, "One parameter");
+  NS_TEST_EXPECT_MSG_EQ (route.params[0], std::string ("\0\x03", 2), "9-bit port");
+  NS_TEST_EXPECT_MSG_EQ (route.priority, -1, "No priority");
+
+  const P4ParsedTableEntry &acl = entries[1];
+  NS_TEST_EXPECT_MSG_EQ (acl.action, "MyIngress.drop", "Full action name");
+  NS_TEST_ASSERT_MSG_EQ (acl.match.size (), 2u, "Two match fields");
+  NS_TEST_EXPECT_MSG_EQ (acl.match[0].type, P4ParsedMatchField::TERNARY, "Ternary");
+  NS_TEST_EXPECT_MSG_EQ (acl.match[0].mask, std::string (6, '\xff'), "Mask");
+  NS_TEST_EXPECT_MSG_EQ (acl.match[1].type, P4ParsedMatchField::RANGE, "Range");
+  NS_TEST_EXPECT_MSG_EQ (acl.match[1].key, std::string ("\x01", 1), "Range start");
+  NS_TEST_EXPECT_MSG_EQ (acl.match[1].mask, std::string ("\x40", 1), "Range end");
+  NS_TEST_EXPECT_MSG_EQ (acl.params.size (), 0u, "No parameters");
+  NS_TEST_EXPECT_MSG_EQ (acl.priority, 10, "Priority");
+
+  // errors name the line
+  P4ParsedTableEntry entry;
+  NS_TEST_EXPECT_MSG_EQ (parser.ParseLine ("table_add routes drop 10.0.0.0/8 =>", &entry), -1,
+                         "Ambiguous action");
+  NS_TEST_EXPECT_MSG_EQ (parser.ParseLine ("table_add routes forward 10.0.0.0/33 => 1", &entry),
+                         -1, "Prefix too long");
+  NS_TEST_EXPECT_MSG_EQ (parser.ParseLine ("table_add routes forward 10.0.0.0/8 =>", &entry), -1,
+                         "Missing parameter");
+  NS_TEST_EXPECT_MSG_EQ (parser.ParseLine ("table_add acl MyIngress.drop 1 =>", &entry), -1,
+                         "Missing match field");
+  entries.clear ();
+  NS_TEST_EXPECT_MSG_EQ (parser.ParseText ("\ntable_add nat forward 1 => 1\n", &entries), false,
+                         "Unknown table");
+  NS_TEST_EXPECT_MSG_EQ (parser.GetError (), "line 2: unknown table nat", "Error message");
+}
+
+/**
+ * \brief Checks a flow table file of the test programs.
+ */
+class P4FlowTableParserFileTestCase : public TestCase
+{
+public:
+  P4FlowTableParserFileTestCase ();
+  virtual void DoRun (void);
+};
+
+P4FlowTableParserFileTestCase::P4FlowTableParserFileTestCase ()
+    : TestCase ("P4FlowTableParser reads a flow table file")
+{
+}
+
+void
+P4FlowTableParserFileTestCase::DoRun (void)
+{
+  std::string dir = GetP4TestPath () + "/simple_v1model";
+  std::ifstream json (dir + "/simple_v1model.json");
+  std::ostringstream config;
+  config << json.rdbuf ();
+
+  P4FlowTableParser parser;
+  NS_TEST_ASSERT_MSG_EQ (parser.LoadConfig (config.str ()), true, "Program read");
+  std::vector<P4ParsedTableEntry> entries;
+  NS_TEST_ASSERT_MSG_EQ (parser.ParseFile (dir + "/flowtable_0.txt", &entries), true,
+                         parser.GetError ());
+  NS_TEST_ASSERT_MSG_EQ (entries.empty (), false, "Entries read");
+  for (const P4ParsedTableEntry &entry : entries)
+    {
+      NS_TEST_EXPECT_MSG_EQ ((entry.table == "MyIngress.ipv4_nhop" ||
+                              entry.table == "MyIngress.arp_simple"),
+                             true, "Known table");
+      NS_TEST_EXPECT_MSG_EQ (entry.match.size (), 1u, "One exact key");
+      NS_TEST_EXPECT_MSG_EQ (entry.match[0].key.size (), 4u, "IPv4 key");
+    }
+  NS_TEST_EXPECT_MSG_EQ (entries[0].action, "MyIngress.ipv4_forward", "Action");
+  NS_TEST_EXPECT_MSG_EQ (entries[0].params[0], std::string ("\0\0\0\0\0\x01", 6), "MAC");
+}
+
+/**
+ * \brief TestSuite for the flow table file parser
+ */
+class P4FlowTableParserTestSuite : public TestSuite
+{
+public:
+  P4FlowTableParserTestSuite ();
+};
+
+P4FlowTableParserTestSuite::P4FlowTableParserTestSuite () : TestSuite ("p4-flow-table-parser", UNIT)
+{
+  AddTestCase (new P4FlowTableParserValueTestCase, TestCase::QUICK);
+  AddTestCase (new P4FlowTableParserCommandTestCase, TestCase::QUICK);
+  AddTestCase (new P4FlowTableParserFileTestCase, TestCase::QUICK);
+}
+
+static P4FlowTableParserTestSuite g_p4FlowTableParserTestSuite;
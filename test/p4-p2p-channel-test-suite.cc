@@ -24,8 +24,13 @@
 #include "ns3/custom-p2p-net-device.h"
 #include "ns3/p4-p2p-channel.h"
 #include "ns3/net-device-queue-interface.h"
+#include "ns3/p4-event-profiler.h"
+#include "ns3/uinteger.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/udp-header.h"
 
 #include <string>
+#include <vector>
 
 using namespace ns3;
 
@@ -131,6 +136,687 @@ PointToPointTest::DoRun (void)
   Simulator::Destroy ();
 }
 
+/**
+ * \brief Base class of the tests running over one P4P2PChannel
+ *
+ * It builds a link of two CustomP2PNetDevice on two nodes, sends packets from
+ * the first device and records the packets handed up by the second one.
+ */
+class P4P2PLinkTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Create the test
+   *
+   * \param name Name of the test.
+   */
+  explicit P4P2PLinkTestCase (std::string name);
+
+protected:
+  /**
+   * \brief Build the link and clear the recorded packets
+   *
+   * Attributes of the devices and of the channel can be set afterwards, they
+   * are only read once the simulation runs.
+   */
+  void BuildLink (void);
+  /**
+   * \brief Destroy the simulation and release the link
+   */
+  void DestroyLink (void);
+  /**
+   * \brief Schedule the send of a packet by the first device
+   *
+   * \param at Time of the send.
+   * \param packet The packet to send.
+   * \param dest Destination address, broadcast if not set.
+   */
+  void SendAt (Time at, Ptr<Packet> packet, Address dest = Address ());
+  /**
+   * \brief Callback recording the packets handed up by a device
+   *
+   * \param dev The receiving device.
+   * \param pkt The received packet.
+   * \param protocol The protocol of the packet.
+   * \param sender The sender address.
+   *
+   * \return Always true.
+   */
+  bool RxPacket (Ptr<NetDevice> dev, Ptr<const Packet> pkt, uint16_t protocol,
+                 const Address &sender);
+
+  /**
+   * \brief Create a packet whose payload byte i is i modulo 256
+   *
+   * \param size Size of the payload.
+   * \return The packet.
+   */
+  static Ptr<Packet> MakePacket (uint32_t size);
+  /**
+   * \brief Get the bytes of a packet
+   *
+   * \param p The packet.
+   * \return The bytes of the packet.
+   */
+  static std::vector<uint8_t> GetBytes (Ptr<const Packet> p);
+
+  Ptr<CustomP2PNetDevice> m_devA; //!< sending device
+  Ptr<CustomP2PNetDevice> m_devB; //!< receiving device
+  Ptr<P4P2PChannel> m_channel; //!< channel between the two devices
+  std::vector<const Packet *> m_sent; //!< packets given to the sending device
+  std::vector<Ptr<const Packet>> m_received; //!< packets handed up by the receiver
+  std::vector<Time> m_arrivals; //!< arrival time of every received packet
+
+private:
+  /**
+   * \brief Send a packet from the first device
+   *
+   * \param packet The packet to send.
+   * \param dest Destination address, broadcast if not set.
+   */
+  void Send (Ptr<Packet> packet, Address dest);
+};
+
+P4P2PLinkTestCase::P4P2PLinkTestCase (std::string name) : TestCase (name)
+{
+}
+
+void
+P4P2PLinkTestCase::BuildLink (void)
+{
+  Ptr<Node> a = CreateObject<Node> ();
+  Ptr<Node> b = CreateObject<Node> ();
+  m_devA = CreateObject<CustomP2PNetDevice> ();
+  m_devB = CreateObject<CustomP2PNetDevice> ();
+  m_channel = CreateObject<P4P2PChannel> ();
+
+  m_devA->Attach (m_channel);
+  m_devA->SetAddress (Mac48Address::Allocate ());
+  m_devA->SetQueue (CreateObject<DropTailQueue<Packet>> ());
+  m_devB->Attach (m_channel);
+  m_devB->SetAddress (Mac48Address::Allocate ());
+  m_devB->SetQueue (CreateObject<DropTailQueue<Packet>> ());
+  a->AddDevice (m_devA);
+  b->AddDevice (m_devB);
+  m_devB->SetReceiveCallback (MakeCallback (&P4P2PLinkTestCase::RxPacket, this));
+
+  m_sent.clear ();
+  m_received.clear ();
+  m_arrivals.clear ();
+}
+
+void
+P4P2PLinkTestCase::DestroyLink (void)
+{
+  Simulator::Destroy ();
+  m_devA = nullptr;
+  m_devB = nullptr;
+  m_channel = nullptr;
+}
+
+void
+P4P2PLinkTestCase::SendAt (Time at, Ptr<Packet> packet, Address dest)
+{
+  Simulator::Schedule (at, &P4P2PLinkTestCase::Send, this, packet, dest);
+}
+
+void
+P4P2PLinkTestCase::Send (Ptr<Packet> packet, Address dest)
+{
+  m_sent.push_back (PeekPointer (packet));
+  m_devA->Send (packet, dest.IsInvalid () ? m_devA->GetBroadcast () : dest, 0x800);
+}
+
+bool
+P4P2PLinkTestCase::RxPacket (Ptr<NetDevice> dev, Ptr<const Packet> pkt, uint16_t protocol,
+                             const Address &sender)
+{
+  m_received.push_back (pkt);
+  m_arrivals.push_back (Simulator::Now ());
+  return true;
+}
+
+Ptr<Packet>
+P4P2PLinkTestCase::MakePacket (uint32_t size)
+{
+  std::vector<uint8_t> payload (size);
+  for (uint32_t i = 0; i < size; i++)
+    {
+      payload[i] = static_cast<uint8_t> (i);
+    }
+  return Create<Packet> (payload.data (), size);
+}
+
+std::vector<uint8_t>
+P4P2PLinkTestCase::GetBytes (Ptr<const Packet> p)
+{
+  std::vector<uint8_t> bytes (p->GetSize ());
+  p->CopyData (bytes.data (), bytes.size ());
+  return bytes;
+}
+
+/**
+ * \brief Checks the custom header splicing of CustomP2PNetDevice
+ *
+ * An IPv4/UDP packet is sent with a layer 3 custom header, once in front of
+ * and once behind the IPv4 header. The frame on the wire must carry the custom
+ * header at that offset, and the receiver must get the original bytes back.
+ */
+class CustomHeaderSpliceTest : public P4P2PLinkTestCase
+{
+public:
+  CustomHeaderSpliceTest ();
+  virtual void DoRun (void);
+
+private:
+  void RunCase (HeaderLayerOperator op);
+  void PhyRx (Ptr<const Packet> pkt);
+
+  std::vector<uint8_t> m_wire; //!< bytes seen on the wire
+};
+
+CustomHeaderSpliceTest::CustomHeaderSpliceTest () : P4P2PLinkTestCase ("CustomHeader splicing")
+{
+}
+
+void
+CustomHeaderSpliceTest::PhyRx (Ptr<const Packet> pkt)
+{
+  m_wire = GetBytes (pkt);
+}
+
+void
+CustomHeaderSpliceTest::RunCase (HeaderLayerOperator op)
+{
+  BuildLink ();
+
+  // the first field carries the protocol that follows the custom header
+  uint64_t next = (op == HeaderLayerOperator::ADD_BEFORE) ? 0x0800 : 0x11;
+  CustomHeader header;
+  header.SetLayer (HeaderLayer::LAYER_3);
+  header.SetOperator (op);
+  header.AddField ("proto", 16);
+  header.AddField ("tag", 8);
+  header.SetField ("proto", next);
+  header.SetField ("tag", 0x5A);
+  m_devA->SetCustomHeader (header);
+  m_devB->SetCustomHeader (header);
+  m_devB->TraceConnectWithoutContext ("PhyRxEnd",
+                                      MakeCallback (&CustomHeaderSpliceTest::PhyRx, this));
+
+  Ptr<Packet> p = Create<Packet> (64);
+  UdpHeader udp;
+  udp.SetSourcePort (1000);
+  udp.SetDestinationPort (10500); // inside the default custom port range
+  p->AddHeader (udp);
+  Ipv4Header ip;
+  ip.SetSource (Ipv4Address ("10.1.1.1"));
+  ip.SetDestination (Ipv4Address ("10.1.1.2"));
+  ip.SetProtocol (0x11);
+  ip.SetPayloadSize (p->GetSize ());
+  p->AddHeader (ip);
+  std::vector<uint8_t> original = GetBytes (p);
+
+  // the header chain is parsed without touching the packet
+  NS_TEST_EXPECT_MSG_EQ (m_devA->GetDstPort (p), 10500, "Destination port");
+  NS_TEST_EXPECT_MSG_EQ ((GetBytes (p) == original), true, "Parsing must not modify the packet");
+
+  m_wire.clear ();
+  SendAt (Seconds (1.0), p);
+  Simulator::Run ();
+
+  // on the wire: [ethernet] + original bytes with 3 custom header bytes at the offset
+  uint32_t offset = (op == HeaderLayerOperator::ADD_BEFORE) ? 14 : 34;
+  NS_TEST_ASSERT_MSG_EQ (m_wire.size (), original.size () + 14 + 3, "Wire frame size");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_wire[offset], (uint32_t) (next >> 8), "Custom header");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_wire[offset + 1], (uint32_t) (next & 0xff), "Custom header");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_wire[offset + 2], 0x5Au, "Custom header");
+
+  std::vector<uint8_t> expected = original;
+  if (op == HeaderLayerOperator::ADD_AFTER)
+    {
+      // the IPv4 protocol announces the custom header and is not restored
+      expected[9] = 0xDC;
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_wire[14 + 9], 0xDCu, "IPv4 protocol on the wire");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 1u, "Packet received");
+  std::vector<uint8_t> rx = GetBytes (m_received[0]);
+  NS_TEST_ASSERT_MSG_EQ (rx.size (), expected.size (), "Received size");
+  NS_TEST_EXPECT_MSG_EQ ((rx == expected), true, "Received bytes");
+
+  DestroyLink ();
+}
+
+void
+CustomHeaderSpliceTest::DoRun (void)
+{
+  RunCase (HeaderLayerOperator::ADD_BEFORE);
+  RunCase (HeaderLayerOperator::ADD_AFTER);
+}
+
+/**
+ * \brief Checks that packet trains keep the per-packet arrival times
+ *
+ * A burst of packets is sent once without and once with trains. Both runs must
+ * deliver the packets at the same times, and the train run must need fewer
+ * transmit-complete events. The same must hold when a background flow starts
+ * in the middle of a train, and when the queue is full while a train is sent.
+ */
+class PacketTrainTest : public P4P2PLinkTestCase
+{
+public:
+  PacketTrainTest ();
+  virtual void DoRun (void);
+
+private:
+  std::vector<Time> RunBurst (uint32_t trainLength, uint64_t *txEvents);
+  std::vector<Time> RunLoadChange (uint32_t trainLength);
+  std::vector<Time> RunFullQueue (uint32_t trainLength);
+};
+
+PacketTrainTest::PacketTrainTest () : P4P2PLinkTestCase ("Packet trains")
+{
+}
+
+std::vector<Time>
+PacketTrainTest::RunBurst (uint32_t trainLength, uint64_t *txEvents)
+{
+  BuildLink ();
+  m_channel->SetAttribute ("Delay", TimeValue (MilliSeconds (1)));
+  m_devA->SetAttribute ("DataRate", DataRateValue (DataRate ("1Mbps")));
+  m_devA->SetAttribute ("InterframeGap", TimeValue (MicroSeconds (3)));
+  m_devA->SetAttribute ("TrainLength", UintegerValue (trainLength));
+
+  // 8 packets of different sizes at once: 1 goes out alone, 7 wait in the queue
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      SendAt (Seconds (1.0), Create<Packet> (100 + 50 * i));
+    }
+
+  P4EventProfiler::Enable ();
+  Simulator::Run ();
+  *txEvents = P4EventProfiler::GetTotal (P4EventProfiler::DEVICE_TRANSMIT).executed;
+  P4EventProfiler::Disable ();
+  P4EventProfiler::Reset ();
+  DestroyLink ();
+  return m_arrivals;
+}
+
+std::vector<Time>
+PacketTrainTest::RunLoadChange (uint32_t trainLength)
+{
+  BuildLink ();
+  m_devA->SetAttribute ("DataRate", DataRateValue (DataRate ("1Mbps")));
+  m_devA->SetAttribute ("InterframeGap", TimeValue (MicroSeconds (3)));
+  m_devA->SetAttribute ("TrainLength", UintegerValue (trainLength));
+  // starts while the fourth packet is sent, stops before the last one
+  m_devA->AddBackgroundFlow (DataRate ("500kbps"), 1000, Seconds (1.004), Seconds (1.010));
+
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      SendAt (Seconds (1.0), Create<Packet> (100 + 50 * i));
+    }
+  Simulator::Run ();
+  DestroyLink ();
+  return m_arrivals;
+}
+
+std::vector<Time>
+PacketTrainTest::RunFullQueue (uint32_t trainLength)
+{
+  BuildLink ();
+  m_devA->SetAttribute ("DataRate", DataRateValue (DataRate ("1Mbps")));
+  m_devA->SetAttribute ("InterframeGap", TimeValue (MicroSeconds (3)));
+  m_devA->SetAttribute ("TrainLength", UintegerValue (trainLength));
+  m_devA->GetQueue ()->SetAttribute ("MaxSize", QueueSizeValue (QueueSize ("4p")));
+
+  // 1 packet goes out alone and fills no place, 4 fill the queue
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      SendAt (Seconds (1.0), Create<Packet> (100 + 50 * i));
+    }
+  // the second packet has started, so one of these fits and one is dropped
+  SendAt (Seconds (1.0009), Create<Packet> (100));
+  SendAt (Seconds (1.0009), Create<Packet> (100));
+  Simulator::Run ();
+  DestroyLink ();
+  return m_arrivals;
+}
+
+void
+PacketTrainTest::DoRun (void)
+{
+  uint64_t singleEvents = 0;
+  uint64_t trainEvents = 0;
+  std::vector<Time> single = RunBurst (1, &singleEvents);
+  std::vector<Time> train = RunBurst (4, &trainEvents);
+
+  NS_TEST_ASSERT_MSG_EQ (single.size (), 8u, "All packets received without trains");
+  NS_TEST_ASSERT_MSG_EQ (train.size (), 8u, "All packets received with trains");
+  for (size_t i = 0; i < single.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (train[i], single[i], "Arrival time of packet " << i);
+    }
+
+  NS_TEST_EXPECT_MSG_EQ (singleEvents, 8u, "One transmit-complete event per packet");
+  // the first packet alone, then trains of 4 and 3
+  NS_TEST_EXPECT_MSG_EQ (trainEvents, 3u, "One transmit-complete event per train");
+
+  single = RunLoadChange (1);
+  train = RunLoadChange (4);
+  NS_TEST_ASSERT_MSG_EQ (train.size (), single.size (), "All packets received with a load change");
+  for (size_t i = 0; i < single.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (train[i], single[i], "Arrival time with a load change, packet " << i);
+    }
+
+  single = RunFullQueue (1);
+  train = RunFullQueue (4);
+  NS_TEST_ASSERT_MSG_EQ (single.size (), 6u, "One packet dropped by the full queue");
+  NS_TEST_ASSERT_MSG_EQ (train.size (), 6u, "Same drop with trains");
+  for (size_t i = 0; i < single.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (train[i], single[i], "Arrival time with a full queue, packet " << i);
+    }
+}
+
+/**
+ * \brief Checks the copy-free packet handover of P4P2PChannel
+ *
+ * Packets are sent without trace sinks, where the channel must hand the
+ * sender's packet objects over without a copy, and with a PhyTxEnd sink
+ * keeping the sent packets, where the receiver must get copies. Both are run
+ * once with single packets and once with trains. The receiver must get the
+ * same bytes in every run, and the packets kept by the sink must not be
+ * changed by the receiver.
+ */
+class PacketHandoverTest : public P4P2PLinkTestCase
+{
+public:
+  PacketHandoverTest ();
+  virtual void DoRun (void);
+
+private:
+  void RunOnce (bool traceSender, uint32_t trainLength);
+  void PhyTxEnd (Ptr<const Packet> pkt);
+
+  std::vector<Ptr<const Packet>> m_traced; //!< packets kept by the PhyTxEnd sink
+  std::vector<uint32_t> m_tracedSize; //!< size of the kept packets when they were traced
+};
+
+PacketHandoverTest::PacketHandoverTest () : P4P2PLinkTestCase ("Packet handover")
+{
+}
+
+void
+PacketHandoverTest::PhyTxEnd (Ptr<const Packet> pkt)
+{
+  m_traced.push_back (pkt);
+  m_tracedSize.push_back (pkt->GetSize ());
+}
+
+void
+PacketHandoverTest::RunOnce (bool traceSender, uint32_t trainLength)
+{
+  BuildLink ();
+  m_devA->SetAttribute ("TrainLength", UintegerValue (trainLength));
+  if (traceSender)
+    {
+      m_devA->TraceConnectWithoutContext ("PhyTxEnd",
+                                          MakeCallback (&PacketHandoverTest::PhyTxEnd, this));
+    }
+
+  // 1 packet goes out alone, the others wait in the queue and form a train
+  m_traced.clear ();
+  m_tracedSize.clear ();
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      SendAt (Seconds (1.0), MakePacket (200));
+    }
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 5u, "All packets received");
+  std::vector<uint8_t> payload = GetBytes (MakePacket (200));
+  for (size_t i = 0; i < m_received.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ ((GetBytes (m_received[i]) == payload), true,
+                             "Received bytes of packet " << i);
+      // a copy is made while the sent packet is still alive, so it can not
+      // get the address of the packet it was copied from
+      NS_TEST_EXPECT_MSG_EQ ((PeekPointer (m_received[i]) == m_sent[i]), !traceSender,
+                             "Packet " << i << " handed over without a copy");
+    }
+
+  if (traceSender)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_traced.size (), 5u, "PhyTxEnd traced");
+      for (size_t i = 0; i < m_traced.size (); i++)
+        {
+          NS_TEST_EXPECT_MSG_EQ (m_traced[i]->GetSize (), m_tracedSize[i],
+                                 "Traced packet " << i << " not modified by the receiver");
+        }
+    }
+  m_traced.clear ();
+  DestroyLink ();
+}
+
+void
+PacketHandoverTest::DoRun (void)
+{
+  RunOnce (false, 1);
+  RunOnce (true, 1);
+  RunOnce (false, 4);
+  RunOnce (true, 4);
+}
+
+/**
+ * \brief Checks the fluid background load model of CustomP2PNetDevice
+ *
+ * One packet is sent on an idle link, one while a background flow takes half
+ * of the data rate, and one after the flow has stopped. The loaded packet must
+ * be serialized at half the rate and wait the M/D/1 queueing delay.
+ */
+class BackgroundLoadTest : public P4P2PLinkTestCase
+{
+public:
+  BackgroundLoadTest ();
+  virtual void DoRun (void);
+};
+
+BackgroundLoadTest::BackgroundLoadTest () : P4P2PLinkTestCase ("Background load")
+{
+}
+
+void
+BackgroundLoadTest::DoRun (void)
+{
+  BuildLink ();
+  m_devA->SetAttribute ("DataRate", DataRateValue (DataRate ("1Mbps")));
+
+  NS_TEST_EXPECT_MSG_EQ (m_devA->AddBackgroundFlow (DataRate ("500kbps"), 0, Seconds (0),
+                                                    Seconds (1)),
+                         -1, "Flow without packet size rejected");
+  NS_TEST_EXPECT_MSG_EQ (m_devA->AddBackgroundFlow (DataRate ("500kbps"), 1000, Seconds (2),
+                                                    Seconds (2)),
+                         -1, "Flow without duration rejected");
+  NS_TEST_EXPECT_MSG_EQ (m_devA->AddBackgroundFlow (DataRate ("500kbps"), 1000, Seconds (1.5),
+                                                    Seconds (2.5)),
+                         0, "Flow accepted");
+
+  SendAt (Seconds (1.0), Create<Packet> (1000));
+  SendAt (Seconds (2.0), Create<Packet> (1000));
+  SendAt (Seconds (3.0), Create<Packet> (1000));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_arrivals.size (), 3u, "All packets received");
+  double idleTx = (m_arrivals[0] - Seconds (1.0)).GetSeconds ();
+  // rho = 0.5, background service time S = 8 ms, Wq = rho * S / (2 * (1 - rho))
+  double loadedTx = (m_arrivals[1] - Seconds (2.0)).GetSeconds ();
+  NS_TEST_EXPECT_MSG_EQ_TOL (loadedTx, 0.004 + 2 * idleTx, 1e-9,
+                             "Half the rate plus the M/D/1 waiting time");
+  NS_TEST_EXPECT_MSG_EQ (m_arrivals[2] - Seconds (3.0), m_arrivals[0] - Seconds (1.0),
+                         "Idle link again once the flow stopped");
+  NS_TEST_EXPECT_MSG_EQ (m_devA->GetBackgroundLoad (), 0.0, "No background load after the run");
+
+  DestroyLink ();
+}
+
+/**
+ * \brief Checks the frame pass-through mode of CustomP2PNetDevice
+ *
+ * The first device sends a packet to the second one in pass-through mode,
+ * which must hand up the frame with its Ethernet header and report the frame
+ * addresses and EtherType. The frame is then sent back unchanged with
+ * SendFrame, and the first device must receive the original payload.
+ */
+class FramePassThroughTest : public P4P2PLinkTestCase
+{
+public:
+  FramePassThroughTest ();
+  virtual void DoRun (void);
+
+private:
+  bool PortRx (Ptr<NetDevice> dev, Ptr<const Packet> pkt, uint16_t protocol, const Address &src,
+               const Address &dst, NetDevice::PacketType type);
+  bool HostRx (Ptr<NetDevice> dev, Ptr<const Packet> pkt, uint16_t protocol,
+               const Address &sender);
+
+  Ptr<const Packet> m_frame; //!< frame received by the pass-through device
+  uint16_t m_frameProtocol; //!< EtherType reported by the pass-through device
+  Address m_frameSrc; //!< source reported by the pass-through device
+  Address m_frameDst; //!< destination reported by the pass-through device
+  Ptr<const Packet> m_hostPacket; //!< packet received back by the first device
+  uint16_t m_hostProtocol; //!< protocol reported to the first device
+};
+
+FramePassThroughTest::FramePassThroughTest ()
+  : P4P2PLinkTestCase ("Frame pass-through"), m_frameProtocol (0), m_hostProtocol (0)
+{
+}
+
+bool
+FramePassThroughTest::PortRx (Ptr<NetDevice> dev, Ptr<const Packet> pkt, uint16_t protocol,
+                              const Address &src, const Address &dst,
+                              NetDevice::PacketType type)
+{
+  m_frame = pkt;
+  m_frameProtocol = protocol;
+  m_frameSrc = src;
+  m_frameDst = dst;
+  // send the frame back as it is, like a switch port on egress
+  m_devB->SendFrame (pkt->Copy ());
+  return true;
+}
+
+bool
+FramePassThroughTest::HostRx (Ptr<NetDevice> dev, Ptr<const Packet> pkt, uint16_t protocol,
+                              const Address &sender)
+{
+  m_hostPacket = pkt;
+  m_hostProtocol = protocol;
+  return true;
+}
+
+void
+FramePassThroughTest::DoRun (void)
+{
+  BuildLink ();
+  m_devB->SetFramePassThrough (true);
+  NS_TEST_ASSERT_MSG_EQ (m_devB->IsFramePassThrough (), true, "Pass-through enabled");
+  m_devB->SetPromiscReceiveCallback (MakeCallback (&FramePassThroughTest::PortRx, this));
+  m_devA->SetReceiveCallback (MakeCallback (&FramePassThroughTest::HostRx, this));
+
+  Mac48Address dest = Mac48Address ("00:00:00:00:0a:0b");
+  SendAt (Seconds (1.0), Create<Packet> (120), dest);
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_NE (m_frame, nullptr, "Frame received by the pass-through device");
+  NS_TEST_EXPECT_MSG_EQ (m_frame->GetSize (), 120u + 14u, "Ethernet header kept");
+  NS_TEST_EXPECT_MSG_EQ (m_frameProtocol, 0x800, "EtherType taken from the frame");
+  NS_TEST_EXPECT_MSG_EQ (Mac48Address::ConvertFrom (m_frameSrc),
+                         Mac48Address::ConvertFrom (m_devA->GetAddress ()),
+                         "Source taken from the frame");
+  NS_TEST_EXPECT_MSG_EQ (Mac48Address::ConvertFrom (m_frameDst), dest,
+                         "Destination taken from the frame");
+
+  NS_TEST_ASSERT_MSG_NE (m_hostPacket, nullptr, "Frame sent back to the first device");
+  NS_TEST_EXPECT_MSG_EQ (m_hostPacket->GetSize (), 120u, "First device got the payload back");
+  NS_TEST_EXPECT_MSG_EQ (m_hostProtocol, 0x800, "First device got the EtherType back");
+
+  m_frame = nullptr;
+  m_hostPacket = nullptr;
+  DestroyLink ();
+}
+
+/**
+ * \brief Checks that a CustomP2PNetDevice bound as a switch port hands its
+ * frames to the switch callback with the port number, bypassing the receive
+ * callback, and goes back to the receive callback once unbound.
+ */
+class SwitchPortBindingTest : public P4P2PLinkTestCase
+{
+public:
+  SwitchPortBindingTest ();
+  virtual void DoRun (void);
+
+private:
+  void SwitchRx (uint32_t port, Ptr<Packet> pkt, uint16_t protocol, const Address &src,
+                 const Address &dst, NetDevice::PacketType type);
+
+  uint32_t m_switchCount; //!< frames given to the switch callback
+  uint32_t m_switchPort; //!< port number of the last switch frame
+  uint32_t m_switchSize; //!< size of the last switch frame
+  uint16_t m_switchProtocol; //!< protocol of the last switch frame
+};
+
+SwitchPortBindingTest::SwitchPortBindingTest ()
+  : P4P2PLinkTestCase ("Switch port binding"),
+    m_switchCount (0),
+    m_switchPort (0),
+    m_switchSize (0),
+    m_switchProtocol (0)
+{
+}
+
+void
+SwitchPortBindingTest::SwitchRx (uint32_t port, Ptr<Packet> pkt, uint16_t protocol,
+                                 const Address &src, const Address &dst,
+                                 NetDevice::PacketType type)
+{
+  m_switchCount++;
+  m_switchPort = port;
+  m_switchSize = pkt->GetSize ();
+  m_switchProtocol = protocol;
+}
+
+void
+SwitchPortBindingTest::DoRun (void)
+{
+  BuildLink ();
+  m_devB->SetFramePassThrough (true);
+  m_devB->BindSwitchPort (MakeCallback (&SwitchPortBindingTest::SwitchRx, this), 7);
+  NS_TEST_ASSERT_MSG_EQ (m_devB->IsSwitchPortBound (), true, "Device bound");
+
+  SendAt (Seconds (1.0), Create<Packet> (120));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_switchCount, 1u, "Frame given to the switch");
+  NS_TEST_EXPECT_MSG_EQ (m_switchPort, 7u, "Frame tagged with the port number");
+  NS_TEST_EXPECT_MSG_EQ (m_switchSize, 120u + 14u, "Frame kept its Ethernet header");
+  NS_TEST_EXPECT_MSG_EQ (m_switchProtocol, 0x800, "EtherType taken from the frame");
+  NS_TEST_EXPECT_MSG_EQ (m_received.size (), 0u, "Receive callback bypassed");
+
+  m_devB->UnbindSwitchPort ();
+  NS_TEST_ASSERT_MSG_EQ (m_devB->IsSwitchPortBound (), false, "Device unbound");
+  SendAt (Seconds (2.0), Create<Packet> (120));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_switchCount, 1u, "No frame given to the switch once unbound");
+  NS_TEST_EXPECT_MSG_EQ (m_received.size (), 1u, "Receive callback used once unbound");
+
+  DestroyLink ();
+}
+
 /**
  * \brief TestSuite for PointToPoint module
  */
@@ -146,6 +832,12 @@ public:
 PointToPointTestSuite::PointToPointTestSuite () : TestSuite ("p4-p2p-channel-test-suite", UNIT)
 {
   AddTestCase (new PointToPointTest, TestCase::QUICK);
+  AddTestCase (new CustomHeaderSpliceTest, TestCase::QUICK);
+  AddTestCase (new PacketTrainTest, TestCase::QUICK);
+  AddTestCase (new PacketHandoverTest, TestCase::QUICK);
+  AddTestCase (new BackgroundLoadTest, TestCase::QUICK);
+  AddTestCase (new FramePassThroughTest, TestCase::QUICK);
+  AddTestCase (new SwitchPortBindingTest, TestCase::QUICK);
 }
 
 static PointToPointTestSuite g_pointToPointTestSuite; //!< The testsuite
@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/p4-rate-meter.h"
+#include "ns3/test.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Checks the two-rate three-color marking of a packet meter on a given
+ * clock.
+ */
+class P4RateMeterTwoRateTestCase : public TestCase
+{
+public:
+  P4RateMeterTwoRateTestCase ();
+  virtual void DoRun (void);
+};
+
+P4RateMeterTwoRateTestCase::P4RateMeterTwoRateTestCase ()
+    : TestCase ("P4RateMeter marks packets against two rates")
+{
+}
+
+void
+P4RateMeterTwoRateTestCase::DoRun (void)
+{
+  const uint32_t GREEN = 0;
+  const uint32_t YELLOW = 1;
+  const uint32_t RED = 2;
+
+  P4RateMeter meter;
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (0, 1), GREEN, "Unconfigured meter is GREEN");
+
+  // committed 1000 packets/s with a burst of 2, peak 2000 packets/s with a burst of 4
+  std::vector<P4RateMeter::Rate> rates = {{0.001, 2}, {0.002, 4}};
+  NS_TEST_EXPECT_MSG_EQ (meter.SetRates (rates), true, "Rates changed");
+  NS_TEST_EXPECT_MSG_EQ (meter.SetRates (rates), false, "Same rates again");
+
+  uint64_t now = 1000000;
+  std::vector<uint32_t> burst;
+  for (int i = 0; i < 5; i++)
+    {
+      burst.push_back (meter.Execute (now, 1));
+    }
+  std::vector<uint32_t> expected = {GREEN, GREEN, YELLOW, YELLOW, RED};
+  NS_TEST_EXPECT_MSG_EQ ((burst == expected), true, "Burst drains both buckets");
+
+  // 1 ms later: 2 peak tokens and 1 committed token
+  now += 1000000;
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (now, 1), GREEN, "Refilled committed token");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (now, 1), YELLOW, "Refilled peak token");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (now, 1), RED, "Peak bucket empty");
+
+  // the buckets never hold more than their burst
+  now += 10000000000ull;
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (now, 1), GREEN, "Full after idle");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (now, 1), GREEN, "Full after idle");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (now, 1), YELLOW, "Committed burst capped");
+
+  // new rates refill the buckets
+  rates[0].burstSize = 3;
+  NS_TEST_EXPECT_MSG_EQ (meter.SetRates (rates), true, "Rates changed");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (now, 3), GREEN, "Refilled on new rates");
+}
+
+/**
+ * \brief Checks that a byte meter takes the packet length from the buckets.
+ */
+class P4RateMeterBytesTestCase : public TestCase
+{
+public:
+  P4RateMeterBytesTestCase ();
+  virtual void DoRun (void);
+};
+
+P4RateMeterBytesTestCase::P4RateMeterBytesTestCase ()
+    : TestCase ("P4RateMeter meters bytes")
+{
+}
+
+void
+P4RateMeterBytesTestCase::DoRun (void)
+{
+  // 1 byte/us committed and peak, bursts of 1500 and 3000 bytes
+  P4RateMeter meter;
+  meter.SetRates ({{1.0, 1500}, {1.0, 3000}});
+
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (0, 1500), 0u, "First packet GREEN");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (0, 1500), 1u, "Second packet YELLOW");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (0, 100), 2u, "Third packet RED");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (500000, 500), 0u, "500 bytes back after 500 us");
+  NS_TEST_EXPECT_MSG_EQ (meter.Execute (400000, 1), 2u, "Time does not go back");
+}
+
+/**
+ * \brief TestSuite for the meters run on the simulator clock
+ */
+class P4RateMeterTestSuite : public TestSuite
+{
+public:
+  P4RateMeterTestSuite ();
+};
+
+P4RateMeterTestSuite::P4RateMeterTestSuite () : TestSuite ("p4-rate-meter", UNIT)
+{
+  AddTestCase (new P4RateMeterTwoRateTestCase, TestCase::QUICK);
+  AddTestCase (new P4RateMeterBytesTestCase, TestCase::QUICK);
+}
+
+static P4RateMeterTestSuite g_p4RateMeterTestSuite;
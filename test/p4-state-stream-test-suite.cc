@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/p4-state-stream.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * \brief Checks that values written by P4StateWriter read back unchanged and
+ * that reads past the end fail.
+ */
+class P4StateStreamTestCase : public TestCase
+{
+public:
+  P4StateStreamTestCase ();
+  virtual void DoRun (void);
+};
+
+P4StateStreamTestCase::P4StateStreamTestCase () : TestCase ("P4StateWriter and P4StateReader")
+{
+}
+
+void
+P4StateStreamTestCase::DoRun (void)
+{
+  P4StateWriter writer;
+  writer.WriteU8 (0xab);
+  writer.WriteU32 (0xdeadbeef);
+  writer.WriteU64 (0x0123456789abcdefull);
+  writer.WriteString (std::string ("a\0b", 3));
+  writer.WriteString ("");
+  NS_TEST_EXPECT_MSG_EQ (writer.GetData ().size (), 1u + 4 + 8 + 7 + 4, "Fixed-width encoding");
+
+  P4StateReader reader (writer.GetData ());
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU8 (), 0xab, "u8");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 0xdeadbeef, "u32");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU64 (), 0x0123456789abcdefull, "u64");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadString (), std::string ("a\0b", 3), "Binary string");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadString (), "", "Empty string");
+  NS_TEST_EXPECT_MSG_EQ (reader.IsOk (), true, "All reads succeeded");
+  NS_TEST_EXPECT_MSG_EQ (reader.AtEnd (), true, "All data read");
+
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 0u, "Read past the end");
+  NS_TEST_EXPECT_MSG_EQ (reader.IsOk (), false, "Reader failed");
+
+  // a length running past the end of the data
+  P4StateWriter truncated;
+  truncated.WriteU32 (100);
+  P4StateReader truncatedReader (truncated.GetData ());
+  NS_TEST_EXPECT_MSG_EQ (truncatedReader.ReadString (), "", "Truncated string");
+  NS_TEST_EXPECT_MSG_EQ (truncatedReader.IsOk (), false, "Truncated string fails");
+}
+
+/**
+ * \brief Checks that P4JsonValue walks the bmv2 documents the checkpoints read.
+ */
+class P4JsonValueTestCase : public TestCase
+{
+public:
+  P4JsonValueTestCase ();
+  virtual void DoRun (void);
+};
+
+P4JsonValueTestCase::P4JsonValueTestCase () : TestCase ("P4JsonValue parsing")
+{
+}
+
+void
+P4JsonValueTestCase::DoRun (void)
+{
+  P4JsonValue root;
+  bool ok = P4JsonValue::Parse (
+      "{ \"counter_arrays\" : [ { \"name\" : \"MyIngress.c\", \"id\" : 0, "
+      "\"source_info\" : { \"line\" : 12 }, \"size\" : 1024, \"is_direct\" : false }, "
+      "{ \"name\" : \"d\\\"q\", \"is_direct\" : true, \"binding\" : \"t\" } ], "
+      "\"ratio\" : -1.5e3, \"none\" : null, \"empty\" : [] }",
+      &root);
+  NS_TEST_ASSERT_MSG_EQ (ok, true, "Valid document");
+  NS_TEST_ASSERT_MSG_NE (root.Get ("counter_arrays"), nullptr, "Member lookup");
+
+  const std::vector<P4JsonValue> &arrays = root.Get ("counter_arrays")->GetElements ();
+  NS_TEST_ASSERT_MSG_EQ (arrays.size (), 2u, "Array elements");
+  NS_TEST_EXPECT_MSG_EQ (arrays[0].Get ("name")->GetString (), "MyIngress.c", "String");
+  NS_TEST_EXPECT_MSG_EQ (arrays[0].Get ("size")->GetUint (), 1024u, "Unsigned number");
+  NS_TEST_EXPECT_MSG_EQ (arrays[0].Get ("is_direct")->GetBool (), false, "false");
+  NS_TEST_EXPECT_MSG_EQ (arrays[1].Get ("is_direct")->GetBool (), true, "true");
+  NS_TEST_EXPECT_MSG_EQ (arrays[1].Get ("name")->GetString (), "d\"q", "Escaped quote");
+  NS_TEST_EXPECT_MSG_EQ (arrays[1].Get ("size"), nullptr, "Missing member");
+  NS_TEST_EXPECT_MSG_EQ (root.Get ("ratio")->GetUint (), 0u, "Not an unsigned integer");
+  NS_TEST_EXPECT_MSG_EQ (root.Get ("none")->GetType (), P4JsonValue::NUL, "null");
+  NS_TEST_EXPECT_MSG_EQ (root.Get ("empty")->GetElements ().size (), 0u, "Empty array");
+
+  NS_TEST_EXPECT_MSG_EQ (P4JsonValue::Parse ("{ \"a\" : }", &root), false, "Missing value");
+  NS_TEST_EXPECT_MSG_EQ (P4JsonValue::Parse ("[1, 2] x", &root), false, "Trailing text");
+  NS_TEST_EXPECT_MSG_EQ (P4JsonValue::Parse ("[1, 2", &root), false, "Unterminated array");
+}
+
+/**
+ * \brief TestSuite for the checkpoint encoding helpers
+ */
+class P4StateStreamTestSuite : public TestSuite
+{
+public:
+  P4StateStreamTestSuite ();
+};
+
+P4StateStreamTestSuite::P4StateStreamTestSuite () : TestSuite ("p4-state-stream", UNIT)
+{
+  AddTestCase (new P4StateStreamTestCase, TestCase::QUICK);
+  AddTestCase (new P4JsonValueTestCase, TestCase::QUICK);
+}
+
+static P4StateStreamTestSuite g_p4StateStreamTestSuite;
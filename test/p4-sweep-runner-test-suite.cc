@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/p4-sweep-runner.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/test.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Checks that P4SweepRunner runs every point once in a worker process
+ * and collects the results in sweep order.
+ *
+ * Every point writes a marker file into its output directory and returns its
+ * parameters and RNG run as results. One point fails on purpose.
+ */
+class P4SweepRunnerTestCase : public TestCase
+{
+public:
+  P4SweepRunnerTestCase ();
+  virtual void DoRun (void);
+};
+
+P4SweepRunnerTestCase::P4SweepRunnerTestCase () : TestCase ("P4SweepRunner points and summary")
+{
+}
+
+void
+P4SweepRunnerTestCase::DoRun (void)
+{
+  std::string dir = CreateTempDirFilename ("p4-sweep");
+
+  P4SweepRunner sweep;
+  sweep.AddParameter ("rate", {"1", "2", "3"});
+  sweep.AddParameter ("buffer", {"10", "20"});
+  sweep.SetRepetitions (2);
+  sweep.SetSeed (7);
+  sweep.SetWorkers (3);
+  sweep.SetOutputDirectory (dir);
+
+  NS_TEST_ASSERT_MSG_EQ (sweep.GetNPoints (), 12u, "3 x 2 values, 2 repetitions");
+  P4SweepRunner::Point point = sweep.GetPoint (5);
+  NS_TEST_EXPECT_MSG_EQ (point.Get ("rate"), "2", "First parameter varies slowest");
+  NS_TEST_EXPECT_MSG_EQ (point.Get ("buffer"), "10", "Second parameter");
+  NS_TEST_EXPECT_MSG_EQ (point.run, 2u, "Repetitions vary fastest");
+  NS_TEST_EXPECT_MSG_EQ (point.Get ("unknown"), "", "Unknown parameter");
+
+  int failed = sweep.Run ([] (const P4SweepRunner::Point &p, P4SweepRunner::Results *results) {
+    if (p.index == 11)
+      {
+        return 3;
+      }
+    std::ofstream (p.outputPath + "/marker") << p.index;
+    (*results)["product"] = std::to_string (std::stoi (p.Get ("rate")) *
+                                            std::stoi (p.Get ("buffer")));
+    (*results)["rngRun"] = std::to_string (RngSeedManager::GetRun ());
+    return 0;
+  });
+  NS_TEST_EXPECT_MSG_EQ (failed, 1, "One failed point");
+
+  for (uint32_t i = 0; i < 11; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (std::filesystem::exists (sweep.GetPoint (i).outputPath + "/marker"),
+                             true, "Point " << i << " ran");
+    }
+
+  std::ifstream summary (dir + "/summary.csv");
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline (summary, line))
+    {
+      lines.push_back (line);
+    }
+  NS_TEST_ASSERT_MSG_EQ (lines.size (), 13u, "Header and one row per point");
+  NS_TEST_EXPECT_MSG_EQ (lines[0], "index,seed,run,rate,buffer,status,product,rngRun", "Header");
+  NS_TEST_EXPECT_MSG_EQ (lines[4], "3,7,2,1,20,0,20,2", "Row of point 3");
+  NS_TEST_EXPECT_MSG_EQ (lines[12], "11,7,2,3,20,3,,", "Failed point has no results");
+
+  std::filesystem::remove_all (dir);
+}
+
+/**
+ * \brief Checks that P4SweepRunner quotes the summary fields holding commas,
+ * quotes or line breaks, and keeps such results intact.
+ */
+class P4SweepRunnerCsvTestCase : public TestCase
+{
+public:
+  P4SweepRunnerCsvTestCase ();
+  virtual void DoRun (void);
+};
+
+P4SweepRunnerCsvTestCase::P4SweepRunnerCsvTestCase () : TestCase ("P4SweepRunner summary quoting")
+{
+}
+
+void
+P4SweepRunnerCsvTestCase::DoRun (void)
+{
+  std::string dir = CreateTempDirFilename ("p4-sweep-csv");
+
+  P4SweepRunner sweep;
+  sweep.AddParameter ("route", {"a,b", "plain"});
+  sweep.SetWorkers (1);
+  sweep.SetOutputDirectory (dir);
+
+  int failed = sweep.Run ([] (const P4SweepRunner::Point &p, P4SweepRunner::Results *results) {
+    (*results)["note"] = p.index == 0 ? "say \"hi\"\nback\\slash" : "none";
+    return 0;
+  });
+  NS_TEST_EXPECT_MSG_EQ (failed, 0, "No failed point");
+
+  std::ifstream summary (dir + "/summary.csv");
+  std::string text ((std::istreambuf_iterator<char> (summary)), std::istreambuf_iterator<char> ());
+  NS_TEST_EXPECT_MSG_EQ (text,
+                         "index,seed,run,route,status,note\n"
+                         "0,1,1,\"a,b\",0,\"say \"\"hi\"\"\nback\\slash\"\n"
+                         "1,1,1,plain,0,none\n",
+                         "Quoted fields");
+
+  std::filesystem::remove_all (dir);
+}
+
+/**
+ * \brief TestSuite for P4SweepRunner
+ */
+class P4SweepRunnerTestSuite : public TestSuite
+{
+public:
+  P4SweepRunnerTestSuite ();
+};
+
+P4SweepRunnerTestSuite::P4SweepRunnerTestSuite () : TestSuite ("p4-sweep-runner", UNIT)
+{
+  AddTestCase (new P4SweepRunnerTestCase, TestCase::QUICK);
+  AddTestCase (new P4SweepRunnerCsvTestCase, TestCase::QUICK);
+}
+
+static P4SweepRunnerTestSuite g_p4SweepRunnerTestSuite;
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/custom-p2p-net-device.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/node.h"
+#include "ns3/p4-p2p-channel.h"
+#include "ns3/p4-switch-net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Checks that P4SwitchNetDevice resolves its bridged ports by number
+ *
+ * The switch gets a host-facing device that is not bridged, then a number of
+ * bridged ports. Every port must resolve to the number it was added with, and
+ * devices that are not bridged must not resolve.
+ */
+class P4SwitchPortLookupTestCase : public TestCase
+{
+public:
+  P4SwitchPortLookupTestCase ();
+  virtual void DoRun (void);
+
+private:
+  Ptr<CustomP2PNetDevice> CreatePort (Ptr<Node> node);
+};
+
+P4SwitchPortLookupTestCase::P4SwitchPortLookupTestCase ()
+  : TestCase ("P4SwitchNetDevice port lookup")
+{
+}
+
+Ptr<CustomP2PNetDevice>
+P4SwitchPortLookupTestCase::CreatePort (Ptr<Node> node)
+{
+  Ptr<CustomP2PNetDevice> dev = CreateObject<CustomP2PNetDevice> ();
+  dev->Attach (CreateObject<P4P2PChannel> ());
+  dev->SetAddress (Mac48Address::Allocate ());
+  dev->SetQueue (CreateObject<DropTailQueue<Packet>> ());
+  node->AddDevice (dev);
+  return dev;
+}
+
+void
+P4SwitchPortLookupTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<CustomP2PNetDevice> unbridged = CreatePort (node);
+
+  Ptr<P4SwitchNetDevice> sw = CreateObject<P4SwitchNetDevice> ();
+  node->AddDevice (sw);
+
+  const uint32_t nPorts = 70;
+  std::vector<Ptr<CustomP2PNetDevice>> ports;
+  for (uint32_t i = 0; i < nPorts; i++)
+    {
+      ports.push_back (CreatePort (node));
+      sw->AddBridgePort (ports.back ());
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (sw->GetNBridgePorts (), nPorts, "All ports bridged");
+  for (uint32_t i = 0; i < nPorts; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (sw->GetPortNumber (ports[i]), i, "Port number of port " << i);
+      NS_TEST_EXPECT_MSG_EQ (sw->GetBridgePort (i), ports[i], "Device of port " << i);
+      NS_TEST_EXPECT_MSG_EQ (ports[i]->IsSwitchPortBound (), true, "Port " << i << " bound");
+    }
+  NS_TEST_EXPECT_MSG_EQ (unbridged->IsSwitchPortBound (), false, "Unbridged device not bound");
+
+  NS_TEST_EXPECT_MSG_EQ (sw->GetPortNumber (unbridged), static_cast<uint32_t> (-1),
+                         "Device that is not bridged");
+  // interface index 2 is port 0 on the switch node
+  Ptr<Node> other = CreateObject<Node> ();
+  CreatePort (other);
+  CreatePort (other);
+  Ptr<CustomP2PNetDevice> foreign = CreatePort (other);
+  NS_TEST_EXPECT_MSG_EQ (sw->GetPortNumber (foreign), static_cast<uint32_t> (-1),
+                         "Device of another node with a used interface index");
+
+  NS_TEST_EXPECT_MSG_EQ (sw->GetPortCounters (0).rxPackets, 0u, "No traffic yet");
+  NS_TEST_EXPECT_MSG_EQ (sw->GetPortCounters (nPorts).txPackets, 0u, "Port out of range");
+
+  sw->Dispose ();
+  NS_TEST_EXPECT_MSG_EQ (ports[0]->IsSwitchPortBound (), false, "Ports unbound on dispose");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \brief TestSuite for P4SwitchNetDevice
+ */
+class P4SwitchNetDeviceTestSuite : public TestSuite
+{
+public:
+  P4SwitchNetDeviceTestSuite ();
+};
+
+P4SwitchNetDeviceTestSuite::P4SwitchNetDeviceTestSuite ()
+  : TestSuite ("p4-switch-net-device", UNIT)
+{
+  AddTestCase (new P4SwitchPortLookupTestCase, TestCase::QUICK);
+}
+
+static P4SwitchNetDeviceTestSuite g_p4SwitchNetDeviceTestSuite;
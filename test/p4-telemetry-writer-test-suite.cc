@@ -0,0 +1,140 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/p4-state-stream.h"
+#include "ns3/p4-telemetry-writer.h"
+#include "ns3/test.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace ns3;
+
+/**
+ * \brief Read a whole file
+ * \param path the file
+ * \return the bytes
+ */
+static std::string
+ReadFile (const std::string &path)
+{
+  std::ifstream file (path, std::ios::binary);
+  std::ostringstream data;
+  data << file.rdbuf ();
+  return data.str ();
+}
+
+/**
+ * \brief Checks the CSV rows and that they reach the file only when the
+ * buffer fills up or is flushed.
+ */
+class P4TelemetryWriterCsvTestCase : public TestCase
+{
+public:
+  P4TelemetryWriterCsvTestCase ();
+  virtual void DoRun (void);
+};
+
+P4TelemetryWriterCsvTestCase::P4TelemetryWriterCsvTestCase ()
+    : TestCase ("P4TelemetryWriter writes buffered CSV rows")
+{
+}
+
+void
+P4TelemetryWriterCsvTestCase::DoRun (void)
+{
+  std::string path = CreateTempDirFilename ("telemetry.csv");
+  P4TelemetryWriter writer;
+  NS_TEST_ASSERT_MSG_EQ (writer.Open (path, P4TelemetryWriter::CSV, {"register:r", "queue_depth"}),
+                         true, "File created");
+  writer.Write (1000, 0, 0, 3, 42, 0);
+  writer.Write (1000, 2, 1, 1, 7, 0);
+  writer.Write (2000, 1, 5, 0, 1, 2);
+  NS_TEST_EXPECT_MSG_EQ (writer.GetRows (), 3u, "Three rows");
+  NS_TEST_EXPECT_MSG_EQ (ReadFile (path), "", "Rows are buffered");
+
+  writer.Flush ();
+  std::string expected = "time_ns,switch,metric,cell,value,value2\n"
+                         "1000,0,register:r,3,42,0\n"
+                         "1000,2,queue_depth,1,7,0\n"
+                         "2000,1,5,0,1,2\n";
+  NS_TEST_EXPECT_MSG_EQ (ReadFile (path), expected, "Rows after a flush");
+
+  // a small buffer goes to the file as soon as it is full
+  writer.Open (path, P4TelemetryWriter::CSV, {"m"}, 64);
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      writer.Write (i, 0, 0, i, i, 0);
+    }
+  NS_TEST_EXPECT_MSG_EQ (ReadFile (path).empty (), false, "Full buffer written");
+  writer.Close ();
+  NS_TEST_EXPECT_MSG_EQ (writer.IsOpen (), false, "Closed");
+  NS_TEST_EXPECT_MSG_EQ (ReadFile (path).size (), 40u + 10 * 12, "All rows written on close");
+}
+
+/**
+ * \brief Checks the header and the fixed-size rows of the binary format.
+ */
+class P4TelemetryWriterBinaryTestCase : public TestCase
+{
+public:
+  P4TelemetryWriterBinaryTestCase ();
+  virtual void DoRun (void);
+};
+
+P4TelemetryWriterBinaryTestCase::P4TelemetryWriterBinaryTestCase ()
+    : TestCase ("P4TelemetryWriter writes binary rows")
+{
+}
+
+void
+P4TelemetryWriterBinaryTestCase::DoRun (void)
+{
+  std::string path = CreateTempDirFilename ("telemetry.bin");
+  P4TelemetryWriter writer;
+  NS_TEST_ASSERT_MSG_EQ (writer.Open (path, P4TelemetryWriter::BINARY, {"counter:c"}), true,
+                         "File created");
+  writer.Write (123456789012ull, 4, 0, 17, 1500, 1);
+  writer.Write (123456789013ull, 5, 0, 18, 1ull << 40, 2);
+  writer.Close ();
+
+  std::string data = ReadFile (path);
+  NS_TEST_ASSERT_MSG_EQ (data.size (), 4u + 4 + 4 + 4 + 9 + 2 * 36, "Header and two rows");
+  NS_TEST_EXPECT_MSG_EQ (data.substr (0, 4), "P4TL", "Magic");
+
+  // the header and rows use the same little-endian encoding as the checkpoints
+  std::string body = data.substr (4);
+  P4StateReader reader (body);
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 1u, "Version");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 1u, "One metric");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadString (), "counter:c", "Metric name");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU64 (), 123456789012ull, "Time");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 4u, "Switch");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 0u, "Metric");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 17u, "Cell");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU64 (), 1500u, "Value");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU64 (), 1u, "Value2");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU64 (), 123456789013ull, "Time");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 5u, "Switch");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 0u, "Metric");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU32 (), 18u, "Cell");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU64 (), 1ull << 40, "Value");
+  NS_TEST_EXPECT_MSG_EQ (reader.ReadU64 (), 2u, "Value2");
+  NS_TEST_EXPECT_MSG_EQ (reader.IsOk () && reader.AtEnd (), true, "Whole file read");
+}
+
+/**
+ * \brief TestSuite for the telemetry output of the controller
+ */
+class P4TelemetryWriterTestSuite : public TestSuite
+{
+public:
+  P4TelemetryWriterTestSuite ();
+};
+
+P4TelemetryWriterTestSuite::P4TelemetryWriterTestSuite () : TestSuite ("p4-telemetry-writer", UNIT)
+{
+  AddTestCase (new P4TelemetryWriterCsvTestCase, TestCase::QUICK);
+  AddTestCase (new P4TelemetryWriterBinaryTestCase, TestCase::QUICK);
+}
+
+static P4TelemetryWriterTestSuite g_p4TelemetryWriterTestSuite;
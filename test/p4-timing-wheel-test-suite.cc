@@ -0,0 +1,180 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/p4-timing-wheel.h"
+#include "ns3/test.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace ns3;
+
+/**
+ * \brief Checks expiry, restart and removal of timers on one level and across
+ * cascades.
+ */
+class P4TimingWheelBasicTestCase : public TestCase
+{
+public:
+  P4TimingWheelBasicTestCase ();
+  virtual void DoRun (void);
+};
+
+P4TimingWheelBasicTestCase::P4TimingWheelBasicTestCase ()
+    : TestCase ("P4TimingWheel expires, restarts and removes timers")
+{
+}
+
+void
+P4TimingWheelBasicTestCase::DoRun (void)
+{
+  // 4 slots per level, 3 levels: 64 ticks before the overflow list
+  P4TimingWheel wheel (2, 3);
+  std::vector<uint64_t> expired;
+
+  wheel.Insert (1, 3);
+  wheel.Insert (2, 20);
+  wheel.Insert (3, 1000);
+  wheel.Insert (4, 20);
+  NS_TEST_EXPECT_MSG_EQ (wheel.GetSize (), 4u, "Four timers");
+
+  uint64_t next = 0;
+  NS_TEST_ASSERT_MSG_EQ (wheel.GetNextExpiry (&next), true, "Timers are running");
+  NS_TEST_EXPECT_MSG_EQ (next, 3u, "Earliest expiry");
+
+  wheel.Advance (2, &expired);
+  NS_TEST_EXPECT_MSG_EQ (expired.size (), 0u, "Nothing due at tick 2");
+  wheel.Advance (3, &expired);
+  NS_TEST_ASSERT_MSG_EQ (expired.size (), 1u, "One timer due at tick 3");
+  NS_TEST_EXPECT_MSG_EQ (expired[0], 1u, "Key 1 expired");
+
+  // restarting moves the timer, removing stops it
+  wheel.Insert (2, 30);
+  NS_TEST_EXPECT_MSG_EQ (wheel.Remove (4), true, "Key 4 removed");
+  NS_TEST_EXPECT_MSG_EQ (wheel.Remove (4), false, "Key 4 already removed");
+  NS_TEST_EXPECT_MSG_EQ (wheel.GetNextExpiry (&next), true, "Timers are running");
+  NS_TEST_EXPECT_MSG_EQ (next, 30u, "Restarted expiry");
+
+  expired.clear ();
+  wheel.Advance (29, &expired);
+  NS_TEST_EXPECT_MSG_EQ (expired.size (), 0u, "Restarted and removed timers did not fire");
+  wheel.Advance (30, &expired);
+  NS_TEST_ASSERT_MSG_EQ (expired.size (), 1u, "Restarted timer fired");
+  NS_TEST_EXPECT_MSG_EQ (expired[0], 2u, "Key 2 expired");
+
+  // beyond the top level, and a jump far past it
+  expired.clear ();
+  wheel.Advance (999, &expired);
+  NS_TEST_EXPECT_MSG_EQ (expired.size (), 0u, "Overflow timer not due");
+  wheel.Advance (5000, &expired);
+  NS_TEST_ASSERT_MSG_EQ (expired.size (), 1u, "Overflow timer fired");
+  NS_TEST_EXPECT_MSG_EQ (expired[0], 3u, "Key 3 expired");
+  NS_TEST_EXPECT_MSG_EQ (wheel.GetSize (), 0u, "Wheel empty");
+  NS_TEST_EXPECT_MSG_EQ (wheel.GetNextExpiry (&next), false, "No timer running");
+
+  // a past expiry fires on the next tick
+  wheel.Insert (5, 10);
+  NS_TEST_EXPECT_MSG_EQ (wheel.GetNextExpiry (&next), true, "Timer running");
+  NS_TEST_EXPECT_MSG_EQ (next, 5001u, "Past expiry moved to the next tick");
+}
+
+/**
+ * \brief Compares the wheel against a plain map of expiries over a long
+ * pseudo-random sequence of operations.
+ */
+class P4TimingWheelReferenceTestCase : public TestCase
+{
+public:
+  P4TimingWheelReferenceTestCase ();
+  virtual void DoRun (void);
+};
+
+P4TimingWheelReferenceTestCase::P4TimingWheelReferenceTestCase ()
+    : TestCase ("P4TimingWheel matches a reference timer list")
+{
+}
+
+void
+P4TimingWheelReferenceTestCase::DoRun (void)
+{
+  P4TimingWheel wheel (3, 2);
+  std::map<uint64_t, uint64_t> reference;
+  uint64_t now = 0;
+  uint64_t state = 12345;
+  auto random = [&state] () {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return state >> 33;
+  };
+
+  for (int step = 0; step < 20000; step++)
+    {
+      uint64_t op = random () % 10;
+      if (op < 5)
+        {
+          uint64_t key = random () % 200;
+          uint64_t expiry = now + 1 + random () % 1000;
+          wheel.Insert (key, expiry);
+          reference[key] = expiry;
+        }
+      else if (op < 6)
+        {
+          uint64_t key = random () % 200;
+          NS_TEST_ASSERT_MSG_EQ (wheel.Remove (key), reference.erase (key) == 1, "Remove");
+        }
+      else
+        {
+          uint64_t next = 0;
+          bool running = wheel.GetNextExpiry (&next);
+          NS_TEST_ASSERT_MSG_EQ (running, !reference.empty (), "Running timers");
+          uint64_t to = now + random () % 200;
+          if (running)
+            {
+              uint64_t earliest = reference.begin ()->second;
+              for (const auto &timer : reference)
+                {
+                  earliest = std::min (earliest, timer.second);
+                }
+              NS_TEST_ASSERT_MSG_EQ (next, earliest, "Next expiry");
+              if (op < 8)
+                {
+                  to = next;
+                }
+            }
+
+          std::vector<uint64_t> expired;
+          wheel.Advance (to, &expired);
+          std::vector<uint64_t> due;
+          for (auto it = reference.begin (); it != reference.end ();)
+            {
+              if (it->second <= to)
+                {
+                  due.push_back (it->first);
+                  it = reference.erase (it);
+                }
+              else
+                {
+                  ++it;
+                }
+            }
+          std::sort (expired.begin (), expired.end ());
+          NS_TEST_ASSERT_MSG_EQ ((expired == due), true, "Expired timers at tick " << to);
+          now = std::max (now, to);
+        }
+    }
+}
+
+/**
+ * \brief TestSuite for the timing wheel of the entry ageing
+ */
+class P4TimingWheelTestSuite : public TestSuite
+{
+public:
+  P4TimingWheelTestSuite ();
+};
+
+P4TimingWheelTestSuite::P4TimingWheelTestSuite () : TestSuite ("p4-timing-wheel", UNIT)
+{
+  AddTestCase (new P4TimingWheelBasicTestCase, TestCase::QUICK);
+  AddTestCase (new P4TimingWheelReferenceTestCase, TestCase::QUICK);
+}
+
+static P4TimingWheelTestSuite g_p4TimingWheelTestSuite;
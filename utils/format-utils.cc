@@ -26,12 +26,15 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
 
+#include <unistd.h>
+
 namespace ns3
 {
 
@@ -386,6 +389,19 @@ getTickCount()
         .count();
 }
 
+uint64_t
+GetResidentBytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    uint64_t totalPages = 0;
+    uint64_t residentPages = 0;
+    if (!(statm >> totalPages >> residentPages))
+    {
+        return 0;
+    }
+    return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
 std::string
 GetP4SimDir()
 {
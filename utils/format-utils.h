@@ -185,6 +185,18 @@ std::string ParseParam(std::string& inputStr, unsigned int bitWidth);
 
 uint64_t getTickCount(); // Get current time (ms)
 
+/**
+ * @brief Get the resident set size of the simulator process.
+ *
+ * The difference of two readings is only an estimate of what was allocated in
+ * between: the allocator keeps freed memory for reuse and may map memory it
+ * does not touch yet, so a delta can miss allocations served from its cache,
+ * or count memory freed by other code in the meantime.
+ *
+ * @return The resident bytes, 0 if /proc is not available.
+ */
+uint64_t GetResidentBytes();
+
 /**
  * @brief Get the P4Sim project root directory path.
  *
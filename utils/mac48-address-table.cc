@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#include "ns3/mac48-address-table.h"
+
+#include "ns3/log.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("Mac48AddressTable");
+
+namespace
+{
+
+const uint32_t INITIAL_BUCKETS = 16; //!< Buckets of an empty table, a power of two
+
+} // namespace
+
+Mac48AddressTable::Mac48AddressTable(uint32_t capacity)
+    : m_capacity(std::max<uint32_t>(capacity, 1)),
+      m_oldest(NONE),
+      m_newest(NONE),
+      m_reclaimed(0),
+      m_bucket(INITIAL_BUCKETS, NONE)
+{
+}
+
+uint32_t
+Mac48AddressTable::Intern(const Mac48Address& address)
+{
+    uint64_t key = ToKey(address);
+    uint32_t bucket = FindBucket(key);
+    if (bucket != NONE)
+    {
+        uint32_t index = m_bucket[bucket];
+        if (m_entries[index].refs == 0 && index != m_newest)
+        {
+            Unlink(index);
+            PushNewest(index);
+        }
+        return index;
+    }
+
+    uint32_t index;
+    if (m_entries.size() < m_capacity)
+    {
+        // keep the load factor at or below 1/2
+        if ((m_entries.size() + 1) * 2 > m_bucket.size())
+        {
+            Grow();
+        }
+        index = m_entries.size();
+        m_entries.push_back(Entry{key, NONE, NONE, 0});
+    }
+    else if (m_oldest == NONE)
+    {
+        // only referenced entries are left, all of them in flight
+        NS_LOG_WARN("All " << m_capacity << " addresses are in flight");
+        return FULL;
+    }
+    else
+    {
+        index = m_oldest;
+        NS_LOG_LOGIC("Table full, reclaiming index " << index);
+        EraseBucket(FindBucket(m_entries[index].key));
+        Unlink(index);
+        m_entries[index].key = key;
+        m_reclaimed++;
+    }
+    InsertBucket(index);
+    PushNewest(index);
+    return index;
+}
+
+uint32_t
+Mac48AddressTable::Acquire(const Mac48Address& address)
+{
+    uint32_t index = Intern(address);
+    if (index != FULL)
+    {
+        AddReference(index);
+    }
+    return index;
+}
+
+void
+Mac48AddressTable::AddReference(uint32_t index)
+{
+    // a referenced entry leaves the use order, so it cannot be reclaimed
+    if (m_entries[index].refs++ == 0)
+    {
+        Unlink(index);
+    }
+}
+
+void
+Mac48AddressTable::Release(uint32_t index)
+{
+    if (index >= m_entries.size() || m_entries[index].refs == 0)
+    {
+        NS_LOG_WARN("Address index " << index << " is not referenced");
+        return;
+    }
+    if (--m_entries[index].refs == 0)
+    {
+        PushNewest(index);
+    }
+}
+
+Mac48Address
+Mac48AddressTable::Get(uint32_t index) const
+{
+    if (index >= m_entries.size())
+    {
+        NS_LOG_WARN("Address index " << index << " is not in use");
+        return Mac48Address();
+    }
+    uint64_t key = m_entries[index].key;
+    uint8_t buffer[6];
+    for (int i = 5; i >= 0; i--)
+    {
+        buffer[i] = static_cast<uint8_t>(key);
+        key >>= 8;
+    }
+    Mac48Address address;
+    address.CopyFrom(buffer);
+    return address;
+}
+
+size_t
+Mac48AddressTable::GetMemoryBytes() const
+{
+    return sizeof(*this) + m_entries.capacity() * sizeof(Entry) +
+           m_bucket.capacity() * sizeof(uint32_t);
+}
+
+uint64_t
+Mac48AddressTable::ToKey(const Mac48Address& address)
+{
+    uint8_t buffer[6];
+    address.CopyTo(buffer);
+    uint64_t key = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        key = (key << 8) | buffer[i];
+    }
+    return key;
+}
+
+uint32_t
+Mac48AddressTable::Home(uint64_t key) const
+{
+    // Fibonacci hashing, the bucket count is a power of two
+    return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & (m_bucket.size() - 1);
+}
+
+uint32_t
+Mac48AddressTable::FindBucket(uint64_t key) const
+{
+    uint32_t mask = m_bucket.size() - 1;
+    for (uint32_t b = Home(key);; b = (b + 1) & mask)
+    {
+        uint32_t index = m_bucket[b];
+        if (index == NONE)
+        {
+            return NONE;
+        }
+        if (m_entries[index].key == key)
+        {
+            return b;
+        }
+    }
+}
+
+void
+Mac48AddressTable::InsertBucket(uint32_t index)
+{
+    uint32_t mask = m_bucket.size() - 1;
+    uint32_t b = Home(m_entries[index].key);
+    while (m_bucket[b] != NONE)
+    {
+        b = (b + 1) & mask;
+    }
+    m_bucket[b] = index;
+}
+
+void
+Mac48AddressTable::EraseBucket(uint32_t bucket)
+{
+    uint32_t mask = m_bucket.size() - 1;
+    uint32_t hole = bucket;
+    m_bucket[hole] = NONE;
+    for (uint32_t b = (hole + 1) & mask; m_bucket[b] != NONE; b = (b + 1) & mask)
+    {
+        // An entry may move into the hole unless its home lies cyclically in
+        // (hole, b]: it would then no longer be reachable from its home.
+        uint32_t home = Home(m_entries[m_bucket[b]].key);
+        bool stays = (hole <= b) ? (hole < home && home <= b) : (hole < home || home <= b);
+        if (!stays)
+        {
+            m_bucket[hole] = m_bucket[b];
+            m_bucket[b] = NONE;
+            hole = b;
+        }
+    }
+}
+
+void
+Mac48AddressTable::Grow()
+{
+    m_bucket.assign(m_bucket.size() * 2, NONE);
+    for (uint32_t index = 0; index < m_entries.size(); index++)
+    {
+        InsertBucket(index);
+    }
+}
+
+void
+Mac48AddressTable::Unlink(uint32_t index)
+{
+    Entry& entry = m_entries[index];
+    if (entry.prev != NONE)
+    {
+        m_entries[entry.prev].next = entry.next;
+    }
+    else
+    {
+        m_oldest = entry.next;
+    }
+    if (entry.next != NONE)
+    {
+        m_entries[entry.next].prev = entry.prev;
+    }
+    else
+    {
+        m_newest = entry.prev;
+    }
+    entry.prev = NONE;
+    entry.next = NONE;
+}
+
+void
+Mac48AddressTable::PushNewest(uint32_t index)
+{
+    Entry& entry = m_entries[index];
+    entry.prev = m_newest;
+    entry.next = NONE;
+    if (m_newest != NONE)
+    {
+        m_entries[m_newest].next = index;
+    }
+    else
+    {
+        m_oldest = index;
+    }
+    m_newest = index;
+}
+
+} // namespace ns3
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#ifndef MAC48_ADDRESS_TABLE_H
+#define MAC48_ADDRESS_TABLE_H
+
+#include "ns3/mac48-address.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * @brief Bounded interning table mapping Mac48Address values to small indices.
+ *
+ * The switch cores carry the ns-3 destination address of a packet through the
+ * bm pipeline as an index in a packet register field. This table hands out
+ * those indices. Lookups hash the 48-bit address into an open-addressing table
+ * and cost constant time.
+ *
+ * The table never holds more than its capacity. When it is full, the entry
+ * that was used least recently is reclaimed for the new address. A packet in
+ * flight holds a reference on its index from Acquire until Release, and an
+ * entry with references is never reclaimed, so a buffered packet always
+ * resolves to its own address. If every entry is referenced, a new address
+ * gets no index.
+ *
+ * Memory grows with the number of distinct addresses seen, up to the capacity.
+ */
+class Mac48AddressTable
+{
+  public:
+    static constexpr uint32_t FULL = UINT32_MAX; //!< No entry could be reclaimed
+
+    /**
+     * @brief Create an empty table
+     * @param capacity the maximum number of entries, at least 1
+     */
+    explicit Mac48AddressTable(uint32_t capacity);
+
+    /**
+     * @brief Get the index of an address, adding it if needed
+     *
+     * Marks the entry as the most recently used one. When the table is full,
+     * the least recently used entry without references is reclaimed.
+     *
+     * @param address the address
+     * @return the index, below the capacity, or FULL if every entry is
+     * referenced
+     */
+    uint32_t Intern(const Mac48Address& address);
+
+    /**
+     * @brief Get the index of an address and take a reference on it
+     * @param address the address
+     * @return the index, or FULL if every entry is referenced
+     */
+    uint32_t Acquire(const Mac48Address& address);
+
+    /**
+     * @brief Take another reference on an index in use
+     * @param index the index returned by Acquire
+     */
+    void AddReference(uint32_t index);
+
+    /**
+     * @brief Drop a reference taken by Acquire or AddReference
+     *
+     * An entry without references becomes the most recently used one.
+     *
+     * @param index the index
+     */
+    void Release(uint32_t index);
+
+    /**
+     * @brief Get the number of references on an index
+     * @param index the index
+     * @return the number of references
+     */
+    uint32_t GetReferences(uint32_t index) const
+    {
+        return index < m_entries.size() ? m_entries[index].refs : 0;
+    }
+
+    /**
+     * @brief Get the address stored at an index
+     * @param index the index returned by Intern
+     * @return the address, the zero address if the index is not in use
+     */
+    Mac48Address Get(uint32_t index) const;
+
+    /**
+     * @brief Get the number of entries in use
+     * @return the number of entries
+     */
+    uint32_t GetSize() const
+    {
+        return m_entries.size();
+    }
+
+    /**
+     * @brief Get the maximum number of entries
+     * @return the capacity
+     */
+    uint32_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    /**
+     * @brief Get the number of entries reclaimed since the table was created
+     * @return the number of reclaimed entries
+     */
+    uint64_t GetReclaimed() const
+    {
+        return m_reclaimed;
+    }
+
+    /**
+     * @brief Get the memory held by the table
+     * @return the size in bytes
+     */
+    size_t GetMemoryBytes() const;
+
+  private:
+    static constexpr uint32_t NONE = UINT32_MAX; //!< Empty bucket or list end
+
+    /**
+     * @brief One interned address
+     */
+    struct Entry
+    {
+        uint64_t key;  //!< The address as a 48-bit integer
+        uint32_t prev; //!< Previous entry in use order, towards the oldest
+        uint32_t next; //!< Next entry in use order, towards the newest
+        uint32_t refs; //!< Packets in flight, the entry is out of the use order
+    };
+
+    /**
+     * @brief Convert an address to its hash key
+     * @param address the address
+     * @return the 48-bit key
+     */
+    static uint64_t ToKey(const Mac48Address& address);
+
+    /**
+     * @brief Get the home bucket of a key
+     * @param key the key
+     * @return the bucket index
+     */
+    uint32_t Home(uint64_t key) const;
+
+    /**
+     * @brief Find the bucket holding a key
+     * @param key the key
+     * @return the bucket index, or NONE if the key is not in the table
+     */
+    uint32_t FindBucket(uint64_t key) const;
+
+    /**
+     * @brief Insert an entry index into the buckets
+     * @param index the entry index, its key must be set
+     */
+    void InsertBucket(uint32_t index);
+
+    /**
+     * @brief Remove a bucket, shifting back the entries probed past it
+     * @param bucket the bucket index
+     */
+    void EraseBucket(uint32_t bucket);
+
+    /**
+     * @brief Double the number of buckets and rehash
+     */
+    void Grow();
+
+    /**
+     * @brief Unlink an entry from the use order
+     * @param index the entry index
+     */
+    void Unlink(uint32_t index);
+
+    /**
+     * @brief Link an entry as the most recently used one
+     * @param index the entry index
+     */
+    void PushNewest(uint32_t index);
+
+    uint32_t m_capacity;            //!< Maximum number of entries
+    uint32_t m_oldest;              //!< Least recently used entry
+    uint32_t m_newest;              //!< Most recently used entry
+    uint64_t m_reclaimed;           //!< Entries reclaimed so far
+    std::vector<Entry> m_entries;   //!< Entries, by index
+    std::vector<uint32_t> m_bucket; //!< Open-addressing buckets of entry indices
+};
+
+} // namespace ns3
+
+#endif /* MAC48_ADDRESS_TABLE_H */
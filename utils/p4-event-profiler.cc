@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#include "ns3/p4-event-profiler.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <iomanip>
+#include <map>
+#include <mutex>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("P4EventProfiler");
+
+std::atomic<bool> P4EventProfiler::m_enabled{false};
+
+namespace
+{
+
+using NodeCounters = std::array<P4EventProfiler::Counters, P4EventProfiler::ORIGIN_COUNT>;
+
+/**
+ * @brief Profiler state, kept in one place so Reset() is trivial
+ */
+struct ProfilerState
+{
+    std::mutex mutex;                                //!< Guards the members below
+    std::map<uint32_t, NodeCounters> nodes;          //!< Counters per node id
+    std::chrono::steady_clock::time_point wallStart; //!< Wall clock at Enable()
+    int64_t simStartNs{0};                           //!< Simulated time at Enable()
+};
+
+ProfilerState&
+GetState()
+{
+    static ProfilerState state;
+    return state;
+}
+
+/**
+ * @brief Sum the counters of one origin over all nodes, the state lock held
+ * @param state the profiler state
+ * @param origin the origin
+ * @return the counters
+ */
+P4EventProfiler::Counters
+SumCounters(const ProfilerState& state, P4EventProfiler::Origin origin)
+{
+    P4EventProfiler::Counters total;
+    for (const auto& entry : state.nodes)
+    {
+        const P4EventProfiler::Counters& c = entry.second[origin];
+        total.scheduled += c.scheduled;
+        total.executed += c.executed;
+        total.wallNs += c.wallNs;
+    }
+    return total;
+}
+
+} // namespace
+
+P4EventProfiler::Scope::Scope(Origin origin, uint32_t nodeId)
+    : m_active(P4EventProfiler::IsEnabled()),
+      m_origin(origin),
+      m_nodeId(nodeId)
+{
+    if (m_active)
+    {
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+P4EventProfiler::Scope::~Scope()
+{
+    if (m_active)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - m_start;
+        P4EventProfiler::DoRecordExecuted(
+            m_origin,
+            m_nodeId,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+}
+
+void
+P4EventProfiler::Enable()
+{
+    NS_LOG_FUNCTION_NOARGS();
+    Reset();
+    m_enabled = true;
+}
+
+void
+P4EventProfiler::Disable()
+{
+    NS_LOG_FUNCTION_NOARGS();
+    m_enabled = false;
+}
+
+void
+P4EventProfiler::Reset()
+{
+    ProfilerState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.nodes.clear();
+    state.wallStart = std::chrono::steady_clock::now();
+    state.simStartNs = Simulator::Now().GetNanoSeconds();
+}
+
+void
+P4EventProfiler::DoRecordScheduled(Origin origin, uint32_t nodeId)
+{
+    ProfilerState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.nodes[nodeId][origin].scheduled++;
+}
+
+void
+P4EventProfiler::DoRecordExecuted(Origin origin, uint32_t nodeId, uint64_t wallNs)
+{
+    ProfilerState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    Counters& c = state.nodes[nodeId][origin];
+    c.executed++;
+    c.wallNs += wallNs;
+}
+
+P4EventProfiler::Counters
+P4EventProfiler::GetTotal(Origin origin)
+{
+    ProfilerState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return SumCounters(state, origin);
+}
+
+P4EventProfiler::Counters
+P4EventProfiler::Get(Origin origin, uint32_t nodeId)
+{
+    ProfilerState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto it = state.nodes.find(nodeId);
+    if (it == state.nodes.end())
+    {
+        return Counters();
+    }
+    return it->second[origin];
+}
+
+const char*
+P4EventProfiler::GetOriginName(Origin origin)
+{
+    switch (origin)
+    {
+    case EGRESS_TIMER:
+        return "egress-timer";
+    case EGRESS_RETRY:
+        return "egress-retry";
+    case STATS_TIMER:
+        return "stats-timer";
+    case CHANNEL_DELIVERY:
+        return "channel-delivery";
+    case DEVICE_TRANSMIT:
+        return "device-transmit";
+    default:
+        return "unknown";
+    }
+}
+
+void
+P4EventProfiler::Print(std::ostream& os)
+{
+    ProfilerState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    double simSeconds = (Simulator::Now().GetNanoSeconds() - state.simStartNs) / 1e9;
+    double wallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - state.wallStart)
+                        .count();
+
+    os << "=== P4 event profile: " << std::fixed << std::setprecision(3) << simSeconds
+       << " s simulated, " << wallNs / 1e9 << " s wall ===" << std::endl;
+    os << std::left << std::setw(18) << "origin" << std::right << std::setw(14) << "scheduled"
+       << std::setw(14) << "executed" << std::setw(14) << "events/s" << std::setw(12)
+       << "wall[%]" << std::endl;
+
+    for (int o = 0; o < ORIGIN_COUNT; o++)
+    {
+        Counters c = SumCounters(state, static_cast<Origin>(o));
+        os << std::left << std::setw(18) << GetOriginName(static_cast<Origin>(o)) << std::right
+           << std::setw(14) << c.scheduled << std::setw(14) << c.executed << std::setw(14)
+           << (simSeconds > 0 ? c.executed / simSeconds : 0.0) << std::setw(12)
+           << (wallNs > 0 ? 100.0 * c.wallNs / wallNs : 0.0) << std::endl;
+    }
+
+    os << "--- per node ---" << std::endl;
+    for (const auto& entry : state.nodes)
+    {
+        for (int o = 0; o < ORIGIN_COUNT; o++)
+        {
+            const Counters& c = entry.second[o];
+            if (c.scheduled == 0 && c.executed == 0)
+            {
+                continue;
+            }
+            os << "node " << std::setw(5) << entry.first << " " << std::left << std::setw(18)
+               << GetOriginName(static_cast<Origin>(o)) << std::right << std::setw(14)
+               << c.scheduled << std::setw(14) << c.executed << std::setw(14)
+               << (simSeconds > 0 ? c.executed / simSeconds : 0.0) << std::setw(12)
+               << (wallNs > 0 ? 100.0 * c.wallNs / wallNs : 0.0) << std::endl;
+        }
+    }
+    os.unsetf(std::ios::floatfield);
+}
+
+} // namespace ns3
@@ -0,0 +1,538 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+
+#include "ns3/p4-flow-table-parser.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace ns3
+{
+
+namespace
+{
+
+/**
+ * @brief Split a string at a separator
+ * @param text the string
+ * @param separator the separator
+ * @return the parts
+ */
+std::vector<std::string>
+Split(const std::string& text, const std::string& separator)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    size_t pos;
+    while ((pos = text.find(separator, start)) != std::string::npos)
+    {
+        parts.push_back(text.substr(start, pos - start));
+        start = pos + separator.size();
+    }
+    parts.push_back(text.substr(start));
+    return parts;
+}
+
+/**
+ * @brief Parse an unsigned number of any size into big-endian bytes
+ * @param digits the digits, without prefix
+ * @param base 10 or 16
+ * @param bytes the value, as many bytes as needed, empty for 0
+ * @return false if a character is not a digit of the base
+ */
+bool
+ParseNumber(const std::string& digits, uint32_t base, std::vector<uint8_t>* bytes)
+{
+    if (digits.empty())
+    {
+        return false;
+    }
+    bytes->clear();
+    for (char c : digits)
+    {
+        uint32_t digit;
+        if (c >= '0' && c <= '9')
+        {
+            digit = c - '0';
+        }
+        else if (base == 16 && c >= 'a' && c <= 'f')
+        {
+            digit = c - 'a' + 10;
+        }
+        else if (base == 16 && c >= 'A' && c <= 'F')
+        {
+            digit = c - 'A' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        // bytes = bytes * base + digit, least significant byte last
+        uint32_t carry = digit;
+        for (auto it = bytes->rbegin(); it != bytes->rend(); ++it)
+        {
+            uint32_t value = *it * base + carry;
+            *it = value & 0xff;
+            carry = value >> 8;
+        }
+        while (carry)
+        {
+            bytes->insert(bytes->begin(), carry & 0xff);
+            carry >>= 8;
+        }
+    }
+    while (!bytes->empty() && bytes->front() == 0)
+    {
+        bytes->erase(bytes->begin());
+    }
+    return true;
+}
+
+/**
+ * @brief Get the match type of a key field in the bmv2 JSON
+ * @param name the match_type
+ * @param type the type
+ * @return false if not supported
+ */
+bool
+GetMatchType(const std::string& name, P4ParsedMatchField::Type* type)
+{
+    if (name == "exact")
+    {
+        *type = P4ParsedMatchField::EXACT;
+    }
+    else if (name == "lpm")
+    {
+        *type = P4ParsedMatchField::LPM;
+    }
+    else if (name == "ternary")
+    {
+        *type = P4ParsedMatchField::TERNARY;
+    }
+    else if (name == "range")
+    {
+        *type = P4ParsedMatchField::RANGE;
+    }
+    else if (name == "valid")
+    {
+        *type = P4ParsedMatchField::VALID;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool
+P4FlowTableParser::ParseValue(const std::string& text, uint32_t bitwidth, std::string* bytes)
+{
+    std::vector<uint8_t> value;
+    std::vector<std::string> dotted = Split(text, ".");
+    std::vector<std::string> colons = Split(text, ":");
+    if (dotted.size() == 4)
+    {
+        // IPv4 address
+        for (const std::string& part : dotted)
+        {
+            std::vector<uint8_t> octet;
+            if (!ParseNumber(part, 10, &octet) || octet.size() > 1)
+            {
+                return false;
+            }
+            value.push_back(octet.empty() ? 0 : octet[0]);
+        }
+    }
+    else if (colons.size() > 1)
+    {
+        // MAC address or other colon-separated bytes
+        for (const std::string& part : colons)
+        {
+            std::vector<uint8_t> octet;
+            if (part.size() > 2 || !ParseNumber(part, 16, &octet))
+            {
+                return false;
+            }
+            value.push_back(octet.empty() ? 0 : octet[0]);
+        }
+    }
+    else if (text.compare(0, 2, "0x") == 0 || text.compare(0, 2, "0X") == 0)
+    {
+        if (!ParseNumber(text.substr(2), 16, &value))
+        {
+            return false;
+        }
+    }
+    else if (!ParseNumber(text, 10, &value))
+    {
+        return false;
+    }
+
+    while (!value.empty() && value.front() == 0)
+    {
+        value.erase(value.begin());
+    }
+    size_t width = (bitwidth + 7) / 8;
+    if (value.size() > width ||
+        (value.size() == width && bitwidth % 8 && (value.front() >> (bitwidth % 8))))
+    {
+        return false;
+    }
+    bytes->assign(width - value.size(), '\0');
+    bytes->append(value.begin(), value.end());
+    return true;
+}
+
+bool
+P4FlowTableParser::LoadConfig(const std::string& config)
+{
+    m_tables.clear();
+    m_actions.clear();
+
+    P4JsonValue root;
+    if (!P4JsonValue::Parse(config, &root))
+    {
+        m_error = "cannot read the program";
+        return false;
+    }
+
+    // width of every header field
+    std::map<std::string, std::map<std::string, uint32_t>> headerTypes;
+    if (const P4JsonValue* types = root.Get("header_types"))
+    {
+        for (const P4JsonValue& type : types->GetElements())
+        {
+            const P4JsonValue* name = type.Get("name");
+            const P4JsonValue* fields = type.Get("fields");
+            if (!name || !fields)
+            {
+                continue;
+            }
+            for (const P4JsonValue& field : fields->GetElements())
+            {
+                if (field.GetElements().size() >= 2)
+                {
+                    headerTypes[name->GetString()][field.GetElements()[0].GetString()] =
+                        field.GetElements()[1].GetUint();
+                }
+            }
+        }
+    }
+    std::map<std::string, std::string> headers;
+    if (const P4JsonValue* instances = root.Get("headers"))
+    {
+        for (const P4JsonValue& header : instances->GetElements())
+        {
+            const P4JsonValue* name = header.Get("name");
+            const P4JsonValue* type = header.Get("header_type");
+            if (name && type)
+            {
+                headers[name->GetString()] = type->GetString();
+            }
+        }
+    }
+
+    if (const P4JsonValue* pipelines = root.Get("pipelines"))
+    {
+        for (const P4JsonValue& pipeline : pipelines->GetElements())
+        {
+            const P4JsonValue* tables = pipeline.Get("tables");
+            if (!tables)
+            {
+                continue;
+            }
+            for (const P4JsonValue& table : tables->GetElements())
+            {
+                const P4JsonValue* name = table.Get("name");
+                const P4JsonValue* key = table.Get("key");
+                if (!name)
+                {
+                    continue;
+                }
+                std::vector<KeyInfo>& fields = m_tables[name->GetString()];
+                if (!key)
+                {
+                    continue;
+                }
+                for (const P4JsonValue& field : key->GetElements())
+                {
+                    const P4JsonValue* matchType = field.Get("match_type");
+                    const P4JsonValue* target = field.Get("target");
+                    KeyInfo info{P4ParsedMatchField::EXACT, 0};
+                    if (!matchType || !GetMatchType(matchType->GetString(), &info.type))
+                    {
+                        m_error = "unsupported match type in table " + name->GetString();
+                        return false;
+                    }
+                    if (info.type == P4ParsedMatchField::VALID)
+                    {
+                        info.bitwidth = 1;
+                    }
+                    else if (target && target->GetElements().size() == 2)
+                    {
+                        const std::string& header = target->GetElements()[0].GetString();
+                        const std::string& member = target->GetElements()[1].GetString();
+                        info.bitwidth = member == "$valid$"
+                                            ? 1
+                                            : headerTypes[headers[header]][member];
+                    }
+                    if (info.bitwidth == 0)
+                    {
+                        m_error = "unknown key field in table " + name->GetString();
+                        return false;
+                    }
+                    fields.push_back(info);
+                }
+            }
+        }
+    }
+
+    if (const P4JsonValue* actions = root.Get("actions"))
+    {
+        for (const P4JsonValue& action : actions->GetElements())
+        {
+            const P4JsonValue* name = action.Get("name");
+            const P4JsonValue* params = action.Get("runtime_data");
+            if (!name)
+            {
+                continue;
+            }
+            std::vector<uint32_t>& widths = m_actions[name->GetString()];
+            widths.clear();
+            if (params)
+            {
+                for (const P4JsonValue& param : params->GetElements())
+                {
+                    const P4JsonValue* bitwidth = param.Get("bitwidth");
+                    widths.push_back(bitwidth ? bitwidth->GetUint() : 0);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <typename T>
+std::string
+P4FlowTableParser::Resolve(const std::map<std::string, T>& names, const std::string& name)
+{
+    if (names.count(name))
+    {
+        return name;
+    }
+    std::string found;
+    for (const auto& entry : names)
+    {
+        const std::string& full = entry.first;
+        if (full.size() > name.size() && full.compare(full.size() - name.size(), name.size(), name) == 0 &&
+            full[full.size() - name.size() - 1] == '.')
+        {
+            if (!found.empty())
+            {
+                return "";
+            }
+            found = full;
+        }
+    }
+    return found;
+}
+
+bool
+P4FlowTableParser::ParseMatchField(const std::string& text,
+                                   const KeyInfo& info,
+                                   P4ParsedMatchField* field)
+{
+    field->type = info.type;
+    field->mask.clear();
+    field->prefixLength = 0;
+    switch (info.type)
+    {
+    case P4ParsedMatchField::EXACT:
+        return ParseValue(text, info.bitwidth, &field->key);
+    case P4ParsedMatchField::VALID: {
+        bool valid = text == "1" || text == "true";
+        if (!valid && text != "0" && text != "false")
+        {
+            return false;
+        }
+        field->key.assign(1, valid ? '\1' : '\0');
+        return true;
+    }
+    case P4ParsedMatchField::LPM: {
+        std::vector<std::string> parts = Split(text, "/");
+        std::vector<uint8_t> length;
+        if (parts.size() != 2 || !ParseNumber(parts[1], 10, &length) || length.size() > 2)
+        {
+            return false;
+        }
+        field->prefixLength = length.empty() ? 0 : (length.size() == 1 ? length[0]
+                                                                      : length[0] << 8 | length[1]);
+        return static_cast<uint32_t>(field->prefixLength) <= info.bitwidth &&
+               ParseValue(parts[0], info.bitwidth, &field->key);
+    }
+    case P4ParsedMatchField::TERNARY: {
+        std::vector<std::string> parts = Split(text, "&&&");
+        return parts.size() == 2 && ParseValue(parts[0], info.bitwidth, &field->key) &&
+               ParseValue(parts[1], info.bitwidth, &field->mask);
+    }
+    case P4ParsedMatchField::RANGE: {
+        std::vector<std::string> parts = Split(text, "->");
+        return parts.size() == 2 && ParseValue(parts[0], info.bitwidth, &field->key) &&
+               ParseValue(parts[1], info.bitwidth, &field->mask);
+    }
+    }
+    return false;
+}
+
+int
+P4FlowTableParser::ParseLine(const std::string& line, P4ParsedTableEntry* entry)
+{
+    std::istringstream stream(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (stream >> token)
+    {
+        tokens.push_back(token);
+    }
+    if (tokens.empty() || tokens[0] != "table_add")
+    {
+        return 0;
+    }
+    if (tokens.size() < 3)
+    {
+        m_error = "table_add needs a table and an action";
+        return -1;
+    }
+
+    *entry = P4ParsedTableEntry();
+    entry->table = Resolve(m_tables, tokens[1]);
+    if (entry->table.empty())
+    {
+        m_error = "unknown table " + tokens[1];
+        return -1;
+    }
+    entry->action = Resolve(m_actions, tokens[2]);
+    if (entry->action.empty())
+    {
+        m_error = "unknown action " + tokens[2];
+        return -1;
+    }
+
+    size_t arrow = 3;
+    while (arrow < tokens.size() && tokens[arrow] != "=>")
+    {
+        arrow++;
+    }
+    const std::vector<KeyInfo>& keys = m_tables[entry->table];
+    if (arrow - 3 != keys.size())
+    {
+        m_error = entry->table + " has " + std::to_string(keys.size()) + " match fields";
+        return -1;
+    }
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        P4ParsedMatchField field;
+        if (!ParseMatchField(tokens[3 + i], keys[i], &field))
+        {
+            m_error = "bad match field " + tokens[3 + i];
+            return -1;
+        }
+        entry->match.push_back(field);
+    }
+
+    // action parameters, then an optional priority
+    const std::vector<uint32_t>& widths = m_actions[entry->action];
+    size_t first = std::min(arrow + 1, tokens.size());
+    size_t count = tokens.size() - first;
+    if (count != widths.size() && count != widths.size() + 1)
+    {
+        m_error = entry->action + " has " + std::to_string(widths.size()) + " parameters";
+        return -1;
+    }
+    for (size_t i = 0; i < widths.size(); i++)
+    {
+        std::string param;
+        if (!ParseValue(tokens[first + i], widths[i], &param))
+        {
+            m_error = "bad action parameter " + tokens[first + i];
+            return -1;
+        }
+        entry->params.push_back(param);
+    }
+    if (count > widths.size())
+    {
+        std::vector<uint8_t> priority;
+        const std::string& text = tokens.back();
+        if (!ParseNumber(text, 10, &priority) || priority.size() > 3)
+        {
+            m_error = "bad priority " + text;
+            return -1;
+        }
+        entry->priority = 0;
+        for (uint8_t byte : priority)
+        {
+            entry->priority = entry->priority << 8 | byte;
+        }
+    }
+    return 1;
+}
+
+bool
+P4FlowTableParser::ParseText(const std::string& text, std::vector<P4ParsedTableEntry>* entries)
+{
+    std::istringstream stream(text);
+    std::string line;
+    int number = 0;
+    while (std::getline(stream, line))
+    {
+        number++;
+        P4ParsedTableEntry entry;
+        int rc = ParseLine(line, &entry);
+        if (rc < 0)
+        {
+            m_error = "line " + std::to_string(number) + ": " + m_error;
+            return false;
+        }
+        if (rc > 0)
+        {
+            entries->push_back(entry);
+        }
+    }
+    return true;
+}
+
+bool
+P4FlowTableParser::ParseFile(const std::string& path, std::vector<P4ParsedTableEntry>* entries)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        m_error = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return ParseText(text.str(), entries);
+}
+
+} // namespace ns3
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+
+#ifndef P4_FLOW_TABLE_PARSER_H
+#define P4_FLOW_TABLE_PARSER_H
+
+#include "ns3/p4-state-stream.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * @brief A match field of a parsed table entry, in the layout of bm::MatchKeyParam
+ */
+struct P4ParsedMatchField
+{
+    /**
+     * @brief Match type
+     */
+    enum Type
+    {
+        RANGE,
+        VALID,
+        EXACT,
+        LPM,
+        TERNARY
+    };
+
+    Type type{EXACT};     //!< Match type
+    std::string key;      //!< Value, big-endian in the bytes of the field
+    std::string mask;     //!< Ternary mask, or range end
+    int prefixLength{0};  //!< LPM prefix length
+};
+
+/**
+ * @brief A table_add command of a flow table file
+ */
+struct P4ParsedTableEntry
+{
+    std::string table;                     //!< Full table name
+    std::string action;                    //!< Full action name
+    std::vector<P4ParsedMatchField> match; //!< Match fields, in key order
+    std::vector<std::string> params;       //!< Action parameters, big-endian bytes
+    int priority{-1};                      //!< Priority, -1 if not given
+};
+
+/**
+ * @brief Reads the table_add commands of a runtime CLI flow table file.
+ *
+ * The widths and match types come from the bmv2 JSON of the program, so the
+ * entries can be installed through the runtime interface instead of the CLI.
+ * Values may be decimal, 0x hexadecimal, dotted IPv4 or colon-separated bytes
+ * (MAC addresses), with "value/length" for LPM, "value&&&mask" for ternary
+ * and "start->end" for range fields. Table and action names may be shortened
+ * to a unique suffix after a '.', like in the CLI. Other commands are skipped.
+ */
+class P4FlowTableParser
+{
+  public:
+    /**
+     * @brief Read the tables and actions of a program
+     * @param config the bmv2 JSON
+     * @return false if the document cannot be read
+     */
+    bool LoadConfig(const std::string& config);
+
+    /**
+     * @brief Parse one line
+     * @param line the line
+     * @param entry the entry of a table_add command
+     * @return 1 for a table_add command, 0 for a line without one, -1 on error
+     */
+    int ParseLine(const std::string& line, P4ParsedTableEntry* entry);
+
+    /**
+     * @brief Parse all lines of a text
+     * @param text the text
+     * @param entries the entries are appended, in file order
+     * @return false on the first error
+     */
+    bool ParseText(const std::string& text, std::vector<P4ParsedTableEntry>* entries);
+
+    /**
+     * @brief Parse a file
+     * @param path the file
+     * @param entries the entries are appended, in file order
+     * @return false if the file cannot be read or on the first error
+     */
+    bool ParseFile(const std::string& path, std::vector<P4ParsedTableEntry>* entries);
+
+    /**
+     * @brief Get the reason of the last failure
+     * @return the message
+     */
+    const std::string& GetError() const
+    {
+        return m_error;
+    }
+
+    /**
+     * @brief Convert a value to big-endian bytes
+     * @param text the value
+     * @param bitwidth the width of the field
+     * @param bytes the (bitwidth + 7) / 8 bytes
+     * @return false if the value is malformed or does not fit
+     */
+    static bool ParseValue(const std::string& text, uint32_t bitwidth, std::string* bytes);
+
+  private:
+    /**
+     * @brief A key field of a table
+     */
+    struct KeyInfo
+    {
+        P4ParsedMatchField::Type type; //!< Match type
+        uint32_t bitwidth;             //!< Width of the field
+    };
+
+    /**
+     * @brief Resolve a possibly shortened name
+     * @param names the full names
+     * @param name the name
+     * @return the full name, empty if unknown or ambiguous
+     */
+    template <typename T>
+    static std::string Resolve(const std::map<std::string, T>& names, const std::string& name);
+
+    /**
+     * @brief Parse a match field
+     * @param text the field
+     * @param info the key field of the table
+     * @param field the parsed field
+     * @return false if malformed
+     */
+    bool ParseMatchField(const std::string& text, const KeyInfo& info, P4ParsedMatchField* field);
+
+    std::map<std::string, std::vector<KeyInfo>> m_tables;   //!< Key fields by table
+    std::map<std::string, std::vector<uint32_t>> m_actions; //!< Parameter widths by action
+    std::string m_error;                                    //!< Last failure
+};
+
+} // namespace ns3
+
+#endif /* P4_FLOW_TABLE_PARSER_H */
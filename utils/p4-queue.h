@@ -21,7 +21,9 @@
 #include "ns3/simulator.h"
 
 #include <bm/bm_sim/packet.h>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <map>
 #include <mutex>
 #include <queue>
@@ -93,11 +95,41 @@ class InputBuffer
         }
     }
 
+    // Blocking variant of pop_back, used by the ingress thread in emulation
+    // mode: waits until a packet (or the sentinel) is available.
+    void pop_back_wait(std::unique_ptr<bm::Packet>* pItem)
+    {
+        Lock lock(mutex);
+        cvar_can_pop.wait(lock, [this] { return (queue_hi.size() + queue_lo.size()) > 0; });
+        // give higher priority to resubmit/recirculate queue
+        if (queue_hi.size() > 0)
+        {
+            *pItem = std::move(queue_hi.back());
+            queue_hi.pop_back();
+            lock.unlock();
+            cvar_can_push_hi.notify_one();
+        }
+        else
+        {
+            *pItem = std::move(queue_lo.back());
+            queue_lo.pop_back();
+            lock.unlock();
+            cvar_can_push_lo.notify_one();
+        }
+    }
+
     size_t get_size()
     {
         return capacity_hi + capacity_lo;
     }
 
+    // number of packets currently waiting in both priority queues
+    size_t get_occupancy()
+    {
+        Lock lock(mutex);
+        return queue_hi.size() + queue_lo.size();
+    }
+
   private:
     using Mutex = std::mutex;
     using Lock = std::unique_lock<Mutex>;
@@ -186,8 +218,23 @@ class NSQueueingLogicPriRL
           capacity(capacity),
           workers_info(nb_workers),
           map_to_worker(std::move(map_to_worker)),
-          nb_priorities(nb_priorities)
+          nb_priorities(nb_priorities),
+          clock(&Simulator::Now)
+    {
+    }
+
+    /**
+     * @brief Set the clock used for the rate limiting.
+     *
+     * Simulator::Now by default. The emulation mode of the switch, where the
+     * queue is used from worker threads, sets a thread-safe wall clock.
+     *
+     * @param now the clock, must be set before any packet is queued
+     */
+    void set_clock(std::function<Time()> now)
     {
+        LockType lock(mutex);
+        clock = std::move(now);
     }
 
     /**
@@ -297,7 +344,7 @@ class NSQueueingLogicPriRL
             }
             else
             {
-                Time now = Simulator::Now();
+                Time now = clock();
                 Time next = now + Seconds(5);
 
                 // auto now_real = std::chrono::steady_clock::now ();
@@ -343,6 +390,85 @@ class NSQueueingLogicPriRL
         w_info.size--;
     }
 
+    /**
+     * @brief Blocking variant of
+     * pop_back(size_t worker_id, size_t *queue_id, size_t *priority, T *pItem),
+     * the bmv2 behavior used by the egress threads in emulation mode.
+     *
+     * Waits until an element of the worker is eligible for transmission
+     * according to the rate of its queue, using the clock of the queue. Once
+     * stop() was called, returns a default constructed element (the sentinel)
+     * right away, whatever is still queued.
+     *
+     * @param worker_id the egress thread id
+     * @param queue_id the queue_id of the element, i.e. the egress port
+     * @param priority the priority queue of the element
+     * @param pItem the element
+     */
+    void pop_back_wait(size_t worker_id, size_t* queue_id, size_t* priority, T* pItem)
+    {
+        LockType lock(mutex);
+        auto& w_info = workers_info.at(worker_id);
+        MyQ* queue = nullptr;
+        size_t pri;
+        while (true)
+        {
+            if (stopped)
+            {
+                *pItem = T();
+                return;
+            }
+            if (w_info.size == 0)
+            {
+                w_info.q_not_empty.wait(lock);
+                continue;
+            }
+            Time now = clock();
+            Time next = Time::Max();
+            for (pri = nb_priorities; pri-- > 0;)
+            {
+                auto& q = w_info.queues[pri];
+                if (q.size() == 0)
+                    continue;
+                if (q.top().send <= now)
+                {
+                    queue = &q;
+                    break;
+                }
+                next = std::min(next, q.top().send);
+            }
+            if (queue)
+                break;
+            // a new element may become eligible first, so it wakes us up too
+            w_info.q_not_empty.wait_for(lock,
+                                        std::chrono::nanoseconds((next - now).GetNanoSeconds()));
+        }
+        *queue_id = queue->top().queue_id;
+        *priority = pri;
+        *pItem = std::move(const_cast<QE&>(queue->top()).e);
+        queue->pop();
+        auto& q_info = get_queue_or_throw(*queue_id);
+        auto& q_info_pri = q_info.at(*priority);
+        q_info_pri.size--;
+        q_info.size--;
+        w_info.size--;
+    }
+
+    /**
+     * @brief Release the workers blocked in pop_back_wait(), which return the
+     * sentinel from now on. The queued elements are left in place and freed
+     * with the queue.
+     */
+    void stop()
+    {
+        LockType lock(mutex);
+        stopped = true;
+        for (auto& w_info : workers_info)
+        {
+            w_info.q_not_empty.notify_all();
+        }
+    }
+
     Time get_this_pkt_delay(const size_t queue_id, const size_t priority)
     {
         auto& q_info = get_queue(queue_id);
@@ -353,7 +479,7 @@ class NSQueueingLogicPriRL
 
     Time get_next_tp_all_ports()
     {
-        Time now = Simulator::Now();
+        Time now = clock();
         Time next = now + Seconds(5);
 
         // This will iterate from nb_priorities-1 to 0
@@ -429,6 +555,38 @@ class NSQueueingLogicPriRL
         return q_info_pri.size;
     }
 
+    /**
+     * @brief Get the number of elements held by all the logical queues.
+     *
+     * @return size_t
+     */
+    size_t total_size() const
+    {
+        LockType lock(mutex);
+        size_t total = 0;
+        for (const auto& w_info : workers_info)
+            total += w_info.size;
+        return total;
+    }
+
+    /**
+     * @brief Approximate the heap memory used by the queue bookkeeping, i.e.
+     * the per-queue info, the per-worker priority heaps and the queued entries
+     * themselves (but not what the entries point to).
+     *
+     * @return size_t bytes
+     */
+    size_t footprint_bytes() const
+    {
+        LockType lock(mutex);
+        size_t bytes = 0;
+        for (const auto& p : queues_info)
+            bytes += sizeof(p) + p.second.capacity() * sizeof(QueueInfoPri);
+        for (const auto& w_info : workers_info)
+            bytes += sizeof(WorkerInfo) + w_info.size * sizeof(QE);
+        return bytes;
+    }
+
     /**
      * @brief Set the capacity of all the priority queues for logical
      * queue \p queue_id to \p c elements.
@@ -586,11 +744,11 @@ class NSQueueingLogicPriRL
      */
     struct QueueInfoPri
     {
-        QueueInfoPri(size_t capacity, uint64_t queue_rate_pps)
+        QueueInfoPri(size_t capacity, uint64_t queue_rate_pps, const Time& now)
             : capacity(capacity),
               queue_rate_pps(queue_rate_pps),
               pkt_delay_time(rate_to_time(queue_rate_pps)),
-              last_sent(Simulator::Now())
+              last_sent(now)
         {
         }
 
@@ -607,8 +765,8 @@ class NSQueueingLogicPriRL
      */
     struct QueueInfo : public std::vector<QueueInfoPri>
     {
-        QueueInfo(size_t capacity, uint64_t queue_rate_pps, size_t nb_priorities)
-            : std::vector<QueueInfoPri>(nb_priorities, QueueInfoPri(capacity, queue_rate_pps))
+        QueueInfo(size_t capacity, uint64_t queue_rate_pps, size_t nb_priorities, const Time& now)
+            : std::vector<QueueInfoPri>(nb_priorities, QueueInfoPri(capacity, queue_rate_pps, now))
         {
         }
 
@@ -632,7 +790,8 @@ class NSQueueingLogicPriRL
         auto it = queues_info.find(queue_id);
         if (it != queues_info.end())
             return it->second;
-        auto p = queues_info.emplace(queue_id, QueueInfo(capacity, queue_rate_pps, nb_priorities));
+        auto p = queues_info.emplace(queue_id,
+                                     QueueInfo(capacity, queue_rate_pps, nb_priorities, clock()));
         return p.first->second;
     }
 
@@ -649,8 +808,9 @@ class NSQueueingLogicPriRL
     Time get_next_tp(const QueueInfoPri& q_info_pri)
     {
         // Calculate when the next step should be sent
-        return (Simulator::Now() > q_info_pri.last_sent + q_info_pri.pkt_delay_time)
-                   ? Simulator::Now()
+        Time now = clock();
+        return (now > q_info_pri.last_sent + q_info_pri.pkt_delay_time)
+                   ? now
                    : q_info_pri.last_sent + q_info_pri.pkt_delay_time;
     }
 
@@ -714,6 +874,8 @@ class NSQueueingLogicPriRL
     std::vector<MyQ> queues{};
     FMap map_to_worker;
     size_t nb_priorities;
+    std::function<Time()> clock; // time base of the rate limiting
+    bool stopped{false};         // pop_back_wait returns the sentinel
 };
 
 } // namespace ns3
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+
+#include "ns3/p4-rate-meter.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+P4RateMeter::P4RateMeter()
+    : m_lastNs(0),
+      m_started(false)
+{
+}
+
+bool
+P4RateMeter::SetRates(const std::vector<Rate>& rates)
+{
+    if (rates == m_rates)
+    {
+        return false;
+    }
+    m_rates = rates;
+    m_tokens.assign(rates.size(), 0);
+    for (size_t i = 0; i < rates.size(); i++)
+    {
+        m_tokens[i] = static_cast<double>(rates[i].burstSize);
+    }
+    m_started = false;
+    return true;
+}
+
+uint32_t
+P4RateMeter::Execute(uint64_t nowNs, uint64_t input)
+{
+    if (m_rates.empty())
+    {
+        return 0;
+    }
+
+    if (m_started && nowNs > m_lastNs)
+    {
+        double elapsedUs = (nowNs - m_lastNs) / 1000.0;
+        for (size_t i = 0; i < m_rates.size(); i++)
+        {
+            m_tokens[i] = std::min(m_tokens[i] + elapsedUs * m_rates[i].infoRate,
+                                   static_cast<double>(m_rates[i].burstSize));
+        }
+    }
+    if (!m_started || nowNs > m_lastNs)
+    {
+        m_lastNs = nowNs;
+        m_started = true;
+    }
+
+    for (size_t i = m_rates.size(); i > 0; i--)
+    {
+        if (m_tokens[i - 1] < input)
+        {
+            return static_cast<uint32_t>(i);
+        }
+        m_tokens[i - 1] -= input;
+    }
+    return 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+
+#ifndef P4_RATE_METER_H
+#define P4_RATE_METER_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * @brief Multi-rate token bucket meter, run on a caller-supplied clock.
+ *
+ * Same marking as bm::Meter, RFC 2698 for two rates: rate i is checked from
+ * the highest down, a packet that finds bucket i short of tokens gets color
+ * i + 1, and takes its tokens only from the buckets checked before. A packet
+ * that passes every bucket is GREEN (0). Buckets start full.
+ *
+ * Unlike bm::Meter the meter does not read a clock itself, so it runs on
+ * simulator time and gives the same colors in every run.
+ */
+class P4RateMeter
+{
+  public:
+    /**
+     * @brief Rate of one bucket, in the units of bm::Meter::rate_config_t
+     */
+    struct Rate
+    {
+        double infoRate;    //!< Tokens per microsecond
+        uint64_t burstSize; //!< Bucket depth in tokens
+
+        bool operator==(const Rate& other) const
+        {
+            return infoRate == other.infoRate && burstSize == other.burstSize;
+        }
+    };
+
+    /**
+     * @brief Create an unconfigured meter, which marks every packet GREEN
+     */
+    P4RateMeter();
+
+    /**
+     * @brief Configure the rates, and refill the buckets if they changed
+     * @param rates rate of color 1 first, like bm::Meter::set_rates
+     * @return true if the rates changed
+     */
+    bool SetRates(const std::vector<Rate>& rates);
+
+    /**
+     * @brief Get the configured rates
+     * @return the rates, empty if unconfigured
+     */
+    const std::vector<Rate>& GetRates() const
+    {
+        return m_rates;
+    }
+
+    /**
+     * @brief Meter a packet
+     * @param nowNs the current time in nanoseconds, not before the last call
+     * @param input the tokens the packet needs, 1 or its length in bytes
+     * @return the color, 0 for GREEN
+     */
+    uint32_t Execute(uint64_t nowNs, uint64_t input);
+
+  private:
+    std::vector<Rate> m_rates;    //!< Configured rates
+    std::vector<double> m_tokens; //!< Tokens in each bucket
+    uint64_t m_lastNs;            //!< Time of the last refill
+    bool m_started;               //!< m_lastNs is set
+};
+
+} // namespace ns3
+
+#endif /* P4_RATE_METER_H */
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#include "ns3/p4-state-stream.h"
+
+#include <cctype>
+
+namespace ns3
+{
+
+void
+P4StateWriter::WriteU8(uint8_t value)
+{
+    m_data.push_back(static_cast<char>(value));
+}
+
+void
+P4StateWriter::WriteU32(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        m_data.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+void
+P4StateWriter::WriteU64(uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        m_data.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+void
+P4StateWriter::WriteString(const std::string& value)
+{
+    WriteU32(value.size());
+    m_data.append(value);
+}
+
+P4StateReader::P4StateReader(const std::string& data)
+    : m_data(data),
+      m_pos(0),
+      m_ok(true)
+{
+}
+
+uint64_t
+P4StateReader::ReadLe(size_t bytes)
+{
+    if (!m_ok || m_data.size() - m_pos < bytes)
+    {
+        m_ok = false;
+        return 0;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(m_data[m_pos + i])) << (8 * i);
+    }
+    m_pos += bytes;
+    return value;
+}
+
+uint8_t
+P4StateReader::ReadU8()
+{
+    return ReadLe(1);
+}
+
+uint32_t
+P4StateReader::ReadU32()
+{
+    return ReadLe(4);
+}
+
+uint64_t
+P4StateReader::ReadU64()
+{
+    return ReadLe(8);
+}
+
+std::string
+P4StateReader::ReadString()
+{
+    uint32_t size = ReadU32();
+    if (!m_ok || m_data.size() - m_pos < size)
+    {
+        m_ok = false;
+        return "";
+    }
+    std::string value = m_data.substr(m_pos, size);
+    m_pos += size;
+    return value;
+}
+
+/**
+ * @brief Recursive-descent parser filling P4JsonValue
+ */
+class P4JsonParser
+{
+  public:
+    explicit P4JsonParser(const std::string& text)
+        : m_text(text),
+          m_pos(0)
+    {
+    }
+
+    bool ParseDocument(P4JsonValue* value)
+    {
+        if (!ParseValue(value, 0))
+        {
+            return false;
+        }
+        SkipSpace();
+        return m_pos == m_text.size();
+    }
+
+  private:
+    static constexpr int MAX_DEPTH = 64; //!< Nesting limit
+
+    void SkipSpace()
+    {
+        while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos])))
+        {
+            m_pos++;
+        }
+    }
+
+    bool Consume(char c)
+    {
+        SkipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == c)
+        {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool ParseLiteral(const char* literal)
+    {
+        std::string word(literal);
+        if (m_text.compare(m_pos, word.size(), word) != 0)
+        {
+            return false;
+        }
+        m_pos += word.size();
+        return true;
+    }
+
+    bool ParseString(std::string* out)
+    {
+        if (!Consume('"'))
+        {
+            return false;
+        }
+        out->clear();
+        while (m_pos < m_text.size())
+        {
+            char c = m_text[m_pos++];
+            if (c == '"')
+            {
+                return true;
+            }
+            if (c != '\\')
+            {
+                out->push_back(c);
+                continue;
+            }
+            if (m_pos >= m_text.size())
+            {
+                return false;
+            }
+            char e = m_text[m_pos++];
+            switch (e)
+            {
+            case 'n':
+                out->push_back('\n');
+                break;
+            case 't':
+                out->push_back('\t');
+                break;
+            case 'r':
+                out->push_back('\r');
+                break;
+            case 'b':
+                out->push_back('\b');
+                break;
+            case 'f':
+                out->push_back('\f');
+                break;
+            case 'u':
+                // names in bmv2 documents are ASCII, keep the escape as it is
+                out->append("\\u");
+                break;
+            default:
+                out->push_back(e);
+            }
+        }
+        return false;
+    }
+
+    bool ParseValue(P4JsonValue* value, int depth)
+    {
+        if (depth > MAX_DEPTH)
+        {
+            return false;
+        }
+        SkipSpace();
+        if (m_pos >= m_text.size())
+        {
+            return false;
+        }
+        char c = m_text[m_pos];
+        if (c == '{')
+        {
+            m_pos++;
+            value->m_type = P4JsonValue::OBJECT;
+            if (Consume('}'))
+            {
+                return true;
+            }
+            do
+            {
+                std::string key;
+                P4JsonValue member;
+                if (!ParseString(&key) || !Consume(':') || !ParseValue(&member, depth + 1))
+                {
+                    return false;
+                }
+                value->m_members.emplace_back(std::move(key), std::move(member));
+            } while (Consume(','));
+            return Consume('}');
+        }
+        if (c == '[')
+        {
+            m_pos++;
+            value->m_type = P4JsonValue::ARRAY;
+            if (Consume(']'))
+            {
+                return true;
+            }
+            do
+            {
+                P4JsonValue element;
+                if (!ParseValue(&element, depth + 1))
+                {
+                    return false;
+                }
+                value->m_elements.push_back(std::move(element));
+            } while (Consume(','));
+            return Consume(']');
+        }
+        if (c == '"')
+        {
+            value->m_type = P4JsonValue::STRING;
+            return ParseString(&value->m_text);
+        }
+        if (c == 't' || c == 'f')
+        {
+            value->m_type = P4JsonValue::BOOLEAN;
+            value->m_text = (c == 't') ? "true" : "false";
+            return ParseLiteral(c == 't' ? "true" : "false");
+        }
+        if (c == 'n')
+        {
+            value->m_type = P4JsonValue::NUL;
+            return ParseLiteral("null");
+        }
+        size_t start = m_pos;
+        while (m_pos < m_text.size() &&
+               (std::isdigit(static_cast<unsigned char>(m_text[m_pos])) || m_text[m_pos] == '-' ||
+                m_text[m_pos] == '+' || m_text[m_pos] == '.' || m_text[m_pos] == 'e' ||
+                m_text[m_pos] == 'E'))
+        {
+            m_pos++;
+        }
+        if (m_pos == start)
+        {
+            return false;
+        }
+        value->m_type = P4JsonValue::NUMBER;
+        value->m_text = m_text.substr(start, m_pos - start);
+        return true;
+    }
+
+    const std::string& m_text; //!< Document
+    size_t m_pos;              //!< Parse position
+};
+
+bool
+P4JsonValue::Parse(const std::string& text, P4JsonValue* value)
+{
+    *value = P4JsonValue();
+    P4JsonParser parser(text);
+    return parser.ParseDocument(value);
+}
+
+const P4JsonValue*
+P4JsonValue::Get(const std::string& key) const
+{
+    for (const auto& member : m_members)
+    {
+        if (member.first == key)
+        {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t
+P4JsonValue::GetUint() const
+{
+    if (m_type != NUMBER)
+    {
+        return 0;
+    }
+    uint64_t value = 0;
+    for (char c : m_text)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(c)))
+        {
+            return 0;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+} // namespace ns3
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#ifndef P4_STATE_STREAM_H
+#define P4_STATE_STREAM_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * @brief Appends fixed-width little-endian values to a byte string.
+ *
+ * Used for the compact binary switch checkpoints. Strings and blobs are
+ * prefixed with their 32-bit length.
+ */
+class P4StateWriter
+{
+  public:
+    void WriteU8(uint8_t value);
+    void WriteU32(uint32_t value);
+    void WriteU64(uint64_t value);
+    void WriteString(const std::string& value);
+
+    /**
+     * @brief Get the bytes written so far
+     * @return the bytes
+     */
+    const std::string& GetData() const
+    {
+        return m_data;
+    }
+
+  private:
+    std::string m_data; //!< Bytes written so far
+};
+
+/**
+ * @brief Reads the values written by P4StateWriter.
+ *
+ * A read past the end of the data fails, returns zero or an empty string, and
+ * leaves the reader failed: check IsOk once after a group of reads.
+ */
+class P4StateReader
+{
+  public:
+    /**
+     * @brief Read from a byte string, which must outlive the reader
+     * @param data the bytes
+     */
+    explicit P4StateReader(const std::string& data);
+
+    uint8_t ReadU8();
+    uint32_t ReadU32();
+    uint64_t ReadU64();
+    std::string ReadString();
+
+    /**
+     * @brief Check that no read failed
+     * @return true if all reads succeeded
+     */
+    bool IsOk() const
+    {
+        return m_ok;
+    }
+
+    /**
+     * @brief Check whether all data was read
+     * @return true at the end of the data
+     */
+    bool AtEnd() const
+    {
+        return m_pos == m_data.size();
+    }
+
+  private:
+    /**
+     * @brief Read a little-endian unsigned value
+     * @param bytes the width in bytes
+     * @return the value, 0 on failure
+     */
+    uint64_t ReadLe(size_t bytes);
+
+    const std::string& m_data; //!< Bytes to read
+    size_t m_pos;              //!< Read position
+    bool m_ok;                 //!< No read failed
+};
+
+/**
+ * @brief Minimal read-only JSON document.
+ *
+ * bmv2 reports its configuration and its multicast state as JSON. This is just
+ * enough to walk those documents: numbers keep their text and are read as
+ * unsigned integers, objects keep their member order.
+ */
+class P4JsonValue
+{
+  public:
+    /**
+     * @brief Type of a JSON value
+     */
+    enum Type
+    {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    /**
+     * @brief Parse a document
+     * @param text the JSON text
+     * @param value the parsed document
+     * @return true on success
+     */
+    static bool Parse(const std::string& text, P4JsonValue* value);
+
+    Type GetType() const
+    {
+        return m_type;
+    }
+
+    /**
+     * @brief Get a member of an object
+     * @param key the member name
+     * @return the member, nullptr if this is not an object or has no such member
+     */
+    const P4JsonValue* Get(const std::string& key) const;
+
+    /**
+     * @brief Get the elements of an array
+     * @return the elements, empty if this is not an array
+     */
+    const std::vector<P4JsonValue>& GetElements() const
+    {
+        return m_elements;
+    }
+
+    /**
+     * @brief Get a string, or the text of a number
+     * @return the text, empty for other types
+     */
+    const std::string& GetString() const
+    {
+        return m_text;
+    }
+
+    /**
+     * @brief Get a number as an unsigned integer
+     * @return the value, 0 if this is not a non-negative integer
+     */
+    uint64_t GetUint() const;
+
+    /**
+     * @brief Get a boolean
+     * @return the value, false if this is not a boolean
+     */
+    bool GetBool() const
+    {
+        return m_type == BOOLEAN && m_text == "true";
+    }
+
+  private:
+    friend class P4JsonParser;
+
+    Type m_type{NUL};                                        //!< Type
+    std::string m_text;                                      //!< String or number text
+    std::vector<P4JsonValue> m_elements;                     //!< Array elements
+    std::vector<std::pair<std::string, P4JsonValue>> m_members; //!< Object members
+};
+
+} // namespace ns3
+
+#endif /* P4_STATE_STREAM_H */
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+
+#include "ns3/p4-telemetry-writer.h"
+
+#include <charconv>
+
+namespace ns3
+{
+
+static const char TELEMETRY_MAGIC[] = "P4TL";
+static const uint32_t TELEMETRY_VERSION = 1;
+
+P4TelemetryWriter::P4TelemetryWriter()
+    : m_format(CSV),
+      m_bufferSize(0),
+      m_rows(0)
+{
+}
+
+P4TelemetryWriter::~P4TelemetryWriter()
+{
+    Close();
+}
+
+bool
+P4TelemetryWriter::Open(const std::string& path,
+                        Format format,
+                        const std::vector<std::string>& metrics,
+                        size_t bufferSize)
+{
+    Close();
+    m_file.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+    m_format = format;
+    m_metrics = metrics;
+    m_bufferSize = bufferSize;
+    m_buffer.clear();
+    m_buffer.reserve(bufferSize + 256);
+    m_rows = 0;
+
+    if (format == CSV)
+    {
+        m_buffer.append("time_ns,switch,metric,cell,value,value2\n");
+    }
+    else
+    {
+        m_buffer.append(TELEMETRY_MAGIC, 4);
+        AppendLe(TELEMETRY_VERSION, 4);
+        AppendLe(metrics.size(), 4);
+        for (const std::string& metric : metrics)
+        {
+            AppendLe(metric.size(), 4);
+            m_buffer.append(metric);
+        }
+    }
+    return true;
+}
+
+void
+P4TelemetryWriter::AppendLe(uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        m_buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+void
+P4TelemetryWriter::AppendDecimal(uint64_t value, char separator)
+{
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    m_buffer.append(digits, result.ptr);
+    m_buffer.push_back(separator);
+}
+
+void
+P4TelemetryWriter::Write(uint64_t timeNs,
+                         uint32_t switchIndex,
+                         uint32_t metric,
+                         uint32_t cell,
+                         uint64_t value,
+                         uint64_t value2)
+{
+    if (!m_file.is_open())
+    {
+        return;
+    }
+    if (m_format == CSV)
+    {
+        AppendDecimal(timeNs, ',');
+        AppendDecimal(switchIndex, ',');
+        if (metric < m_metrics.size())
+        {
+            m_buffer.append(m_metrics[metric]);
+            m_buffer.push_back(',');
+        }
+        else
+        {
+            AppendDecimal(metric, ',');
+        }
+        AppendDecimal(cell, ',');
+        AppendDecimal(value, ',');
+        AppendDecimal(value2, '\n');
+    }
+    else
+    {
+        AppendLe(timeNs, 8);
+        AppendLe(switchIndex, 4);
+        AppendLe(metric, 4);
+        AppendLe(cell, 4);
+        AppendLe(value, 8);
+        AppendLe(value2, 8);
+    }
+    m_rows++;
+    if (m_buffer.size() >= m_bufferSize)
+    {
+        Flush();
+    }
+}
+
+void
+P4TelemetryWriter::Flush()
+{
+    if (m_file.is_open() && !m_buffer.empty())
+    {
+        m_file.write(m_buffer.data(), m_buffer.size());
+        m_file.flush();
+    }
+    m_buffer.clear();
+}
+
+void
+P4TelemetryWriter::Close()
+{
+    if (!m_file.is_open())
+    {
+        return;
+    }
+    Flush();
+    m_file.close();
+}
+
+} // namespace ns3
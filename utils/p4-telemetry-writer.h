@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+
+#ifndef P4_TELEMETRY_WRITER_H
+#define P4_TELEMETRY_WRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * @brief Buffered writer of telemetry samples, as CSV or compact binary rows.
+ *
+ * A row is one cell of one metric on one switch: the time in nanoseconds, the
+ * switch index, the metric ID, the cell (register or counter index, entry
+ * handle or port) and two values (the value and 0, or bytes and packets).
+ * Rows are formatted into a memory buffer, which goes to the file when it
+ * holds BufferSize bytes and on Flush or Close.
+ *
+ * CSV starts with the line "time_ns,switch,metric,cell,value,value2" and
+ * prints the metric by name. The binary format starts with the magic "P4TL",
+ * the version (1) and the metric names, each prefixed with its length, and
+ * has fixed 36-byte rows: time (u64), switch (u32), metric (u32), cell (u32),
+ * value (u64) and value2 (u64). All numbers are little-endian.
+ */
+class P4TelemetryWriter
+{
+  public:
+    /**
+     * @brief Output format
+     */
+    enum Format
+    {
+        CSV,
+        BINARY
+    };
+
+    P4TelemetryWriter();
+    ~P4TelemetryWriter();
+
+    P4TelemetryWriter(const P4TelemetryWriter&) = delete;
+    P4TelemetryWriter& operator=(const P4TelemetryWriter&) = delete;
+
+    /**
+     * @brief Create the file and write the header
+     * @param path the file, truncated if it exists
+     * @param format the format
+     * @param metrics names of the metrics, by ID
+     * @param bufferSize bytes collected before a write to the file
+     * @return false if the file cannot be created
+     */
+    bool Open(const std::string& path,
+              Format format,
+              const std::vector<std::string>& metrics,
+              size_t bufferSize = 1 << 16);
+
+    /**
+     * @brief Check whether a file is open
+     * @return true between Open and Close
+     */
+    bool IsOpen() const
+    {
+        return m_file.is_open();
+    }
+
+    /**
+     * @brief Append a row
+     * @param timeNs the sample time in nanoseconds
+     * @param switchIndex the switch
+     * @param metric the metric ID
+     * @param cell the cell
+     * @param value the value
+     * @param value2 the second value
+     */
+    void Write(uint64_t timeNs,
+               uint32_t switchIndex,
+               uint32_t metric,
+               uint32_t cell,
+               uint64_t value,
+               uint64_t value2);
+
+    /**
+     * @brief Write the buffered rows to the file
+     */
+    void Flush();
+
+    /**
+     * @brief Flush and close the file
+     */
+    void Close();
+
+    /**
+     * @brief Get the number of rows written since Open
+     * @return the rows
+     */
+    uint64_t GetRows() const
+    {
+        return m_rows;
+    }
+
+  private:
+    /**
+     * @brief Append a little-endian unsigned value to the buffer
+     * @param value the value
+     * @param bytes the width in bytes
+     */
+    void AppendLe(uint64_t value, size_t bytes);
+
+    /**
+     * @brief Append a decimal number and a separator to the buffer
+     * @param value the number
+     * @param separator the separator
+     */
+    void AppendDecimal(uint64_t value, char separator);
+
+    std::ofstream m_file;               //!< The output file
+    Format m_format;                    //!< Format of the file
+    std::vector<std::string> m_metrics; //!< Metric names, for CSV
+    size_t m_bufferSize;                //!< Flush threshold
+    std::string m_buffer;               //!< Rows not written yet
+    uint64_t m_rows;                    //!< Rows written since Open
+};
+
+} // namespace ns3
+
+#endif /* P4_TELEMETRY_WRITER_H */
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#include "ns3/p4-timing-wheel.h"
+
+#include "ns3/abort.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+P4TimingWheel::P4TimingWheel(uint32_t slotBits, uint32_t levels)
+    : m_slotBits(slotBits),
+      m_levels(levels),
+      m_mask((uint64_t(1) << slotBits) - 1),
+      m_current(0),
+      m_slots(levels, std::vector<std::vector<Timer>>(uint64_t(1) << slotBits)),
+      m_levelSize(levels + 1, 0)
+{
+    NS_ABORT_MSG_IF(slotBits == 0 || levels == 0 || slotBits * levels > 48,
+                    "P4TimingWheel: unsupported geometry " << slotBits << " x " << levels);
+}
+
+std::vector<P4TimingWheel::Timer>&
+P4TimingWheel::GetSlot(uint32_t level, uint32_t slot)
+{
+    return level == m_levels ? m_overflow : m_slots[level][slot];
+}
+
+void
+P4TimingWheel::Place(const Timer& timer)
+{
+    uint32_t level = 0;
+    uint32_t slot = 0;
+    for (level = 0; level < m_levels; level++)
+    {
+        uint32_t shift = m_slotBits * (level + 1);
+        if ((timer.expiry >> shift) == (m_current >> shift))
+        {
+            slot = (timer.expiry >> (m_slotBits * level)) & m_mask;
+            break;
+        }
+    }
+    std::vector<Timer>& timers = GetSlot(level, slot);
+    m_index[timer.key] = {level, slot, static_cast<uint32_t>(timers.size())};
+    timers.push_back(timer);
+    m_levelSize[level]++;
+}
+
+std::vector<P4TimingWheel::Timer>
+P4TimingWheel::Take(uint32_t level, uint32_t slot)
+{
+    std::vector<Timer> timers;
+    timers.swap(GetSlot(level, slot));
+    m_levelSize[level] -= timers.size();
+    for (const Timer& timer : timers)
+    {
+        m_index.erase(timer.key);
+    }
+    return timers;
+}
+
+void
+P4TimingWheel::Insert(uint64_t key, uint64_t expiry)
+{
+    Remove(key);
+    Place({key, std::max(expiry, m_current + 1)});
+}
+
+bool
+P4TimingWheel::Remove(uint64_t key)
+{
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+    {
+        return false;
+    }
+    Location location = it->second;
+    m_index.erase(it);
+
+    std::vector<Timer>& timers = GetSlot(location.level, location.slot);
+    if (location.pos + 1 != timers.size())
+    {
+        timers[location.pos] = timers.back();
+        m_index[timers[location.pos].key].pos = location.pos;
+    }
+    timers.pop_back();
+    m_levelSize[location.level]--;
+    return true;
+}
+
+bool
+P4TimingWheel::Contains(uint64_t key) const
+{
+    return m_index.count(key) != 0;
+}
+
+bool
+P4TimingWheel::GetNextExpiry(uint64_t* tick) const
+{
+    // a lower level always expires first, and within a level the slots ahead
+    // of the current one are in expiry order
+    for (uint32_t level = 0; level < m_levels; level++)
+    {
+        if (m_levelSize[level] == 0)
+        {
+            continue;
+        }
+        uint64_t current = (m_current >> (m_slotBits * level)) & m_mask;
+        for (uint64_t slot = current; slot <= m_mask; slot++)
+        {
+            const std::vector<Timer>& timers = m_slots[level][slot];
+            if (timers.empty())
+            {
+                continue;
+            }
+            *tick = timers.front().expiry;
+            for (const Timer& timer : timers)
+            {
+                *tick = std::min(*tick, timer.expiry);
+            }
+            return true;
+        }
+    }
+    if (m_overflow.empty())
+    {
+        return false;
+    }
+    *tick = m_overflow.front().expiry;
+    for (const Timer& timer : m_overflow)
+    {
+        *tick = std::min(*tick, timer.expiry);
+    }
+    return true;
+}
+
+void
+P4TimingWheel::Advance(uint64_t now, std::vector<uint64_t>* expired)
+{
+    while (m_current < now)
+    {
+        uint64_t next = m_current + 1;
+        if (m_levelSize[0] == 0)
+        {
+            // nothing expires before the lowest occupied level cascades
+            uint32_t level = 1;
+            while (level <= m_levels && m_levelSize[level] == 0)
+            {
+                level++;
+            }
+            if (level > m_levels)
+            {
+                m_current = now;
+                break;
+            }
+            uint32_t shift = m_slotBits * level;
+            uint64_t cascade = ((m_current >> shift) + 1) << shift;
+            if (cascade > now)
+            {
+                m_current = now;
+                break;
+            }
+            next = cascade;
+        }
+        m_current = next;
+
+        // cascade from the top, a timer may move down several levels at once
+        if ((next & ((uint64_t(1) << (m_slotBits * m_levels)) - 1)) == 0)
+        {
+            for (const Timer& timer : Take(m_levels, 0))
+            {
+                Place(timer);
+            }
+        }
+        for (uint32_t level = m_levels - 1; level > 0; level--)
+        {
+            uint32_t shift = m_slotBits * level;
+            if ((next & ((uint64_t(1) << shift) - 1)) == 0)
+            {
+                for (const Timer& timer : Take(level, (next >> shift) & m_mask))
+                {
+                    Place(timer);
+                }
+            }
+        }
+
+        for (const Timer& timer : Take(0, next & m_mask))
+        {
+            expired->push_back(timer.key);
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2025 TU Dresden
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Mingyu Ma <mingyu.ma@tu-dresden.de>
+ */
+
+#ifndef P4_TIMING_WHEEL_H
+#define P4_TIMING_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * @brief Hierarchical timing wheel of keyed timers, in integer ticks.
+ *
+ * Level l has 2^slotBits slots of 2^(l * slotBits) ticks each. A timer sits on
+ * the lowest level whose current rotation contains its expiry, and moves one
+ * level down each time the wheel reaches its slot. Timers beyond the top level
+ * wait in an overflow list. Insert and Remove cost constant time; Advance costs
+ * the expired and cascaded timers plus at most one step per level, however far
+ * the wheel moves, so long idle stretches are skipped in one call.
+ *
+ * The wheel does not keep time itself: the owner calls Advance with the current
+ * tick, typically at the tick returned by GetNextExpiry.
+ */
+class P4TimingWheel
+{
+  public:
+    /**
+     * @brief Create an empty wheel at tick 0
+     * @param slotBits log2 of the slots per level
+     * @param levels number of levels, slotBits * levels at most 48
+     */
+    P4TimingWheel(uint32_t slotBits = 8, uint32_t levels = 4);
+
+    /**
+     * @brief Start or restart the timer of a key
+     * @param key the key
+     * @param expiry tick at which the timer expires, a past tick expires on the
+     * next tick
+     */
+    void Insert(uint64_t key, uint64_t expiry);
+
+    /**
+     * @brief Stop the timer of a key
+     * @param key the key
+     * @return true if the key had a running timer
+     */
+    bool Remove(uint64_t key);
+
+    /**
+     * @brief Check whether a key has a running timer
+     * @param key the key
+     * @return true if it has one
+     */
+    bool Contains(uint64_t key) const;
+
+    /**
+     * @brief Get the number of running timers
+     * @return the number of timers
+     */
+    size_t GetSize() const
+    {
+        return m_index.size();
+    }
+
+    /**
+     * @brief Get the last tick the wheel was advanced to
+     * @return the tick
+     */
+    uint64_t GetCurrent() const
+    {
+        return m_current;
+    }
+
+    /**
+     * @brief Get the earliest expiry of the running timers
+     * @param tick the expiry
+     * @return false if no timer is running
+     */
+    bool GetNextExpiry(uint64_t* tick) const;
+
+    /**
+     * @brief Move the wheel forward and collect the expired timers
+     * @param now the current tick, nothing happens if it is not ahead
+     * @param expired the keys of the expired timers are appended, in expiry order
+     */
+    void Advance(uint64_t now, std::vector<uint64_t>* expired);
+
+  private:
+    /**
+     * @brief A running timer
+     */
+    struct Timer
+    {
+        uint64_t key;    //!< Key of the timer
+        uint64_t expiry; //!< Expiry tick
+    };
+
+    /**
+     * @brief Position of a timer
+     */
+    struct Location
+    {
+        uint32_t level; //!< Level, m_levels for the overflow list
+        uint32_t slot;  //!< Slot in the level
+        uint32_t pos;   //!< Position in the slot
+    };
+
+    /**
+     * @brief Put a timer on the wheel relative to the current tick
+     * @param timer the timer
+     */
+    void Place(const Timer& timer);
+
+    /**
+     * @brief Take all timers out of a slot
+     * @param level the level, m_levels for the overflow list
+     * @param slot the slot
+     * @return the timers
+     */
+    std::vector<Timer> Take(uint32_t level, uint32_t slot);
+
+    /**
+     * @brief Get a slot
+     * @param level the level, m_levels for the overflow list
+     * @param slot the slot
+     * @return the slot
+     */
+    std::vector<Timer>& GetSlot(uint32_t level, uint32_t slot);
+
+    uint32_t m_slotBits; //!< log2 of the slots per level
+    uint32_t m_levels;   //!< Number of levels
+    uint64_t m_mask;     //!< Slot index mask
+    uint64_t m_current;  //!< Last tick processed
+    std::vector<std::vector<std::vector<Timer>>> m_slots; //!< Timers by level and slot
+    std::vector<Timer> m_overflow;                        //!< Timers beyond the top level
+    std::vector<size_t> m_levelSize; //!< Timers per level, the overflow list last
+    std::unordered_map<uint64_t, Location> m_index; //!< Position of every timer
+};
+
+} // namespace ns3
+
+#endif /* P4_TIMING_WHEEL_H */
@@ -18,6 +18,8 @@
  *
  */
 
+#include "ns3/p4-switch-core.h"
+
 #include <bm/bm_sim/actions.h>
 #include <bm/bm_sim/calculations.h>
 #include <bm/bm_sim/core/primitives.h>
@@ -325,6 +327,13 @@ class execute_meter : public ActionPrimitive<MeterArray&, const Data&, Field&>
 {
     void operator()(MeterArray& meter_array, const Data& idx, Field& dst)
     {
+        // meter on the simulator clock of the switch running this pass
+        ns3::P4SwitchCore* core = ns3::P4SwitchCore::GetLatchedCore();
+        if (core)
+        {
+            dst.set(core->ExecuteMeter(meter_array, idx.get_uint(), get_packet()));
+            return;
+        }
         dst.set(meter_array.execute_meter(get_packet(), idx.get_uint()));
     }
 };
@@ -103,7 +103,8 @@ class RegisterAccess
     // Bits [31:16] — ns-3 protocol number (e.g. 0x0800 for IPv4)
     // Bits [47:32] — ns-3 destination address index (lookup into
     //                P4SwitchNetDevice's address table; max 65535 entries)
-    // Bits [63:48] — currently unused / reserved
+    // Bit  [48]    — the packet holds a reference on its address index
+    // Bits [63:49] — currently unused / reserved
 
     static constexpr int RECIRCULATE_FLAG_REG_IDX = 2;
     static constexpr uint64_t RECIRCULATE_FLAG_MASK = 0x000000000000ffff;
@@ -124,6 +125,11 @@ class RegisterAccess
     static constexpr uint64_t NS_ADDRESS_MASK = 0x0000ffff00000000;
     static constexpr uint64_t NS_ADDRESS_SHIFT = 32;
 
+    /// Set in register 2, bit 48, while the packet holds a reference on its
+    /// address index. Copies made with clear_all() do not hold one.
+    static constexpr int NS_ADDRESS_HELD_REG_IDX = 2;
+    static constexpr uint64_t NS_ADDRESS_HELD_MASK = 0x0001000000000000;
+
     // ── Mirror session helpers ─────────────────────────────────────────
     static constexpr uint16_t MAX_MIRROR_SESSION_ID = (1u << 15) - 1;
     static constexpr uint16_t MIRROR_SESSION_ID_VALID_MASK = (1u << 15);
@@ -245,10 +251,11 @@ class RegisterAccess
     //
     // ns-3 destination addresses (ns3::Address) cannot be stored directly
     // in a 16-bit register field.  Instead, the switch maintains a lookup
-    // table (m_destinationList) that maps a uint16_t index to the actual
+    // table (m_addressTable) that maps a uint16_t index to the actual
     // ns3::Address.  We store the index here and resolve it back to an
-    // address after the P4 pipeline finishes.  This supports up to 65535
-    // distinct destination addresses per switch.
+    // address after the P4 pipeline finishes.  The table holds up to 65536
+    // destination addresses at once and reuses the index of the least
+    // recently used one when it is full.
 
     /// Retrieve the saved ns-3 destination address index.
     static uint16_t get_ns_address(bm::Packet* pkt)
@@ -257,13 +264,27 @@ class RegisterAccess
         return static_cast<uint16_t>((rv & NS_ADDRESS_MASK) >> NS_ADDRESS_SHIFT);
     }
 
-    /// Save the ns-3 destination address index into the BMv2 packet register.
+    /// Save the ns-3 destination address index into the BMv2 packet register,
+    /// marking the packet as holding a reference on it.
     static void set_ns_address(bm::Packet* pkt, uint16_t addr_index)
     {
         uint64_t rv = pkt->get_register(NS_ADDRESS_REG_IDX);
         rv = ((rv & ~NS_ADDRESS_MASK) |
               ((static_cast<uint64_t>(addr_index)) << NS_ADDRESS_SHIFT));
-        pkt->set_register(NS_ADDRESS_REG_IDX, rv);
+        pkt->set_register(NS_ADDRESS_REG_IDX, rv | NS_ADDRESS_HELD_MASK);
+    }
+
+    /// Whether the packet holds a reference on its address index.
+    static bool get_ns_address_held(bm::Packet* pkt)
+    {
+        return (pkt->get_register(NS_ADDRESS_HELD_REG_IDX) & NS_ADDRESS_HELD_MASK) != 0;
+    }
+
+    /// Mark the reference on the address index as given up.
+    static void clear_ns_address_held(bm::Packet* pkt)
+    {
+        uint64_t rv = pkt->get_register(NS_ADDRESS_HELD_REG_IDX);
+        pkt->set_register(NS_ADDRESS_HELD_REG_IDX, rv & ~NS_ADDRESS_HELD_MASK);
     }
 };
 